@@ -74,11 +74,14 @@ public:
               size_t   a_rd_bufsz = 0);
 
   /// Add a file handler.
+  /// With \a a_queue_depth > 1 or \a a_direct the file is read ahead by up to
+  /// \a a_queue_depth concurrent reads of \a a_rd_bufsz bytes, which are passed
+  /// to \a a_on_read in file order (see AIOReader::Init()).
   FdInfo& AddFile(
       std::string const& a_name, std::string const& a_filename, FileHandler const& a_on_read,
       ErrHandler const& a_on_error, void* a_instance = nullptr, void* a_opaque = nullptr,
       size_t a_rd_bufsz = 5242880, ReadSizeEstim a_read_at_least = nullptr,
-      TriggerT a_trigger = LEVEL_TRIGGERED);
+      TriggerT a_trigger = LEVEL_TRIGGERED, int a_queue_depth = 1, bool a_direct = false);
 
   /// Add a pipe (popen) handler.
   FdInfo& AddPipe(
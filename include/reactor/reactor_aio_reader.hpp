@@ -11,6 +11,8 @@
 
 #include <reactor/reactor_platform.hpp>
 #include <string>
+#include <utility>
+#include <vector>
 
 #if defined(REACTOR_OS_LINUX)
 #include <libaio.h>
@@ -23,6 +25,14 @@ namespace utxx {
 ///
 /// On Linux: uses eventfd(2) + libaio for async completion notifications.
 /// On macOS/BSD: not supported — AIOReader always throws on Init().
+///
+/// The reader works in one of two modes:
+/// - single read: AsyncRead() schedules one read into the caller's buffer,
+///   and ReadEvents() reports its completion;
+/// - read-ahead queue (see Init() with a queue depth): up to Depth() reads of
+///   ChunkSize() bytes are kept in flight in the reader's pool of aligned
+///   buffers, and Reap() collects their completions, which are delivered in
+///   file order by Front()/Pop().
 //------------------------------------------------------------------------------
 class AIOReader {
 public:
@@ -33,6 +43,13 @@ public:
 
   /// Post-construction initialization
   void                         Init(int a_efd, const char* a_filename);
+  /// Initialization of the read-ahead queue mode.
+  /// @param a_depth    max number of reads in flight
+  /// @param a_chunk    size of each read (rounded up to the I/O alignment)
+  /// @param a_direct   open the file with O_DIRECT bypassing the page cache
+  ///                   (buffered reads are used if the file system doesn't
+  ///                   support it, see Direct())
+  void Init(int a_efd, const char* a_filename, int a_depth, size_t a_chunk, bool a_direct = false);
   void                         Clear();
 
   /// Schedule an asynchronous read
@@ -44,6 +61,24 @@ public:
   /// Read completion notification events; returns (bytes_read, err_msg)
   std::pair<long, const char*> ReadEvents(int a_events);
 
+  /// Submit reads of the next chunks of the file into free buffers of the
+  /// read-ahead queue.
+  /// @return number of submitted reads, or -1 on error (errno is set)
+  int                          Submit();
+
+  /// Collect up to \a a_events completions of reads issued by Submit().
+  /// @return number of completed reads, or -1 on error (errno is set)
+  int                          Reap(int a_events);
+
+  /// The next chunk of the file in the read-ahead queue as (data, size).
+  /// Returns (nullptr, 0) if the chunk hasn't been read yet, and a negative
+  /// size (-errno) if its read failed.
+  std::pair<const char*, long> Front() const;
+
+  /// Release the chunk returned by Front() so that its buffer can be reused
+  /// by the next Submit()
+  void                         Pop();
+
   // clang-format off
   long               Offset()    const { return m_offset;               }
   long               Position()  const { return m_position;             }
@@ -51,8 +86,20 @@ public:
   long               Remaining() const { return m_file_size - m_offset; }
   int                EventFD()   const { return m_efd;                  }
   const std::string& Filename()  const { return m_filename;             }
+
+  /// True when reading in the read-ahead queue mode
+  bool               Queued()    const { return m_depth > 0;            }
+  /// Max number of reads in flight in the read-ahead queue mode
+  int                Depth()     const { return m_depth;                }
+  /// Size of each read in the read-ahead queue mode
+  size_t             ChunkSize() const { return m_chunk;                }
+  /// True if the file is read with O_DIRECT
+  bool               Direct()    const { return m_direct;               }
   // clang-format on
 
+  /// Alignment of buffers, offsets and sizes of O_DIRECT reads
+  static constexpr size_t s_align = 4096;
+
 private:
   int         m_efd     = -1;
   int         m_file_fd = -1;
@@ -61,10 +108,37 @@ private:
   long        m_position  = 0;
   long        m_offset    = 0;
   long        m_file_size = 0;
+
+  /// Buffer of the read-ahead queue
+  struct Chunk {
+    char* data   = nullptr;
+    long  offset = 0;     ///< File offset of the chunk
+    long  size   = 0;     ///< Number of bytes to read
+    long  got    = 0;     ///< Number of bytes read (-errno on error)
+    bool  done   = false; ///< Read completed
+  };
+
+  int                m_depth  = 0;      ///< Queue depth (0 - single read mode)
+  size_t             m_chunk  = 0;
+  bool               m_direct = false;
+  char*              m_pool   = nullptr;   ///< Aligned buffers of all chunks
+  std::vector<Chunk> m_chunks;
+  int                m_head   = 0;      ///< Next chunk to deliver
+  int                m_tail   = 0;      ///< Next chunk to submit
+  int                m_busy   = 0;      ///< Chunks submitted and not popped
+  long               m_submit_offset = 0; ///< File offset of the next read
+
 #if defined(REACTOR_OS_LINUX)
-  io_context_t m_ctx = nullptr;
-  struct iocb  m_iocb[1];
-  struct iocb* m_piocb[1];
+  io_context_t       m_ctx = nullptr;
+  struct iocb        m_iocb[1];
+  struct iocb*       m_piocb[1];
+  std::vector<iocb>  m_chunk_iocb;
+  std::vector<iocb*> m_chunk_piocb;
+  std::vector<io_event> m_events;
+
+  void Open(int a_efd, const char* a_filename, bool a_direct, int a_max_events);
+  /// Prepare a read of the unread part of chunk \a a_idx
+  iocb* PrepChunk(int a_idx);
 #endif
 };
 
@@ -14,6 +14,9 @@
 #include <reactor/compat.hpp>
 #include <reactor/reactor_aio_reader.hpp>
 #include <reactor/reactor_platform.hpp>
+#include <algorithm>
+#include <stdint.h>
+#include <stdlib.h>
 #include <utility>
 
 #if defined(REACTOR_OS_LINUX)
@@ -45,21 +48,29 @@ inline void AIOReader::Clear()
     m_file_fd = -1;
   }
 #if defined(REACTOR_OS_LINUX)
+  // Waits for completion of reads in flight, so the buffers can be freed
   if (m_ctx) {
     ::io_destroy(m_ctx);
     m_ctx = nullptr;
   }
 #endif
+  if (m_pool) {
+    ::free(m_pool);
+    m_pool = nullptr;
+  }
+  m_chunks.clear();
+  m_depth         = 0;
+  m_direct        = false;
+  m_head          = 0;
+  m_tail          = 0;
+  m_busy          = 0;
+  m_submit_offset = 0;
 }
 
+#if defined(REACTOR_OS_LINUX)
 //------------------------------------------------------------------------------
-inline void AIOReader::Init(int a_efd, const char* a_filename)
+inline void AIOReader::Open(int a_efd, const char* a_filename, bool a_direct, int a_max_events)
 {
-#if !defined(REACTOR_OS_LINUX)
-  (void)a_efd;
-  (void)a_filename;
-  throw utxx::io_error(REACTOR_SRC, ENOSYS, "AIOReader: not supported on this platform");
-#else
   Clear();
   m_efd       = a_efd;
   m_filename  = a_filename;
@@ -70,7 +81,11 @@ inline void AIOReader::Init(int a_efd, const char* a_filename)
   if (a_efd < 0) throw utxx::io_error(REACTOR_SRC, errno, "invalid eventfd descriptor");
 
   int flags = O_RDONLY | O_NONBLOCK | O_LARGEFILE;
-  m_file_fd = ::open(a_filename, flags);
+  m_file_fd = a_direct ? ::open(a_filename, flags | O_DIRECT) : -1;
+  m_direct  = m_file_fd >= 0;
+
+  // Some file systems (e.g. older tmpfs) don't support O_DIRECT
+  if (m_file_fd < 0) m_file_fd = ::open(a_filename, flags);
 
   if (m_file_fd < 0)
     throw utxx::io_error(
@@ -81,7 +96,7 @@ inline void AIOReader::Init(int a_efd, const char* a_filename)
   m_file_size = utxx::path::file_size(m_file_fd);
   m_ctx       = nullptr;
 
-  if (io_setup(128, &m_ctx) < 0)
+  if (io_setup(a_max_events, &m_ctx) < 0)
     throw utxx::io_error(
         REACTOR_SRC, errno,
         utxx::detail::concat("failed to do AIO setup on file '", a_filename, "'"));
@@ -89,6 +104,57 @@ inline void AIOReader::Init(int a_efd, const char* a_filename)
   m_piocb[0] = &m_iocb[0];
 
   guard.disable();
+}
+#endif
+
+//------------------------------------------------------------------------------
+inline void AIOReader::Init(int a_efd, const char* a_filename)
+{
+#if !defined(REACTOR_OS_LINUX)
+  (void)a_efd;
+  (void)a_filename;
+  throw utxx::io_error(REACTOR_SRC, ENOSYS, "AIOReader: not supported on this platform");
+#else
+  Open(a_efd, a_filename, false, 128);
+#endif
+}
+
+//------------------------------------------------------------------------------
+inline void AIOReader::Init(
+    int a_efd, const char* a_filename, int a_depth, size_t a_chunk, bool a_direct)
+{
+#if !defined(REACTOR_OS_LINUX)
+  (void)a_efd;
+  (void)a_filename;
+  (void)a_depth;
+  (void)a_chunk;
+  (void)a_direct;
+  throw utxx::io_error(REACTOR_SRC, ENOSYS, "AIOReader: not supported on this platform");
+#else
+  if (a_depth <= 0 || a_chunk == 0)
+    throw utxx::io_error(
+        REACTOR_SRC, EINVAL,
+        utxx::detail::concat("invalid AIO queue depth=", a_depth, " or chunk size=", a_chunk));
+
+  Open(a_efd, a_filename, a_direct, std::max(a_depth, 128));
+
+  m_depth = a_depth;
+  m_chunk = (a_chunk + s_align - 1) & ~(s_align - 1);
+
+  void* pool;
+  if (::posix_memalign(&pool, s_align, m_chunk * m_depth) != 0) {
+    Clear();
+    throw utxx::io_error(
+        REACTOR_SRC, ENOMEM, utxx::detail::concat("cannot allocate AIO buffers of ", a_filename));
+  }
+  m_pool = static_cast<char*>(pool);
+
+  m_chunks.assign(m_depth, Chunk());
+  m_chunk_iocb.resize(m_depth);
+  m_chunk_piocb.resize(m_depth);
+  m_events.resize(m_depth);
+
+  for (int i = 0; i < m_depth; i++) m_chunks[i].data = m_pool + i * m_chunk;
 #endif
 }
 
@@ -174,4 +240,149 @@ inline std::pair<long, const char*> AIOReader::ReadEvents(int a_events)
 #endif
 }
 
+#if defined(REACTOR_OS_LINUX)
+//------------------------------------------------------------------------------
+inline iocb* AIOReader::PrepChunk(int a_idx)
+{
+  auto& c    = m_chunks[a_idx];
+  auto  cb   = &m_chunk_iocb[a_idx];
+  long  left = c.size - c.got;
+
+  // O_DIRECT requires the size of the last read of the file to be aligned too
+  if (m_direct) left = (left + s_align - 1) & ~(s_align - 1);
+
+  ::io_prep_pread(cb, m_file_fd, c.data + c.got, left, c.offset + c.got);
+  ::io_set_eventfd(cb, m_efd);
+  cb->data = (void*)(uintptr_t)a_idx;
+  return cb;
+}
+#endif
+
+//------------------------------------------------------------------------------
+inline int AIOReader::Submit()
+{
+#if !defined(REACTOR_OS_LINUX)
+  errno = ENOSYS;
+  return -1;
+#else
+  assert(Queued());
+
+  int n    = 0;
+  int tail = m_tail;
+
+  for (; m_busy + n < m_depth && m_submit_offset < m_file_size; n++) {
+    auto& c          = m_chunks[tail];
+    c.offset         = m_submit_offset;
+    c.size           = std::min<long>(m_chunk, m_file_size - m_submit_offset);
+    c.got            = 0;
+    c.done           = false;
+    m_chunk_piocb[n] = PrepChunk(tail);
+    m_submit_offset += c.size;
+    tail             = (tail + 1) % m_depth;
+  }
+
+  if (n == 0) return 0;
+
+  int  rc  = io_submit(m_ctx, n, m_chunk_piocb.data());
+  bool err = rc < 0;
+
+  if (UNLIKELY(err)) {
+    errno = -rc;
+    rc    = 0;
+  }
+
+  // The reads that weren't submitted will be retried by the next call
+  for (int i = rc; i < n; i++) m_submit_offset -= m_chunks[(m_tail + i) % m_depth].size;
+
+  m_tail       = (m_tail + rc) % m_depth;
+  m_busy      += rc;
+  m_async_ops += rc;
+
+  // Running out of AIO resources is not an error while some reads are in
+  // flight, as their completion will trigger another Submit()
+  return err && (errno != EAGAIN || m_busy == 0) ? -1 : rc;
+#endif
+}
+
+//------------------------------------------------------------------------------
+inline int AIOReader::Reap(int a_events)
+{
+#if !defined(REACTOR_OS_LINUX)
+  (void)a_events;
+  errno = ENOSYS;
+  return -1;
+#else
+  assert(Queued());
+
+  static struct timespec tmo = {.tv_sec = 0, .tv_nsec = 0};
+  int                    n;
+
+  do {
+    n = ::io_getevents_ex(m_ctx, 0, std::min(a_events, m_depth), m_events.data(), &tmo);
+  } while (UNLIKELY(n == -EINTR));
+
+  if (UNLIKELY(n < 0)) {
+    errno = -n;
+    return -1;
+  }
+
+  int done = 0;
+
+  for (int i = 0; i < n; i++) {
+    auto  idx = int(uintptr_t(m_events[i].data));
+    auto& c   = m_chunks[idx];
+    long  res = long(m_events[i].res);
+
+    m_async_ops--;
+
+    if (UNLIKELY(res < 0)) {
+      c.got = res;
+    } else {
+      c.got = std::min(c.got + res, c.size);
+
+      // The file was truncated while being read
+      if (UNLIKELY(res == 0 && c.got < c.size)) c.got = -ENODATA;
+
+      // Short buffered read before the end of the chunk: read the rest
+      else if (UNLIKELY(res > 0 && c.got < c.size)) {
+        auto cb = PrepChunk(idx);
+        int  rc = io_submit(m_ctx, 1, &cb);
+        if (LIKELY(rc == 1)) {
+          m_async_ops++;
+          continue;
+        }
+        c.got = rc < 0 ? rc : -EAGAIN;
+      }
+    }
+
+    c.done = true;
+    done++;
+  }
+
+  return done;
+#endif
+}
+
+//------------------------------------------------------------------------------
+inline std::pair<const char*, long> AIOReader::Front() const
+{
+  if (m_busy == 0) return {nullptr, 0};
+
+  auto& c = m_chunks[m_head];
+  return c.done ? std::pair<const char*, long>(c.data, c.got) : std::pair<const char*, long>();
+}
+
+//------------------------------------------------------------------------------
+inline void AIOReader::Pop()
+{
+  assert(m_busy > 0 && m_chunks[m_head].done);
+
+  auto& c    = m_chunks[m_head];
+  m_position = c.offset;
+  m_offset   = c.offset + std::max(0L, c.got);
+  c.done     = false;
+  m_head     = (m_head + 1) % m_depth;
+  m_busy--;
+}
+
 } // namespace utxx
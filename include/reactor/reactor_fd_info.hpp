@@ -161,6 +161,7 @@ private:
   long HandleRawIO(uint32_t a_events);
   long HandlePipe (uint32_t a_events);
   long HandleFile (uint32_t a_events);
+  long HandleFileQueue(long a_events);
   long HandleEvent(uint32_t a_events, bool);
   long HandleTimer(uint32_t a_events);
   long HandleSignal(uint32_t a_events);
@@ -222,6 +222,8 @@ inline long FdInfo::HandleFile(uint32_t a_events)
   auto file = m_file_reader.get();
   assert(file);
 
+  if (file->Queued()) return HandleFileQueue(rc);
+
   const char* err;
   long        size;
   std::tie(size, err) = file->ReadEvents(rc);
@@ -296,6 +298,84 @@ inline long FdInfo::HandleFile(uint32_t a_events)
   return rc;
 }
 
+//------------------------------------------------------------------------------
+// Chunks read ahead by the file reader are appended to m_rd_buff in file
+// order, so that the file handler sees a contiguous stream, as in the
+// single read mode.
+//------------------------------------------------------------------------------
+inline long FdInfo::HandleFileQueue(long a_events)
+{
+  REACTOR_PRETTY_FUNCTION();
+
+  auto file = m_file_reader.get();
+
+  if (UNLIKELY(file->Reap(a_events) < 0))
+    return ReportError(IOType::Read, errno, "io_getevents()", REACTOR_SRCX);
+
+  long total = 0;
+
+  for (auto chunk = file->Front(); chunk.first; chunk = file->Front()) {
+    if (UNLIKELY(chunk.second < 0))
+      return ReportError(
+          IOType::Read, -chunk.second,
+          utxx::to_string(
+              "error reading file ", file->Filename(), " at pos=", file->Offset(), ": ",
+              strerror(-chunk.second)),
+          REACTOR_SRCX);
+
+    // Grow the buffer only if the chunk doesn't fit after the unread data
+    m_rd_buff->read_and_crunch(0);
+    if (m_rd_buff->capacity() < size_t(chunk.second))
+      m_rd_buff->reserve(m_rd_buff->size() + chunk.second);
+    memcpy(m_rd_buff->wr_ptr(), chunk.first, chunk.second);
+    m_rd_buff->commit(chunk.second);
+    total += chunk.second;
+    file->Pop();
+
+    // Keep the device busy while the chunk is being processed
+    if (UNLIKELY(file->Submit() < 0))
+      return ReportError(IOType::Read, errno, "error in AsyncRead", REACTOR_SRCX);
+
+    if (m_read_at_least) {
+      auto got  = m_rd_buff->size();
+      auto need = m_read_at_least(m_rd_buff->rd_ptr(), got);
+      if (UNLIKELY(need > 100 * 1024 * 1024)) {
+        auto e = utxx::to_string("suspicious read size = ", need);
+        return ReportError(IOType::Read, EMSGSIZE, e, REACTOR_SRCX);
+      }
+      if (need > got && file->Remaining()) continue;
+    }
+
+    try {
+      int cb_rc = m_handler.AsFile()(*this, *m_rd_buff);
+      if (UNLIKELY(cb_rc < 0))
+        return ReportError(
+            IOType::Read, 0,
+            utxx::to_string(
+                "error processing file data ", file->Filename(), " at pos=", file->Position(),
+                " of ", file->Size(), (errno ? ": " : ""), (errno ? strerror(errno) : "")),
+            REACTOR_SRCX);
+    } catch (utxx::runtime_error& e) {
+      return ReportError(IOType::UserCode, 0, e.str(), e.src());
+    } catch (std::exception& e) {
+      return ReportError(IOType::UserCode, 0, e.what(), REACTOR_SRCX);
+    }
+
+    // When m_fd < 0, it means that the file descriptor was closed by user
+    if (m_fd < 0) return total;
+  }
+
+  if (UNLIKELY(!file->Remaining())) {
+    UTXX_RLOG(this, DEBUG, "file read done (offset=", file->Offset(), ", size=", file->Size(), ')');
+
+    if (m_on_error) m_on_error(*this, IOType::EndOfFile, "end-of-file reached", REACTOR_SRCX);
+
+    Clear();
+  }
+
+  return total;
+}
+
 //------------------------------------------------------------------------------
 inline long FdInfo::HandleSignal(uint32_t a_events)
 {
@@ -0,0 +1,325 @@
+// vim:ts=4:et:sw=4
+//----------------------------------------------------------------------------
+/// \file   alloc_arena.hpp
+/// \author Serge Aleynikov
+//----------------------------------------------------------------------------
+/// \brief Monotonic (bump pointer) arena for scratch memory.
+///
+/// The monotonic_arena hands out memory by advancing a pointer in a block,
+/// and never frees individual allocations (except for the last one, which
+/// can be rolled back).  All memory is reclaimed at once in O(1) by reset(),
+/// which rewinds the arena to its first block, keeping the chained blocks
+/// for reuse, so that a cycle of per-message or per-request allocations
+/// followed by reset() doesn't touch the global heap once the arena has
+/// grown to the size of the cycle.  The first block may be supplied by the
+/// caller (e.g. a buffer on the stack).
+///
+/// The arena is a std::pmr::memory_resource, so it can be used with the
+/// std::pmr containers, and arena_allocator<T> adapts it to containers
+/// taking an allocator type, such as basic_short_vector, assoc_vector and
+/// basic_buffered_print:
+/// \code
+///     char buf[4096];
+///     memory::monotonic_arena arena(buf, sizeof(buf));
+///     std::pmr::vector<int>   v(&arena);
+///     basic_short_vector<int, 8, memory::arena_allocator<int>>
+///                             s(memory::arena_allocator<int>(arena));
+///     ...
+///     arena.reset();          // After v and s are destroyed
+/// \endcode
+//----------------------------------------------------------------------------
+// Created: 2026-10-16
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the utxx open-source project.
+
+Copyright (C) 2026 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+#pragma once
+
+#include <utxx/error.hpp>
+#include <utxx/compiler_hints.hpp>
+#include <boost/noncopyable.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <new>
+
+namespace utxx   {
+namespace memory {
+
+//-----------------------------------------------------------------------------
+/// Bump pointer arena with optional chained growth and O(1) reset
+//-----------------------------------------------------------------------------
+class monotonic_arena : public std::pmr::memory_resource
+                      , boost::noncopyable
+{
+public:
+    static constexpr size_t s_default_align = alignof(std::max_align_t);
+
+    /// Arena whose blocks are allocated from the upstream resource
+    /// @param a_block_size size of the first block (the following blocks
+    ///                     double in size)
+    /// @param a_growable   when false, allocations that don't fit in the
+    ///                     first block throw std::bad_alloc
+    explicit monotonic_arena(
+        size_t                     a_block_size = 4096,
+        bool                       a_growable   = true,
+        std::pmr::memory_resource* a_upstream   =
+            std::pmr::new_delete_resource());
+
+    /// Arena whose first block is the caller's buffer
+    /// @param a_growable when true, the arena grows by allocating blocks from
+    ///                   the upstream resource when the buffer is exhausted
+    monotonic_arena(
+        void*                      a_buf,
+        size_t                     a_size,
+        bool                       a_growable   = false,
+        std::pmr::memory_resource* a_upstream   =
+            std::pmr::new_delete_resource());
+
+    ~monotonic_arena() override {
+        release();
+        if (m_first->owned)
+            m_upstream->deallocate(m_first, m_first->size, alignof(block));
+    }
+
+    /// Allocate \a a_size bytes aligned at \a a_align (2^N)
+    void* allocate(size_t a_size, size_t a_align = s_default_align) {
+        auto p = align(m_pos, a_align);
+        if (likely(p + a_size <= m_end)) {
+            m_pos = p + a_size;
+            return p;
+        }
+        return allocate_slow(a_size, a_align);
+    }
+
+    /// Allocations aren't freed individually, except that the most recent
+    /// one is rolled back.
+    void deallocate(void* a_ptr, size_t a_size, size_t = s_default_align) {
+        if (static_cast<char*>(a_ptr) + a_size == m_pos)
+            m_pos = static_cast<char*>(a_ptr);
+    }
+
+    /// Free all allocations in O(1) keeping the blocks for reuse
+    void reset() {
+        m_cur = m_first;
+        m_pos = m_first->data();
+        m_end = m_first->end();
+    }
+
+    /// Free all allocations and return all but the first block to the
+    /// upstream resource
+    void release();
+
+    /// Bytes allocated since the last reset (including alignment padding)
+    size_t used()     const;
+    /// Total size of the blocks
+    size_t capacity() const;
+    /// Number of blocks
+    size_t blocks()   const;
+    /// True if the arena allocates blocks when the current one is exhausted
+    bool   growable() const { return m_growable; }
+
+    std::pmr::memory_resource* upstream() const { return m_upstream; }
+
+protected:
+    void* do_allocate(size_t a_size, size_t a_align) override {
+        return allocate(a_size, a_align);
+    }
+
+    void  do_deallocate(void* a_ptr, size_t a_size, size_t a_align) override {
+        deallocate(a_ptr, a_size, a_align);
+    }
+
+    bool  do_is_equal(const std::pmr::memory_resource& a) const
+        noexcept override { return this == &a; }
+
+private:
+    /// Header at the beginning of a block
+    struct alignas(s_default_align) block {
+        block* next;
+        size_t size;    // Including the header
+        bool   owned;   // Allocated from the upstream resource
+
+        char* data() { return reinterpret_cast<char*>(this + 1); }
+        char* end()  { return reinterpret_cast<char*>(this) + size; }
+    };
+
+    std::pmr::memory_resource* m_upstream;
+    bool                       m_growable;
+    size_t                     m_next_size; // Size of the next new block
+    block*                     m_first;
+    block*                     m_cur;
+    char*                      m_pos;
+    char*                      m_end;
+
+    static char* align(char* p, size_t a_align) {
+        auto n = reinterpret_cast<uintptr_t>(p);
+        return reinterpret_cast<char*>((n + a_align-1) & ~(a_align-1));
+    }
+
+    block* new_block(size_t a_size);
+    void*  allocate_slow(size_t a_size, size_t a_align);
+};
+
+//-----------------------------------------------------------------------------
+/// Allocator adapting the monotonic_arena to containers taking an allocator
+//-----------------------------------------------------------------------------
+template <class T>
+class arena_allocator {
+    template <class U> friend class arena_allocator;
+    monotonic_arena* m_arena;
+public:
+    using value_type = T;
+
+    template <class U>
+    struct rebind { using other = arena_allocator<U>; };
+
+    arena_allocator(monotonic_arena& a) noexcept : m_arena(&a) {}
+
+    template <class U>
+    arena_allocator(const arena_allocator<U>& a) noexcept
+        : m_arena(a.m_arena) {}
+
+    T* allocate(size_t n) {
+        return static_cast<T*>(m_arena->allocate(n * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T* p, size_t n) {
+        m_arena->deallocate(p, n * sizeof(T), alignof(T));
+    }
+
+    monotonic_arena& arena() const { return *m_arena; }
+
+    template <class U>
+    bool operator==(const arena_allocator<U>& a) const {
+        return m_arena == a.m_arena;
+    }
+    template <class U>
+    bool operator!=(const arena_allocator<U>& a) const {
+        return m_arena != a.m_arena;
+    }
+};
+
+//-----------------------------------------------------------------------------
+// IMPLEMENTATION
+//-----------------------------------------------------------------------------
+
+inline monotonic_arena::
+monotonic_arena(size_t a_block_size, bool a_growable,
+                std::pmr::memory_resource* a_upstream)
+    : m_upstream(a_upstream)
+    , m_growable(a_growable)
+    , m_next_size(std::max<size_t>(a_block_size, 2*sizeof(block)))
+{
+    m_first = new_block(m_next_size);
+    reset();
+}
+
+inline monotonic_arena::
+monotonic_arena(void* a_buf, size_t a_size, bool a_growable,
+                std::pmr::memory_resource* a_upstream)
+    : m_upstream(a_upstream)
+    , m_growable(a_growable)
+    , m_next_size(std::max<size_t>(a_size, 2*sizeof(block)))
+{
+    auto p = align(static_cast<char*>(a_buf), alignof(block));
+    if (!a_buf || p + sizeof(block) > static_cast<char*>(a_buf) + a_size)
+        UTXX_THROW_BADARG_ERROR("Arena buffer is too small: ", a_size);
+
+    m_first = new (p) block{nullptr,
+                            a_size - size_t(p - static_cast<char*>(a_buf)),
+                            false};
+    reset();
+}
+
+inline monotonic_arena::block* monotonic_arena::new_block(size_t a_size)
+{
+    auto p = m_upstream->allocate(a_size, alignof(block));
+    return new (p) block{nullptr, a_size, true};
+}
+
+inline void* monotonic_arena::allocate_slow(size_t a_size, size_t a_align)
+{
+    // Reuse the blocks retained by reset()
+    while (m_cur->next) {
+        m_cur = m_cur->next;
+        m_pos = m_cur->data();
+        m_end = m_cur->end();
+        auto p = align(m_pos, a_align);
+        if (p + a_size <= m_end) {
+            m_pos = p + a_size;
+            return p;
+        }
+    }
+
+    if (!m_growable)
+        throw std::bad_alloc();
+
+    m_next_size *= 2;
+    auto need    = sizeof(block) + a_size + a_align;
+    auto b       = new_block(std::max(m_next_size, need));
+    m_cur->next  = b;
+    m_cur        = b;
+    m_end        = b->end();
+    auto p       = align(b->data(), a_align);
+    m_pos        = p + a_size;
+    return p;
+}
+
+inline void monotonic_arena::release()
+{
+    for (block* b = m_first->next, *next; b; b = next) {
+        next = b->next;
+        m_upstream->deallocate(b, b->size, alignof(block));
+    }
+    m_first->next = nullptr;
+    m_next_size   = m_first->size;
+    reset();
+}
+
+inline size_t monotonic_arena::used() const
+{
+    size_t n = 0;
+    for (block* b = m_first; b != m_cur; b = b->next)
+        n += b->size - sizeof(block);
+    return n + size_t(m_pos - m_cur->data());
+}
+
+inline size_t monotonic_arena::capacity() const
+{
+    size_t n = 0;
+    for (block* b = m_first; b; b = b->next)
+        n += b->size - sizeof(block);
+    return n;
+}
+
+inline size_t monotonic_arena::blocks() const
+{
+    size_t n = 0;
+    for (block* b = m_first; b; b = b->next)
+        ++n;
+    return n;
+}
+
+} // namespace memory
+} // namespace utxx
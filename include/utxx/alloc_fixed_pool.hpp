@@ -4,6 +4,7 @@
 /// \brief This module implements a concurrent lock-free fixed size pool
 /// manager for objects allocated in the heap or shared memory.
 /// Modeled after IBM free-list algorithm.
+/// See alloc_magazine_pool.hpp for a pool with thread-local caches of objects.
 //----------------------------------------------------------------------------
 // Copyright (c) 2010 Serge Aleynikov <saleyn@gmail.com>
 // Created: 2009-11-21
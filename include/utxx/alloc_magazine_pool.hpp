@@ -0,0 +1,430 @@
+// vim:ts=4:et:sw=4
+//----------------------------------------------------------------------------
+/// \file   alloc_magazine_pool.hpp
+/// \author Serge Aleynikov
+//----------------------------------------------------------------------------
+/// \brief Concurrent pool of fixed size objects with thread-local caches.
+///
+/// Unlike fixed_size_object_pool, which serves all threads from one shared
+/// free list, this pool keeps a magazine of free objects per thread, so that
+/// allocate() and free() don't touch shared state most of the time.  An
+/// empty magazine is refilled, and an overflowing one is flushed, by a batch
+/// of objects at a time from/to a depot protected by a light mutex.
+///
+/// There is a depot per NUMA node.  The objects are carved out of slabs
+/// obtained with mmap(2), which are bound to the node of the thread that
+/// needed them, and a thread's magazine exchanges objects with the depot of
+/// the node the thread ran on when it first used the pool.  Objects freed by
+/// threads of other nodes are returned to their slab's node depot.  Slabs can
+/// be backed by huge pages (MAP_HUGETLB), falling back to transparent huge
+/// pages when no huge pages are reserved in the system.
+//----------------------------------------------------------------------------
+// Created: 2026-10-16
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the utxx open-source project.
+
+Copyright (C) 2026 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+#pragma once
+
+#include <utxx/config.h>
+#include <utxx/math.hpp>
+#include <utxx/error.hpp>
+#include <utxx/futex.hpp>
+#include <utxx/thread_local.hpp>
+#include <utxx/compiler_hints.hpp>
+#include <boost/noncopyable.hpp>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace utxx   {
+namespace memory {
+
+//-----------------------------------------------------------------------------
+/// Pool of fixed size objects with per-thread magazines and per-node depots
+//-----------------------------------------------------------------------------
+class magazine_object_pool : boost::noncopyable {
+public:
+    struct config {
+        size_t m_batch;         // Objects moved between a magazine and a depot
+                                // at once (a magazine holds up to twice more)
+        size_t m_slab_size;     // Slab of objects obtained from the OS (2^N)
+        size_t m_max_bytes;     // Memory limit of the pool (0 - unlimited)
+        bool   m_huge_pages;    // Back the slabs by huge pages
+        bool   m_numa;          // Use a depot per NUMA node
+
+        config()
+            : m_batch     (64)
+            , m_slab_size (2 * 1024 * 1024)
+            , m_max_bytes (0)
+            , m_huge_pages(false)
+            , m_numa      (true)
+        {}
+    };
+
+    /// @param a_object_size size of the objects (rounded up to 16 bytes)
+    explicit magazine_object_pool(size_t a_object_size,
+                                  const config& a_cfg = config());
+
+    ~magazine_object_pool();
+
+    /// Allocate an object of object_size() bytes. This operation is
+    /// thread-safe.
+    /// @return nullptr when the pool reached its m_max_bytes limit
+    void* allocate();
+
+    /// Return an object to the pool. This operation is thread-safe.
+    void  free(void* a_object);
+
+    /// Return the objects cached by the calling thread to the depot
+    void  flush();
+
+    /// @return object size managed by this pool.
+    size_t object_size() const { return m_object_size;  }
+
+    /// Number of depots
+    size_t nodes()       const { return m_depots.size(); }
+
+    /// Number of slabs obtained from the OS
+    size_t slabs() const { return m_slabs.load(std::memory_order_relaxed); }
+
+    /// Memory obtained from the OS
+    size_t bytes() const { return m_bytes.load(std::memory_order_relaxed); }
+
+    /// Number of slabs backed by MAP_HUGETLB huge pages
+    size_t huge_slabs() const { return m_huge.load(std::memory_order_relaxed); }
+
+    const config& cfg()  const { return m_cfg; }
+
+    /// NUMA node of the CPU the calling thread is running on
+    static int current_node();
+
+    /// Number of NUMA nodes of the system
+    static int numa_nodes();
+
+private:
+    static constexpr uint32_t s_magic = 0x4D41475A;
+
+    /// Header at the beginning of each slab
+    struct slab {
+        uint32_t magic;
+        int      node;
+        slab*    next;
+        size_t   bytes;
+    };
+
+    struct alignas(UTXX_CL_SIZE) depot {
+        light_mutex        lock;
+        std::vector<void*> free;        // Free objects of this node
+        slab*              slabs = nullptr;
+    };
+
+    /// Free objects of a thread
+    struct cache {
+        int                node;
+        size_t             count = 0;
+        std::vector<void*> objs;
+    };
+
+    config                              m_cfg;
+    size_t                              m_object_size;
+    size_t                              m_header_size;
+    std::vector<std::unique_ptr<depot>> m_depots;
+    std::atomic<size_t>                 m_bytes;
+    std::atomic<size_t>                 m_slabs;
+    std::atomic<size_t>                 m_huge;
+    thr_local_ptr<cache>                m_cache;  // Magazine of this thread
+
+    cache* get_cache();
+
+    int  node_of(void* a_object) const {
+        auto p = reinterpret_cast<uintptr_t>(a_object);
+        return reinterpret_cast<slab*>(p & ~(m_cfg.m_slab_size-1))->node;
+    }
+
+    // Move up to m_batch objects from the node's depot to the magazine
+    size_t refill(cache& a_cache);
+
+    // Move a_count oldest objects of the magazine to their nodes' depots
+    void   flush(cache& a_cache, size_t a_count);
+
+    // Carve a new slab into the depot's free list (called under lock)
+    bool   new_slab(depot& a_depot, int a_node);
+
+    void*  map_slab(bool& a_huge);
+};
+
+//-----------------------------------------------------------------------------
+// IMPLEMENTATION
+//-----------------------------------------------------------------------------
+
+inline magazine_object_pool::
+magazine_object_pool(size_t a_object_size, const config& a_cfg)
+    : m_cfg(a_cfg)
+    , m_object_size((std::max<size_t>(a_object_size, 1) + 15) & ~size_t(15))
+    , m_header_size((sizeof(slab) + UTXX_CL_SIZE-1) & ~size_t(UTXX_CL_SIZE-1))
+    , m_bytes(0)
+    , m_slabs(0)
+    , m_huge(0)
+{
+    if (!m_cfg.m_batch)
+        UTXX_THROW_BADARG_ERROR("Invalid batch size: 0");
+    auto sz = m_cfg.m_slab_size;
+    if (sz < 4096 || (sz & (sz-1)))
+        UTXX_THROW_BADARG_ERROR("Invalid slab size: ", m_cfg.m_slab_size);
+    if (m_object_size + m_header_size > m_cfg.m_slab_size)
+        UTXX_THROW_BADARG_ERROR("Object size ", a_object_size,
+                                " exceeds slab size ", m_cfg.m_slab_size);
+
+    int n = m_cfg.m_numa ? numa_nodes() : 1;
+    for (int i = 0; i < n; ++i)
+        m_depots.emplace_back(new depot);
+}
+
+inline magazine_object_pool::~magazine_object_pool()
+{
+    for (auto& d : m_depots)
+        for (slab* s = d->slabs, *next; s; s = next) {
+            next = s->next;
+            ::munmap(s, s->bytes);
+        }
+}
+
+inline int magazine_object_pool::current_node()
+{
+#ifdef SYS_getcpu
+    unsigned cpu, node;
+    if (::syscall(SYS_getcpu, &cpu, &node, nullptr) == 0)
+        return int(node);
+#endif
+    return 0;
+}
+
+inline int magazine_object_pool::numa_nodes()
+{
+    static const int s_nodes = [] {
+        int  n   = 0;
+        auto dir = ::opendir("/sys/devices/system/node");
+        if (!dir)
+            return 1;
+        while (auto e = ::readdir(dir)) {
+            int i;
+            if (sscanf(e->d_name, "node%d", &i) == 1)
+                n = std::max(n, i + 1);
+        }
+        ::closedir(dir);
+        return std::max(n, 1);
+    }();
+    return s_nodes;
+}
+
+inline magazine_object_pool::cache* magazine_object_pool::get_cache()
+{
+    cache* c = m_cache.get();
+    if (likely(c))
+        return c;
+
+    c = new cache;
+    c->node = std::min<int>(current_node(), int(m_depots.size()) - 1);
+    c->objs.resize(2 * m_cfg.m_batch);
+    m_cache.reset(c, [this](cache* a_cache, tlp_destruct_mode a_mode) {
+        // On thread exit make the cached objects available to other threads
+        if (a_mode == tlp_destruct_mode::THIS_THREAD)
+            flush(*a_cache, a_cache->count);
+        delete a_cache;
+    });
+    return c;
+}
+
+inline void* magazine_object_pool::allocate()
+{
+    cache* c = get_cache();
+    if (unlikely(!c->count) && !refill(*c))
+        return nullptr;
+    return c->objs[--c->count];
+}
+
+inline void magazine_object_pool::free(void* a_object)
+{
+    if (!a_object)
+        return;
+    cache* c = get_cache();
+    if (unlikely(c->count == c->objs.size()))
+        flush(*c, m_cfg.m_batch);
+    c->objs[c->count++] = a_object;
+}
+
+inline void magazine_object_pool::flush()
+{
+    cache* c = m_cache.get();
+    if (c)
+        flush(*c, c->count);
+}
+
+inline size_t magazine_object_pool::refill(cache& a_cache)
+{
+    auto& d = *m_depots[a_cache.node];
+    std::lock_guard<light_mutex> g(d.lock);
+
+    if (d.free.empty() && !new_slab(d, a_cache.node))
+        return 0;
+
+    auto n = std::min(m_cfg.m_batch, d.free.size());
+    auto p = d.free.end() - n;
+    memcpy(&a_cache.objs[0], &*p, n * sizeof(void*));
+    d.free.erase(p, d.free.end());
+    return a_cache.count = n;
+}
+
+inline void magazine_object_pool::flush(cache& a_cache, size_t a_count)
+{
+    if (!a_count)
+        return;
+
+    auto objs = &a_cache.objs[0];
+    auto last = a_count;
+
+    // Objects of other nodes go back to their own depots
+    if (m_depots.size() > 1)
+        for (size_t i = 0; i < last; ) {
+            int node = node_of(objs[i]);
+            if (node == a_cache.node) {
+                ++i;
+                continue;
+            }
+            auto& d = *m_depots[node];
+            {
+                std::lock_guard<light_mutex> g(d.lock);
+                d.free.push_back(objs[i]);
+            }
+            objs[i] = objs[--last];
+        }
+
+    if (last) {
+        auto& d = *m_depots[a_cache.node];
+        std::lock_guard<light_mutex> g(d.lock);
+        d.free.insert(d.free.end(), objs, objs + last);
+    }
+
+    // Keep the most recently freed (hot) objects in the magazine
+    a_cache.count -= a_count;
+    memmove(objs, objs + a_count, a_cache.count * sizeof(void*));
+}
+
+inline void* magazine_object_pool::map_slab(bool& a_huge)
+{
+    // The slab is aligned to its size, so that the slab header of an object
+    // can be found by masking its address. Unless the mapping is aligned by
+    // the kernel, twice the size is mapped and the excess is unmapped.
+    auto   sz    = m_cfg.m_slab_size;
+    auto   len   = 2 * sz;
+    int    flags = MAP_PRIVATE | MAP_ANONYMOUS;
+    void*  p     = MAP_FAILED;
+
+    a_huge = false;
+#ifdef MAP_HUGETLB
+    if (m_cfg.m_huge_pages && sz >= (2u << 20)) {
+        // Huge page mappings are aligned to the huge page size, which is
+        // sufficient unless the slab is larger than a huge page
+        p = ::mmap(nullptr, sz, PROT_READ|PROT_WRITE, flags|MAP_HUGETLB, -1, 0);
+        if (p != MAP_FAILED && (reinterpret_cast<uintptr_t>(p) & (sz - 1))) {
+            ::munmap(p, sz);
+            p = ::mmap(nullptr, len, PROT_READ|PROT_WRITE,
+                       flags|MAP_HUGETLB, -1, 0);
+        } else if (p != MAP_FAILED)
+            len = sz;
+        a_huge = p != MAP_FAILED;
+    }
+#endif
+    if (p == MAP_FAILED)
+        p = ::mmap(nullptr, len, PROT_READ|PROT_WRITE, flags, -1, 0);
+    if (p == MAP_FAILED)
+        return nullptr;
+
+    auto base = reinterpret_cast<uintptr_t>(p);
+    auto beg  = (base + sz - 1) & ~(sz - 1);
+    if (beg > base)
+        ::munmap(p, beg - base);
+    if (base + len > beg + sz)
+        ::munmap(reinterpret_cast<void*>(beg + sz), base + len - beg - sz);
+
+#ifdef MADV_HUGEPAGE
+    if (m_cfg.m_huge_pages && !a_huge)
+        ::madvise(reinterpret_cast<void*>(beg), sz, MADV_HUGEPAGE);
+#endif
+    return reinterpret_cast<void*>(beg);
+}
+
+inline bool magazine_object_pool::new_slab(depot& a_depot, int a_node)
+{
+    // The bytes are accounted before mapping the slab, so that concurrent
+    // calls from different depots can't exceed the limit
+    auto sz    = m_cfg.m_slab_size;
+    auto bytes = m_bytes.fetch_add(sz, std::memory_order_relaxed) + sz;
+    if (m_cfg.m_max_bytes && bytes > m_cfg.m_max_bytes) {
+        m_bytes.fetch_sub(sz, std::memory_order_relaxed);
+        return false;
+    }
+
+    bool  huge;
+    void* p = map_slab(huge);
+    if (!p) {
+        m_bytes.fetch_sub(sz, std::memory_order_relaxed);
+        return false;
+    }
+
+#ifdef SYS_mbind
+    // Prefer the memory of the node (MPOL_PREFERRED) before it's touched
+    if (m_depots.size() > 1 && a_node < 64) {
+        unsigned long mask = 1ul << a_node;
+        ::syscall(SYS_mbind, p, sz, 1 /* MPOL_PREFERRED */, &mask,
+                  sizeof(mask) * 8, 0);
+    }
+#endif
+
+    auto s   = new (p) slab{s_magic, a_node, a_depot.slabs, sz};
+    auto beg = static_cast<char*>(p) + m_header_size;
+    auto cnt = (sz - m_header_size) / m_object_size;
+
+    a_depot.slabs = s;
+    a_depot.free.reserve(a_depot.free.size() + cnt);
+    // Push in reverse order, so that the objects are handed out by address
+    for (auto i = cnt; i--; )
+        a_depot.free.push_back(beg + i * m_object_size);
+
+    m_slabs.fetch_add(1,  std::memory_order_relaxed);
+    if (huge)
+        m_huge.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+} // namespace memory
+} // namespace utxx
@@ -31,6 +31,8 @@
 ///      capacity.
 ///    - Max size limit of ~18x initial size (dependent on max load factor).
 ///    - Memory is not freed or reclaimed by erase.
+///      (see sharded_atomic_hash_map.hpp for a map that grows online and
+///      compacts erased entries, at the cost of serializing writers per shard)
 ///
 /// Usage and Operation Details:
 ///   Simple performance/memory tradeoff with max_load_factor.  Higher load factors
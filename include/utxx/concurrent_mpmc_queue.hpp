@@ -0,0 +1,385 @@
+// vim:ts=4:et:sw=4
+//----------------------------------------------------------------------------
+/// \file   concurrent_mpmc_queue.hpp
+/// \author Serge Aleynikov
+//----------------------------------------------------------------------------
+/// \brief Bounded lock-free SPMC and MPMC array queues.
+///
+/// Each cell of the ring carries a sequence number telling whether it's free
+/// for a producer or ready for a consumer at a given position (the algorithm
+/// by Dmitry Vyukov: http://www.1024cores.net/home/lock-free-algorithms/
+/// queues/bounded-mpmc-queue). Unlike concurrent_spsc_queue, any number of
+/// threads can pop items, and (in the MPMC flavor) push items concurrently.
+//----------------------------------------------------------------------------
+// Created: 2026-10-16
+//----------------------------------------------------------------------------
+/*
+ ***** BEGIN LICENSE BLOCK *****
+
+ This file is part of the utxx open-source project.
+
+ Copyright (C) 2026 Serge Aleynikov <saleyn@gmail.com>
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public
+ License as published by the Free Software Foundation; either
+ version 2.1 of the License, or (at your option) any later version.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+ ***** END LICENSE BLOCK *****
+*/
+#pragma once
+
+#include <utxx/config.h>
+#include <utxx/math.hpp>
+#include <utxx/error.hpp>
+#include <utxx/compiler_hints.hpp>
+#include <boost/noncopyable.hpp>
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace utxx {
+
+namespace detail {
+
+//===========================================================================//
+// Bounded queue of sequence-numbered cells without locks.                   //
+// MultiProducer/MultiConsumer select whether the tail/head counters are     //
+// claimed with a CAS (many threads) or a plain store (a single thread).     //
+//===========================================================================//
+template <class T, bool MultiProducer, bool MultiConsumer>
+class basic_concurrent_ring_queue : private boost::noncopyable
+{
+    //-----------------------------------------------------------------------//
+    // Cell: an item's storage and its sequence number                       //
+    //-----------------------------------------------------------------------//
+    // A cell at position "pos" is free for a producer when m_seq == pos, and
+    // holds an item for a consumer when m_seq == pos+1. After popping, m_seq
+    // is set to pos+capacity (the position of the next lap over the ring).
+    struct cell
+    {
+        std::atomic<uint64_t>                                      m_seq;
+        typename std::aligned_storage<sizeof(T), alignof(T)>::type m_data;
+
+        T* data() { return reinterpret_cast<T*>(&m_data); }
+    };
+
+    //-----------------------------------------------------------------------//
+    // Header (can also be located in ShMem along with the cells).           //
+    // The producers' and consumers' counters are on separate cache lines.   //
+    //-----------------------------------------------------------------------//
+    struct header
+    {
+        alignas(UTXX_CL_SIZE) std::atomic<uint64_t> m_head;  // Next pop
+        alignas(UTXX_CL_SIZE) std::atomic<uint64_t> m_tail;  // Next push
+        alignas(UTXX_CL_SIZE) uint32_t              m_capacity;
+        std::atomic<uint32_t>                       m_magic;     // MAGIC once initialized
+        uint16_t                                    m_version;   // Layout version (VERSION)
+        uint32_t                                    m_item_size; // sizeof(T)
+
+        enum : uint32_t { MAGIC = 0x52696e67, VERSION = 1 }; // "Ring"
+
+        explicit header(uint32_t a_capacity)
+            : m_head     (0)
+            , m_tail     (0)
+            , m_capacity (a_capacity)
+            , m_magic    (0)
+            , m_version  (VERSION)
+            , m_item_size(sizeof(T))
+        {}
+    };
+
+    static uint32_t adjust_capacity(size_t a_capacity)
+    {
+        if (a_capacity < 2 || a_capacity > (1u << 31))
+            UTXX_THROW_BADARG_ERROR("Invalid capacity=", a_capacity);
+        uint32_t n = math::upper_power(uint32_t(a_capacity), 2);
+        // Round the capacity DOWN to a power of 2
+        return n == a_capacity ? n : n / 2;
+    }
+
+    cell& cell_at(uint64_t a_pos) const { return m_cells[a_pos & m_mask]; }
+
+    // Claim up to a_n consecutive cells starting at the position of a_ctr,
+    // which are ready when their sequence is equal to "position + a_lag".
+    // @return the number of claimed cells, whose first position is a_pos
+    template <bool Multi>
+    size_t claim(std::atomic<uint64_t>& a_ctr, uint64_t a_lag, size_t a_n,
+                 uint64_t& a_pos)
+    {
+        uint64_t pos = a_ctr.load(std::memory_order_relaxed);
+
+        while (true) {
+            size_t n = 0;
+            while (n < a_n &&
+                   cell_at(pos+n).m_seq.load(std::memory_order_acquire)
+                   == pos + n + a_lag)
+                ++n;
+
+            if (n == 0) {
+                auto seq = cell_at(pos).m_seq.load(std::memory_order_acquire);
+                // Queue is full (for producers) or empty (for consumers):
+                if (int64_t(seq - (pos + a_lag)) < 0)
+                    return 0;
+                // Otherwise another thread has claimed this position
+                pos = a_ctr.load(std::memory_order_relaxed);
+                continue;
+            }
+
+            if (!Multi) {
+                a_ctr.store(pos + n, std::memory_order_relaxed);
+                a_pos = pos;
+                return n;
+            }
+            // On failure "pos" is reloaded with the current counter value
+            if (a_ctr.compare_exchange_weak(pos, pos + n,
+                                            std::memory_order_relaxed)) {
+                a_pos = pos;
+                return n;
+            }
+        }
+    }
+
+public:
+    typedef T value_type;
+
+    /// @return memory size needed for allocating queue data of \a a_capacity
+    /// items (e.g. in shared memory).
+    static size_t memory_size(uint32_t a_capacity)
+      { return sizeof(header) + adjust_capacity(a_capacity) * sizeof(cell); }
+
+    //-----------------------------------------------------------------------//
+    // Ctors, Dtor:                                                          //
+    //-----------------------------------------------------------------------//
+    /// Ctor allocating the queue on the heap. The capacity is rounded down
+    /// to a power of 2, and all of it is usable.
+    explicit basic_concurrent_ring_queue(uint32_t a_capacity)
+        : m_shared(false)
+    {
+        auto cap = adjust_capacity(a_capacity);
+        void* p;
+        if (::posix_memalign(&p, UTXX_CL_SIZE, memory_size(cap)) != 0)
+            throw std::bad_alloc();
+        init(p, cap);
+    }
+
+    /// Ctor using external memory (eg shared memory) of \a a_size bytes,
+    /// which should be obtained by the call to memory_size().
+    /// @param a_init when true, the queue is initialized in \a a_storage,
+    ///               otherwise the queue previously initialized there by
+    ///               another process is attached to.
+    /// NB: items stored in shared memory must not contain pointers to the
+    /// process' own memory.
+    basic_concurrent_ring_queue(void* a_storage, size_t a_size, bool a_init)
+        : m_shared(true)
+    {
+        if (a_size <= sizeof(header) ||
+           (reinterpret_cast<uintptr_t>(a_storage) % alignof(header)) != 0)
+            UTXX_THROW_BADARG_ERROR("Invalid storage size: ", a_size);
+
+        auto cap = adjust_capacity((a_size - sizeof(header)) / sizeof(cell));
+
+        if (a_init) {
+            init(a_storage, cap);
+            return;
+        }
+
+        m_header = static_cast<header*>(a_storage);
+        m_cells  = reinterpret_cast<cell*>(m_header + 1);
+        m_mask   = m_header->m_capacity - 1;
+
+        // The magic is stored last by init(), so the cells are initialized
+        // when it's found
+        const char* invalid =
+            m_header->m_magic.load(std::memory_order_acquire) != header::MAGIC
+                ? "not initialized" :
+            m_header->m_version   != header::VERSION ? "layout version mismatch" :
+            m_header->m_item_size != sizeof(T)       ? "item size mismatch"      :
+            m_header->m_capacity  >  cap             ? "capacity mismatch"       :
+            nullptr;
+
+        if (invalid)
+            UTXX_THROW_RUNTIME_ERROR("Storage doesn't contain a valid queue "
+                                     "of capacity ", cap, ": ", invalid);
+    }
+
+    /// Dtor: destructs the items remaining in the queue, unless the queue is
+    /// located in external memory, whose lifetime is managed by the caller.
+    ~basic_concurrent_ring_queue()
+    {
+        if (m_shared)
+            return;
+        clear();
+        ::free(m_header);
+    }
+
+    //-----------------------------------------------------------------------//
+    // Push / Pop operations:                                                //
+    //-----------------------------------------------------------------------//
+    /// Write a T object constructed with the \a a_args to the queue.
+    /// If the constructor may throw, the object is constructed before a cell
+    /// is claimed and is moved there, so T must be nothrow move-constructible.
+    /// @return false when the queue is full
+    template <class... Args>
+    bool try_push(Args&&... a_args)
+    {
+        return emplace(std::is_nothrow_constructible<T, Args&&...>(),
+                       std::forward<Args>(a_args)...);
+    }
+
+    /// Move the value at the front of the queue to \a a_item.
+    /// @return false when the queue is empty
+    bool try_pop(T& a_item)
+    {
+        uint64_t pos;
+        if (!claim<MultiConsumer>(m_header->m_head, 1, 1, pos))
+            return false;
+        release(pos, a_item);
+        return true;
+    }
+
+    /// Write up to \a a_n items copied from \a a_first with a single claim
+    /// of consecutive cells.  Items whose copy may throw are pushed one by
+    /// one with try_push().
+    /// @return the number of written items (0 when the queue is full)
+    template <class InputIt>
+    size_t try_push_n(InputIt a_first, size_t a_n)
+    {
+        if (!std::is_nothrow_constructible<T, decltype(*a_first)>::value) {
+            size_t n = 0;
+            for (; n < a_n && try_push(*a_first); ++n, ++a_first);
+            return n;
+        }
+
+        uint64_t pos;
+        size_t   n = claim<MultiProducer>(m_header->m_tail, 0, a_n, pos);
+        for (size_t i = 0; i < n; ++i, ++a_first) {
+            auto& c = cell_at(pos + i);
+            new (c.data()) T(*a_first);
+            c.m_seq.store(pos + i + 1, std::memory_order_release);
+        }
+        return n;
+    }
+
+    /// Move up to \a a_n items from the front of the queue to \a a_out with a
+    /// single claim of consecutive cells.
+    /// @return the number of popped items (0 when the queue is empty)
+    template <class OutputIt>
+    size_t try_pop_n(OutputIt a_out, size_t a_n)
+    {
+        uint64_t pos;
+        size_t   n = claim<MultiConsumer>(m_header->m_head, 1, a_n, pos);
+        for (size_t i = 0; i < n; ++i, ++a_out)
+            release(pos + i, *a_out);
+        return n;
+    }
+
+    /// Remove all items from the queue, destroying them in place. Only safe
+    /// if no other thread is pushing into the queue concurrently.
+    void clear()
+    {
+        uint64_t pos;
+        while (size_t n = claim<MultiConsumer>(m_header->m_head, 1,
+                                               capacity(), pos))
+            for (size_t i = 0; i < n; ++i)
+                discard(pos + i);
+    }
+
+    //-----------------------------------------------------------------------//
+    // Queue Status:                                                         //
+    //-----------------------------------------------------------------------//
+    /// Test for the queue being empty (the result may be stale by the time
+    /// it is used if other threads access the queue concurrently)
+    bool empty() const { return size() == 0; }
+
+    /// Approximate number of items in the queue
+    uint32_t size() const
+    {
+        auto h = m_header->m_head.load(std::memory_order_acquire);
+        auto t = m_header->m_tail.load(std::memory_order_acquire);
+        return t > h ? uint32_t(t - h) : 0;
+    }
+
+    uint32_t capacity() const { return m_header->m_capacity; }
+
+private:
+    header*  m_header;
+    cell*    m_cells;
+    uint64_t m_mask;
+    bool     m_shared;
+
+    void init(void* a_storage, uint32_t a_capacity)
+    {
+        m_header = new (a_storage) header(a_capacity);
+        m_cells  = reinterpret_cast<cell*>(m_header + 1);
+        m_mask   = a_capacity - 1;
+        for (uint32_t i = 0; i < a_capacity; ++i)
+            new (&m_cells[i].m_seq) std::atomic<uint64_t>(i);
+        // Everything is initialized: let other processes attach
+        m_header->m_magic.store(header::MAGIC, std::memory_order_release);
+    }
+
+    // A claimed cell must be published, otherwise consumers wait for it
+    // forever, so the item is constructed there only if that can't throw
+    template <class... Args>
+    bool emplace(std::true_type, Args&&... a_args)
+    {
+        uint64_t pos;
+        if (!claim<MultiProducer>(m_header->m_tail, 0, 1, pos))
+            return false;
+        auto& c = cell_at(pos);
+        new (c.data()) T(std::forward<Args>(a_args)...);
+        c.m_seq.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    template <class... Args>
+    bool emplace(std::false_type, Args&&... a_args)
+    {
+        static_assert(std::is_nothrow_move_constructible<T>::value,
+                      "T must be nothrow move-constructible");
+        T item(std::forward<Args>(a_args)...);
+        return emplace(std::true_type(), std::move(item));
+    }
+
+    template <class Out>
+    void release(uint64_t a_pos, Out& a_item)
+    {
+        a_item = std::move(*cell_at(a_pos).data());
+        discard(a_pos);
+    }
+
+    // Destroy the item in a claimed cell, and free the cell for producers
+    void discard(uint64_t a_pos)
+    {
+        auto& c = cell_at(a_pos);
+        if (!std::is_trivially_destructible<T>::value)
+            c.data()->~T();
+        c.m_seq.store(a_pos + m_mask + 1, std::memory_order_release);
+    }
+};
+
+} // namespace detail
+
+/// Single-producer multiple-consumer bounded lock-free queue
+template <class T>
+using concurrent_spmc_queue = detail::basic_concurrent_ring_queue<T, false, true>;
+
+/// Multiple-producer multiple-consumer bounded lock-free queue
+template <class T>
+using concurrent_mpmc_queue = detail::basic_concurrent_ring_queue<T, true,  true>;
+
+} // namespace utxx
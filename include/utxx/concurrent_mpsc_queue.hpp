@@ -41,6 +41,7 @@
 #include <boost/noncopyable.hpp>
 #include <boost/type_traits.hpp>
 #include <utxx/math.hpp>
+#include <utxx/thread_local.hpp>
 
 namespace utxx {
 
@@ -49,6 +50,12 @@ namespace utxx {
 /**
  * A lock-free implementation of the multi-producer-single-consumer queue.
  * All elements are equally sized of type T.
+ *
+ * Nodes are carved out of slabs obtained from the Allocator, and are never
+ * returned to it until the queue is destroyed. Each producer thread takes
+ * nodes from its own free list, which is refilled with all the nodes freed
+ * by the consumer at once, so that allocating a node doesn't go through the
+ * global heap, and doesn't touch shared state most of the time.
  */
 template <class T, class Allocator = std::allocator<char>>
 struct concurrent_mpsc_queue {
@@ -71,20 +78,46 @@ struct concurrent_mpsc_queue {
 
     using Alloc = typename std::allocator_traits<Allocator>::template rebind_alloc<node>;
 
+    /// Number of nodes allocated at once by a producer with an empty free list
+    static constexpr size_t s_slab_size     = 64;
+    /// Number of nodes freed by the consumer before they're made available to
+    /// the producers (they are also made available by pop_all())
+    static constexpr size_t s_recycle_batch = 64;
+
     explicit concurrent_mpsc_queue(const Alloc& a_alloc = Alloc())
-        : m_head     (nullptr)
-        , m_allocator(a_alloc)
+        : m_head      (nullptr)
+        , m_allocator (a_alloc)
+        , m_recycled  (nullptr)
+        , m_slabs     (nullptr)
+        , m_freed     (nullptr)
+        , m_freed_tail(nullptr)
+        , m_freed_cnt (0)
     {}
 
+    ~concurrent_mpsc_queue() {
+        clear();
+        for (slot* p = m_slabs.load(std::memory_order_acquire), *next; p; p = next) {
+            next = p->next;
+            m_allocator.deallocate(reinterpret_cast<node*>(p), s_slab_size);
+        }
+    }
+
     bool empty() const {
         return m_head.load(std::memory_order_relaxed) == nullptr;
     }
 
+    /// Allocate a node from the calling producer's free list, and construct
+    /// its data with given arguments.
     template <typename... Args>
     node* allocate(Args&&... args) {
         try {
-            node*  n = m_allocator.allocate(1);
-            new   (n)  node(std::forward<Args>(args)...);
+            node*  n = reinterpret_cast<node*>(take_slot());
+            try {
+                new (n) node(std::forward<Args>(args)...);
+            } catch (...) {
+                give_slot(reinterpret_cast<slot*>(n));
+                throw;
+            }
             return n;
         } catch (std::bad_alloc const&) {
             return nullptr;
@@ -93,14 +126,11 @@ struct concurrent_mpsc_queue {
 
     /// Insert an element's copy into the queue. 
     bool push(const T& data) {
-        try {
-            node* n = m_allocator.allocate(1);
-            new  (n)  node(data);
-            push (n);
-            return true;
-        } catch (std::bad_alloc const&) {
+        node* n = allocate(data);
+        if (!n)
             return false;
-        }
+        push(n);
+        return true;
     }
 
     /// Insert an element into the queue. 
@@ -111,16 +141,30 @@ struct concurrent_mpsc_queue {
         while (!m_head.compare_exchange_weak(h, a_node, std::memory_order_release));
     }
 
+    /// Insert a batch of elements into the queue with a single CAS.
+    /// The nodes must have been previously allocated using allocate(), and
+    /// linked with node::next() from \a a_first to \a a_last in the order of
+    /// insertion.
+    void push_chain(node* a_first, node* a_last) {
+        // The queue is a stack, so relink the chain from the last to the first
+        node* prev = nullptr;
+        for (node* p = a_first, *next; prev != a_last; prev = p, p = next) {
+            next = p->next();
+            p->next(prev);
+        }
+        node*   h;
+        do    { h = m_head.load(std::memory_order_relaxed); a_first->next(h); }
+        while (!m_head.compare_exchange_weak(h, a_last, std::memory_order_release));
+    }
+
     /// Emplace an element into the queue by constructing the data with given arguments. 
     template <typename... Args>
     bool emplace(Args&&... args) {
-        try {
-            node* n = allocate(std::forward<Args>(args)...);
-            push(n);
-            return true;
-        } catch (std::bad_alloc const&) {
+        node* n = allocate(std::forward<Args>(args)...);
+        if (!n)
             return false;
-        }
+        push(n);
+        return true;
     }
 
     /// Pop all queued elements in the order of insertion
@@ -140,13 +184,22 @@ struct concurrent_mpsc_queue {
     ///
     /// Use concurrent_mpsc_queue::free() to deallocate each node
     node* pop_all_reverse() {
+        recycle();
         return m_head.exchange(nullptr, std::memory_order_acquire);
     }
 
-    /// Deallocate a node created by a call to pop_all() or pop_all_reverse()
+    /// Deallocate a node created by a call to pop_all() or pop_all_reverse().
+    /// Must only be called by the consumer. The node is returned to the
+    /// producers' free lists in batches.
     void free(node* a_node) {
         a_node->~node();
-        m_allocator.deallocate(a_node, 1);
+        auto  p = reinterpret_cast<slot*>(a_node);
+        p->next = m_freed;
+        m_freed = p;
+        if (!m_freed_tail)
+            m_freed_tail = p;
+        if (++m_freed_cnt == s_recycle_batch)
+            recycle();
     }
 
     /// Clear the queue
@@ -155,10 +208,91 @@ struct concurrent_mpsc_queue {
             tmp  = last->next();
             free(last);
         }
+        recycle();
     }
 private:
-    std::atomic<node*> m_head;
-    Alloc              m_allocator;
+    /// Raw storage of a node in a free list or of a slab in the list of slabs
+    struct slot { slot* next; };
+
+    /// Free list of a producer thread
+    struct cache {
+        slot* head = nullptr;
+    };
+
+    // Get a node's storage from the calling thread's free list, refilling
+    // it with the nodes recycled by the consumer or with a new slab
+    slot* take_slot() {
+        cache* c = m_cache.get();
+        if (utxx::unlikely(!c)) {
+            c = new cache;
+            m_cache.reset(c, [this](cache* a_cache, tlp_destruct_mode a_mode) {
+                // On thread exit make the nodes available to other producers
+                if (a_mode == tlp_destruct_mode::THIS_THREAD && a_cache->head) {
+                    slot* last = a_cache->head;
+                    while (last->next)
+                        last = last->next;
+                    push_slots(m_recycled, a_cache->head, last);
+                }
+                delete a_cache;
+            });
+        }
+        if (utxx::unlikely(!c->head)) {
+            c->head = m_recycled.exchange(nullptr, std::memory_order_acquire);
+            if (!c->head)
+                c->head = new_slab();
+        }
+        slot* p = c->head;
+        c->head = p->next;
+        return p;
+    }
+
+    // Return a node's storage to the calling thread's free list
+    void give_slot(slot* a_slot) {
+        cache* c     = m_cache.get();
+        a_slot->next = c->head;
+        c->head      = a_slot;
+    }
+
+    // Allocate a slab of nodes. Its first node's storage links the slab to
+    // the list of slabs, and the rest are returned linked as a free list
+    slot* new_slab() {
+        auto  base  = m_allocator.allocate(s_slab_size);
+        auto  slab  = reinterpret_cast<slot*>(base);
+        push_slots(m_slabs, slab, slab);
+
+        slot* head = nullptr;
+        for (size_t i = s_slab_size; --i; ) {
+            auto p  = reinterpret_cast<slot*>(base + i);
+            p->next = head;
+            head    = p;
+        }
+        return head;
+    }
+
+    // Make the nodes freed by the consumer available to the producers
+    void recycle() {
+        if (!m_freed)
+            return;
+        push_slots(m_recycled, m_freed, m_freed_tail);
+        m_freed      = m_freed_tail = nullptr;
+        m_freed_cnt  = 0;
+    }
+
+    static void push_slots(std::atomic<slot*>& a_list, slot* a_first, slot* a_last) {
+        slot*   h;
+        do    { h = a_list.load(std::memory_order_relaxed); a_last->next = h; }
+        while (!a_list.compare_exchange_weak(h, a_first, std::memory_order_release));
+    }
+
+    std::atomic<node*>   m_head;
+    Alloc                m_allocator;
+    std::atomic<slot*>   m_recycled;  // Freed nodes taken at once by a producer
+    std::atomic<slot*>   m_slabs;     // All slabs allocated by the producers
+    thr_local_ptr<cache> m_cache;     // Free list of the calling producer
+    // Consumer's batch of freed nodes not yet made available to producers
+    slot*                m_freed;
+    slot*                m_freed_tail;
+    size_t               m_freed_cnt;
 };
 
 template <class Allocator>
@@ -272,6 +406,22 @@ struct concurrent_mpsc_queue<char, Allocator> {
         while (!m_head.compare_exchange_weak(h, a_node, std::memory_order_release));
     }
 
+    /// Insert a batch of elements into the queue with a single CAS.
+    /// The nodes must have been previously allocated using allocate(), and
+    /// linked with node::next() from \a a_first to \a a_last in the order of
+    /// insertion.
+    void push_chain(node* a_first, node* a_last) {
+        // The queue is a stack, so relink the chain from the last to the first
+        node* prev = nullptr;
+        for (node* p = a_first, *next; prev != a_last; prev = p, p = next) {
+            next = p->next();
+            p->next(prev);
+        }
+        node*   h;
+        do    { h = m_head.load(std::memory_order_relaxed); a_first->next(h); }
+        while (!m_head.compare_exchange_weak(h, a_last, std::memory_order_release));
+    }
+
     /// Pop all queued elements in the order of insertion
     ///
     /// Use concurrent_mpsc_queue::free() to deallocate each node
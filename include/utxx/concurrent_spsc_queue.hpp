@@ -38,14 +38,25 @@
 */
 #pragma once
 
+#include <utxx/config.h>
 #include <utxx/math.hpp>
 #include <utxx/error.hpp>
+#include <utxx/futex.hpp>
 #include <utxx/compiler_hints.hpp>
 #include <boost/noncopyable.hpp>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include <atomic>
+#include <algorithm>
 #include <cassert>
+#include <chrono>
 #include <cstdlib>
+#include <memory>
 #include <stdexcept>
+#include <string>
+#include <thread>
 #include <type_traits>
 #include <utility>
 
@@ -69,13 +80,27 @@ private:
     //-----------------------------------------------------------------------//
     // Header (can also be located in ShMem along with the data):            //
     //-----------------------------------------------------------------------//
+    // The head (written by the Consumer) and the tail (written by the Produ-
+    // cer) are placed on separate cache lines, so that updating one of them
+    // doesn't invalidate the other one in the other side's cache:
+    //
     struct header
     {
         std::atomic<uint32_t>  m_head;
+        char                   __pad0[UTXX_CL_SIZE - sizeof(uint32_t)];
         std::atomic<uint32_t>  m_tail;
+        char                   __pad1[UTXX_CL_SIZE - sizeof(uint32_t)];
         uint32_t    const      m_capacity;
+        std::atomic<uint32_t>  m_magic;     // MAGIC once initialized in ShMem
+        uint16_t               m_version;   // Layout version (VERSION)
+        uint16_t               m_blocking;  // Producer wakes up pop_wait()
+        uint32_t               m_item_size; // sizeof(T)
+        std::atomic<int>       m_futex;     // Bumped on each consumer wakeup
+        std::atomic<int>       m_waiters;   // Consumers blocked in pop_wait()
         T                      __padding[0];
 
+        enum : uint32_t { MAGIC = 0x53505343, VERSION = 2 }; // "SPSC"
+
         static uint32_t adjust_capacity(uint32_t a_capacity)
         {
             uint32_t n = math::upper_power(a_capacity, 2);
@@ -90,15 +115,27 @@ private:
         }
 
         header()
-            : m_head    (0)
-            , m_tail    (0)
-            , m_capacity(0)
+            : m_head     (0)
+            , m_tail     (0)
+            , m_capacity (0)
+            , m_magic    (0)
+            , m_version  (VERSION)
+            , m_blocking (0)
+            , m_item_size(sizeof(T))
+            , m_futex    (0)
+            , m_waiters  (0)
         {}
 
-        header(uint32_t a_capacity)
-            : m_head(0)
-            , m_tail(0)
-            , m_capacity(adjust_capacity(a_capacity))
+        header(uint32_t a_capacity, bool a_blocking = false)
+            : m_head     (0)
+            , m_tail     (0)
+            , m_capacity (adjust_capacity(a_capacity))
+            , m_magic    (0)
+            , m_version  (VERSION)
+            , m_blocking (a_blocking)
+            , m_item_size(sizeof(T))
+            , m_futex    (0)
+            , m_waiters  (0)
         {
             assert((m_capacity & (m_capacity-1)) == 0);  // Power of 2 indeed
             if (m_capacity < 2)
@@ -156,6 +193,9 @@ public:
         , m_shared_data(true)
         , m_side       (a_side)
         , m_mask       (m_header.m_capacity-1)
+        , m_shm_size   (0)
+        , m_head_cache (m_header_ptr->m_head.load(std::memory_order_relaxed))
+        , m_tail_cache (m_header_ptr->m_tail.load(std::memory_order_relaxed))
     {
         // Verify that the sizes are correct (as would indeed be the case if
         // "a_size" was computed by "memory_size" above):
@@ -176,15 +216,20 @@ public:
     /// full() will return true after \a capacity-1 insertions.
     /// XXX: Because the "side" cannot be made thread-local here as yet, we
     /// have to set it to "side_t::both":
+    /// @param a_blocking when true, push() wakes up a consumer blocked in
+    ///                   pop_wait()
     ///
-    explicit concurrent_spsc_queue(uint32_t a_capacity)
-        : m_header     (a_capacity)
+    explicit concurrent_spsc_queue(uint32_t a_capacity, bool a_blocking = false)
+        : m_header     (a_capacity, a_blocking)
         , m_header_ptr (&m_header)
         , m_rec_ptr    (reinterpret_cast<T*>
                        (::malloc(sizeof(T)*m_header.m_capacity)))
         , m_shared_data(false)
         , m_side       (side_t::both)
         , m_mask       (m_header.m_capacity-1)
+        , m_shm_size   (0)
+        , m_head_cache (m_header_ptr->m_head.load(std::memory_order_relaxed))
+        , m_tail_cache (m_header_ptr->m_tail.load(std::memory_order_relaxed))
     {
         if (unlikely(StaticCapacity != 0))
             UTXX_THROW_RUNTIME_ERROR("Cannot specify both static and dynamic "
@@ -203,6 +248,9 @@ public:
         , m_shared_data(false)
         , m_side       (side_t::both)
         , m_mask       (m_header.m_capacity-1)
+        , m_shm_size   (0)
+        , m_head_cache (m_header_ptr->m_head.load(std::memory_order_relaxed))
+        , m_tail_cache (m_header_ptr->m_tail.load(std::memory_order_relaxed))
     {}
 
     /// Dtor:
@@ -216,9 +264,13 @@ public:
     {
         // If the data are shared, don't clear or de-allocate the queue: it may
         // (or may not) need to be persistent, so its lifetime is managed by
-        // the callers:
-        if (m_shared_data)
+        // the callers. A segment mapped by create_in_shm()/attach_shm() is
+        // unmapped, but not removed (see remove_shm()):
+        if (m_shared_data) {
+            if (m_shm_size)
+                ::munmap(m_header_ptr, m_shm_size);
             return;
+        }
 
         // Otherwise: If necessary, invoke the Dtors on the stored contents (but
         // pass a flag indicating that we are calling "clear" from the Dtor, so
@@ -234,6 +286,160 @@ public:
         }
     }
 
+    //-----------------------------------------------------------------------//
+    // Named Shared Memory:                                                  //
+    //-----------------------------------------------------------------------//
+    /// Create a queue of \a a_capacity items (rounded down to a power of 2)
+    /// in a new named shared memory segment (see shm_open(3)), so that another
+    /// process could attach to it by calling attach_shm(). Fails if the seg-
+    /// ment already exists. The segment is unmapped by the Dtor, but persists
+    /// until removed by remove_shm().
+    /// NB: items stored in shared memory must not contain pointers to the
+    /// process' own memory.
+    /// @param a_blocking when true, push() wakes up a consumer blocked in
+    ///                   pop_wait() (possibly in another process)
+    /// @param a_mode     access permissions of the segment
+    static std::unique_ptr<concurrent_spsc_queue> create_in_shm
+    (
+        std::string const& a_name,
+        uint32_t           a_capacity,
+        side_t             a_side,
+        bool               a_blocking = false,
+        mode_t             a_mode     = 0660
+    )
+    {
+        static_assert(StaticCapacity == 0,
+                      "Shared memory queue cannot have static capacity");
+
+        uint32_t cap = header::adjust_capacity(a_capacity);
+        if (cap < 2)
+            UTXX_THROW_BADARG_ERROR("Invalid capacity=", a_capacity);
+
+        uint32_t size = memory_size(cap);
+        int      fd   = ::shm_open(a_name.c_str(), O_CREAT|O_EXCL|O_RDWR,
+                                   a_mode);
+        if (fd < 0)
+            UTXX_THROW_IO_ERROR(errno, "Cannot create shared memory segment ",
+                                a_name);
+
+        void* p = ::ftruncate(fd, size) == 0
+                ? ::mmap(nullptr, size, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0)
+                : MAP_FAILED;
+        int err = errno;
+        ::close(fd);
+
+        if (p == MAP_FAILED) {
+            ::shm_unlink(a_name.c_str());
+            UTXX_THROW_IO_ERROR(err, "Cannot map shared memory segment ",
+                                a_name);
+        }
+
+        auto hdr = new (p) header(cap, a_blocking);
+        std::unique_ptr<concurrent_spsc_queue> q;
+        try {
+            q.reset(new concurrent_spsc_queue(p, size, a_side));
+        } catch (...) {
+            ::munmap(p, size);
+            ::shm_unlink(a_name.c_str());
+            throw;
+        }
+        q->m_shm_size = size;
+
+        // Everything is initialized: let attach_shm() callers use the queue
+        hdr->m_magic.store(header::MAGIC, std::memory_order_release);
+        return q;
+    }
+
+    /// Attach to a queue created by create_in_shm() (eg in another process).
+    /// Waits up to \a a_timeout for the segment to be created and initialized,
+    /// and validates the layout version, the item size and the capacity of the
+    /// queue found there.
+    static std::unique_ptr<concurrent_spsc_queue> attach_shm
+    (
+        std::string const&        a_name,
+        side_t                    a_side,
+        std::chrono::milliseconds a_timeout = std::chrono::milliseconds(0)
+    )
+    {
+        static_assert(StaticCapacity == 0,
+                      "Shared memory queue cannot have static capacity");
+
+        using clock   = std::chrono::steady_clock;
+        auto deadline = clock::now() + a_timeout;
+        auto backoff  = [&] {
+            if (clock::now() >= deadline)
+                return false;
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            return true;
+        };
+
+        int         fd;
+        struct stat st;
+
+        // The creator may not have sized the segment yet:
+        while (true) {
+            fd = ::shm_open(a_name.c_str(), O_RDWR, 0);
+            if (fd >= 0 && ::fstat(fd, &st) == 0 &&
+                size_t(st.st_size) > sizeof(header))
+                break;
+            int err = fd < 0 ? errno : 0;
+            if (fd >= 0)
+                ::close(fd);
+            if (backoff())
+                continue;
+            if (err)
+                UTXX_THROW_IO_ERROR(err, "Cannot open shared memory segment ",
+                                    a_name);
+            UTXX_THROW_RUNTIME_ERROR("Shared memory segment ", a_name,
+                                     " is not initialized");
+        }
+
+        size_t size = st.st_size;
+        void*  p    = ::mmap(nullptr, size, PROT_READ|PROT_WRITE, MAP_SHARED,
+                             fd, 0);
+        int    err  = errno;
+        ::close(fd);
+
+        if (p == MAP_FAILED)
+            UTXX_THROW_IO_ERROR(err, "Cannot map shared memory segment ",
+                                a_name);
+
+        auto hdr = static_cast<header const*>(p);
+        while (hdr->m_magic.load(std::memory_order_acquire) != header::MAGIC &&
+               backoff());
+
+        const char* invalid =
+            hdr->m_magic.load(std::memory_order_relaxed) != header::MAGIC
+                ? "not initialized" :
+            hdr->m_version   != header::VERSION ? "layout version mismatch" :
+            hdr->m_item_size != sizeof(T)       ? "item size mismatch"      :
+            size > UINT32_MAX || memory_size(hdr->m_capacity) != size
+                                                ? "capacity mismatch"       :
+            nullptr;
+
+        if (invalid) {
+            ::munmap(p, size);
+            UTXX_THROW_RUNTIME_ERROR("Invalid queue in shared memory segment ",
+                                     a_name, ": ", invalid);
+        }
+
+        std::unique_ptr<concurrent_spsc_queue> q;
+        try {
+            q.reset(new concurrent_spsc_queue(p, uint32_t(size), a_side));
+        } catch (...) {
+            ::munmap(p, size);
+            throw;
+        }
+        q->m_shm_size = size;
+        return q;
+    }
+
+    /// Remove the named shared memory segment created by create_in_shm().
+    /// The processes that have the queue mapped can continue using it.
+    /// @return false if the segment doesn't exist
+    static bool remove_shm(std::string const& a_name)
+      { return ::shm_unlink(a_name.c_str()) == 0; }
+
     //-----------------------------------------------------------------------//
     // Data Push / Pop / Peek operations:                                    //
     //-----------------------------------------------------------------------//
@@ -252,11 +458,14 @@ public:
         uint32_t t    = tail().load(std::memory_order_relaxed);
         uint32_t next = increment(t);
 
-        if (next != head().load(std::memory_order_acquire))
+        if (next != m_head_cache ||
+            next != (m_head_cache = head().load(std::memory_order_acquire)))
         {
             T* at = m_rec_ptr + t;
             new (at) T(std::forward<Args>(a_item_args)...);
             tail().store(next, std::memory_order_release);
+            if (unlikely(m_header_ptr->m_blocking))
+                notify();
             return at;
         }
         // Otherwise: queue is full, nothing is inserted
@@ -270,7 +479,8 @@ public:
         assert(m_side != side_t::producer);
 
         uint32_t h = head().load(std::memory_order_relaxed);
-        if (h == tail().load(std::memory_order_acquire))
+        if (h == m_tail_cache &&
+            h == (m_tail_cache = tail().load(std::memory_order_acquire)))
             // queue is empty:
             return false;
 
@@ -282,6 +492,70 @@ public:
         return true;
     }
 
+    /// Move (or copy) the value at the front of the queue to \a a_item,
+    /// blocking on a futex while the queue is empty. The queue must be created
+    /// with blocking enabled, so that the producer wakes up the consumer when
+    /// the queue becomes non-empty.
+    /// @param a_timeout max time to wait (nanoseconds::max() - infinity)
+    /// @param a_spins   number of polls of the queue before blocking
+    /// @return false if the queue remained empty for \a a_timeout
+    bool pop_wait
+    (
+        T&                       a_item,
+        std::chrono::nanoseconds a_timeout = std::chrono::nanoseconds::max(),
+        uint32_t                 a_spins   = 64
+    )
+    {
+        for (uint32_t i = 0; i <= a_spins; ++i)
+            if (pop(a_item))
+                return true;
+
+        if (unlikely(!m_header_ptr->m_blocking))
+            UTXX_THROW_RUNTIME_ERROR("Queue is not in blocking mode");
+
+        using clock   = std::chrono::steady_clock;
+        bool infinite = a_timeout == std::chrono::nanoseconds::max();
+        auto deadline = infinite ? clock::time_point()
+                                 : clock::now() + a_timeout;
+        auto& hdr     = *m_header_ptr;
+
+        while (true) {
+            int seq = hdr.m_futex.load(std::memory_order_acquire);
+
+            // Announce ourselves to the producer and check the queue again,
+            // so that either we see the new item, or the producer sees us
+            // waiting (see notify()):
+            hdr.m_waiters.fetch_add(1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+
+            if (pop(a_item)) {
+                hdr.m_waiters.fetch_sub(1, std::memory_order_relaxed);
+                return true;
+            }
+
+            struct timespec ts, *pts = nullptr;
+            if (!infinite) {
+                auto left = std::chrono::duration_cast<std::chrono::nanoseconds>
+                            (deadline - clock::now()).count();
+                if (left <= 0) {
+                    hdr.m_waiters.fetch_sub(1, std::memory_order_relaxed);
+                    return false;
+                }
+                ts  = { time_t(left / 1000000000L), long(left % 1000000000L) };
+                pts = &ts;
+            }
+
+            auto res = futex_wait_slow(reinterpret_cast<int*>(&hdr.m_futex),
+                                       seq, pts);
+            hdr.m_waiters.fetch_sub(1, std::memory_order_relaxed);
+
+            if (pop(a_item))
+                return true;
+            if (unlikely(res == wakeup_result::ERROR))
+                UTXX_THROW_IO_ERROR(errno, "Error waiting on queue futex");
+        }
+    }
+
     /// Pop an element from the front of the queue.
     /// Queue must not be empty!
     void pop()
@@ -308,7 +582,8 @@ public:
 
         uint32_t h = head().load(std::memory_order_relaxed);
         return
-            (h == tail().load(std::memory_order_acquire))
+            (h == m_tail_cache &&
+             h == (m_tail_cache = tail().load(std::memory_order_acquire)))
             ? nullptr    // queue is empty
             : (m_rec_ptr + h);
     }
@@ -321,6 +596,94 @@ public:
               (const_cast<concurrent_spsc_queue const*>(this)->peek());
     }
 
+    /// Pointer to the value located \a a_offset entries past the front of the
+    /// queue (for use in-place) or nullptr if the queue has fewer entries.
+    /// This allows the Consumer to look ahead before popping the entries.
+    T const* peek(uint32_t a_offset) const
+    {
+        assert(m_side != side_t::producer);
+
+        uint32_t h = head().load(std::memory_order_relaxed);
+        if (((m_tail_cache - h) & m_mask) <= a_offset)
+            m_tail_cache = tail().load(std::memory_order_acquire);
+        uint32_t t = m_tail_cache;
+        return (((t - h) & m_mask) > a_offset)
+             ? (m_rec_ptr + increment(h, a_offset))
+             : nullptr;
+    }
+
+    //-----------------------------------------------------------------------//
+    // Zero-Copy Batch operations:                                           //
+    //-----------------------------------------------------------------------//
+    /// Reserve up to \a a_n contiguous free slots at the tail of the queue,
+    /// to be filled in-place by the Producer and published by commit_write().
+    /// The slots are uninitialized memory, so unless T is trivial, the items
+    /// must be constructed in them with placement new.
+    /// @param a_n on input - the max number of slots; on output - the number
+    ///            of reserved slots (less than requested when the queue is
+    ///            nearly full, or when the free space wraps around the end of
+    ///            the ring buffer)
+    /// @return pointer to the first slot, or nullptr if the queue is full
+    T* begin_write(uint32_t& a_n)
+    {
+        assert(m_side != side_t::consumer);
+
+        uint32_t t = tail().load(std::memory_order_relaxed);
+        uint32_t n = std::min(a_n, free_from(t));
+        if (n < a_n) {
+            m_head_cache = head().load(std::memory_order_acquire);
+            n = std::min(a_n, free_from(t));
+        }
+        a_n = n;
+        return n ? m_rec_ptr + t : nullptr;
+    }
+
+    /// Publish \a a_n items written to the slots returned by begin_write()
+    void commit_write(uint32_t a_n)
+    {
+        assert(m_side != side_t::consumer);
+
+        uint32_t t = tail().load(std::memory_order_relaxed);
+        assert(a_n <= free_from(t));
+        tail().store(increment(t, a_n), std::memory_order_release);
+        if (unlikely(m_header_ptr->m_blocking))
+            notify();
+    }
+
+    /// Get up to \a a_n contiguous items at the front of the queue for use
+    /// in-place by the Consumer. The items stay in the queue until removed by
+    /// release().
+    /// @param a_n on input - the max number of items; on output - the number
+    ///            of available items (they may be fewer than the queue holds,
+    ///            when the items wrap around the end of the ring buffer)
+    /// @return pointer to the first item, or nullptr if the queue is empty
+    T* peek_batch(uint32_t& a_n)
+    {
+        assert(m_side != side_t::producer);
+
+        uint32_t h = head().load(std::memory_order_relaxed);
+        uint32_t n = std::min(a_n, used_from(h));
+        if (n < a_n) {
+            m_tail_cache = tail().load(std::memory_order_acquire);
+            n = std::min(a_n, used_from(h));
+        }
+        a_n = n;
+        return n ? m_rec_ptr + h : nullptr;
+    }
+
+    /// Remove \a a_n items returned by peek_batch() from the queue
+    void release(uint32_t a_n)
+    {
+        assert(m_side != side_t::producer);
+
+        uint32_t h = head().load(std::memory_order_relaxed);
+        assert(a_n <= used_from(h));
+        if (!std::is_trivially_destructible<T>::value)
+            for (uint32_t i = 0; i < a_n; ++i)
+                m_rec_ptr[h + i].~T();
+        head().store(increment(h, a_n), std::memory_order_release);
+    }
+
     /// Clear: Remove all entries from the queue. Only safe if invoked on the
     /// Consumer side:
     void clear(bool force = false)
@@ -346,8 +709,9 @@ public:
     bool empty() const
     {
         assert(m_side != side_t::producer);
-        return head().load(std::memory_order_relaxed)
-            == tail().load(std::memory_order_acquire);
+        uint32_t h = head().load(std::memory_order_relaxed);
+        return h == m_tail_cache &&
+               h == (m_tail_cache = tail().load(std::memory_order_acquire));
     }
 
     /// Test for the queue begin full, safe if invoked from the producer side.
@@ -358,8 +722,9 @@ public:
     bool full() const
     {
         assert(m_side != side_t::consumer);
-        uint32_t next =  increment(tail().load(std::memory_order_relaxed));
-        return   next == head().load(std::memory_order_acquire);
+        uint32_t next = increment(tail().load(std::memory_order_relaxed));
+        return next == m_head_cache &&
+               next == (m_head_cache = head().load(std::memory_order_acquire));
     }
 
     /// Return current count of T objects stored in the queue.
@@ -405,6 +770,9 @@ public:
     /// Queue Capacity (static or dynamic):
     uint32_t capacity() const { return m_header.m_capacity; }
 
+    /// True if push() wakes up a consumer blocked in pop_wait()
+    bool blocking() const { return m_header_ptr->m_blocking; }
+
     //=======================================================================//
     // UNSAFE iterators over the queue:                                      //
     //=======================================================================//
@@ -736,8 +1104,47 @@ private:
     bool     const  m_shared_data;
     side_t          m_side;
     uint32_t const  m_mask;
+    size_t          m_shm_size;     // Size of the segment mapped by us (or 0)
+    // Each side's copy of the other side's index is on its own cache line.
+    // It is only refreshed when the queue looks full (or empty), so that
+    // the producer and the consumer mostly access their own cache lines:
+    char            __pad0[UTXX_CL_SIZE];
+    mutable uint32_t m_head_cache;  // Producer's copy of the head
+    char            __pad1[UTXX_CL_SIZE - sizeof(uint32_t)];
+    mutable uint32_t m_tail_cache;  // Consumer's copy of the tail
+    char            __pad2[UTXX_CL_SIZE - sizeof(uint32_t)];
     T               m_records[StaticCapacity];
 
+    //-----------------------------------------------------------------------//
+    // Contiguous free / used slots according to the cached indices:         //
+    //-----------------------------------------------------------------------//
+    // Free slots start at the tail "t" and end before the head (one slot is
+    // always kept empty), used slots start at the head "h" and end before the
+    // tail. Either range is cut at the end of the ring buffer:
+    //
+    uint32_t free_from(uint32_t t) const
+      { return std::min((m_head_cache - t - 1) & m_mask, m_mask + 1 - t); }
+
+    uint32_t used_from(uint32_t h) const
+      { return std::min((m_tail_cache - h) & m_mask, m_mask + 1 - h); }
+
+    //-----------------------------------------------------------------------//
+    // "notify":                                                             //
+    //-----------------------------------------------------------------------//
+    // Wake up the consumer blocked in pop_wait(). The fence orders the store
+    // of "tail" in push() before the load of "m_waiters" (it is paired with
+    // the fence in pop_wait()). As the consumer only waits on an empty queue,
+    // the futex is only signaled on the empty -> non-empty transition:
+    //
+    void notify()
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (m_header_ptr->m_waiters.load(std::memory_order_relaxed) == 0)
+            return;
+        m_header_ptr->m_futex.fetch_add(1, std::memory_order_release);
+        futex_wake_slow(reinterpret_cast<int*>(&m_header_ptr->m_futex));
+    }
+
     //-----------------------------------------------------------------------//
     // Accessors (for internal use only):                                    //
     //-----------------------------------------------------------------------//
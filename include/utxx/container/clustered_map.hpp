@@ -40,7 +40,9 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include <boost/mpl/if.hpp>
 #include <boost/mpl/int.hpp>
 #include <utxx/bitmap.hpp>
-#include <map>
+#include <utxx/compiler_hints.hpp>
+#include <vector>
+#include <memory>
 #include <functional>
 
 namespace utxx {
@@ -48,6 +50,14 @@ namespace utxx {
 struct ascending {};
 struct desending {};
 
+/// Map of keys clustered in groups of 2^LowBits adjacent keys.
+///
+/// The level-1 index of groups is a sorted array of the groups' keys (8
+/// keys per cache line), searched with a branchless binary search, with a
+/// parallel array of pointers to the groups. The groups are allocated
+/// separately, so that the data references returned by insert()/at() remain
+/// valid until the key is erased, while iterators are invalidated by adding
+/// or removing a group.
 template <
     class Key,
     class Data,
@@ -60,6 +70,7 @@ class clustered_map {
     typedef bitmap_low<1 << LowBits> bitmap_t;
     static const size_t s_lo_mask = (1 << LowBits) - 1;
     static const size_t s_hi_mask = ~s_lo_mask;
+    static const size_t s_npos    = size_t(-1);
     static const int    s_level2_init_value =
         boost::is_same<SortOrder, ascending>::value ? -1 : bitmap_t::cend;
 
@@ -68,119 +79,135 @@ class clustered_map {
         Data        data[1 << LowBits];
     };
 
-    typedef std::map<
-        Key,
-        key_data,
-        typename boost::mpl::if_<
-            boost::is_same<SortOrder, ascending>,
-            std::less<Key>, std::greater<Key>
-        >::type
-    > gross_map;
+    typedef typename boost::mpl::if_<
+        boost::is_same<SortOrder, ascending>,
+        std::less<Key>, std::greater<Key>
+    >::type key_compare;
 
-    typedef typename gross_map::iterator l1_iterator;
+    typedef std::unique_ptr<key_data> group_ptr;
 
-    gross_map m_map;
+    std::vector<Key>        m_keys;     // Sorted keys of the groups
+    std::vector<group_ptr>  m_groups;   // Groups in the order of m_keys
+    std::vector<group_ptr>  m_free;     // Groups of erased keys for reuse
 
     /* Two mru slots are used to cover cases of lookup oscilations
-     * between keys on the boundary of adjucent groups to cache
-     * slow lookups in the gross_map */
-    typename gross_map::iterator m_mru[2];
-
-    bool mru_map_lookup(size_t a_hi, typename gross_map::iterator& a_it) {
-        if (!mru_lookup(a_hi, a_it)) {
-            a_it = m_map.find(a_hi);
-            if (a_it != m_map.end()) {
-                m_mru[1] = m_mru[0];
-                m_mru[0] = a_it;
-                return true;
-            }
-            return false;
+     * between keys on the boundary of adjucent groups. They hold positions
+     * in m_keys, which are validated by comparing the key at the position.
+     * They are only updated by non-const lookups, so that const lookups
+     * can be made concurrently */
+    size_t m_mru[2];
+
+    /// Position of the first group key not ordered before \a a_hi
+    size_t l1_lower_bound(Key a_hi) const {
+        size_t n = m_keys.size();
+        if (!n)
+            return 0;
+        const Key* base = m_keys.data();
+        key_compare less;
+        while (n > 1) {
+            size_t half = n / 2;
+            base = less(base[half], a_hi) ? base + half : base;
+            n   -= half;
         }
-        return true;
+        return (base - m_keys.data()) + less(*base, a_hi);
     }
 
-    // NB: iterator unchanged if it's not in MRU cache
-    bool mru_lookup(size_t a_hi, typename gross_map::iterator& a_it) {
-        if (m_mru[0] == m_map.end())
-            return false;
-        else if (m_mru[0]->first == a_hi)
-            a_it = m_mru[0];
-        else if (m_mru[1] == m_map.end())
-            return false;
-        else if (m_mru[1]->first == a_hi) {
-            std::swap(m_mru[0], m_mru[1]);
-            a_it = m_mru[1];
-        } else
-            return false;
-        return true;
+    /// Position of the group \a a_hi in m_keys, or s_npos if not found
+    size_t l1_find(Key a_hi) const {
+        size_t n = m_keys.size();
+        if (likely(m_mru[0] < n && m_keys[m_mru[0]] == a_hi))
+            return m_mru[0];
+        if (m_mru[1] < n && m_keys[m_mru[1]] == a_hi)
+            return m_mru[1];
+        size_t i = l1_lower_bound(a_hi);
+        return i == n || m_keys[i] != a_hi ? s_npos : i;
     }
 
-    void update_mru(typename gross_map::iterator& a_it) {
-        if (m_mru[0] != a_it && a_it != m_map.end()) {
+    /// Same as above, and make the found group the most recently used one
+    size_t l1_find(Key a_hi) {
+        size_t i = static_cast<const clustered_map&>(*this).l1_find(a_hi);
+        if (i != s_npos && i != m_mru[0]) {
             m_mru[1] = m_mru[0];
-            m_mru[0] = a_it;
+            m_mru[0] = i;
         }
+        return i;
     }
 
+    key_data& group(size_t a_l1) const { return *m_groups[a_l1]; }
+
     std::pair<bool, Data*> ensure(size_t a_hi, size_t a_lo) {
-        typename gross_map::iterator it; // FIXME: should we init it to m_map.end()?
-        bool found = mru_map_lookup(a_hi, it);
+        size_t i     = l1_find(a_hi);
+        bool   found = i != s_npos;
         if (!found) {
-            std::pair<typename gross_map::iterator, bool> res =
-                m_map.insert(std::make_pair(a_hi, key_data()));
-            it = res.first;
-            update_mru(it);
+            i = l1_lower_bound(a_hi);
+            group_ptr g;
+            if (m_free.empty())
+                g.reset(new key_data());
+            else {
+                g = std::move(m_free.back());
+                m_free.pop_back();
+                *g = key_data();
+            }
+            m_keys.insert(m_keys.begin() + i, a_hi);
+            m_groups.insert(m_groups.begin() + i, std::move(g));
+            m_mru[1] = m_mru[0];
+            m_mru[0] = i;
         } else
-            found = it->second.index[a_lo];
+            found = group(i).index[a_lo];
 
-        it->second.index.set(a_lo);
-        return std::make_pair(found, &it->second.data[a_lo]);
+        group(i).index.set(a_lo);
+        return std::make_pair(found, &group(i).data[a_lo]);
+    }
+
+    void erase_group(size_t a_l1) {
+        m_free.push_back(std::move(m_groups[a_l1]));
+        m_groups.erase(m_groups.begin() + a_l1);
+        m_keys.erase(m_keys.begin() + a_l1);
     }
 
 public:
-    typedef typename gross_map::key_type    key_type;
-    typedef typename gross_map::mapped_type mapped_type;
-    typedef typename gross_map::value_type  value_type;
+    typedef Key                       key_type;
+    typedef key_data                  mapped_type;
+    typedef std::pair<const Key, key_data> value_type;
 
     class const_iterator;
     class iterator;
 
     clustered_map() {
-        m_mru[0] = m_map.end();
-        m_mru[1] = m_map.end();
+        m_mru[0] = s_npos;
+        m_mru[1] = s_npos;
     }
 
-    iterator        begin() { return iterator(m_map, m_map.begin()); }
-    iterator        end()   { return iterator(m_map, m_map.end(), bitmap_t::cend); }
+    iterator        begin() { return iterator(*this, 0); }
+    iterator        end()   { return iterator(*this, m_keys.size(), bitmap_t::cend); }
 
-    const_iterator  begin() const { return const_iterator(m_map, m_map.begin()); }
-    const_iterator  end()   const { return const_iterator(m_map, m_map.end(), bitmap_t::cend);   }
+    const_iterator  begin() const { return const_iterator(*this, 0); }
+    const_iterator  end()   const { return const_iterator(*this, m_keys.size(), bitmap_t::cend);   }
 
     /// Total number of clustered key groups
-    size_t group_count() const { return m_map.size(); }
+    size_t group_count() const { return m_keys.size(); }
     /// Number of items in the cluster group associated with the \a a_key.
     size_t item_count(Key a_key) const {
-        typename gross_map::const_iterator it = m_map.find(a_key & s_hi_mask);
-        return it == m_map.end() ? 0 : it->second.index.count();
+        size_t i = l1_find(a_key & s_hi_mask);
+        return i == s_npos ? 0 : group(i).index.count();
     }
 
     /// Return the data pointer associated with the \a a_key entry
     /// in the container. If the \a a_key is not found, return NULL.
     Data* at(Key a_key) {
-        typename gross_map::iterator it;
-        if (!mru_map_lookup(a_key & s_hi_mask, it))
+        size_t i = l1_find(a_key & s_hi_mask);
+        if (i == s_npos)
             return NULL;
-        return it->second.index[a_key & s_lo_mask]
-            ? &it->second.data[a_key & s_lo_mask]
-            : NULL;
+        key_data& g = group(i);
+        return g.index[a_key & s_lo_mask] ? &g.data[a_key & s_lo_mask] : NULL;
     }
 
     iterator find(Key a_key) {
-        typename gross_map::iterator it;
-        if (!mru_map_lookup(a_key& s_hi_mask, it))
+        size_t i = l1_find(a_key & s_hi_mask);
+        if (i == s_npos)
             return end();
         size_t l2 = a_key & s_lo_mask;
-        return it->second.index[l2] ? iterator(m_map, it, l2) : end();
+        return group(i).index[l2] ? iterator(*this, i, l2) : end();
     }
 
     /// Insert an entry in the container associated with the \a a_key.
@@ -206,19 +233,21 @@ public:
 
     /// Erase given key from the container
     bool erase(Key a_key) {
-        iterator it(m_map, a_key);
-        return erase(it);
+        size_t i = l1_find(a_key & s_hi_mask);
+        return i != s_npos && erase(iterator(*this, i, a_key & s_lo_mask));
     }
 
     /// Clears the container
     void clear() {
-        m_map.clear();
-        m_mru[0] = m_map.end();
-        m_mru[1] = m_map.end();
+        m_keys.clear();
+        m_groups.clear();
+        m_free.clear();
+        m_mru[0] = s_npos;
+        m_mru[1] = s_npos;
     }
 
     /// Returns true when the container is empty
-    bool empty() const { return m_map.empty(); }
+    bool empty() const { return m_keys.empty(); }
 
     template <class Visitor, class State>
     void for_each(Visitor& a_visit, State& a_state) {
@@ -230,28 +259,30 @@ public:
 template <class Key, class Data, int LowBits, class SortOrder>
 class clustered_map<Key, Data, LowBits, SortOrder>::iterator
 {
-    gross_map*   m_owner;
-    l1_iterator  m_level1;
-    int          m_level2;
+    clustered_map* m_owner;
+    size_t         m_level1;
+    int            m_level2;
 
-    int find_first_level2() {
-        if (m_level1 == m_owner->end())
+    bool at_end() const { return m_level1 >= m_owner->m_keys.size(); }
+
+    int find_first_level2() const {
+        if (at_end())
             return s_level2_init_value;
         return boost::is_same<SortOrder, ascending>::value
-            ? m_level1->second.index.first()
-            : m_level1->second.index.last();
+            ? m_owner->group(m_level1).index.first()
+            : m_owner->group(m_level1).index.last();
     }
 
-    int find_next_level2(int a_level2 = s_level2_init_value) {
-        if (m_level1 == m_owner->end())
+    int find_next_level2(int a_level2 = s_level2_init_value) const {
+        if (at_end())
             return a_level2;
+        const bitmap_t& index = m_owner->group(m_level1).index;
         return boost::is_same<SortOrder, ascending>::value
-            ? m_level1->second.index.next(a_level2)
-            : m_level1->second.index.prev(a_level2);
+            ? index.next(a_level2)
+            : a_level2 == bitmap_t::cend ? index.last() : index.prev(a_level2);
     }
 
-    l1_iterator& level1() { return m_level1; }
-    int&         level2() { return m_level2; }
+    size_t level1() const { return m_level1; }
 
     friend class clustered_map<Key, Data, LowBits, SortOrder>;
 public:
@@ -259,52 +290,31 @@ public:
     using reference       = Data&;
     using const_reference = Data const&;
 
-    iterator() : m_level2(s_level2_init_value) {}
-
-    iterator(gross_map& a_map, Key a_key)
-        : m_owner(&a_map)
-        , m_level1(a_map.find(a_key & s_hi_mask))
-        , m_level2(a_key & s_lo_mask)
-    {
-        if (m_level1 == a_map.end())
-            m_level2 = bitmap_t::cend;
-        else if (!m_level1->second.index.is_set(m_level2))
-            m_level2 = find_next_level2(m_level2);
-    }
+    iterator() : m_owner(NULL), m_level1(0), m_level2(s_level2_init_value) {}
 
-    iterator(gross_map& a_map, const l1_iterator& a_level1)
+    iterator(clustered_map& a_map, size_t a_level1)
         : m_owner(&a_map)
         , m_level1(a_level1)
         , m_level2(find_first_level2())
     {}
 
-    iterator(gross_map& a_map, const l1_iterator& a_level1, int a_level2)
+    iterator(clustered_map& a_map, size_t a_level1, int a_level2)
         : m_owner(&a_map)
         , m_level1(a_level1)
         , m_level2(a_level2)
     {}
 
-    iterator(const iterator& a_rhs)
-        : m_owner(a_rhs.m_owner)
-        , m_level1(a_rhs.m_level1)
-        , m_level2(a_rhs.m_level2)
-    {}
-
     Key key() const {
-        BOOST_ASSERT(m_level1 != m_owner->end());
-        return m_level1->first | m_level2;
+        BOOST_ASSERT(!at_end());
+        return m_owner->m_keys[m_level1] | m_level2;
     }
 
-    Data&       data()                      { return m_level1->second.data[m_level2]; } //return this->second.data[m_level2]; }
-    const Data& data()              const   { return m_level1->second.data[m_level2]; }
+    Data&       data()                      { return m_owner->group(m_level1).data[m_level2]; }
+    const Data& data()              const   { return m_owner->group(m_level1).data[m_level2]; }
 
-    typename gross_map::iterator&       group()       { return m_level1; }
-    typename gross_map::const_iterator& group() const {
-        assert(m_owner);
-        return const_iterator(*m_owner, m_level1, m_level2);
-    }
-
-    size_t      item_count()        const   { return m_level1->index.count(); }
+    /// Key of the group of the current item
+    Key         group_key()         const   { return m_owner->m_keys[m_level1]; }
+    size_t      item_count()        const   { return m_owner->group(m_level1).index.count(); }
     int         item()              const   { return m_level2; }
     static const int  end_item()            { return bitmap_t::cend; }
     int         first_item_idx()    const   { return find_first_level2(); }
@@ -312,12 +322,12 @@ public:
 
     Data* first_item() {
         m_level2 = find_first_level2();
-        return m_level2 == end_item() ? NULL : &m_level1->second.data[m_level2];
+        return m_level2 == end_item() ? NULL : &data();
     }
 
     Data* next_item() {
         m_level2 = find_next_level2(m_level2);
-        return m_level2 == end_item() ? NULL : &m_level1->second.data[m_level2];
+        return m_level2 == end_item() ? NULL : &data();
     }
 
     bool operator== (const iterator& a_rhs) const {
@@ -328,14 +338,14 @@ public:
         return (m_level1 != a_rhs.m_level1) || item() != a_rhs.item();
     }
 
-    pointer         operator->() const  { return &m_level1->second.data[m_level2]; }
-    reference       operator*()         { return  m_level1->second.data[m_level2]; }
-    const_reference operator*()  const  { return  m_level1->second.data[m_level2]; }
+    pointer         operator->() const  { return &m_owner->group(m_level1).data[m_level2]; }
+    reference       operator*()         { return  data(); }
+    const_reference operator*()  const  { return  data(); }
 
     bool find_first_key() {
-        m_level1 = m_owner->begin();
+        m_level1 = 0;
         m_level2 = find_first_level2();
-        return m_level1 != m_owner->end() && m_level2 != bitmap_t::cend;
+        return !at_end() && m_level2 != bitmap_t::cend;
     }
 
     iterator& operator++() {
@@ -346,8 +356,9 @@ public:
                 return *this;
             ++m_level1;
             n = s_level2_init_value;
-        } while (m_level1 != m_owner->end());
+        } while (!at_end());
 
+        m_level2 = bitmap_t::cend;
         return *this;
     }
 };
@@ -360,32 +371,26 @@ public:
     typedef typename clustered_map::iterator base;
 
     const_iterator() : base() {}
-    const_iterator(gross_map& a_map, typename gross_map::const_iterator& a_level1)
-        : base(a_map, a_level1)
-    {}
-
-    const_iterator(gross_map& a_map, typename gross_map::const_iterator& a_level1, int a_level2)
-        : base(a_map, a_level1, a_level2)
+    const_iterator(const clustered_map& a_map, size_t a_level1)
+        : base(const_cast<clustered_map&>(a_map), a_level1)
     {}
 
-    const_iterator(const const_iterator& a_rhs)
-        : base(a_rhs)
+    const_iterator(const clustered_map& a_map, size_t a_level1, int a_level2)
+        : base(const_cast<clustered_map&>(a_map), a_level1, a_level2)
     {}
 };
 
 template <class Key, class Data, int LowBits, class SortOrder>
 bool clustered_map<Key, Data, LowBits, SortOrder>::
 erase(iterator a_it) {
-    if (m_map.find(a_it.level1()->first) == m_map.end())
+    if (a_it.at_end() || a_it.item() == bitmap_t::cend)
         return false;
-    if (!a_it.level1()->second.index.is_set(a_it.item()))
+    key_data& g = group(a_it.level1());
+    if (!g.index.is_set(a_it.item()))
         return false;
-    a_it.level1()->second.index.clear(a_it.item());
-    if (a_it.level1()->second.index.empty()) {
-        m_map.erase(a_it.level1());
-        if (m_mru[1] == a_it.level1()) m_mru[1] = m_map.end();
-        if (m_mru[0] == a_it.level1()) m_mru[0] = m_mru[1];
-    }
+    g.index.clear(a_it.item());
+    if (g.index.empty())
+        erase_group(a_it.level1());
     return true;
 }
 
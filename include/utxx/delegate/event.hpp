@@ -152,6 +152,9 @@ namespace utxx
                     ++it;
         }
 
+        /// True if no event sinks are connected
+        bool empty() const { return m_sinks.empty(); }
+
         /// Notify all event sinks
         template <class TInvoker>
         void emit(TInvoker const& invoker)
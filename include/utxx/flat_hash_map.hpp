@@ -0,0 +1,936 @@
+// vim:ts=4:et:sw=4
+//----------------------------------------------------------------------------
+/// \file   flat_hash_map.hpp
+/// \author Serge Aleynikov
+//----------------------------------------------------------------------------
+/// \brief Open-addressing hash map with SIMD probing of control bytes.
+///
+/// The design follows the "Swiss table" (absl::flat_hash_map): values are
+/// stored inline in a flat array of slots, and every slot has a control byte
+/// holding either 7 bits of the hash of its key, or the EMPTY/DELETED marker.
+/// A lookup compares the control bytes of a group of 16 slots (32 with AVX2,
+/// 8 without SSE2) with the key's hash bits in a few instructions, and only
+/// compares the keys of the matching slots, so that a typical lookup touches
+/// one cache line of control bytes and one slot.
+///
+/// The map is a drop-in replacement of detail::basic_hash_map/unordered_map
+/// for the common usage (same constructors, operator[], find(), insert(),
+/// erase(), iteration over std::pair<const K, V>), except that:
+///   - inserting may move the values and invalidates iterators and references;
+///   - there's no bucket interface.
+///
+/// With the default flat_hash<K>/flat_equal_to<K> functors the maps keyed by
+/// std::string, std::string_view, nchar<N> or name_t support heterogeneous
+/// lookup (find(), count(), contains(), at(), erase()) by any of the other
+/// string-like types without constructing a temporary key.
+//----------------------------------------------------------------------------
+// Created: 2026-10-16
+//----------------------------------------------------------------------------
+/*
+ ***** BEGIN LICENSE BLOCK *****
+
+ This file is part of the utxx open-source project.
+
+ Copyright (C) 2026 Serge Aleynikov <saleyn@gmail.com>
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public
+ License as published by the Free Software Foundation; either
+ version 2.1 of the License, or (at your option) any later version.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+ ***** END LICENSE BLOCK *****
+*/
+#pragma once
+
+#include <utxx/compiler_hints.hpp>
+#include <utxx/nchar.hpp>
+#include <utxx/name.hpp>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#  include <immintrin.h>
+#endif
+
+namespace utxx {
+
+//----------------------------------------------------------------------------
+// Hash and equality functors
+//----------------------------------------------------------------------------
+/// View of the characters of a string-like key (an nchar is viewed up to its
+/// first '\0')
+inline std::string_view flat_string_view(std::string_view a) { return a; }
+
+template <int N>
+inline std::string_view flat_string_view(const detail::basic_nchar<N>& a)
+{
+    return std::string_view(a.data(), ::strnlen(a.data(), N));
+}
+
+/// Transparent hash of string-like keys (std::string, std::string_view,
+/// const char*, nchar<N>)
+struct flat_string_hash {
+    typedef void is_transparent;
+
+    template <class T>
+    size_t operator()(const T& a) const
+    {
+        return std::hash<std::string_view>()(flat_string_view(a));
+    }
+};
+
+struct flat_string_equal {
+    typedef void is_transparent;
+
+    template <class T, class U>
+    bool operator()(const T& a, const U& b) const
+    {
+        return flat_string_view(a) == flat_string_view(b);
+    }
+};
+
+/// Transparent hash of name_t keys, which can also be looked up by their
+/// string representation
+struct flat_name_hash {
+    typedef void is_transparent;
+
+    /// Convert \a a to \a a_name.
+    /// @return false if \a a is not a valid name
+    static bool to_name(std::string_view a, name_t& a_name)
+    {
+        return a.size() <= name_t::size()
+            && a_name.set(a.data(), a.size()) == 0;
+    }
+
+    size_t operator()(const name_t& a) const { return a.to_int(); }
+
+    template <class T>
+    size_t operator()(const T& a) const
+    {
+        name_t n;
+        return to_name(flat_string_view(a), n) ? n.to_int() : 0;
+    }
+};
+
+struct flat_name_equal {
+    typedef void is_transparent;
+
+    bool operator()(const name_t& a, const name_t& b) const { return a == b; }
+
+    template <class T>
+    bool operator()(const name_t& a, const T& b) const
+    {
+        name_t n;
+        return flat_name_hash::to_name(flat_string_view(b), n) && a == n;
+    }
+};
+
+template <class K> struct flat_hash     : std::hash<K>     {};
+template <class K> struct flat_equal_to : std::equal_to<K> {};
+
+template <> struct flat_hash<std::string>          : flat_string_hash  {};
+template <> struct flat_hash<std::string_view>     : flat_string_hash  {};
+template <int N> struct flat_hash<nchar<N>>        : flat_string_hash  {};
+template <> struct flat_hash<name_t>               : flat_name_hash    {};
+template <> struct flat_equal_to<std::string>      : flat_string_equal {};
+template <> struct flat_equal_to<std::string_view> : flat_string_equal {};
+template <int N> struct flat_equal_to<nchar<N>>    : flat_string_equal {};
+template <> struct flat_equal_to<name_t>           : flat_name_equal   {};
+
+namespace detail {
+
+    //------------------------------------------------------------------------
+    // Control bytes: a full slot has the 7 low bits of its key's hash (H2)
+    //------------------------------------------------------------------------
+    typedef int8_t flat_ctrl;
+
+    enum : flat_ctrl {
+        FLAT_EMPTY    = -128,   // 0b10000000
+        FLAT_DELETED  = -2,     // 0b11111110
+        FLAT_SENTINEL = -1      // 0b11111111 (marks the end of the table)
+    };
+
+    /// Set of slots of a group matching a condition. A slot is represented
+    /// by 1 << Shift bits of the mask.
+    template <int Width, int Shift>
+    class flat_bitmask {
+        uint64_t m_mask;
+    public:
+        explicit flat_bitmask(uint64_t a) : m_mask(a) {}
+
+        explicit operator bool() const { return m_mask != 0; }
+
+        /// Offset of the first matching slot
+        uint32_t lowest() const { return __builtin_ctzll(m_mask) >> Shift; }
+        void     next()         { m_mask &= m_mask - 1; }
+
+        /// Number of non-matching slots at the beginning of the group
+        uint32_t trailing_zeros() const { return m_mask ? lowest() : Width; }
+
+        /// Number of non-matching slots at the end of the group
+        uint32_t leading_zeros()  const
+        {
+            return m_mask ? (__builtin_clzll(m_mask)
+                             - (64 - (Width << Shift))) >> Shift
+                          : Width;
+        }
+    };
+
+#if defined(__AVX2__)
+    struct flat_group {
+        static constexpr size_t s_width = 32;
+        typedef flat_bitmask<32, 0> bitmask;
+
+        explicit flat_group(const flat_ctrl* a)
+            : m_ctrl(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(a)))
+        {}
+
+        bitmask match(flat_ctrl a_h2) const
+            { return mask(_mm256_set1_epi8(a_h2)); }
+        bitmask match_empty() const
+            { return mask(_mm256_set1_epi8(FLAT_EMPTY)); }
+
+        bitmask match_empty_or_deleted() const
+        {
+            auto s = _mm256_set1_epi8(FLAT_SENTINEL);
+            return bitmask(uint32_t(_mm256_movemask_epi8(
+                                        _mm256_cmpgt_epi8(s, m_ctrl))));
+        }
+    private:
+        __m256i m_ctrl;
+
+        bitmask mask(__m256i a) const
+        {
+            return bitmask(uint32_t(_mm256_movemask_epi8(
+                                        _mm256_cmpeq_epi8(a, m_ctrl))));
+        }
+    };
+#elif defined(__SSE2__)
+    struct flat_group {
+        static constexpr size_t s_width = 16;
+        typedef flat_bitmask<16, 0> bitmask;
+
+        explicit flat_group(const flat_ctrl* a)
+            : m_ctrl(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a)))
+        {}
+
+        bitmask match(flat_ctrl a_h2) const
+            { return mask(_mm_set1_epi8(a_h2)); }
+        bitmask match_empty() const
+            { return mask(_mm_set1_epi8(FLAT_EMPTY)); }
+
+        bitmask match_empty_or_deleted() const
+        {
+            auto s = _mm_set1_epi8(FLAT_SENTINEL);
+            return bitmask(uint32_t(_mm_movemask_epi8(
+                                        _mm_cmpgt_epi8(s, m_ctrl))));
+        }
+    private:
+        __m128i m_ctrl;
+
+        bitmask mask(__m128i a) const
+        {
+            return bitmask(uint32_t(_mm_movemask_epi8(
+                                        _mm_cmpeq_epi8(a, m_ctrl))));
+        }
+    };
+#else
+    // Portable group of 8 control bytes in a 64-bit word (little-endian).
+    // match() may return false positives, which are filtered out by the key
+    // comparison.
+    struct flat_group {
+        static constexpr size_t s_width = 8;
+        typedef flat_bitmask<8, 3> bitmask;
+
+        explicit flat_group(const flat_ctrl* a) { memcpy(&m_ctrl, a, 8); }
+
+        bitmask match(flat_ctrl a_h2) const
+        {
+            auto x = m_ctrl ^ (s_lsbs * uint8_t(a_h2));
+            return bitmask((x - s_lsbs) & ~x & s_msbs);
+        }
+
+        bitmask match_empty() const
+            { return bitmask(m_ctrl & ~(m_ctrl << 6) & s_msbs); }
+
+        bitmask match_empty_or_deleted() const
+            { return bitmask(m_ctrl & ~(m_ctrl << 7) & s_msbs); }
+    private:
+        static constexpr uint64_t s_lsbs = 0x0101010101010101ull;
+        static constexpr uint64_t s_msbs = 0x8080808080808080ull;
+        uint64_t m_ctrl;
+    };
+#endif
+
+    /// Control bytes of a map without slots
+    inline flat_ctrl* flat_empty_group()
+    {
+        alignas(32) static const flat_ctrl s_group[32] = {
+            FLAT_SENTINEL, FLAT_EMPTY, FLAT_EMPTY, FLAT_EMPTY,
+            FLAT_EMPTY,    FLAT_EMPTY, FLAT_EMPTY, FLAT_EMPTY,
+            FLAT_EMPTY,    FLAT_EMPTY, FLAT_EMPTY, FLAT_EMPTY,
+            FLAT_EMPTY,    FLAT_EMPTY, FLAT_EMPTY, FLAT_EMPTY,
+            FLAT_EMPTY,    FLAT_EMPTY, FLAT_EMPTY, FLAT_EMPTY,
+            FLAT_EMPTY,    FLAT_EMPTY, FLAT_EMPTY, FLAT_EMPTY,
+            FLAT_EMPTY,    FLAT_EMPTY, FLAT_EMPTY, FLAT_EMPTY,
+            FLAT_EMPTY,    FLAT_EMPTY, FLAT_EMPTY, FLAT_EMPTY
+        };
+        return const_cast<flat_ctrl*>(s_group);
+    }
+
+    template <class T, class = void>
+    struct flat_is_transparent : std::false_type {};
+
+    template <class T>
+    struct flat_is_transparent<T, std::void_t<typename T::is_transparent>>
+        : std::true_type {};
+
+    /// Type of the key argument of lookup functions: any type when the hash
+    /// and equality functors are transparent, and the key type otherwise
+    template <bool Transparent>
+    struct flat_key_arg {
+        template <class K2, class Key> using type = K2;
+    };
+
+    template <>
+    struct flat_key_arg<false> {
+        template <class K2, class Key> using type = Key;
+    };
+
+} // namespace detail
+
+//----------------------------------------------------------------------------
+/// Open-addressing hash map with SIMD probing of control bytes
+//----------------------------------------------------------------------------
+template <class K,
+          class V,
+          class Hash  = flat_hash<K>,
+          class Eq    = flat_equal_to<K>,
+          class Alloc = std::allocator<std::pair<const K, V>>>
+class flat_hash_map
+{
+    typedef detail::flat_ctrl  ctrl_t;
+    typedef detail::flat_group group;
+    typedef typename std::allocator_traits<Alloc>::
+        template rebind_alloc<char> char_alloc;
+
+    static constexpr size_t s_width = group::s_width;
+    static constexpr size_t s_npos  = size_t(-1);
+
+    template <class K2>
+    using key_arg = typename detail::flat_key_arg<
+        detail::flat_is_transparent<Hash>::value &&
+        detail::flat_is_transparent<Eq>::value>::template type<K2, K>;
+
+public:
+    typedef K                                   key_type;
+    typedef V                                   mapped_type;
+    typedef std::pair<const K, V>               value_type;
+    typedef size_t                              size_type;
+    typedef ptrdiff_t                           difference_type;
+    typedef Hash                                hasher;
+    typedef Eq                                  key_equal;
+    typedef Alloc                               allocator_type;
+    typedef value_type&                         reference;
+    typedef const value_type&                   const_reference;
+
+    static_assert(alignof(value_type) <= alignof(std::max_align_t),
+                  "Over-aligned values are not supported");
+
+    template <bool Const>
+    class iter {
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef flat_hash_map::value_type value_type;
+        typedef ptrdiff_t                 difference_type;
+        typedef typename std::conditional<Const, const value_type*,
+                                                 value_type*>::type pointer;
+        typedef typename std::conditional<Const, const value_type&,
+                                                 value_type&>::type reference;
+    private:
+        friend class flat_hash_map;
+        template <bool> friend class iter;
+
+        ctrl_t*     m_ctrl;
+        value_type* m_slot;
+
+        iter(ctrl_t* a_ctrl, value_type* a_slot)
+            : m_ctrl(a_ctrl), m_slot(a_slot)
+        {}
+
+        // Advance to a full slot or to the end of the table
+        void skip()
+        {
+            while (*m_ctrl < detail::FLAT_SENTINEL) { ++m_ctrl; ++m_slot; }
+        }
+    public:
+        iter() : m_ctrl(nullptr), m_slot(nullptr) {}
+
+        template <bool C = Const, class = typename std::enable_if<C>::type>
+        iter(const iter<false>& a) : m_ctrl(a.m_ctrl), m_slot(a.m_slot) {}
+
+        reference operator*()  const { return *m_slot; }
+        pointer   operator->() const { return  m_slot; }
+
+        iter& operator++()    { ++m_ctrl; ++m_slot; skip(); return *this; }
+        iter  operator++(int) { auto it = *this; ++*this; return it; }
+
+        template <bool C>
+        bool operator==(const iter<C>& a) const { return m_ctrl == a.m_ctrl; }
+        template <bool C>
+        bool operator!=(const iter<C>& a) const { return m_ctrl != a.m_ctrl; }
+    };
+
+    typedef iter<false> iterator;
+    typedef iter<true>  const_iterator;
+
+    //-----------------------------------------------------------------------//
+    // Ctors, Dtor                                                           //
+    //-----------------------------------------------------------------------//
+    flat_hash_map() : flat_hash_map(0) {}
+
+    explicit flat_hash_map(size_t       a_size,
+                           const Hash&  a_hash  = Hash(),
+                           const Eq&    a_eq    = Eq(),
+                           const Alloc& a_alloc = Alloc())
+        : m_ctrl       (detail::flat_empty_group())
+        , m_slots      (nullptr)
+        , m_size       (0)
+        , m_cap        (0)
+        , m_growth_left(0)
+        , m_hash       (a_hash)
+        , m_eq         (a_eq)
+        , m_alloc      (a_alloc)
+    {
+        if (a_size)
+            resize(capacity_for(a_size));
+    }
+
+    flat_hash_map(std::initializer_list<value_type> a_list)
+        : flat_hash_map(a_list.size())
+    {
+        insert(a_list.begin(), a_list.end());
+    }
+
+    flat_hash_map(const flat_hash_map& a)
+        : flat_hash_map(a.size(), a.m_hash, a.m_eq, a.m_alloc)
+    {
+        for (auto& v : a)
+            insert_value(v);
+    }
+
+    flat_hash_map(flat_hash_map&& a) noexcept
+        : m_ctrl       (a.m_ctrl)
+        , m_slots      (a.m_slots)
+        , m_size       (a.m_size)
+        , m_cap        (a.m_cap)
+        , m_growth_left(a.m_growth_left)
+        , m_hash       (std::move(a.m_hash))
+        , m_eq         (std::move(a.m_eq))
+        , m_alloc      (std::move(a.m_alloc))
+    {
+        a.reset();
+    }
+
+    ~flat_hash_map() { destroy(); }
+
+    flat_hash_map& operator=(const flat_hash_map& a)
+    {
+        if (this != &a) {
+            flat_hash_map tmp(a);
+            swap(tmp);
+        }
+        return *this;
+    }
+
+    flat_hash_map& operator=(flat_hash_map&& a) noexcept
+    {
+        if (this != &a) {
+            destroy();
+            reset();
+            swap(a);
+        }
+        return *this;
+    }
+
+    void swap(flat_hash_map& a) noexcept
+    {
+        std::swap(m_ctrl,        a.m_ctrl);
+        std::swap(m_slots,       a.m_slots);
+        std::swap(m_size,        a.m_size);
+        std::swap(m_cap,         a.m_cap);
+        std::swap(m_growth_left, a.m_growth_left);
+        std::swap(m_hash,        a.m_hash);
+        std::swap(m_eq,          a.m_eq);
+        std::swap(m_alloc,       a.m_alloc);
+    }
+
+    //-----------------------------------------------------------------------//
+    // Iteration                                                             //
+    //-----------------------------------------------------------------------//
+    iterator begin()
+    {
+        iterator it(m_ctrl, m_slots);
+        it.skip();
+        return it;
+    }
+    iterator end() { return iterator(m_ctrl + m_cap, m_slots + m_cap); }
+
+    const_iterator begin()  const
+        { return const_cast<flat_hash_map*>(this)->begin(); }
+    const_iterator end()    const
+        { return const_cast<flat_hash_map*>(this)->end();   }
+    const_iterator cbegin() const { return begin(); }
+    const_iterator cend()   const { return end();   }
+
+    //-----------------------------------------------------------------------//
+    // Capacity                                                              //
+    //-----------------------------------------------------------------------//
+    bool   empty()           const { return m_size == 0; }
+    size_t size()            const { return m_size;      }
+    size_t max_size()        const { return size_t(1) << 62; }
+    /// Number of slots (2^N - 1)
+    size_t capacity()        const { return m_cap;       }
+    size_t bucket_count()    const { return m_cap;       }
+    float  load_factor()     const { return m_cap ? float(m_size) / m_cap : 0; }
+    float  max_load_factor() const { return 7.0 / 8;     }
+
+    /// Make room for \a a_size values without rehashing
+    void reserve(size_t a_size)
+    {
+        if (a_size > m_size + m_growth_left)
+            resize(capacity_for(a_size));
+    }
+
+    /// Rehash the map to the capacity for max(\a a_size, size()) values
+    /// (this also purges the slots of erased values)
+    void rehash(size_t a_size)
+    {
+        auto n = std::max(a_size, m_size);
+        if (n == 0) {
+            destroy();
+            reset();
+        } else
+            resize(capacity_for(n));
+    }
+
+    //-----------------------------------------------------------------------//
+    // Lookup                                                                //
+    //-----------------------------------------------------------------------//
+    template <class K2 = key_type>
+    iterator find(const key_arg<K2>& a_key)
+    {
+        auto i = find_index(a_key, hash_of(a_key));
+        return i == s_npos ? end() : iterator_at(i);
+    }
+
+    template <class K2 = key_type>
+    const_iterator find(const key_arg<K2>& a_key) const
+    {
+        return const_cast<flat_hash_map*>(this)->find(a_key);
+    }
+
+    template <class K2 = key_type>
+    size_t count(const key_arg<K2>& a_key) const
+    {
+        return find_index(a_key, hash_of(a_key)) != s_npos;
+    }
+
+    template <class K2 = key_type>
+    bool contains(const key_arg<K2>& a_key) const { return count(a_key); }
+
+    template <class K2 = key_type>
+    V& at(const key_arg<K2>& a_key)
+    {
+        auto i = find_index(a_key, hash_of(a_key));
+        if (i == s_npos)
+            throw std::out_of_range("flat_hash_map::at: key not found");
+        return m_slots[i].second;
+    }
+
+    template <class K2 = key_type>
+    const V& at(const key_arg<K2>& a_key) const
+    {
+        return const_cast<flat_hash_map*>(this)->at(a_key);
+    }
+
+    V& operator[](const K& a_key) { return try_emplace(a_key).first->second; }
+    V& operator[](K&& a_key)
+    {
+        return try_emplace(std::move(a_key)).first->second;
+    }
+
+    //-----------------------------------------------------------------------//
+    // Modifiers                                                             //
+    //-----------------------------------------------------------------------//
+    std::pair<iterator, bool> insert(const value_type& a_value)
+    {
+        return insert_value(a_value);
+    }
+
+    std::pair<iterator, bool> insert(value_type&& a_value)
+    {
+        return insert_value(std::move(a_value));
+    }
+
+    template <class P, class = typename std::enable_if<
+        std::is_constructible<value_type, P&&>::value>::type>
+    std::pair<iterator, bool> insert(P&& a_value)
+    {
+        return emplace(std::forward<P>(a_value));
+    }
+
+    template <class InputIt>
+    void insert(InputIt a_first, InputIt a_last)
+    {
+        for (; a_first != a_last; ++a_first)
+            insert_value(*a_first);
+    }
+
+    void insert(std::initializer_list<value_type> a_list)
+    {
+        insert(a_list.begin(), a_list.end());
+    }
+
+    template <class... Args>
+    std::pair<iterator, bool> emplace(Args&&... a_args)
+    {
+        return insert_value(value_type(std::forward<Args>(a_args)...));
+    }
+
+    template <class... Args>
+    std::pair<iterator, bool> try_emplace(const K& a_key, Args&&... a_args)
+    {
+        return emplace_key(a_key, std::forward<Args>(a_args)...);
+    }
+
+    template <class... Args>
+    std::pair<iterator, bool> try_emplace(K&& a_key, Args&&... a_args)
+    {
+        return emplace_key(std::move(a_key), std::forward<Args>(a_args)...);
+    }
+
+    template <class M>
+    std::pair<iterator, bool> insert_or_assign(const K& a_key, M&& a_value)
+    {
+        auto res = try_emplace(a_key, std::forward<M>(a_value));
+        if (!res.second)
+            res.first->second = std::forward<M>(a_value);
+        return res;
+    }
+
+    template <class K2 = key_type>
+    size_t erase(const key_arg<K2>& a_key)
+    {
+        auto i = find_index(a_key, hash_of(a_key));
+        if (i == s_npos)
+            return 0;
+        erase_at(i);
+        return 1;
+    }
+
+    /// Erase the value at \a a_it.
+    /// @return iterator following the erased value
+    iterator erase(const_iterator a_it)
+    {
+        auto i = size_t(a_it.m_ctrl - m_ctrl);
+        erase_at(i);
+        iterator it(m_ctrl + i, m_slots + i);
+        it.skip();
+        return it;
+    }
+
+    iterator erase(iterator a_it) { return erase(const_iterator(a_it)); }
+
+    /// Destroy all values, keeping the capacity
+    void clear()
+    {
+        if (!m_cap)
+            return;
+        destroy_values();
+        reset_ctrl();
+        m_size        = 0;
+        m_growth_left = growth(m_cap);
+    }
+
+    hasher         hash_function() const { return m_hash;  }
+    key_equal      key_eq()        const { return m_eq;    }
+    allocator_type get_allocator() const { return allocator_type(m_alloc); }
+
+private:
+    ctrl_t*     m_ctrl;         // m_cap + s_width bytes (sentinel and clones)
+    value_type* m_slots;
+    size_t      m_size;
+    size_t      m_cap;          // 0 or 2^N - 1 >= s_width - 1
+    size_t      m_growth_left;  // Number of values to insert before growing
+    Hash        m_hash;
+    Eq          m_eq;
+    char_alloc  m_alloc;
+
+    // The hash is mixed by the 128-bit product with the golden ratio, since
+    // std::hash of integers is the identity.  The 7 low bits of the result
+    // are stored in the control byte, and the others select the slot.
+    template <class K2>
+    size_t hash_of(const K2& a_key) const
+    {
+        uint64_t h = m_hash(a_key);
+#if defined(__SIZEOF_INT128__)
+        auto m = static_cast<unsigned __int128>(h) * 0x9E3779B97F4A7C15ull;
+        return uint64_t(m) ^ uint64_t(m >> 64);
+#else
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        return h;
+#endif
+    }
+
+    static size_t h1(size_t a_hash) { return a_hash >> 7; }
+    static ctrl_t h2(size_t a_hash) { return ctrl_t(a_hash & 0x7F); }
+
+    // Max number of values in a table of a_cap slots (7/8 load factor)
+    static size_t growth(size_t a_cap)
+    {
+        return a_cap == 7 ? 6 : a_cap - a_cap / 8;
+    }
+
+    static size_t capacity_for(size_t a_size)
+    {
+        size_t cap = s_width - 1;
+        while (growth(cap) < a_size)
+            cap = cap * 2 + 1;
+        return cap;
+    }
+
+    static size_t ctrl_bytes(size_t a_cap)
+    {
+        auto n = a_cap + s_width;
+        auto a = alignof(value_type);
+        return (n + a - 1) / a * a;
+    }
+
+    static size_t alloc_bytes(size_t a_cap)
+    {
+        return ctrl_bytes(a_cap) + a_cap * sizeof(value_type);
+    }
+
+    iterator iterator_at(size_t i) { return iterator(m_ctrl + i, m_slots + i); }
+
+    // Set the control byte of slot i, and of its clone after the sentinel
+    // (the first s_width-1 bytes are cloned, so that a group can be loaded
+    // at any slot without wrapping around).
+    void set_ctrl(size_t i, ctrl_t a_ctrl)
+    {
+        m_ctrl[i] = a_ctrl;
+        m_ctrl[((i - (s_width - 1)) & m_cap) + (s_width - 1)] = a_ctrl;
+    }
+
+    void reset_ctrl()
+    {
+        memset(m_ctrl, detail::FLAT_EMPTY, m_cap + s_width);
+        m_ctrl[m_cap] = detail::FLAT_SENTINEL;
+    }
+
+    void reset()
+    {
+        m_ctrl        = detail::flat_empty_group();
+        m_slots       = nullptr;
+        m_size        = 0;
+        m_cap         = 0;
+        m_growth_left = 0;
+    }
+
+    template <class K2>
+    size_t find_index(const K2& a_key, size_t a_hash) const
+    {
+        auto   h   = h2(a_hash);
+        size_t pos = h1(a_hash) & m_cap;
+
+        for (size_t step = s_width; ; step += s_width) {
+            group g(m_ctrl + pos);
+            for (auto m = g.match(h); m; m.next()) {
+                auto i = (pos + m.lowest()) & m_cap;
+                if (likely(m_eq(m_slots[i].first, a_key)))
+                    return i;
+            }
+            if (likely(bool(g.match_empty())))
+                return s_npos;
+            pos = (pos + step) & m_cap;
+        }
+    }
+
+    size_t find_first_non_full(size_t a_hash) const
+    {
+        size_t pos = h1(a_hash) & m_cap;
+
+        for (size_t step = s_width; ; step += s_width) {
+            auto m = group(m_ctrl + pos).match_empty_or_deleted();
+            if (m)
+                return (pos + m.lowest()) & m_cap;
+            pos = (pos + step) & m_cap;
+        }
+    }
+
+    // Find a slot for a new value with the given hash, growing the table
+    // when there's no room left (the slot of an erased value can be reused)
+    size_t prepare_insert(size_t a_hash)
+    {
+        auto i = find_first_non_full(a_hash);
+        if (unlikely(m_growth_left == 0 && m_ctrl[i] != detail::FLAT_DELETED)) {
+            grow();
+            i = find_first_non_full(a_hash);
+        }
+        return i;
+    }
+
+    // Mark the slot, in which a value was constructed, as full
+    void commit(size_t i, size_t a_hash)
+    {
+        m_growth_left -= m_ctrl[i] == detail::FLAT_EMPTY;
+        set_ctrl(i, h2(a_hash));
+        ++m_size;
+    }
+
+    template <class P>
+    std::pair<iterator, bool> insert_value(P&& a_value)
+    {
+        auto h = hash_of(a_value.first);
+        auto i = find_index(a_value.first, h);
+        if (i != s_npos)
+            return std::make_pair(iterator_at(i), false);
+        i = prepare_insert(h);
+        new (m_slots + i) value_type(std::forward<P>(a_value));
+        commit(i, h);
+        return std::make_pair(iterator_at(i), true);
+    }
+
+    template <class K2, class... Args>
+    std::pair<iterator, bool> emplace_key(K2&& a_key, Args&&... a_args)
+    {
+        auto h = hash_of(a_key);
+        auto i = find_index(a_key, h);
+        if (i != s_npos)
+            return std::make_pair(iterator_at(i), false);
+        i = prepare_insert(h);
+        new (m_slots + i) value_type(std::piecewise_construct,
+                   std::forward_as_tuple(std::forward<K2>(a_key)),
+                   std::forward_as_tuple(std::forward<Args>(a_args)...));
+        commit(i, h);
+        return std::make_pair(iterator_at(i), true);
+    }
+
+    // A slot is marked EMPTY (rather than DELETED) if no probe sequence could
+    // have passed it while looking for an empty slot: that is when there's
+    // no run of s_width non-empty slots around it.
+    void erase_at(size_t i)
+    {
+        m_slots[i].~value_type();
+        --m_size;
+
+        auto before = (i - s_width) & m_cap;
+        auto ea     = group(m_ctrl + i).match_empty();
+        auto eb     = group(m_ctrl + before).match_empty();
+        bool never_full = ea && eb &&
+                          ea.trailing_zeros() + eb.leading_zeros() < s_width;
+
+        set_ctrl(i, never_full ? detail::FLAT_EMPTY : detail::FLAT_DELETED);
+        m_growth_left += never_full;
+    }
+
+    // Double the capacity, or if many slots are DELETED, rebuild the table
+    // into a newly allocated one of the same capacity to drop them
+    void grow()
+    {
+        if (m_cap == 0)
+            resize(s_width - 1);
+        else if (m_size <= growth(m_cap) / 2)
+            resize(m_cap);
+        else
+            resize(m_cap * 2 + 1);
+    }
+
+    void resize(size_t a_cap)
+    {
+        auto old_ctrl   = m_ctrl;
+        auto old_slots  = m_slots;
+        auto old_cap    = m_cap;
+        auto old_growth = m_growth_left;
+
+        auto p  = m_alloc.allocate(alloc_bytes(a_cap));
+        m_ctrl  = reinterpret_cast<ctrl_t*>(p);
+        m_slots = reinterpret_cast<value_type*>(p + ctrl_bytes(a_cap));
+        m_cap   = a_cap;
+        m_growth_left = growth(a_cap) - m_size;
+        reset_ctrl();
+
+        // Values are copied unless their moves can't throw, so that the old
+        // table stays intact if an exception is thrown
+        try {
+            for (size_t i = 0; i < old_cap; ++i) {
+                if (old_ctrl[i] < 0)
+                    continue;
+                auto& v = old_slots[i];
+                auto  h = hash_of(v.first);
+                auto  j = find_first_non_full(h);
+                new (m_slots + j) value_type(
+                    std::move_if_noexcept(const_cast<K&>(v.first)),
+                    std::move_if_noexcept(v.second));
+                set_ctrl(j, h2(h));
+            }
+        } catch (...) {
+            destroy();
+            m_ctrl        = old_ctrl;
+            m_slots       = old_slots;
+            m_cap         = old_cap;
+            m_growth_left = old_growth;
+            throw;
+        }
+
+        if (!std::is_trivially_destructible<value_type>::value)
+            for (size_t i = 0; i < old_cap; ++i)
+                if (old_ctrl[i] >= 0)
+                    old_slots[i].~value_type();
+
+        if (old_cap)
+            m_alloc.deallocate(reinterpret_cast<char*>(old_ctrl),
+                               alloc_bytes(old_cap));
+    }
+
+    void destroy_values()
+    {
+        if (!std::is_trivially_destructible<value_type>::value)
+            for (size_t i = 0; i < m_cap; ++i)
+                if (m_ctrl[i] >= 0)
+                    m_slots[i].~value_type();
+    }
+
+    void destroy()
+    {
+        if (!m_cap)
+            return;
+        destroy_values();
+        m_alloc.deallocate(reinterpret_cast<char*>(m_ctrl), alloc_bytes(m_cap));
+    }
+};
+
+} // namespace utxx
@@ -34,8 +34,11 @@
 // standard C++ with new header file names and std:: namespace
 #include <iostream>
 #include <fstream>
+#include <vector>
 #include <zlib.h>
 #include <assert.h>
+#include <sys/uio.h>
+#include <sys/types.h>
 
 namespace utxx   {
 //------------------------------------------------------------------------------
@@ -131,6 +134,105 @@ public:
     }
 };
 
+//------------------------------------------------------------------------------
+/// Compressor of buffers written to a file descriptor in gzip format
+///
+/// The output is a sequence of gzip members (frames) of about \a a_frame_size
+/// bytes of uncompressed input each, and every write() ends with a sync flush.
+/// Concatenated gzip members are a valid gzip file readable by gzip(1) and
+/// igzstream.  Since the output of every write() is complete, after a crash
+/// all data written before it is still decompressible (only the trailer of
+/// the last frame is missing), and recover() terminates such a frame before
+/// the file is appended to.  If a write to a regular file fails, the file is
+/// truncated to the end of the last successful write and the frame is
+/// terminated there, so the file stays valid.  The class is not thread-safe.
+//------------------------------------------------------------------------------
+class gzframe_writer {
+public:
+    /// @param a_level      compression level (Z_BEST_SPEED..Z_BEST_COMPRESSION)
+    /// @param a_frame_size max size of uncompressed data in a gzip member
+    explicit gzframe_writer(int    a_level      = Z_DEFAULT_COMPRESSION,
+                            size_t a_frame_size = 1024*1024);
+    ~gzframe_writer();
+
+    gzframe_writer(const gzframe_writer&)            = delete;
+    gzframe_writer& operator=(const gzframe_writer&) = delete;
+
+    /// Compress an array of buffers and write the result to \a a_fd.
+    /// On error the current frame is discarded (see reset()).
+    /// @return number of uncompressed bytes written or -1 on error (errno
+    ///         is set)
+    long write(int a_fd, const iovec* a_data, size_t a_size);
+
+    /// Compress a buffer and write the result to \a a_fd
+    long write(int a_fd, const void* a_data, size_t a_size) {
+        iovec v{const_cast<void*>(a_data), a_size};
+        return write(a_fd, &v, 1);
+    }
+
+    /// Finish the current frame by writing the gzip trailer to \a a_fd
+    /// @return 0 on success or -1 on error (errno is set)
+    int    finish(int a_fd);
+
+    /// Discard the current frame, so that the next write starts a new gzip
+    /// member (e.g. after the output was reopened)
+    void   reset();
+
+    /// Prepare the gzip file open in \a a_fd for appending.  If the last
+    /// gzip member is truncated (e.g. its writer crashed), the file is cut
+    /// at the last sync flush point of that member and the member is
+    /// terminated, which preserves all data flushed before the crash.
+    /// The descriptor must be open for reading and writing.
+    /// @return 0 on success or -1 on error (errno is set to EILSEQ if the
+    ///         file is not in gzip format)
+    static int recover(int a_fd);
+
+    int    level()      const { return m_level;      }
+    size_t frame_size() const { return m_frame_size; }
+    /// Total number of uncompressed bytes written
+    size_t bytes_in()   const { return m_bytes_in;   }
+    /// Total number of compressed bytes written
+    size_t bytes_out()  const { return m_bytes_out;  }
+    /// Number of finished frames
+    size_t frames()     const { return m_frames;     }
+
+private:
+    z_stream          m_zs;
+    int               m_level;
+    size_t            m_frame_size;
+    size_t            m_frame_in;   // Uncompressed bytes in the current frame
+    size_t            m_bytes_in;
+    size_t            m_bytes_out;
+    size_t            m_frames;
+    std::vector<char> m_buf;        // Compressed output
+    off_t             m_off;        // File offset of the compressed output
+    off_t             m_sync_off;   // Offset of the last sync flush (or -1)
+    uLong             m_sync_crc;   // CRC32 of the frame data at m_sync_off
+
+    // Frame left unterminated by a failed write, to be fixed on the next one
+    struct rollback {
+        dev_t  dev;
+        ino_t  ino;
+        off_t  off;                 // -1 if there's nothing to roll back
+        uLong  crc;
+        uLong  len;
+    }                 m_rollback;
+
+    // Run deflate on the pending input, writing full buffers to a_fd
+    int  deflate(int a_fd, int a_flush);
+    // Write the compressed output to a_fd
+    int  flush(int a_fd);
+    // Remember the position in a_fd where a new frame starts
+    void start(int a_fd);
+    // Roll back the output of a failed write, discard the frame, return -1
+    long fail(int a_fd);
+    // Truncate a_fd at m_rollback.off and terminate the frame there
+    int  roll_back(int a_fd);
+    // Truncate a_fd at a_off and write the end of a frame with a_len bytes
+    // of data having a_crc checksum (if a_len is 0 only truncate)
+    static int terminate(int a_fd, off_t a_off, uLong a_crc, uLong a_len);
+};
+
 } // namespace utxx
 
 #endif // UTXX_HAVE_LIBZ
@@ -2,6 +2,9 @@
 /// \file  hashmap.hpp
 //----------------------------------------------------------------------------
 /// \brief Abstraction of boost and std unordered_map.
+///
+/// See flat_hash_map.hpp for an open-addressing map with a compatible
+/// interface, which is faster for hot lookups.
 //----------------------------------------------------------------------------
 // Copyright (C) 2009 Serge Aleynikov <saleyn@gmail.com>
 // Created: 2009-09-10
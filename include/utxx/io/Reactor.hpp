@@ -41,6 +41,8 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include <utxx/string.hpp>
 #include <utxx/time_val.hpp>
 #include <utxx/os.hpp>
+#include <utxx/concurrent_mpsc_queue.hpp>
+#include <atomic>
 #include <sys/epoll.h>
 #include <sys/eventfd.h>
 
@@ -48,6 +50,8 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include <utxx/io/ReactorMisc.hpp>
 #include <utxx/io/ReactorTypes.hpp>
 #include <utxx/io/ReactorFdInfo.hpp>
+#include <utxx/io/ReactorIOUring.hpp>
+#include <utxx/io/ReactorTimerWheel.hpp>
 
 namespace utxx {
 namespace io   {
@@ -60,16 +64,27 @@ public:
   using HType        = io::HType;
   using FdInfoVector = std::vector<std::unique_ptr<FdInfo>>;
 
-  /// Create an epoll reactor
+  /// Create a reactor
+  /// @param a_ident    identifier used as the logging prefix
+  /// @param a_debug    debug level
+  /// @param a_epoll_fd external epoll descriptor to use (EPoll backend only)
+  /// @param a_max_fds  initial size of the file descriptor table
+  /// @param a_backend  kernel interface used for I/O multiplexing.  If the
+  ///                   kernel lacks the io_uring features used by the IOUring
+  ///                   backend (see IOUring::Supported()), the EPoll backend
+  ///                   is used instead (see Backend()).
   Reactor
   (
     std::string const&  a_ident,
     int                 a_debug    = 0,
     int                 a_epoll_fd = -1,
-    int                 a_max_fds  = 128
+    int                 a_max_fds  = 128,
+    BackendT            a_backend  = BackendT::EPoll
   )
     : m_own_efd        (a_epoll_fd == -1)
-    , m_epoll_fd       (m_own_efd  ? epoll_create1(0) : a_epoll_fd)
+    , m_epoll_fd       (UseIOUring(a_backend) ? -1
+                       : m_own_efd ? epoll_create1(0)  : a_epoll_fd)
+    , m_uring          (UseIOUring(a_backend) ? new IOUring() : nullptr)
     , m_fds            (a_max_fds)
     , m_debug          (a_debug)
     , m_use_getsockname(utxx::os::getenv("HAVE_GETSOCKNAME", 0l))
@@ -119,7 +134,26 @@ public:
     int                  a_permissions = 0660
   );
 
-  // TODO: Add INET Listener
+  /// Add a TCP listener to the epoll set.
+  /// The \a a_on_accept handler is passed the "Address:Port" of the client.
+  /// @param a_address    local address to bind ("" - any address)
+  /// @param a_port       local port to bind (0 - assigned by the kernel)
+  /// @param a_reuse_port when true, set SO_REUSEPORT so that several
+  ///                     reactors can listen on the same port, and the
+  ///                     kernel distributes new connections among them
+  /// @param a_backlog    max length of the queue of pending connections
+  /// @return FdInfo of the listening socket
+  FdInfo& AddListener
+  (
+    std::string   const& a_name,
+    std::string   const& a_address,
+    int                  a_port,
+    AcceptHandler const& a_on_accept,
+    ErrHandler    const& a_on_error,
+    void*                a_opaque     = nullptr,
+    bool                 a_reuse_port = false,
+    int                  a_backlog    = SOMAXCONN
+  );
 
   /// Add an FD to the epoll set.
   /// This method installs an I/O handling callback for read/write events on
@@ -170,6 +204,30 @@ public:
     size_t              a_rd_bufsz = 0
   );
 
+  /// Add a handler of datagrams received in batches.
+  /// On each readiness notification up to \a a_max_batch datagrams are
+  /// received by a single recvmmsg(2) call into pre-allocated packet buffers,
+  /// and passed to \a a_on_read along with the source address and (when
+  /// enabled by FdInfo::EnableDgramPktInfo() and FdInfo::EnablePktTimeStamps())
+  /// the destination address and the kernel timestamp of each packet.
+  /// @param a_name      the name of this handler
+  /// @param a_fd        non-blocking datagram socket
+  /// @param a_on_read   the callback to be invoked on each batch of datagrams
+  /// @param a_on_error  the callback to be called on error conditions
+  /// @param a_opaque    some user-specific opaque context passed to callbacks
+  /// @param a_max_batch max number of datagrams received at once
+  /// @param a_pkt_size  max size of a datagram (longer ones are truncated)
+  FdInfo& AddDgramBatch
+  (
+    std::string       const& a_name,
+    int                      a_fd,
+    DgramBatchHandler const& a_on_read,
+    ErrHandler        const& a_on_error,
+    void*                    a_opaque    = nullptr,
+    size_t                   a_max_batch = 64,
+    size_t                   a_pkt_size  = 2048
+  );
+
   /// Add handler of reading input from file
   /// @return eventfd associated with file descriptor
   FdInfo& AddFile
@@ -220,6 +278,33 @@ public:
     void*               a_opaque = nullptr
   );
 
+  /// Schedule a timer in the reactor's timer wheel.
+  /// Unlike AddTimer(), which creates a timerfd per timer, all such timers
+  /// are driven by a single one-shot timerfd armed for the earliest
+  /// expiration, and adding, cancelling and rescheduling a timer is O(1). The \a a_on_timer callback is invoked with the FdInfo of
+  /// the timer wheel's timerfd and the TimerID of the fired timer.
+  /// @param a_initial_msec  delay of the first expiration
+  /// @param a_interval_msec repetition interval (0 - one-shot timer)
+  /// @return handle of the scheduled timer
+  TimerID ScheduleTimer
+  (
+    uint32_t            a_initial_msec,
+    uint32_t            a_interval_msec,
+    EventHandler const& a_on_timer
+  );
+
+  /// Reschedule a timer scheduled by ScheduleTimer().
+  /// @return false if the timer is not found (it has fired or was cancelled)
+  bool RescheduleTimer(TimerID a_id, uint32_t a_initial_msec,
+                       uint32_t a_interval_msec);
+
+  /// Cancel a timer scheduled by ScheduleTimer().
+  /// @return false if the timer is not found (it has fired or was cancelled)
+  bool CancelTimer(TimerID a_id);
+
+  /// Number of timers scheduled by ScheduleTimer()
+  size_t TimerCount() const { return m_timers ? m_timers->Size() : 0; }
+
   /// Add a signal handler to the epoll set.
   /// @param a_mask           specifies the set of signals that the caller
   ///                         to accept via the file descriptor wishes
@@ -238,6 +323,19 @@ public:
     int                   a_sigq_capacity = 8
   );
 
+  /// Enable execution of tasks posted to this reactor by Post().
+  /// This adds an eventfd used to wake up the reactor, and must be called
+  /// before other threads can post tasks, either by the reactor's thread or
+  /// before that thread starts calling Wait().
+  void EnablePost();
+
+  /// Post a task for execution on the reactor's thread.
+  /// This call is lock-free and can be made by any thread once EnablePost()
+  /// is called.
+  /// @return false if the task couldn't be allocated
+  bool Post(PostTask&& a_task);
+  bool Post(PostTask const& a_task) { return Post(PostTask(a_task)); }
+
   /// Remove an FD from the epoll set
   void Remove(int& a_fd, bool a_clear_fdinfo=true);
 
@@ -246,11 +344,32 @@ public:
 
   /// Wait for events on file descriptors in the current epoll set.
   /// For each fd that has activity invoke the registered handler.
-  void Wait(int a_timeout_msec = 0);
-
-  /// Report epoll file descriptor
+  /// With the IOUring backend this submits pending requests and processes
+  /// their completions using a single system call.
+  /// In the spin mode (see SpinMode()) the events are busy-polled until
+  /// some are processed or \a a_timeout_msec expires.
+  /// @return number of processed events
+  int  Wait(int a_timeout_msec = 0);
+
+  /// Turn on/off the busy-polling (spin) mode of Wait().
+  /// In this mode Wait() polls for events without blocking. After the
+  /// reactor has been idle for SpinOpts::spin_us, each poll is followed by
+  /// a CPU pause, after SpinOpts::pause_us - by sched_yield(), and after
+  /// SpinOpts::yield_us Wait() blocks for the remaining timeout.
+  /// The idle handler is invoked after every poll returning no events.
+  void SpinMode(bool a_on, SpinOpts const& a_opts = SpinOpts());
+  bool SpinMode() const { return m_spin; }
+
+  /// Counters of time spent spinning versus processing events in spin mode
+  SpinStats const& SpinCounters() const { return m_spin_stats;  }
+  void        ClearSpinCounters()       { m_spin_stats.Clear(); }
+
+  /// Report epoll file descriptor (-1 for the IOUring backend)
   int EPollFD() const { return m_epoll_fd; }
 
+  /// Kernel interface used for I/O multiplexing
+  BackendT Backend() const { return m_uring ? BackendT::IOUring : BackendT::EPoll; }
+
   dynamic_io_buffer* RdBuff(int a_fd);
   dynamic_io_buffer* WrBuff(int a_fd);
 
@@ -284,6 +403,10 @@ public:
 private:
   bool            m_own_efd;
   int             m_epoll_fd;
+  // Must be declared before m_fds, as FdInfo's destructor cancels requests
+  std::unique_ptr<IOUring> m_uring;
+  std::vector<int>         m_uring_arm;  ///< FDs with requests to be issued
+  uint32_t        m_uring_gen = 0;       ///< Generation of issued requests
   FdInfoVector    m_fds;
   IdleHandler     m_on_idle;
   Logger          m_logger;
@@ -291,6 +414,17 @@ private:
   std::string     m_ident;               ///< Indent prefix (E.g. "[p1@] ")
   bool            m_use_getsockname;     ///< true when set env USE_GETSOCKNAME
   bool            m_use_kbp;             ///< Use kernel by-pass (e.g. Mellanox LibVBA)
+  bool            m_spin = false;        ///< Busy-polling mode of Wait()
+  SpinOpts        m_spin_opts;
+  SpinStats       m_spin_stats;
+  long            m_spin_idle_since = 0; ///< Time (ns) of the last processed event
+  std::unique_ptr<TimerWheel> m_timers;  ///< Wheel of ScheduleTimer() timers
+  int             m_timers_fd    = -1;   ///< timerfd driving m_timers
+  long            m_timers_start = 0;    ///< Time (ns) of tick 0 of m_timers
+  uint64_t        m_timers_next  = ~0ul; ///< Tick m_timers_fd is armed for
+  int             m_post_fd      = -1;   ///< eventfd waking up on Post()
+  std::atomic<bool>                 m_post_wake{false};
+  concurrent_mpsc_queue<PostTask>   m_post_queue;
 
   friend class FdInfo;
 
@@ -323,6 +457,43 @@ private:
   FdInfo&  DoAdd(int a_fd, uint32_t a_ev, FdInfo&& a_fi, DebugLambda a_fun);
 
   void EPollAdd(int a_fd, const std::string& a_nm, uint a_ev, utxx::src_info&&);
+  int  EPollWait(int a_timeout_msec);
+
+  int  SpinWait(int a_timeout_msec);
+
+  uint64_t TimerTick() const;
+  void     TimerWheelArm();
+  void     TimerWheelFire(FdInfo& a_fi);
+
+  void     RunPosted();
+  void SetBusyPoll(FdInfo& a_fi);
+
+  /// Turn on/off the write readiness notifications of \a a_fi
+  void WriteEvents(FdInfo& a_fi, bool a_on);
+
+  //----------------------------------------------------------------------------
+  // io_uring backend
+  //----------------------------------------------------------------------------
+  /// Type of an io_uring request stored in its user data along with the fd
+  enum class URingOp : uint8_t { Recv = 1, Poll, Write, Cancel };
+
+  static const uint32_t s_uring_gen_mask = (1u << 24) - 1;
+
+  /// Use the io_uring backend if it's requested and supported by the kernel
+  static bool UseIOUring(BackendT a_backend) {
+    return a_backend == BackendT::IOUring && IOUring::Supported();
+  }
+
+  /// User data of an io_uring request: fd (32 bits), op (8 bits) and the
+  /// generation (24 bits) distinguishing requests of a re-added fd
+  static uint64_t UData(int a_fd, URingOp a_op, uint32_t a_gen) {
+    return uint64_t(uint32_t(a_fd)) | uint64_t(a_op) << 32 | uint64_t(a_gen) << 40;
+  }
+
+  int  IOUringWait(int a_timeout_msec);
+  void IOUringArm(FdInfo& a_fi);
+  void IOUringRearm(FdInfo& a_fi);
+  void IOUringSubscribeWrite(FdInfo& a_fi, bool a_on);
 };
 
 } // namespace io
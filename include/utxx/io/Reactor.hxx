@@ -54,7 +54,7 @@ inline dynamic_io_buffer* Reactor
 inline void Reactor
 ::Ident(const std::string& a_ident)
 {
-  m_ident = utxx::to_string('[', a_ident, '@', m_epoll_fd, "] ");
+  m_ident = utxx::to_string('[', a_ident, '@', m_uring ? m_uring->FD() : m_epoll_fd, "] ");
 }
 
 //------------------------------------------------------------------------------
@@ -63,7 +63,11 @@ inline void Reactor
 {
   if (a_fd < 0) return;
 
-  if (m_epoll_fd >= 0) {
+  if (m_uring) {
+    // Cancel requests before the fd number can be reused
+    m_uring->PrepCancelFD(a_fd, UData(a_fd, URingOp::Cancel, 0));
+    m_uring->Submit();
+  } else if (m_epoll_fd >= 0) {
     epoll_event event;
     event.events  = 0;
     event.data.fd = a_fd;
@@ -100,8 +104,18 @@ inline void Reactor
 }
 
 //------------------------------------------------------------------------------
-inline void Reactor
+inline int Reactor
 ::Wait(int a_timeout_msec)
+{
+  if (m_spin)
+    return SpinWait(a_timeout_msec);
+
+  return m_uring ? IOUringWait(a_timeout_msec) : EPollWait(a_timeout_msec);
+}
+
+//------------------------------------------------------------------------------
+inline int Reactor
+::EPollWait(int a_timeout_msec)
 {
   UTXX_PRETTY_FUNCTION(); // Cache pretty function name
 
@@ -118,6 +132,7 @@ REPEAT:
   }
 
   int i=0;
+  int n=rc;
 
   for (epoll_event* p = cev, *end = cev + rc; p != end; ++p) {
     int fd = p->data.fd;
@@ -182,6 +197,8 @@ REPEAT:
   // trigger the idle state handler:
   if (rc == 0 && m_on_idle)
     m_on_idle();
+
+  return n;
 }
 
 } // namespace io
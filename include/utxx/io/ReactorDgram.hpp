@@ -0,0 +1,119 @@
+// vim:ts=2:sw=2:et
+//------------------------------------------------------------------------------
+/// \file  ReactorDgram.hpp
+//------------------------------------------------------------------------------
+/// \brief Batched datagram I/O using recvmmsg(2) and sendmmsg(2)
+//------------------------------------------------------------------------------
+// Copyright (c) 2026 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-16
+//------------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the utxx open-source project.
+
+Copyright (C) 2026 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+#pragma once
+
+#include <utxx/io/ReactorTypes.hpp>
+#include <sys/socket.h>
+#include <vector>
+
+namespace utxx {
+namespace io   {
+
+//------------------------------------------------------------------------------
+/// Pre-allocated ring of packet buffers receiving datagrams with recvmmsg(2)
+//------------------------------------------------------------------------------
+class DgramRecvRing {
+public:
+  /// @param a_max_batch max number of datagrams received by one call
+  /// @param a_pkt_size  size of each packet buffer (longer datagrams are
+  ///                    truncated and have MSG_TRUNC set in DgramPkt::flags)
+  DgramRecvRing(size_t a_max_batch, size_t a_pkt_size);
+
+  DgramRecvRing(DgramRecvRing const&) = delete;
+  DgramRecvRing& operator=(DgramRecvRing const&) = delete;
+
+  size_t    MaxBatch() const { return m_pkts.size(); }
+  size_t    PktSize()  const { return m_pkt_size;    }
+
+  /// Receive up to MaxBatch() datagrams from the non-blocking socket \a a_fd.
+  /// @param a_ctl_msgs  when true, parse IP_PKTINFO and SO_TIMESTAMPNS
+  ///                    control messages of each packet
+  /// @return number of received datagrams, 0 if no datagrams are available,
+  ///         or -1 on error (errno is set)
+  int       Recv(int a_fd, bool a_ctl_msgs);
+
+  /// Datagrams received by the last call to Recv() returning \a a_count
+  DgramSpan Pkts(int a_count) const { return DgramSpan(m_pkts.data(), a_count); }
+
+private:
+  static const size_t s_ctl_size = 256;
+
+  size_t                  m_pkt_size;
+  std::vector<char>       m_data;
+  std::vector<char>       m_ctl;
+  std::vector<iovec>      m_iov;
+  std::vector<mmsghdr>    m_hdrs;
+  std::vector<DgramPkt>   m_pkts;
+  int                     m_last = 0; ///< Number of headers used by last Recv()
+  bool                    m_with_ctl = false;
+};
+
+//------------------------------------------------------------------------------
+/// Batch of outgoing datagrams sent with sendmmsg(2).
+/// Payloads are not copied and must remain valid until they are sent.
+//------------------------------------------------------------------------------
+class DgramSendBatch {
+public:
+  explicit DgramSendBatch(size_t a_capacity = 64);
+
+  DgramSendBatch(DgramSendBatch const&) = delete;
+  DgramSendBatch& operator=(DgramSendBatch const&) = delete;
+
+  size_t Capacity() const { return m_hdrs.size(); }
+  size_t Size()     const { return m_size;        }
+  bool   Empty()    const { return m_size == 0;   }
+  bool   Full()     const { return m_size == m_hdrs.size(); }
+
+  /// Append a datagram to the batch.
+  /// @param a_dst destination address (nullptr for a connected socket)
+  /// @return false if the batch is full
+  bool   Add(const void* a_data, size_t a_len, const sockaddr_in* a_dst = nullptr);
+
+  void   Clear() { m_size = 0; }
+
+  /// Send pending datagrams to \a a_fd. Sent datagrams are removed from the
+  /// batch, and the ones not sent because of EAGAIN remain queued.
+  /// On error the datagrams sent before the failure are removed as well,
+  /// and the one that failed is left at the front of the batch.
+  /// @return number of sent datagrams, or -1 on error (errno is set)
+  int    Send(int a_fd, int a_flags = MSG_NOSIGNAL);
+
+private:
+  std::vector<iovec>       m_iov;
+  std::vector<sockaddr_in> m_dst;
+  std::vector<mmsghdr>     m_hdrs;
+  size_t                   m_size = 0;
+};
+
+} // namespace io
+} // namespace utxx
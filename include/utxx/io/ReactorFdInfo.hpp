@@ -35,6 +35,8 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include <utxx/io/ReactorTypes.hpp>
 #include <utxx/io/ReactorAIOReader.hpp>
 #include <utxx/io/ReactorCmdExec.hpp>
+#include <utxx/io/ReactorDgram.hpp>
+#include <utxx/io/ReactorWrQueue.hpp>
 #include <utxx/enum.hpp>
 #include <utxx/running_stat.hpp>
 #include <type_traits>
@@ -103,6 +105,8 @@ public:
 
   AIOReader*               FileReader()          { return m_file_reader.get();}
   POpenCmd*                PipeReader()          { return m_exec_cmd.get();   }
+  DgramRecvRing*           DgramRing()           { return m_dgram_ring.get(); }
+  WrQueue const*           WriteQueue()    const { return m_wr_queue.get();   }
 
   /// Identifier used as the logging prefix for this component
   const std::string&       Ident()         const { return m_ident;     }
@@ -145,6 +149,38 @@ public:
   void Reset();  ///< Reset internal state (m_fd must be -1)
 
   void SetFileReader(AIOReader* a_reader) { m_file_reader.reset(a_reader); }
+
+  /// Enable the gather write mode, in which data passed to Send() is queued
+  /// without copying and written with writev(2) as the fd becomes writable.
+  /// @param a_low_wm   low  watermark of queued bytes
+  /// @param a_high_wm  high watermark of queued bytes (0 - no backpressure)
+  /// @param a_on_wm    callback invoked when queued data crosses watermarks
+  void EnableWrQueue(size_t a_low_wm = 0, size_t a_high_wm = 0,
+                     WatermarkHandler const& a_on_wm = nullptr);
+
+  /// Queue \a a_len bytes of \a a_data for writing, and write as much of the
+  /// queue as the fd accepts. The remaining data is written when the fd
+  /// becomes writable. Requires EnableWrQueue().
+  /// @param a_owner  keeps \a a_data alive until it's written (when null, the
+  ///                 caller must guarantee that the data remains valid)
+  /// @return number of bytes pending to be written, or -1 on error reported
+  ///         to the error handler
+  long Send(const void* a_data, size_t a_len,
+            WrQueue::Owner const& a_owner = nullptr);
+
+  /// Queue a buffer owning its data (e.g. std::shared_ptr<std::string>)
+  template <class Buf>
+  long Send(std::shared_ptr<Buf> const& a_buf)
+  { return Send(a_buf->data(), a_buf->size(), a_buf); }
+
+  /// Queue segments of \a a_vec kept alive by \a a_owner until written
+  long Send(iovector const& a_vec, WrQueue::Owner const& a_owner = nullptr);
+
+  /// Send datagrams queued in \a a_batch using sendmmsg(2).
+  /// The datagrams not sent because of EAGAIN remain in the batch.
+  /// @return number of sent datagrams, or -1 on error reported to the
+  ///         error handler
+  int  SendBatch(DgramSendBatch& a_batch, int a_flags = MSG_NOSIGNAL);
   int  ReportError(IOType a_tp, int a_ec, const std::string& a_err,
                    const utxx::src_info& a_si, bool a_throw = true);
   int  ReportError(IOType a_tp, int a_ec, const std::string& a_err,
@@ -172,6 +208,15 @@ private:
   TriggerT                           m_trigger;
   std::unique_ptr<AIOReader>         m_file_reader;
   std::unique_ptr<POpenCmd>          m_exec_cmd;
+  std::unique_ptr<DgramRecvRing>     m_dgram_ring;
+  std::unique_ptr<WrQueue>           m_wr_queue;
+  WatermarkHandler                   m_on_watermark;
+  size_t                             m_low_wm           = 0;
+  size_t                             m_high_wm          = 0;
+  bool                               m_wr_high          = false;
+  /// Write events are requested for the data pending in m_wr_queue (the
+  /// user's interest in them is the EPOLLOUT flag of m_events)
+  bool                               m_wr_armed         = false;
   std::string                        m_ident;
   time_val                           m_ts_wire;
   bool                               m_with_pkt_info    = false;
@@ -181,6 +226,9 @@ private:
   in_addr_t                          m_sock_dst_addr    = 0;
   in_port_t                          m_sock_dst_port    = 0;
   in_addr_t                          m_sock_if_addr     = 0;
+  uint32_t                           m_events           = 0;
+  uint32_t                           m_uring_gen        = 0;
+  bool                               m_uring_wr         = false;
 
   friend class Reactor;
 
@@ -195,6 +243,18 @@ private:
   long HandleTimer (uint32_t a_events);
   long HandleSignal(uint32_t a_events);
   long HandleAccept(uint32_t a_events);
+  long HandleDgramBatch(uint32_t a_events);
+
+  /// Write data of m_wr_queue (when \a a_write is true), subscribe to write
+  /// events while some data remains pending, and check the watermarks
+  /// @return number of bytes pending to be written, or -1 on error
+  long FlushWrQueue(bool a_write = true);
+
+  /// Handle \a a_len bytes received by the io_uring backend
+  long HandleRecv  (const char* a_data, int a_len);
+
+  long InvokeEvent (long     a_value);
+  long InvokeTimer (uint64_t a_count);
 
   struct DebugFunEval {
     template <typename T>
@@ -57,7 +57,7 @@ inline FdInfo::FdInfo
   : m_owner           (a_owner)
   , m_name            (a_name)
   , m_fd              (a_fd)
-  , m_fd_type         (FdTypeT::UNDEFINED)
+  , m_fd_type         (a_fd_type)
   , m_handler         ()
   , m_on_error        (a_on_error)
   , m_read_at_least   (std::move(a_read_sz_fun))
@@ -302,6 +302,7 @@ Handle(uint32_t a_events)
     case HType::Timer:  return HandleTimer (a_events);
     case HType::Accept: return HandleAccept(a_events);
     case HType::Signal: return HandleSignal(a_events);
+    case HType::DgramBatch: return HandleDgramBatch(a_events);
     default:
       UTXX_RLOG(this, DEBUG, "fd=", m_fd, " undefined handler type");
       return -1;
@@ -322,6 +323,23 @@ HandleIO(uint32_t a_events)
   bool handled;
   int  rc;
 
+  // Write the queued data first. The user's write handler is only invoked
+  // when the write queue is drained.
+  if (m_wr_queue && Reactor::IsWritable(a_events)) {
+    try {
+      auto pending = FlushWrQueue();
+      // When m_fd < 0, it means that the file descriptor was closed by user
+      if (pending < 0 || m_fd < 0)
+        return pending;
+      if (pending || !m_handler.AsIO().wh)
+        a_events &= ~EPOLLOUT;
+    } catch (utxx::runtime_error& e) {
+      return ReportError(IOType::UserCode, 0, e.str(), src_info(e.src()));
+    } catch (std::exception& e) {
+      return ReportError(IOType::UserCode, 0, e.what(), UTXX_SRCX);
+    }
+  }
+
   // FD error condition is handled by the caller prior to making this call
   if (Reactor::IsReadable(a_events)) {
     // Perform Reading:
@@ -378,6 +396,57 @@ HandleIO(uint32_t a_events)
   return ReportError(IOType::AppLogic, 0, "LOGIC ERROR: unhandled branch", UTXX_SRCX);
 }
 
+//------------------------------------------------------------------------------
+// Inlined on critical path
+// Datagrams are received in batches of up to DgramRing()->MaxBatch() packets
+// until the socket's receive queue is drained.
+//------------------------------------------------------------------------------
+inline long FdInfo::
+HandleDgramBatch(uint32_t a_events)
+{
+  UTXX_PRETTY_FUNCTION();
+
+  if (UNLIKELY(!Reactor::IsReadable(a_events)))
+    return 0;
+
+  assert(m_dgram_ring);
+
+  long total = 0;
+
+  while (true) {
+    int n = m_dgram_ring->Recv(m_fd, m_with_pkt_info || m_pkt_time_stamps);
+
+    if (UNLIKELY(n <= 0))
+      return n == 0
+           ? total
+           : ReportError(IOType::Read, errno, "error in recvmmsg", UTXX_SRCX);
+
+    auto pkts = m_dgram_ring->Pkts(n);
+
+    if (UNLIKELY(m_rd_debug))
+      for (auto& pkt : pkts)
+        m_rd_debug(pkt.data, pkt.len);
+
+    total += n;
+
+    try {
+      int rc = m_handler.AsDgramBatch()(*this, pkts);
+      // When m_fd < 0, it means that the file descriptor was closed by user
+      if (UNLIKELY(rc < 0 || m_fd < 0))
+        return rc;
+    } catch (utxx::runtime_error& e) {
+      return ReportError(IOType::UserCode, 0, e.str(), src_info(e.src()));
+    } catch (std::exception& e) {
+      return ReportError(IOType::UserCode, 0, e.what(), UTXX_SRCX);
+    }
+
+    // A short batch means that the receive queue was drained, and a packet
+    // arriving after that will trigger another edge
+    if (size_t(n) < m_dgram_ring->MaxBatch() || m_trigger != EDGE_TRIGGERED)
+      return total;
+  }
+}
+
 //------------------------------------------------------------------------------
 // Inlined on critical path
 inline long FdInfo::
@@ -439,16 +508,23 @@ HandleEvent (uint32_t a_events, bool a_invoke_handler)
     return ReportError(IOType::Read, errno, s_err, UTXX_SRCX);
   }
 
-  if (a_invoke_handler) {
-    try   { m_handler.AsEvent()(*this, events); }
-    catch ( utxx::runtime_error& e ) {
-      return ReportError(IOType::UserCode, 0, e.what(), e.src()); }
-    catch ( std::exception& e ) {
-      return ReportError(IOType::UserCode, 0, e.what(), UTXX_SRCX);
-    }
+  return a_invoke_handler ? InvokeEvent(events) : events;
+}
+
+//------------------------------------------------------------------------------
+inline long FdInfo::
+InvokeEvent(long a_value)
+{
+  UTXX_PRETTY_FUNCTION();
+
+  try   { m_handler.AsEvent()(*this, a_value); }
+  catch ( utxx::runtime_error& e ) {
+    return ReportError(IOType::UserCode, 0, e.what(), e.src()); }
+  catch ( std::exception& e ) {
+    return ReportError(IOType::UserCode, 0, e.what(), UTXX_SRCX);
   }
 
-  return events;
+  return a_value;
 }
 
 //------------------------------------------------------------------------------
@@ -469,15 +545,83 @@ HandleTimer (uint32_t a_events)
     return ReportError(IOType::Read, errno, "error reading from timerfd", UTXX_SRCX);
 
   // got == 0 means no timer expirations since last read
+  auto rc = InvokeTimer(exp);
+  return rc < 0 ? rc : got;
+}
+
+//------------------------------------------------------------------------------
+inline long FdInfo::
+InvokeTimer(uint64_t a_count)
+{
+  UTXX_PRETTY_FUNCTION();
+
   // Invoke the user callback
-  try   { m_handler.AsTimer()(*this, exp); }
+  try   { m_handler.AsTimer()(*this, a_count); }
   catch ( utxx::runtime_error& e ) {
     return ReportError(IOType::UserCode, 0, e.what(), e.src()); }
   catch ( std::exception& e ) {
     return ReportError(IOType::UserCode, 0, e.what(), UTXX_SRCX);
   }
 
-  return got;
+  return a_count;
+}
+
+//------------------------------------------------------------------------------
+// Inlined on critical path
+// The data was received by the kernel into a provided buffer of the io_uring
+// backend, and is appended to the read buffer before invoking the handler.
+//------------------------------------------------------------------------------
+inline long FdInfo::
+HandleRecv(const char* a_data, int a_len)
+{
+  UTXX_PRETTY_FUNCTION();
+
+  if (UNLIKELY(a_len == 0))
+    return ReportError(IOType::Read, 0, "connection closed by peer", UTXX_SRCX);
+
+  assert(m_rd_buff);
+
+  if (UNLIKELY(m_rd_buff->capacity() < size_t(a_len)))
+    m_rd_buff->reserve(a_len);
+
+  auto buf = m_rd_buff->wr_ptr();
+  memcpy(buf, a_data, a_len);
+
+  DebugFunEval::run(m_rd_debug, buf, a_len);
+
+  m_rd_buff->commit(a_len);
+
+  try {
+    // See if there are enough bytes available in the buffer
+    if (m_read_at_least) {
+      auto need = m_read_at_least(m_rd_buff->rd_ptr(), m_rd_buff->size());
+      if  (need > m_rd_buff->size()) {
+        if (UNLIKELY(need > 100*1024*1024)) {
+          auto e = utxx::to_string("suspicious read size = ", need);
+          return ReportError(IOType::Read, EMSGSIZE, e, UTXX_SRCX);
+        }
+        // The msg in the buffer is still incomplete. Enlarge
+        // the buffer to the expected msg size of necessary
+        m_rd_buff->reserve(need);
+        return a_len;
+      }
+    }
+
+    int consumed = m_handler.AsIO().rh(*this, *m_rd_buff);
+    // m_rd_buff might be freed by the handler
+    if (UNLIKELY(consumed < 0) || !m_rd_buff)
+      return consumed;
+    else if (LIKELY(consumed  > 0))
+      // Can move partially incomplete data to the front of buffer
+      m_rd_buff->read_and_crunch(consumed);
+
+  } catch (utxx::runtime_error& e) {
+    return ReportError(IOType::UserCode, 0, e.str(), src_info(e.src()));
+  } catch (std::exception& e) {
+    return ReportError(IOType::UserCode, 0, e.what(), UTXX_SRCX);
+  }
+
+  return a_len;
 }
 
 } // namespace io
@@ -0,0 +1,132 @@
+// vim:ts=2:sw=2:et
+//------------------------------------------------------------------------------
+/// \file  ReactorGroup.hpp
+//------------------------------------------------------------------------------
+/// \brief Group of reactors each running in its own thread
+///
+/// The group runs N reactors in threads optionally pinned to given CPUs.
+/// TCP listeners are sharded among the reactors using SO_REUSEPORT, so
+/// that each accepted connection is handled by the reactor that accepted
+/// it, and tasks can be posted to any reactor from any thread.
+//------------------------------------------------------------------------------
+// Copyright (c) 2026 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-16
+//------------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the utxx open-source project.
+
+Copyright (C) 2026 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+#pragma once
+
+#include <utxx/io/Reactor.hpp>
+#include <atomic>
+#include <future>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace utxx {
+namespace io   {
+
+//------------------------------------------------------------------------------
+/// Group of reactors each running in its own thread
+//------------------------------------------------------------------------------
+class ReactorGroup {
+public:
+  /// Create a group of reactors
+  /// @param a_ident   identifier of the group (reactors are named
+  ///                  "Ident1", "Ident2", etc.)
+  /// @param a_count   number of reactors
+  /// @param a_cpus    CPUs to pin the reactors' threads to (a negative value
+  ///                  or a missing entry leaves a thread unpinned)
+  /// @param a_backend kernel interface used by the reactors
+  /// @param a_debug   debug level of the reactors
+  ReactorGroup
+  (
+    std::string      const& a_ident,
+    size_t                  a_count,
+    std::vector<int> const& a_cpus    = std::vector<int>(),
+    BackendT                a_backend = BackendT::EPoll,
+    int                     a_debug   = 0
+  );
+
+  ReactorGroup(ReactorGroup const&) = delete;
+  ReactorGroup& operator=(ReactorGroup const&) = delete;
+
+  /// Stops and joins the reactors' threads
+  ~ReactorGroup();
+
+  size_t    Size()                const { return m_reactors.size(); }
+  Reactor&  operator[](size_t a_id)     { return *m_reactors[a_id];  }
+  bool      Running()             const { return m_running;          }
+
+  /// Start reactors' threads.
+  /// @param a_wait_msec timeout of each Reactor::Wait() call
+  void      Start(int a_wait_msec = 1000);
+
+  /// Signal reactors' threads to exit and wait for their completion
+  void      Stop();
+
+  /// Post a task for execution on the thread of reactor \a a_id
+  /// @return false if the task couldn't be allocated
+  bool      Post(size_t a_id, PostTask&& a_task);
+
+  /// Add a TCP listener to each reactor of the group sharing the same port
+  /// with SO_REUSEPORT, so that new connections are distributed by the
+  /// kernel among the reactors. If the group is running, the listeners are
+  /// added by the reactors' threads, and the call returns when all of them
+  /// are added. It may be called by the thread of a reactor of the group,
+  /// in which case the listener of that reactor is added by the call, and
+  /// the others are added asynchronously (their errors are logged), so that
+  /// reactors adding listeners at the same time don't deadlock.
+  /// @param a_port local port to bind (0 - port assigned by the kernel to
+  ///               the first listener is used by the others)
+  /// @return bound port
+  int       AddListener
+  (
+    std::string   const& a_name,
+    std::string   const& a_address,
+    int                  a_port,
+    AcceptHandler const& a_on_accept,
+    ErrHandler    const& a_on_error,
+    void*                a_opaque  = nullptr,
+    int                  a_backlog = SOMAXCONN
+  );
+
+private:
+  std::vector<std::unique_ptr<Reactor>> m_reactors;
+  std::vector<std::thread>              m_threads;
+  std::vector<int>                      m_cpus;
+  std::atomic<bool>                     m_running;
+
+  void Run(size_t a_id, int a_wait_msec);
+
+  /// Index of the reactor running the calling thread, or Size() if none
+  size_t Self() const;
+
+  /// Execute \a a_fun on the thread of reactor \a a_id, or on the calling
+  /// thread if it's the reactor's thread or the group is not running
+  std::future<int> Call(size_t a_id, std::function<int()> const& a_fun);
+};
+
+} // namespace io
+} // namespace utxx
@@ -0,0 +1,190 @@
+// vim:ts=2:sw=2:et
+//------------------------------------------------------------------------------
+/// \file  ReactorIOUring.hpp
+//------------------------------------------------------------------------------
+/// \brief Minimal io_uring wrapper used by the reactor's io_uring backend
+///
+/// The wrapper talks to the kernel using raw io_uring_setup(2),
+/// io_uring_enter(2) and io_uring_register(2) system calls, so there's no
+/// dependency on liburing. Received data is placed by the kernel into a ring
+/// of provided buffers registered with IORING_REGISTER_PBUF_RING.
+//------------------------------------------------------------------------------
+// Copyright (c) 2026 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-16
+//------------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the utxx open-source project.
+
+Copyright (C) 2026 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+#pragma once
+
+#include <linux/io_uring.h>
+#include <cstdint>
+#include <cstddef>
+
+namespace utxx {
+namespace io   {
+
+//------------------------------------------------------------------------------
+/// Submission/completion queue pair of an io_uring instance
+//------------------------------------------------------------------------------
+class IOUring {
+public:
+  /// Create an io_uring instance.
+  /// @param a_entries  number of submission queue entries
+  /// @param a_nbufs    number of provided receive buffers (power of 2)
+  /// @param a_buf_size size of each provided receive buffer
+  explicit IOUring
+  (
+    unsigned a_entries  = 256,
+    unsigned a_nbufs    = 256,
+    unsigned a_buf_size = 16*1024
+  );
+
+  ~IOUring();
+
+  IOUring(IOUring const&)            = delete;
+  IOUring& operator=(IOUring const&) = delete;
+
+  /// @return true if the running kernel supports the io_uring features used
+  ///         by the reactor: multishot recv and poll requests, and rings of
+  ///         provided buffers (the result is cached)
+  static bool Supported();
+
+  /// File descriptor of the io_uring instance
+  int      FD()       const { return m_fd;       }
+
+  /// Size of each provided receive buffer
+  unsigned BufSize()  const { return m_buf_size; }
+
+  /// Number of prepared submission entries not yet passed to the kernel
+  unsigned Pending()  const { return m_sqe_tail - m_sqe_head; }
+
+  /// @return true if there are completion entries waiting to be processed
+  bool     HasCQE()   const {
+    return __atomic_load_n(m_cq_tail, __ATOMIC_ACQUIRE) != *m_cq_head;
+  }
+
+  /// Submit prepared entries without waiting for completions
+  /// @return number of submitted entries
+  int  Submit();
+
+  /// Submit prepared entries and wait up to \a a_timeout_msec for at least
+  /// one completion to become available (no waiting if \a a_timeout_msec is
+  /// 0, indefinite wait if it's negative).
+  /// @return false on timeout or signal interrupt
+  bool SubmitAndWait(int a_timeout_msec);
+
+  /// Invoke \a a_fun for every available completion entry
+  /// @return number of processed entries
+  template <typename Fun>
+  unsigned ForEachCQE(Fun&& a_fun) {
+    unsigned head = *m_cq_head;
+    unsigned tail = __atomic_load_n(m_cq_tail, __ATOMIC_ACQUIRE);
+    unsigned n    = tail - head;
+    for (; head != tail; ++head) {
+      a_fun(m_cqes[head & m_cq_mask]);
+      // Release the entry right away, so that handlers submitting new
+      // requests don't overflow the completion queue
+      __atomic_store_n(m_cq_head, head+1, __ATOMIC_RELEASE);
+    }
+    return n;
+  }
+
+  /// @return id of the provided buffer holding the data of \a a_cqe or -1
+  static int  BufferID(io_uring_cqe const& a_cqe) {
+    return (a_cqe.flags & IORING_CQE_F_BUFFER)
+         ? int(a_cqe.flags >> IORING_CQE_BUFFER_SHIFT) : -1;
+  }
+
+  /// Data of the provided buffer \a a_bid
+  const char* Buffer(int a_bid) const { return m_bufs + size_t(a_bid)*m_buf_size; }
+
+  /// Give the provided buffer \a a_bid back to the kernel
+  void ReturnBuffer(int a_bid) {
+    AddBuffer(a_bid);
+    __atomic_store_n(&m_buf_ring->tail, m_buf_tail, __ATOMIC_RELEASE);
+  }
+
+  //----------------------------------------------------------------------------
+  // Request preparation
+  //----------------------------------------------------------------------------
+
+  /// Multishot recv(2) into provided buffers
+  void PrepRecvMultishot(int a_fd, uint64_t a_udata);
+  /// Multishot poll for \a a_events (POLLIN, POLLOUT, etc.)
+  void PrepPollMultishot(int a_fd, uint32_t a_events, uint64_t a_udata);
+  /// Remove a poll request identified by \a a_target
+  void PrepPollRemove(uint64_t a_target, uint64_t a_udata);
+  /// Cancel all requests issued for \a a_fd
+  void PrepCancelFD(int a_fd, uint64_t a_udata);
+
+private:
+  int             m_fd;
+  // Submission queue
+  unsigned*       m_sq_head;
+  unsigned*       m_sq_tail;
+  unsigned*       m_sq_array;
+  unsigned        m_sq_mask;
+  unsigned        m_sq_entries;
+  unsigned        m_sqe_head;   ///< First entry not yet passed to the kernel
+  unsigned        m_sqe_tail;   ///< Next entry to be prepared
+  io_uring_sqe*   m_sqes;
+  // Completion queue
+  unsigned*       m_cq_head;
+  unsigned*       m_cq_tail;
+  unsigned        m_cq_mask;
+  io_uring_cqe*   m_cqes;
+  // Mapped memory
+  void*           m_sq_ptr;
+  size_t          m_sq_size;
+  void*           m_cq_ptr;
+  size_t          m_cq_size;
+  size_t          m_sqes_size;
+  // Provided buffers
+  io_uring_buf_ring* m_buf_ring;
+  size_t          m_buf_ring_size;
+  char*           m_bufs;
+  unsigned        m_nbufs;
+  unsigned        m_buf_size;
+  uint16_t        m_buf_tail;
+
+  static const uint16_t s_buf_group = 0;
+
+  io_uring_sqe* GetSQE();
+  int  Enter(unsigned a_wait_nr, unsigned a_flags, void* a_arg, size_t a_arg_sz);
+  void AddBuffer(int a_bid) {
+    // Note: the flexible array member io_uring_buf_ring::bufs is preceded
+    // by an empty struct, which is not zero-sized in C++, so it's not used
+    auto& b = reinterpret_cast<io_uring_buf*>(m_buf_ring)[m_buf_tail++ & (m_nbufs-1)];
+    b.addr  = uint64_t(uintptr_t(Buffer(a_bid)));
+    b.len   = m_buf_size;
+    b.bid   = uint16_t(a_bid);
+  }
+  void Close();
+  // @return description of a missing kernel feature or NULL if the io_uring
+  // instance a_fd created with a_features supports all used features
+  static const char* Unsupported(int a_fd, unsigned a_features);
+};
+
+} // namespace io
+} // namespace utxx
@@ -0,0 +1,189 @@
+// vim:ts=2:sw=2:et
+//------------------------------------------------------------------------------
+/// \file  ReactorTimerWheel.hpp
+//------------------------------------------------------------------------------
+/// \brief Hierarchical timer wheel used by the reactor's timers
+///
+/// The wheel has 4 levels of 256 slots. A timer expiring in less than 256
+/// ticks is linked to a slot of level 0, one expiring in less than 2^16
+/// ticks - to a slot of level 1, etc. When the level 0 index wraps, the
+/// timers of the current slot of level 1 are redistributed (cascaded) to
+/// level 0, and so on. Timers are stored in a pool and addressed by a
+/// TimerID that combines the pool index with a generation number, so that
+/// adding, cancelling and rescheduling a timer is O(1).
+//------------------------------------------------------------------------------
+// Copyright (c) 2026 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-16
+//------------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the utxx open-source project.
+
+Copyright (C) 2026 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+#pragma once
+
+#include <utxx/io/ReactorTypes.hpp>
+#include <vector>
+
+namespace utxx {
+namespace io   {
+
+//------------------------------------------------------------------------------
+/// Hierarchical timer wheel with the resolution of one tick
+//------------------------------------------------------------------------------
+class TimerWheel {
+public:
+  /// @param a_now     current tick
+  /// @param a_reserve number of timers to preallocate
+  explicit TimerWheel(uint64_t a_now = 0, size_t a_reserve = 0);
+
+  TimerWheel(TimerWheel const&) = delete;
+  TimerWheel& operator=(TimerWheel const&) = delete;
+
+  /// Last processed tick
+  uint64_t Now()  const { return m_now;  }
+  /// Number of scheduled timers
+  size_t   Size() const { return m_size; }
+
+  /// Schedule a timer.
+  /// @param a_expires  tick at which the timer fires (a tick in the past or
+  ///                   Now() fires the timer on the next tick)
+  /// @param a_interval repetition interval in ticks (0 - one-shot timer)
+  /// @param a_fun      callback to invoke
+  /// @return handle of the timer
+  TimerID  Add(uint64_t a_expires, uint64_t a_interval, EventHandler const& a_fun);
+
+  /// Reschedule timer \a a_id to fire at \a a_expires.
+  /// @return false if the timer is not found (it has fired or was cancelled)
+  bool     Reschedule(TimerID a_id, uint64_t a_expires, uint64_t a_interval);
+
+  /// Cancel timer \a a_id.
+  /// @return false if the timer is not found (it has fired or was cancelled)
+  bool     Cancel(TimerID a_id);
+
+  /// Check if the timer \a a_id is scheduled
+  bool     Active(TimerID a_id) const { return Find(a_id) != NIL; }
+
+  /// Cancel all timers
+  void     Clear();
+
+  /// Tick at which Advance() has to be called next, or ~0 if no timers are
+  /// scheduled. For timers in the upper levels this is the tick of their
+  /// cascading, which may precede their expiration.
+  uint64_t NextExpiry() const;
+
+  /// Process ticks up to \a a_tick invoking \a a_fire(const EventHandler&,
+  /// TimerID) for each expired timer. Ticks with no timers to fire or
+  /// cascade are skipped. The callback may add, reschedule or cancel timers
+  /// including the one being fired, but must not throw.
+  /// @return number of fired timers
+  template <typename Fire>
+  size_t   Advance(uint64_t a_tick, Fire&& a_fire);
+
+private:
+  enum : uint32_t { NIL = ~0u };
+  enum { BITS = 8, SLOTS = 1 << BITS, MASK = SLOTS - 1, LEVELS = 4 };
+
+  struct Node {
+    uint64_t      expires;
+    uint64_t      interval;
+    uint32_t      next;
+    uint32_t      prev;
+    uint32_t      gen;
+    uint32_t      slot;     ///< NIL when not linked to a slot
+    EventHandler  fun;
+  };
+
+  std::vector<Node> m_nodes;
+  uint32_t          m_free = NIL;           ///< Free list of m_nodes
+  uint32_t          m_slots[LEVELS*SLOTS];
+  uint64_t          m_now;
+  size_t            m_size = 0;
+
+  static TimerID ID(uint32_t a_idx, uint32_t a_gen) {
+    return TimerID(a_gen) << 32 | (a_idx + 1);
+  }
+
+  uint32_t Find(TimerID a_id) const {
+    uint32_t idx = uint32_t(a_id) - 1;
+    return idx < m_nodes.size() && m_nodes[idx].gen == uint32_t(a_id >> 32)
+         ? idx : NIL;
+  }
+
+  uint32_t Alloc();
+  void     Free  (uint32_t a_idx);
+  void     Link  (uint32_t a_idx);
+  void     Unlink(uint32_t a_idx);
+  void     Cascade(int a_level);
+};
+
+//------------------------------------------------------------------------------
+template <typename Fire>
+size_t TimerWheel::
+Advance(uint64_t a_tick, Fire&& a_fire)
+{
+  size_t n = 0;
+
+  while (m_now < a_tick) {
+    // Positions of timers only depend on their expiration ticks, so the
+    // wheel can be fast-forwarded over the ticks having nothing to process
+    auto next = NextExpiry();
+    if  (next > a_tick) {
+      m_now = a_tick;
+      break;
+    }
+
+    m_now    = next;
+    auto idx = m_now & MASK;
+    if (!idx)
+      Cascade(1);
+
+    auto& head = m_slots[idx];
+
+    while (head != NIL) {
+      auto  i    = head;
+      auto& node = m_nodes[i];
+      auto  id   = ID(i, node.gen);
+      auto  fun  = std::move(node.fun);
+      bool  rep  = node.interval != 0;
+
+      Unlink(i);
+
+      if (rep) {
+        node.expires += node.interval;
+        Link(i);
+      } else
+        Free(i);
+
+      a_fire(static_cast<EventHandler const&>(fun), id);
+      ++n;
+
+      // Restore the handler unless the timer was cancelled by the callback
+      if (rep && Find(id) != NIL && m_nodes[i].fun == nullptr)
+        m_nodes[i].fun = std::move(fun);
+    }
+  }
+
+  return n;
+}
+
+} // namespace io
+} // namespace utxx
@@ -38,7 +38,9 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include <utxx/enum.hpp>
 #include <utxx/error.hpp>
 #include <utxx/logger/logger_enums.hpp>
+#include <utxx/time_val.hpp>
 #include <boost/align/aligned_allocator.hpp>
+#include <netinet/in.h>
 #include <memory>
 
 namespace utxx {
@@ -62,6 +64,7 @@ UTXX_ENUM
   Timer,
   Signal,
   Accept,
+  DgramBatch,
   Error
 );
 
@@ -107,6 +110,9 @@ using           RawIOHandler = utxx::function<
 /// This handler type is for reacting to timer or eventfd events
 using           EventHandler = utxx::function<void(FdInfo&, long a_value)>;
 
+/// Handle of a timer scheduled with Reactor::ScheduleTimer() (0 - invalid)
+using           TimerID      = uint64_t;
+
 /// This handler type is for reacting to signal events
 using           SigHandler   = utxx::function<
                                 void(FdInfo&, int a_signal, int a_si_code)>;
@@ -115,6 +121,48 @@ using           SigHandler   = utxx::function<
 using           AcceptHandler= utxx::function<bool(FdInfo&,
                     const char* a_cli_path, int a_cli_fd)>;
 
+/// Datagram received by a DgramBatchHandler
+struct DgramPkt {
+  const char*   data;     ///< Packet payload
+  uint32_t      len;      ///< Payload length
+  uint32_t      flags;    ///< Message flags (e.g. MSG_TRUNC)
+  sockaddr_in   src;      ///< Source address
+  in_addr_t     dst_addr; ///< Destination address (with EnableDgramPktInfo())
+  in_addr_t     if_addr;  ///< Interface address   (with EnableDgramPktInfo())
+  time_val      ts_wire;  ///< Kernel timestamp    (with EnablePktTimeStamps())
+};
+
+/// Contiguous range of datagrams received by one recvmmsg(2) call.
+/// Packet payloads are only valid for the duration of the handler's call.
+class DgramSpan {
+public:
+  DgramSpan(const DgramPkt* a_pkts, size_t a_size)
+    : m_begin(a_pkts), m_end(a_pkts + a_size) {}
+
+  const DgramPkt* begin()                const { return m_begin;          }
+  const DgramPkt* end()                  const { return m_end;            }
+  size_t          size()                 const { return m_end - m_begin;  }
+  bool            empty()                const { return m_end == m_begin; }
+  const DgramPkt& operator[](size_t a_i) const { return m_begin[a_i];     }
+private:
+  const DgramPkt* m_begin;
+  const DgramPkt* m_end;
+};
+
+/// This handler type is for processing a batch of datagrams received at once.
+/// Negative return value aborts reading the remaining datagrams.
+using           DgramBatchHandler = utxx::function<
+                                int(FdInfo& a_fi, DgramSpan const& a_pkts)>;
+
+/// Task posted for execution on a reactor's thread by Reactor::Post()
+using           PostTask     = utxx::function<void()>;
+
+/// This handler type is for applying backpressure to producers of data
+/// queued by FdInfo::Send(). It's called with \a a_high = true when the
+/// number of queued bytes rises above the high watermark, and with
+/// \a a_high = false when it drops to the low watermark.
+using           WatermarkHandler = utxx::function<void(FdInfo& a_fi, bool a_high)>;
+
 /// This handler type is for reporting errors
 using           ErrHandler   = utxx::function<void(FdInfo&,    IOType a_type,
                                                    std::string const& a_error,
@@ -151,6 +199,7 @@ public:
   HandlerT(HType t, EventHandler  const& h) : m_type(t), m_eh(h) {}
   HandlerT(HType t, SigHandler    const& h) : m_type(t), m_sh(h) {}
   HandlerT(HType t, AcceptHandler const& h) : m_type(t), m_ah(h) {}
+  HandlerT(HType t, DgramBatchHandler const& h) : m_type(t), m_dh(h) {}
 
   HandlerT(const HandlerT& a_rhs) : HandlerT() { *this = a_rhs; }
   HandlerT(HandlerT&&      a_rhs) : HandlerT() { *this = std::move(a_rhs); }
@@ -168,6 +217,7 @@ public:
   const EventHandler&  AsTimer () const;
   const SigHandler&    AsSignal() const;
   const AcceptHandler& AsAccept() const;
+  const DgramBatchHandler& AsDgramBatch() const;
 
   void  Clear() { m_type = HType::UNDEFINED; }
 public:
@@ -180,9 +230,41 @@ public:
   EventHandler    m_eh;
   SigHandler      m_sh;
   AcceptHandler   m_ah;
+  DgramBatchHandler m_dh;
 };
 
 enum TriggerT { LEVEL_TRIGGERED, EDGE_TRIGGERED };
 
+/// Kernel interface used by the reactor for I/O multiplexing
+UTXX_ENUM
+(BackendT, int,
+  EPoll,      // epoll(7) readiness notification followed by read(2)/recvmsg(2)
+  IOUring     // io_uring(7) completions of multishot recv/poll and read requests
+);
+
+/// Options of the busy-polling (spin) mode of Reactor::Wait().
+/// The thresholds are measured from the time of the last processed event.
+struct SpinOpts {
+  uint32_t  spin_us      = 50;    ///< Poll in a tight loop
+  uint32_t  pause_us     = 1000;  ///< Poll with a CPU pause between polls
+  uint32_t  yield_us     = 10000; ///< Poll with sched_yield() between polls
+  int       busy_poll_us = 0;     ///< When > 0, set SO_BUSY_POLL on sockets
+};
+
+/// Counters of the busy-polling (spin) mode of Reactor::Wait()
+struct SpinStats {
+  uint64_t  polls    = 0;   ///< Number of non-blocking polls
+  uint64_t  empty    = 0;   ///< Number of polls returning no events
+  uint64_t  events   = 0;   ///< Number of processed events
+  uint64_t  pauses   = 0;   ///< Number of CPU pauses
+  uint64_t  yields   = 0;   ///< Number of sched_yield() calls
+  uint64_t  blocks   = 0;   ///< Number of blocking waits
+  uint64_t  spin_ns  = 0;   ///< Time spent in empty polls and backoff
+  uint64_t  work_ns  = 0;   ///< Time spent in polls processing events
+  uint64_t  block_ns = 0;   ///< Time spent in blocking waits
+
+  void Clear() { *this = SpinStats(); }
+};
+
 } // namespace io
 } // namespace utxx
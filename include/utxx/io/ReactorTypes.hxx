@@ -51,6 +51,8 @@ inline const EventHandler&  HandlerT::AsEvent () const { ACHKN(Event , m_eh ); }
 inline const EventHandler&  HandlerT::AsTimer () const { ACHKN(Timer , m_eh ); }
 inline const SigHandler&    HandlerT::AsSignal() const { ACHKN(Signal, m_sh ); }
 inline const AcceptHandler& HandlerT::AsAccept() const { ACHKN(Accept, m_ah ); }
+inline const DgramBatchHandler&
+                            HandlerT::AsDgramBatch() const { ACHKN(DgramBatch, m_dh); }
 #undef ACHKN
 #undef ACHK
 
@@ -67,6 +69,7 @@ operator=(HandlerT&& a_rhs)
     case HType::Timer:    m_eh    = std::move(a_rhs.m_eh); break;
     case HType::Signal:   m_sh    = std::move(a_rhs.m_sh); break;
     case HType::Accept:   m_ah    = std::move(a_rhs.m_ah); break;
+    case HType::DgramBatch: m_dh  = std::move(a_rhs.m_dh); break;
     default:              break;
   }
   m_type = a_rhs.m_type;
@@ -87,6 +90,7 @@ operator=(const HandlerT& a_rhs)
     case HType::Timer:    m_eh    = a_rhs.m_eh; break;
     case HType::Signal:   m_sh    = a_rhs.m_sh; break;
     case HType::Accept:   m_ah    = a_rhs.m_ah; break;
+    case HType::DgramBatch: m_dh  = a_rhs.m_dh; break;
     default:              break;
   }
   m_type = a_rhs.m_type;
@@ -0,0 +1,102 @@
+// vim:ts=2:sw=2:et
+//------------------------------------------------------------------------------
+/// \file  ReactorWrQueue.hpp
+//------------------------------------------------------------------------------
+/// \brief Gather write queue of the reactor's file descriptors
+///
+/// Instead of copying outgoing data into a contiguous write buffer, callers
+/// queue segments of reference-counted buffers, which are written to the
+/// file descriptor by writev(2) calls of up to IOV_MAX segments each.
+//------------------------------------------------------------------------------
+// Copyright (c) 2026 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-16
+//------------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the utxx open-source project.
+
+Copyright (C) 2026 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+#pragma once
+
+#include <utxx/iovector.hpp>
+#include <sys/uio.h>
+#include <deque>
+#include <memory>
+#include <vector>
+
+namespace utxx {
+namespace io   {
+
+//------------------------------------------------------------------------------
+/// Queue of data segments pending to be written to a file descriptor
+//------------------------------------------------------------------------------
+class WrQueue {
+public:
+  /// Owner of a queued buffer, which is released when the buffer is written
+  using Owner = std::shared_ptr<const void>;
+
+  WrQueue();
+
+  WrQueue(WrQueue const&) = delete;
+  WrQueue& operator=(WrQueue const&) = delete;
+
+  /// Number of bytes pending to be written
+  size_t Bytes()  const { return m_bytes;         }
+  /// Number of segments pending to be written
+  size_t Size()   const { return m_segs.size();   }
+  bool   Empty()  const { return m_segs.empty();  }
+
+  /// Queue \a a_len bytes of \a a_data kept alive by \a a_owner until written.
+  /// When \a a_owner is null, the caller must guarantee that the data stays
+  /// valid until it is written.
+  void Push(const void* a_data, size_t a_len, Owner const& a_owner = nullptr);
+
+  /// Queue a buffer owning its data
+  template <class Buf>
+  void Push(std::shared_ptr<Buf> const& a_buf)
+  { Push(a_buf->data(), a_buf->size(), a_buf); }
+
+  /// Queue segments of \a a_vec kept alive by \a a_owner until written
+  void Push(iovector const& a_vec, Owner const& a_owner = nullptr);
+
+  /// Write queued segments to the non-blocking \a a_fd with writev(2).
+  /// Writing stops when the queue is drained or the fd is not writable.
+  /// Partially written segments remain at the head of the queue.
+  /// @return number of written bytes (0 on EAGAIN), or -1 on error (errno
+  ///         is set)
+  long   Flush(int a_fd);
+
+  /// Discard all queued segments
+  void   Clear();
+
+private:
+  struct Segment {
+    iovec iov;
+    Owner owner;
+  };
+
+  std::deque<Segment>     m_segs;
+  std::vector<iovec>      m_iov;      ///< Scratch array passed to writev(2)
+  size_t                  m_bytes = 0;
+};
+
+} // namespace io
+} // namespace utxx
@@ -33,17 +33,23 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #pragma once
 
 #include <utxx/synch.hpp>
+#include <utxx/compiler_hints.hpp>
 #include <iostream>
 #include <functional>
+#include <algorithm>
 #include <atomic>
 #include <thread>
 #include <memory>
 #include <string>
 #include <stdio.h>
 #include <stdarg.h>
+#include <string.h>
 #include <unistd.h>
 #include <assert.h>
 #include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/xattr.h>
 #include <fcntl.h>
 
 namespace utxx {
@@ -121,6 +127,126 @@ struct async_fd_logger_traits : public async_file_logger_traits {
     static int file_flush(file_type  a_fd) { return 0; }
 };
 
+//-----------------------------------------------------------------------------
+/// File written through a memory-mapped window at its tail
+///
+/// The file is preallocated with fallocate(2) in extents of \a a_extent
+/// bytes, and the writer maps a window of the same size, which is moved
+/// forward when the tail reaches its end.  Therefore writes are memory copies
+/// and the only system calls are made once per extent (to grow the file and
+/// to move the window) and once per \a a_flush_size bytes (to start
+/// background writeback of dirty pages with sync_file_range(2)).
+/// On close the file is truncated to the size of the data written.  If the
+/// process crashes, the file keeps its preallocated size and the data is
+/// followed by zero padding, which is trimmed when the file is reopened.
+/// The size of the data is recorded in the "user.utxx.data_size" extended
+/// attribute of the file when writeback is started, when the file is grown
+/// and on close, and only the NUL bytes past the recorded size are trimmed,
+/// so trailing NUL bytes of the data itself are preserved.  The recorded
+/// size may lag behind the data, which is scanned past it on reopen.  If the
+/// file system doesn't support extended attributes, all trailing NUL bytes of
+/// the file are trimmed.
+//-----------------------------------------------------------------------------
+class mmap_file_writer {
+    int     m_fd;
+    size_t  m_extent;
+    size_t  m_flush_size;
+    size_t  m_pos;          // File offset of the tail (size of data written)
+    size_t  m_alloc;        // Preallocated size of the file
+    size_t  m_synced;       // Offset up to which writeback was started
+    char*   m_win;          // Mapped window
+    size_t  m_win_off;      // File offset of the window
+    size_t  m_recorded;     // Data size stored in the extended attribute
+    bool    m_record;       // Extended attributes are supported
+
+    static constexpr const char* s_size_attr = "user.utxx.data_size";
+
+    // Map the window containing file offset a_pos
+    int remap(size_t a_pos);
+    // Offset past the last non-zero byte in the range [a_from, a_size) of
+    // the file, a_from if the range is all zeros, or -1 on error
+    ssize_t data_size(size_t a_from, size_t a_size) const;
+    // Store the data size in the extended attribute of the file
+    int record_size();
+public:
+    /// Open a file for appending
+    /// @return a new writer or NULL on error (errno is set)
+    static mmap_file_writer* open(const std::string& a_filename, int a_perm,
+                                  size_t a_extent     = 64*1024*1024,
+                                  size_t a_flush_size = 1024*1024);
+
+    /// Write to \a a_fd starting at its current end of file
+    /// @param a_extent     size of preallocated extents and of the mapped
+    ///                     window (rounded up to the page size)
+    /// @param a_flush_size number of written bytes that starts writeback
+    mmap_file_writer(int a_fd, size_t a_extent, size_t a_flush_size);
+
+    ~mmap_file_writer() { close(); }
+
+    mmap_file_writer(const mmap_file_writer&)            = delete;
+    mmap_file_writer& operator=(const mmap_file_writer&) = delete;
+
+    /// Append data to the file
+    /// @return \a a_sz or -1 on error (errno is set)
+    int write(const char* a_data, size_t a_sz) {
+        for (auto n = a_sz; n; ) {
+            if (unlikely(m_pos <  m_win_off || m_pos >= m_win_off + m_extent))
+                if (remap(m_pos) < 0)
+                    return -1;
+            auto m = std::min(n, m_win_off + m_extent - m_pos);
+            memcpy(m_win + (m_pos - m_win_off), a_data, m);
+            m_pos  += m;
+            a_data += m;
+            n      -= m;
+        }
+        return a_sz;
+    }
+
+    /// Start writeback of the data written since the last writeback, and
+    /// record the size of the data written to the file, if there are at
+    /// least flush_size() bytes of it or \a a_force is true
+    int flush(bool a_force = false);
+
+    /// Unmap the window, truncate the file to the size of data written and
+    /// close the file descriptor
+    int close();
+
+    int    fd()         const { return m_fd;         }
+    /// Size of data written to the file
+    size_t size()       const { return m_pos;        }
+    /// Preallocated size of the file
+    size_t allocated()  const { return m_alloc;      }
+    size_t extent()     const { return m_extent;     }
+    size_t flush_size() const { return m_flush_size; }
+};
+
+//-----------------------------------------------------------------------------
+/// Traits of asynchronous logger writing to a memory-mapped file
+/// (see mmap_file_writer).  Override file_open() to change the extent and
+/// flush sizes.
+//-----------------------------------------------------------------------------
+struct async_mmap_logger_traits : public async_file_logger_traits {
+    using file_type  = mmap_file_writer*;
+    static constexpr const file_type null_file_value = nullptr;
+
+    static file_type file_open(const std::string& a_filename,
+                               int a_perm  = def_permissions) {
+        return mmap_file_writer::open(a_filename, a_perm);
+    };
+
+    static int file_write(file_type a_fd, const char* a_data, size_t a_sz) {
+        return a_fd->write(a_data, a_sz);
+    };
+
+    static int file_close(file_type& a_fd) {
+        int rc = a_fd->close();
+        delete a_fd;
+        a_fd = nullptr;
+        return rc;
+    }
+    static int file_flush(file_type  a_fd) { return a_fd->flush(); }
+};
+
 //-----------------------------------------------------------------------------
 /// Asynchronous logger of text messages.
 //-----------------------------------------------------------------------------
@@ -294,6 +420,166 @@ struct text_file_logger: public basic_async_logger<Traits> {
 // Implementation
 //-----------------------------------------------------------------------------
 
+inline mmap_file_writer*
+mmap_file_writer::open(const std::string& a_filename, int a_perm,
+                       size_t a_extent, size_t a_flush_size)
+{
+    int fd = ::open(a_filename.c_str(), O_CREAT | O_RDWR, a_perm);
+    if (fd < 0)
+        return nullptr;
+    auto p = new mmap_file_writer(fd, a_extent, a_flush_size);
+    if (p->fd() < 0) {
+        int e = errno;
+        delete p;
+        errno = e;
+        return nullptr;
+    }
+    return p;
+}
+
+inline mmap_file_writer::
+mmap_file_writer(int a_fd, size_t a_extent, size_t a_flush_size)
+    : m_fd(a_fd)
+    , m_flush_size(a_flush_size)
+    , m_pos(0)
+    , m_alloc(0)
+    , m_synced(0)
+    , m_win(nullptr)
+    , m_win_off(0)
+    , m_recorded(0)
+    , m_record(true)
+{
+    size_t page = sysconf(_SC_PAGESIZE);
+    m_extent    = std::max(page, (a_extent + page - 1) & ~(page - 1));
+
+    struct stat st;
+    if (::fstat(m_fd, &st) < 0) {
+        int e = errno;
+        ::close(m_fd);
+        m_fd  = -1;
+        errno = e;
+        return;
+    }
+    // Trim the zero padding preallocated before a crash past the data size
+    // recorded by the last flush
+    uint64_t rec;
+    if (::fgetxattr(m_fd, s_size_attr, &rec, sizeof(rec)) == sizeof(rec))
+        m_recorded = std::min<uint64_t>(rec, st.st_size);
+    else if (errno == ENOTSUP)
+        m_record   = false;
+    ssize_t sz = data_size(m_recorded, st.st_size);
+    if (sz < 0 || (sz < st.st_size && ::ftruncate(m_fd, sz) < 0)) {
+        int e = errno;
+        ::close(m_fd);
+        m_fd  = -1;
+        errno = e;
+        return;
+    }
+    m_pos = m_alloc = m_synced = sz;
+    // The window is mapped on the first write
+    m_win_off = m_pos + m_extent;
+}
+
+inline ssize_t mmap_file_writer::data_size(size_t a_from, size_t a_size) const
+{
+    char buf[4096];
+    while (a_size > a_from) {
+        size_t  off = a_size - a_from > sizeof(buf) ? a_size - sizeof(buf) : a_from;
+        ssize_t n   = ::pread(m_fd, buf, a_size - off, off);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        if (size_t(n) != a_size - off) {
+            errno = EIO;
+            return -1;
+        }
+        for (auto p = buf + n; p != buf; --p)
+            if (p[-1])
+                return off + (p - buf);
+        a_size = off;
+    }
+    return a_from;
+}
+
+inline int mmap_file_writer::record_size()
+{
+    if (!m_record || m_recorded == m_pos)
+        return 0;
+    uint64_t n = m_pos;
+    if (::fsetxattr(m_fd, s_size_attr, &n, sizeof(n), 0) < 0) {
+        if (errno != ENOTSUP)
+            return -1;
+        m_record = false;
+        return 0;
+    }
+    m_recorded = m_pos;
+    return 0;
+}
+
+inline int mmap_file_writer::remap(size_t a_pos)
+{
+    size_t page = sysconf(_SC_PAGESIZE);
+    size_t off  = a_pos & ~(page - 1);
+    size_t end  = off + m_extent;
+
+    // Grow the file by whole extents past the new window
+    if (end > m_alloc) {
+        if (record_size() < 0)
+            return -1;
+        size_t n = std::max(end, m_alloc + m_extent) - m_alloc;
+        if (::fallocate(m_fd, 0, m_alloc, n) < 0 &&
+           (errno != EOPNOTSUPP || ::ftruncate(m_fd, m_alloc + n) < 0))
+            return -1;
+        m_alloc += n;
+    }
+
+    if (m_win)
+        ::munmap(m_win, m_extent);
+
+    void* p = ::mmap(nullptr, m_extent, PROT_READ | PROT_WRITE, MAP_SHARED,
+                     m_fd, off);
+    if (p == MAP_FAILED) {
+        m_win     = nullptr;
+        m_win_off = m_pos + m_extent;
+        return -1;
+    }
+    m_win     = static_cast<char*>(p);
+    m_win_off = off;
+    return 0;
+}
+
+inline int mmap_file_writer::flush(bool a_force)
+{
+    size_t n = m_pos - m_synced;
+    if (!n || (n < m_flush_size && !a_force))
+        return 0;
+    if (record_size() < 0)
+        return -1;
+    int rc = ::sync_file_range(m_fd, m_synced, n, SYNC_FILE_RANGE_WRITE);
+    m_synced = m_pos;
+    return rc;
+}
+
+inline int mmap_file_writer::close()
+{
+    if (m_fd < 0)
+        return 0;
+
+    int rc = 0;
+    if (m_win && ::munmap(m_win, m_extent) < 0)
+        rc = -1;
+    m_win = nullptr;
+    if (m_alloc != m_pos && ::ftruncate(m_fd, m_pos) < 0)
+        rc = -1;
+    if (record_size() < 0)
+        rc = -1;
+    if (::close(m_fd) < 0)
+        rc = -1;
+    m_fd = -1;
+    return rc;
+}
+
 template<typename traits>
 int basic_async_logger<traits>::
 start(const std::string& a_filename, bool a_notify_immediate, int a_perm)
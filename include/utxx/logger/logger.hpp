@@ -54,9 +54,13 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include <utxx/compiler_hints.hpp>
 #include <utxx/config_tree.hpp>
 #include <utxx/concurrent_mpsc_queue.hpp>
+#include <utxx/concurrent_spsc_queue.hpp>
 #include <utxx/logger/logger_enums.hpp>
 #include <utxx/logger/logger_util.hpp>
+#include <utxx/logger/logger_binary.hpp>
 #include <utxx/synch.hpp>
+#include <utxx/buffer.hpp>
+#include <sys/uio.h>
 #include <thread>
 #include <mutex>
 #if __cplusplus >= 201703L
@@ -184,6 +188,21 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
     utxx::logger::instance().logfmt(Level, Cat, UTXX_LOG_SRCINFO, \
                                     Fmt, ##__VA_ARGS__)
 
+/// Binary logging: the arguments are copied in raw form to the message slot,
+/// and the text is rendered by the logger's thread. \a Fmt must be a string
+/// literal with printf-like format, and arguments must be of arithmetic,
+/// pointer or string types.
+#define UTXX_BCLOG(Level, Cat, Fmt, ...) \
+    do { \
+        static const utxx::bin_format s_utxx_bin_fmt( \
+            decltype(utxx::bin_arg_list_of(__VA_ARGS__))(), \
+            Fmt, UTXX_LOG_SRCINFO); \
+        utxx::logger::instance().logbin(Level, Cat, s_utxx_bin_fmt, ##__VA_ARGS__); \
+    } while(0)
+
+#define UTXX_BLOG(Level, Fmt, ...) \
+    UTXX_BCLOG(Level, utxx::logger::nocat(), Fmt, ##__VA_ARGS__)
+
 #define UTXX_ASYNC_CLOG(Level, Cat, Fmt, ...) \
     do { \
         auto f = [=](char* a_buf, size_t a_size) { \
@@ -276,7 +295,7 @@ struct logger : boost::noncopyable {
     using str_function   = function
         <std::string (const char* pfx, size_t plen, const char* sfx, size_t slen)>;
 
-    enum class payload_t { STR_FUN, CHAR_FUN, STR
+    enum class payload_t { STR_FUN, CHAR_FUN, STR, BIN
 #if __cplusplus >= 201703L
         , STR_VIEW
 #endif
@@ -293,6 +312,13 @@ struct logger : boost::noncopyable {
         payload_t     m_type;
         pthread_t     m_thread_id;
         char          m_thread_name[16];
+        /// Order of the message among the messages of its thread
+        uint64_t      m_seq = next_seq();
+
+        static uint64_t next_seq() {
+            static thread_local uint64_t s_seq;
+            return ++s_seq;
+        }
 
         struct str_wrap {
             str_wrap(const char* a_cstr, size_t a_sz)
@@ -302,10 +328,18 @@ struct logger : boost::noncopyable {
             size_t      m_size;
         };
 
+        /// Binary-encoded arguments of a UTXX_BCLOG() call
+        struct bin_payload {
+            const bin_format* fmt;
+            uint32_t          size;
+            char              data[UTXX_LOGGER_BIN_CAPACITY];
+        };
+
         union U {
             char_function     cf;
             str_function      sf;
             std::string       str;
+            bin_payload       bin;
 #if __cplusplus >= 201703L
             std::string_view  strv;
             U(const std::string_view& v) : strv(v){}
@@ -316,6 +350,7 @@ struct logger : boost::noncopyable {
             U(const str_wrap&         v) : str(v.m_str, v.m_size) {}
             U(const std::string&      v) : str(v) {}
             U(std::string&&           v) : str(std::move(v)) {}
+            U(const bin_format*       f) : bin{f, 0, {}} {}
             ~U() {}
         } m_fun;
 
@@ -393,6 +428,30 @@ struct logger : boost::noncopyable {
                   a_src_loc, a_sloc_len, a_src_fun, a_sfun_len)
         {}
 
+        /// Binary message with the \a a_args encoded in place
+        template <typename... Args>
+        msg(log_level a_ll, const std::string& a_category, const bin_format& a_fmt,
+            uint32_t  a_size, const Args&... a_args)
+            : m_timestamp   (now_utc())
+            , m_level       (a_ll)
+            , m_category    (a_category)
+            , m_src_loc_len (a_fmt.src_loc_len)
+            , m_src_location(a_fmt.src_loc)
+            , m_src_fun_len (a_fmt.src_fun_len)
+            , m_src_fun     (a_fmt.src_fun)
+            , m_type        (payload_t::BIN)
+            , m_thread_id   (pthread_self())
+            , m_fun         (&a_fmt)
+        {
+            assert(a_size <= sizeof(m_fun.bin.data));
+            m_fun.bin.size = a_size;
+            bin_encode(m_fun.bin.data, a_args...);
+
+            if (logger::instance().show_thread() != logger::thr_id_type::NAME ||
+                pthread_getname_np(m_thread_id, m_thread_name, sizeof(m_thread_name)) < 0)
+                m_thread_name[0] = '\0';
+        }
+
         msg(log_level a_ll, const std::string& a_category, std::string&& a_val,
             const char* a_src_loc, std::size_t a_sloc_len,
             const char* a_src_fun, std::size_t a_sfun_len
@@ -432,6 +491,7 @@ struct logger : boost::noncopyable {
                 case payload_t::STR_FUN:  m_fun.sf = nullptr;  break;
                 case payload_t::CHAR_FUN: m_fun.cf = nullptr;  break;
                 case payload_t::STR:      m_fun.str.~basic_string(); break;
+                case payload_t::BIN:      break;
 #if __cplusplus >= 201703L
                 case payload_t::STR_VIEW: m_fun.strv.~basic_string_view(); break;
 #endif
@@ -446,6 +506,22 @@ struct logger : boost::noncopyable {
         std::size_t   src_fun_len () const { return m_src_fun_len;  }
         const char*   src_fun_name() const { return m_src_fun;      }
         payload_t     type        () const { return m_type;         }
+
+        /// True if this message was logged before \a a_rhs.  Messages of the
+        /// same thread with equal timestamps are ordered by their sequence.
+        bool before(const msg& a_rhs) const {
+            return m_timestamp < a_rhs.m_timestamp
+                || (m_timestamp == a_rhs.m_timestamp && m_seq < a_rhs.m_seq &&
+                    pthread_equal(m_thread_id, a_rhs.m_thread_id));
+        }
+
+        /// Format of a payload_t::BIN message (nullptr for other types)
+        const bin_format* bin_fmt () const {
+            return m_type == payload_t::BIN ? m_fun.bin.fmt : nullptr;
+        }
+        /// Encoded arguments of a payload_t::BIN message
+        const char*   bin_data    () const { return m_fun.bin.data;     }
+        uint32_t      bin_size    () const { return m_fun.bin.size;     }
     };
 
     struct msg_streamer {
@@ -539,6 +615,36 @@ struct logger : boost::noncopyable {
         <void (const msg& a_msg, const char* a_buf, size_t a_size)>
         on_msg_delegate_t;
 
+    /// Batch of messages drained from the queue by the logger's thread.
+    /// All messages of a batch are formatted into one contiguous arena, and
+    /// the i-th message is described by <message(i)> and <iov()[i]>, so that
+    /// a back-end can write the whole batch with a single writev(2) call.
+    /// A payload_t::BIN message is not rendered (its iovec is empty) if none
+    /// of the sinks of its level consumes text (see add_batch()).
+    class msg_batch {
+        const msg* const*   m_msgs;
+        const iovec*        m_iov;
+        size_t              m_count;
+        size_t              m_bytes;
+    public:
+        msg_batch(const msg* const* a_msgs, const iovec* a_iov,
+                  size_t a_count,   size_t a_bytes)
+            : m_msgs(a_msgs), m_iov(a_iov), m_count(a_count), m_bytes(a_bytes)
+        {}
+
+        /// Number of messages in the batch
+        size_t       size()            const { return m_count;      }
+        bool         empty()           const { return !m_count;     }
+        /// Total number of formatted bytes in the batch
+        size_t       bytes()           const { return m_bytes;      }
+        /// Array of size() formatted messages
+        const iovec* iov()             const { return m_iov;        }
+        /// Message descriptor of the i-th formatted message
+        const msg&   message(size_t i) const { return *m_msgs[i];   }
+    };
+
+    typedef delegate<void (const msg_batch& a_batch)> on_batch_delegate_t;
+
     // Maps macros to values that can be used in configuration
     // DEPRECATED
     using macro_var_map = config_macros;
@@ -547,15 +653,73 @@ private:
     using concurrent_queue = concurrent_mpsc_queue<msg>;
     using signal_delegate  = signal<on_msg_delegate_t>;
 
+    struct batch_sink {
+        int                 id;
+        uint32_t            levels;
+        on_batch_delegate_t sink;
+        bool                text;
+    };
+
+    using lane_queue       = concurrent_spsc_queue<msg>;
+
+    /// Pre-allocated per-thread message ring written by a single producer
+    struct lane {
+        explicit lane(uint32_t a_capacity) : queue(a_capacity), orphan(false) {}
+
+        lane_queue                  queue;
+        /// Set when the owning thread exits, so that the drained lane is freed
+        std::atomic<bool>           orphan;
+    };
+
+    /// Lanes of all threads.  Shared with the threads' lane references, so
+    /// that a thread can release its lane after the logger is destroyed.
+    struct lane_registry {
+        std::mutex                          mutex;
+        std::vector<std::unique_ptr<lane>>  lanes;
+        std::atomic<bool>                   changed{false};
+        /// Incremented by init(), so that threads replace their lanes with
+        /// ones of the newly configured capacity
+        std::atomic<uint32_t>               gen{0};
+        /// Set by ~logger(): nobody drains the lanes anymore
+        bool                                detached = false;
+    };
+
+    /// Thread-local reference to the lane owned by the current thread
+    struct lane_ref {
+        std::shared_ptr<lane_registry> reg;
+        lane*    ptr   = nullptr;
+        /// Value of lane_registry::gen when the lane was registered
+        uint32_t gen   = 0;
+        ~lane_ref() { release(); }
+        void release();
+    };
+
     std::unique_ptr<std::thread>    m_thread;
     concurrent_queue                m_queue;
     bool                            m_abort                 = false;
-    std::atomic<bool>               m_initialized;
+    std::atomic<bool>               m_initialized{false};
     futex                           m_event;
+    /// Set by the logger thread while it waits on m_event
+    std::atomic<bool>               m_sleeping{false};
     std::mutex                      m_mutex;
     struct timespec                 m_wait_timeout;
 
     signal_delegate                 m_sig_slot[NLEVELS];
+    std::vector<batch_sink>         m_batch_sinks;
+    int                             m_batch_sink_count      = 0;
+    /// Levels of messages delivered to sinks consuming formatted text
+    uint32_t                        m_text_levels           = 0;
+    size_t                          m_batch_size            = 1024;
+    dynamic_io_buffer               m_batch_arena{64*1024};
+    std::vector<const msg*>         m_batch_msgs;
+    std::vector<iovec>              m_batch_iov;
+    std::vector<const msg*>         m_batch_sel_msgs;
+    std::vector<iovec>              m_batch_sel_iov;
+    uint32_t                        m_lane_capacity         = 0;
+    std::shared_ptr<lane_registry>  m_lanes{std::make_shared<lane_registry>()};
+    std::vector<lane*>              m_active_lanes;     // Used by logger thread
+    std::vector<uint32_t>           m_lane_taken;       // Used by logger thread
+    std::vector<uint32_t>           m_lane_avail;       // Used by logger thread
     unsigned int                    m_level_filter          = LEVEL_NO_DEBUG;
     implementations_vector          m_implementations;
     stamp_type                      m_timestamp_type        = TIME;
@@ -570,7 +734,7 @@ private:
     int                             m_fatal_kill_signal     = 0;
     long                            m_sched_yield_us        = 250;
     bool                            m_block_signals         = true;
-    std::atomic<bool>               m_finalizer_installed;
+    std::atomic<bool>               m_finalizer_installed{false};
     config_macros                   m_macro_var_map;
 
     /// Signal set handled by the installed crash signal handler
@@ -588,6 +752,10 @@ private:
     char* format_header(const msg& a_msg, char* a_buf, const char* a_end);
     char* format_footer(const msg& a_msg, char* a_buf, const char* a_end);
 
+    /// Append formatted \a a_msg to the write end of \a a_buf.
+    /// @return number of bytes written
+    size_t format_msg(const msg& a_msg, dynamic_io_buffer& a_buf);
+
     /// @return <true> if log <level> is enabled.
     bool is_enabled(log_level level) const {
         return (m_level_filter & (unsigned int)level) != 0;
@@ -604,7 +772,32 @@ private:
     /// To be called by <logger_impl> child to unregister a delegate
     void remove(log_level a_lvl, int a_id);
 
+    /// To be called by <logger_impl> child to register a delegate to be
+    /// invoked with batches of formatted messages matching \a a_levels mask.
+    /// @param a_text if false, the sink only writes payload_t::BIN messages
+    ///               in binary form, and they aren't rendered to text unless
+    ///               another sink of their level needs it.
+    /// @return Id assigned to the batch sink, which is to be used
+    ///         in the remove_batch call to release the sink.
+    int  add_batch(uint32_t a_levels, on_batch_delegate_t a_subscriber,
+                   bool a_text = true);
+
+    /// To be called by <logger_impl> child to unregister a batch delegate
+    void remove_batch(int a_id);
+
+    /// Deliver a formatted batch to batch sinks and to per-message sinks
+    void dispatch(const msg_batch& a_batch, uint32_t a_levels);
+
+    /// Recalculate m_text_levels after a sink is added or removed
+    void update_text_levels();
+    /// True if the message needs to be formatted for some sink
+    bool needs_text(const msg& a_msg) const {
+        return !a_msg.bin_fmt() || (m_text_levels & a_msg.level())
+            || a_msg.level() == LEVEL_FATAL;
+    }
+
     void dolog_msg(const msg& a_msg);
+    void dolog_batch();
     void dolog_fatal_msg(const char* buf, size_t sz);
 
     template<typename Fun>
@@ -617,6 +810,25 @@ private:
                const char* a_src_loc,  std::size_t  a_src_loc_len,
                const char* a_src_fun,  std::size_t  a_src_fun_len);
 
+    /// Enqueue a message constructed from \a a_args to the calling thread's
+    /// lane (if lanes are enabled and the lane is not full) or to the shared
+    /// MPSC queue otherwise
+    template <typename... Args>
+    bool enqueue(Args&&... a_args);
+
+    /// @return the lane of the calling thread, registering it if needed
+    lane* thread_lane();
+    lane* register_lane(lane_ref& a_ref);
+
+    /// Called by the logger thread to pick up registered and exited lanes
+    void  refresh_lanes();
+    /// @return true if there are no pending messages in the queue and lanes
+    bool  queues_empty();
+    /// Called by init() to have threads replace their lanes.  The old lanes
+    /// are drained by the logger thread and freed when their threads release
+    /// them.
+    void  retire_lanes();
+
     void run();
     bool flush_internal();
 
@@ -651,7 +863,7 @@ public:
     }
 
     logger()  {}
-    ~logger() { finalize(); }
+    ~logger();
 
     /// @return vector of active back-end logging implementations
     const implementations_vector&  implementations() const;
@@ -728,6 +940,15 @@ public:
     /// Set a callback to be called on start of the logger's async thread
     void set_on_after_run (std::function<void()> a_cb) { m_on_after_run  = a_cb; }
 
+    /// Max number of queued messages formatted and written as one batch
+    /// (0 - format and deliver every message individually).
+    size_t batch_size() const       { return m_batch_size; }
+    void   batch_size(size_t a_sz)  { m_batch_size = a_sz; }
+
+    /// Capacity of the per-thread message lane (0 - lanes are disabled and
+    /// all threads enqueue messages to a single shared queue).
+    uint32_t lane_capacity() const  { return m_lane_capacity; }
+
     // FIXME: macros are temporary experimental feature that will be
     // replaces in a future release
 
@@ -982,6 +1203,20 @@ public:
                             a_si.fun(), a_si.fun_len(), a_fmt, std::forward<Args>(a_args)...);
     }
 
+    /// Log a message of given log level with deferred formatting.
+    /// The caller only copies the raw arguments to the queued message, and
+    /// the text is rendered in the logger's thread using \a a_fmt. When the
+    /// encoded arguments exceed UTXX_LOGGER_BIN_CAPACITY bytes, the message
+    /// is formatted in the caller's context.
+    /// Use the provided <UTXX_BLOG>/<UTXX_BCLOG> macros instead of calling it
+    /// directly.
+    /// @param a_level is the log level to record
+    /// @param a_cat   is a category of the message (use NULL if undefined).
+    /// @param a_fmt   is the static descriptor of the call site
+    /// @param a_args  is the list of arguments referenced by the format string
+    template<typename... Args>
+    bool logbin(log_level a_level, const std::string& a_cat,
+                const bin_format& a_fmt, const Args&... a_args);
 };
 
 // Logger back-end implementations must derive from this class.
@@ -1006,6 +1241,14 @@ struct logger_impl {
     ///         in the remove_msg_logger call to release the event sink.
     void add(log_level level, logger::on_msg_delegate_t subscriber);
 
+    /// To be called by <logger_impl> child to register a delegate to be
+    /// invoked with a batch of formatted messages matching \a a_levels.
+    /// Back-ends capable of gather output should prefer this to add().
+    /// Back-ends writing BIN messages in binary form pass \a a_text = false
+    /// (see logger::add_batch()).
+    void add_batch(uint32_t a_levels, logger::on_batch_delegate_t subscriber,
+                   bool a_text = true);
+
     friend bool operator==(const logger_impl& a, const logger_impl& b) {
         return a.name() == b.name();
     };
@@ -1015,6 +1258,7 @@ struct logger_impl {
 protected:
     logger* m_log_mgr;
     int     m_msg_sink_id[logger::NLEVELS]; // Message sink identifiers in the loggers' signal
+    int     m_batch_sink_id;                // Batch sink identifier in the logger
 
     //void do_log(const log_msg_info<>& a_info);
 };
@@ -39,6 +39,38 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 namespace utxx {
 
+inline logger::lane* logger::thread_lane()
+{
+    static thread_local lane_ref s_lane;
+    return likely(s_lane.reg == m_lanes &&
+                  s_lane.gen == m_lanes->gen.load(std::memory_order_relaxed))
+         ? s_lane.ptr : register_lane(s_lane);
+}
+
+template <typename... Args>
+inline bool logger::enqueue(Args&&... a_args)
+{
+    if (m_lane_capacity) {
+        auto* l = thread_lane();
+        // The logger thread only needs to be woken up when it's asleep,
+        // which avoids touching the shared futex on every message.  The
+        // fence pairs with the one in run() so that either the logger thread
+        // sees the message before sleeping or this thread sees it sleeping.
+        if (likely(l->queue.push(std::forward<Args>(a_args)...))) {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (m_sleeping.load(std::memory_order_relaxed))
+                m_event.signal_fast();
+            return true;
+        }
+        // The lane is full - fall back to the shared queue.  Since the
+        // message wasn't constructed, the arguments weren't moved from.
+    }
+
+    bool res = m_queue.emplace(std::forward<Args>(a_args)...);
+    m_event.signal_fast();
+    return res;
+}
+
 template <typename Fun>
 inline bool logger::dolog(
     log_level           a_level,
@@ -52,11 +84,9 @@ inline bool logger::dolog(
     if (!is_enabled(a_level))
         return false;
 
-    bool res = m_queue.emplace(a_level, a_cat, a_fun,
-                               a_src_loc, a_src_loc_len,
-                               a_src_fun, a_src_fun_len);
-    m_event.signal_fast();
-    return res;
+    return enqueue(a_level, a_cat, a_fun,
+                   a_src_loc, a_src_loc_len,
+                   a_src_fun, a_src_fun_len);
 }
 
 inline bool logger::dolog(
@@ -74,11 +104,9 @@ inline bool logger::dolog(
 
     std::string sbuf(a_buf, a_size);
 
-    bool res = m_queue.emplace(a_level, a_cat, sbuf,
-                               a_src_loc, a_src_loc_len,
-                               a_src_fun, a_src_fun_len);
-    m_event.signal_fast();
-    return res;
+    return enqueue(a_level, a_cat, sbuf,
+                   a_src_loc, a_src_loc_len,
+                   a_src_fun, a_src_fun_len);
 }
 
 template <int N, int M>
@@ -124,10 +152,8 @@ inline bool logger::logfmt(
     // when there are no arguments provides, since a_fmt is not a string literal
     n = do_copy(buf, sizeof(buf), a_fmt, std::forward<Args>(a_args)...);
     auto sbuf = std::string(buf, std::min<int>(n, sizeof(buf)-1));
-    bool res  = m_queue.emplace(a_level, a_cat, std::move(sbuf), a_src_loc, a_src_loc_len,
-                                                                 a_src_fun, a_src_fun_len);
-    m_event.signal_fast();
-    return res;
+    return enqueue(a_level, a_cat, std::move(sbuf), a_src_loc, a_src_loc_len,
+                                                    a_src_fun, a_src_fun_len);
 }
 
 template <typename... Args>
@@ -142,11 +168,9 @@ inline bool logger::logs(
 
     basic_buffered_print<1024> buf;
     buf.print(std::forward<Args>(a_args)...);
-    bool res = m_queue.emplace(a_level, a_cat, buf.to_string(),
-                               a_si.srcloc(), a_si.srcloc_len(),
-                               a_si.fun(),    a_si.fun_len());
-    m_event.signal_fast();
-    return res;
+    return enqueue(a_level, a_cat, buf.to_string(),
+                   a_si.srcloc(), a_si.srcloc_len(),
+                   a_si.fun(),    a_si.fun_len());
 }
 
 template <int N, int M, typename... Args>
@@ -162,10 +186,8 @@ inline bool logger::logs(
 
     basic_buffered_print<1024> buf;
     buf.print(std::forward<Args>(a_args)...);
-    bool res = m_queue.emplace(a_level, a_cat, buf.to_string(),
-                               a_src_loc, N-1, a_src_fun, M-1);
-    m_event.signal_fast();
-    return res;
+    return enqueue(a_level, a_cat, buf.to_string(),
+                   a_src_loc, N-1, a_src_fun, M-1);
 }
 
 template <int N, int M>
@@ -179,9 +201,7 @@ inline bool logger::log(
     if (!is_enabled(a_level))
         return false;
 
-    bool res = m_queue.emplace(a_level, a_cat, a_msg, a_src_loc, N-1, a_src_fun, M-1);
-    m_event.signal_fast();
-    return res;
+    return enqueue(a_level, a_cat, a_msg, a_src_loc, N-1, a_src_fun, M-1);
 }
 
 inline bool logger::log(
@@ -193,10 +213,8 @@ inline bool logger::log(
     if (!is_enabled(a_level))
         return false;
 
-    bool res = m_queue.emplace(a_level, a_cat, a_msg, a_si.srcloc(), a_si.srcloc_len(),
-                               a_si.fun(), a_si.fun_len());
-    m_event.signal_fast();
-    return res;
+    return enqueue(a_level, a_cat, a_msg, a_si.srcloc(), a_si.srcloc_len(),
+                   a_si.fun(), a_si.fun_len());
 }
 
 #if __cplusplus >= 201703L
@@ -209,10 +227,8 @@ inline bool logger::log(
     if (!is_enabled(a_level))
         return false;
 
-    bool res = m_queue.emplace(a_level, a_cat, a_msg, a_si.srcloc(), a_si.srcloc_len(),
-                               a_si.fun(), a_si.fun_len());
-    m_event.signal_fast();
-    return res;
+    return enqueue(a_level, a_cat, a_msg, a_si.srcloc(), a_si.srcloc_len(),
+                   a_si.fun(), a_si.fun_len());
 }
 #endif
 
@@ -234,9 +250,31 @@ inline bool logger::async_logs(
         buf.sprint(sfx, ssz);
         return buf.to_string();
     };
-    bool res = m_queue.emplace(a_level, a_cat, fun, a_src_loc, N-1, a_src_fun, M-1);
-    m_event.signal_fast();
-    return res;
+    return enqueue(a_level, a_cat, fun, a_src_loc, N-1, a_src_fun, M-1);
+}
+
+template <typename... Args>
+inline bool logger::logbin(
+    log_level           a_level,
+    const std::string&  a_cat,
+    const bin_format&   a_fmt,
+    const Args&...      a_args)
+{
+    if (!is_enabled(a_level))
+        return false;
+
+    auto sz = bin_encoded_size(a_args...);
+
+    if (likely(sz <= UTXX_LOGGER_BIN_CAPACITY))
+        return enqueue(a_level, a_cat, a_fmt, uint32_t(sz), a_args...);
+
+    // The arguments don't fit in the message, so render the text here
+    std::string data(sz, '\0');
+    bin_encode(&data[0], a_args...);
+    std::string str(a_fmt.max_render_size(sz), '\0');
+    str.resize(a_fmt.render(data.c_str(), sz, &str[0], str.size()));
+    return enqueue(a_level, a_cat, std::move(str),
+                   a_fmt.src_loc, a_fmt.src_loc_len, a_fmt.src_fun, a_fmt.src_fun_len);
 }
 
 // TODO: make synchronous string formatting
@@ -257,10 +295,8 @@ inline bool logger::async_logfmt(
     auto fun = [=](char* a_buf, size_t a_size) {
         return snprintf(a_buf, a_size, a_fmt, std::forward<Args>(a_args)...);
     };
-    bool res = m_queue.emplace(a_level, a_cat, fun, a_src_loc, a_src_loc_len,
-                                                    a_src_fun, a_src_fun_len);
-    m_event.signal_fast();
-    return res;
+    return enqueue(a_level, a_cat, fun, a_src_loc, a_src_loc_len,
+                                        a_src_fun, a_src_fun_len);
 }
 
 } // namespace utxx
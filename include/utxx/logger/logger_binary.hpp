@@ -0,0 +1,289 @@
+//------------------------------------------------------------------------------
+/// \file   logger_binary.hpp
+/// \author Serge Aleynikov
+//------------------------------------------------------------------------------
+/// \brief Binary (deferred) argument capture for the logging framework.
+///
+/// A binary log call stores a pointer to a static call-site descriptor
+/// (bin_format) and a raw copy of the trivially-copyable arguments in the
+/// message. The text is rendered on the logger's thread (or offline from
+/// a binary log file) using the printf-like format string of the call site.
+//------------------------------------------------------------------------------
+// Copyright (C) 2026 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-16
+//------------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the utxx open-source project.
+
+Copyright (C) 2026 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+#pragma once
+
+#include <utxx/time_val.hpp>
+#include <algorithm>
+#include <string>
+#include <cstring>
+#include <cstdint>
+#include <iosfwd>
+#include <type_traits>
+#if __cplusplus >= 201703L
+#include <string_view>
+#endif
+
+#ifndef UTXX_LOGGER_BIN_CAPACITY
+/// Max size of binary-encoded arguments stored in a log message. Calls with
+/// larger arguments are formatted on the caller's thread.
+#define UTXX_LOGGER_BIN_CAPACITY 52
+#endif
+
+namespace utxx {
+
+/// Type tag of a binary-encoded log argument
+enum class bin_arg_type : uint8_t {
+      END
+    , BOOL      // 1 byte
+    , CHAR      // 1 byte
+    , INT32     // 4 bytes
+    , UINT32    // 4 bytes
+    , INT64     // 8 bytes
+    , UINT64    // 8 bytes
+    , DOUBLE    // 8 bytes
+    , PTR       // 8 bytes
+    , STR       // uint16_t length followed by the string bytes
+};
+
+/// Encoding traits of the argument types supported by binary logging
+template <typename T, typename Enable = void>
+struct bin_arg_traits;
+
+namespace detail {
+    template <typename V, bin_arg_type Type>
+    struct bin_fixed_arg {
+        static constexpr bin_arg_type type = Type;
+        template <typename T>
+        static size_t size  (const T&)                  { return sizeof(V); }
+        template <typename T>
+        static char*  encode(char* a_buf, const T& a_v) {
+            V v = static_cast<V>(a_v);
+            memcpy(a_buf, &v, sizeof(V));
+            return a_buf + sizeof(V);
+        }
+    };
+
+    struct bin_str_arg {
+        static constexpr bin_arg_type type = bin_arg_type::STR;
+        enum { MAX_LEN = 0xFFFF };
+
+        static size_t size(const char* a_str, size_t a_len) {
+            return sizeof(uint16_t) + std::min<size_t>(a_len, MAX_LEN);
+        }
+        static char* encode(char* a_buf, const char* a_str, size_t a_len) {
+            uint16_t n = uint16_t(std::min<size_t>(a_len, MAX_LEN));
+            memcpy(a_buf, &n, sizeof(n));
+            memcpy(a_buf + sizeof(n), a_str, n);
+            return a_buf + sizeof(n) + n;
+        }
+    };
+}
+
+template <>
+struct bin_arg_traits<bool>
+    : detail::bin_fixed_arg<uint8_t, bin_arg_type::BOOL> {};
+
+template <>
+struct bin_arg_traits<char>
+    : detail::bin_fixed_arg<char, bin_arg_type::CHAR> {};
+
+template <typename T>
+struct bin_arg_traits<T, typename std::enable_if<
+    (std::is_integral<T>::value || std::is_enum<T>::value) &&
+    !std::is_same<T, bool>::value && !std::is_same<T, char>::value>::type>
+    : detail::bin_fixed_arg<
+        typename std::conditional<sizeof(T) <= 4,
+            typename std::conditional<std::is_signed<T>::value, int32_t,  uint32_t>::type,
+            typename std::conditional<std::is_signed<T>::value, int64_t,  uint64_t>::type
+        >::type,
+        sizeof(T) <= 4
+            ? (std::is_signed<T>::value ? bin_arg_type::INT32 : bin_arg_type::UINT32)
+            : (std::is_signed<T>::value ? bin_arg_type::INT64 : bin_arg_type::UINT64)>
+{};
+
+template <typename T>
+struct bin_arg_traits<T, typename std::enable_if<std::is_floating_point<T>::value>::type>
+    : detail::bin_fixed_arg<double, bin_arg_type::DOUBLE> {};
+
+template <typename T>
+struct bin_arg_traits<T*, typename std::enable_if<
+    !std::is_same<typename std::remove_cv<T>::type, char>::value>::type>
+    : detail::bin_fixed_arg<uint64_t, bin_arg_type::PTR>
+{
+    static char* encode(char* a_buf, const T* a_v) {
+        uint64_t v = reinterpret_cast<uintptr_t>(a_v);
+        memcpy(a_buf, &v, sizeof(v));
+        return a_buf + sizeof(v);
+    }
+};
+
+template <typename T>
+struct bin_arg_traits<T*, typename std::enable_if<
+    std::is_same<typename std::remove_cv<T>::type, char>::value>::type>
+    : detail::bin_str_arg
+{
+    static size_t size(const char* a_str) {
+        return a_str ? bin_str_arg::size(a_str, strlen(a_str)) : size("(null)");
+    }
+    static char*  encode(char* a_buf, const char* a_str) {
+        return a_str ? bin_str_arg::encode(a_buf, a_str, strlen(a_str))
+                     : encode(a_buf, "(null)");
+    }
+};
+
+template <>
+struct bin_arg_traits<std::string> : detail::bin_str_arg {
+    static size_t size  (const std::string& a)             { return bin_str_arg::size(a.data(), a.size()); }
+    static char*  encode(char* a_buf, const std::string& a) { return bin_str_arg::encode(a_buf, a.data(), a.size()); }
+};
+
+#if __cplusplus >= 201703L
+template <>
+struct bin_arg_traits<std::string_view> : detail::bin_str_arg {
+    static size_t size  (const std::string_view& a)             { return bin_str_arg::size(a.data(), a.size()); }
+    static char*  encode(char* a_buf, const std::string_view& a) { return bin_str_arg::encode(a_buf, a.data(), a.size()); }
+};
+#endif
+
+/// List of argument types of a binary log call site
+template <typename... Args>
+struct bin_arg_list {
+    static const size_t count = sizeof...(Args);
+
+    /// Array of argument type tags terminated by bin_arg_type::END
+    static const bin_arg_type* types() {
+        static const bin_arg_type s_types[] = {bin_arg_traits<Args>::type..., bin_arg_type::END};
+        return s_types;
+    }
+};
+
+/// Used in unevaluated context (decltype) to deduce the bin_arg_list of
+/// arguments passed to a binary log call
+template <typename... Args>
+bin_arg_list<typename std::decay<Args>::type...> bin_arg_list_of(const Args&...);
+
+//------------------------------------------------------------------------------
+/// Static descriptor of a binary log call site.
+/// Its address serves as the format id in memory, and the binary file writer
+/// assigns it a numeric id when the format is first written to the file.
+//------------------------------------------------------------------------------
+struct bin_format {
+    const char*             fmt;
+    size_t                  fmt_len;
+    const bin_arg_type*     args;
+    size_t                  nargs;
+    const char*             src_loc;
+    size_t                  src_loc_len;
+    const char*             src_fun;
+    size_t                  src_fun_len;
+
+    template <typename... Args, int N, int M, int K>
+    bin_format(bin_arg_list<Args...>, const char (&a_fmt)[K],
+               const char (&a_src_loc)[N], const char (&a_src_fun)[M])
+        : fmt(a_fmt), fmt_len(K-1)
+        , args(bin_arg_list<Args...>::types()), nargs(sizeof...(Args))
+        , src_loc(a_src_loc), src_loc_len(N-1)
+        , src_fun(a_src_fun), src_fun_len(M-1)
+    {}
+
+    /// Upper bound of the size of text rendered from \a a_len bytes of encoded
+    /// arguments (the longest formatted numeric argument is well below 64
+    /// bytes)
+    size_t max_render_size(size_t a_len) const { return fmt_len + a_len + 64 * nargs; }
+
+    /// Render the encoded arguments \a a_data according to the format string.
+    /// @return number of bytes written to \a a_buf (the output is truncated
+    ///         to \a a_size bytes, and is not NULL-terminated)
+    size_t render(const char* a_data, size_t a_len, char* a_buf, size_t a_size) const {
+        return bin_render(fmt, fmt_len, args, nargs, a_data, a_len, a_buf, a_size);
+    }
+
+    /// Render the encoded arguments \a a_data according to the printf-like
+    /// format string \a a_fmt and argument types \a a_args.
+    /// Integers, strings and fixed-point doubles without width and flags are
+    /// written using itoa/ftoa, others are formatted by snprintf(3). The
+    /// variable width and precision ('*') specifiers are not supported.
+    static size_t bin_render(const char* a_fmt, size_t a_fmt_len,
+                             const bin_arg_type* a_args, size_t a_nargs,
+                             const char* a_data, size_t a_len,
+                             char* a_buf, size_t a_size);
+};
+
+/// @return size of binary-encoded arguments
+inline size_t bin_encoded_size() { return 0; }
+
+template <typename T, typename... Args>
+inline size_t bin_encoded_size(const T& a, const Args&... a_args) {
+    return bin_arg_traits<typename std::decay<T>::type>::size(a)
+         + bin_encoded_size(a_args...);
+}
+
+/// Encode arguments to \a a_buf, which must have at least bin_encoded_size()
+/// bytes available.
+/// @return pointer past the last written byte
+inline char* bin_encode(char* a_buf) { return a_buf; }
+
+template <typename T, typename... Args>
+inline char* bin_encode(char* a_buf, const T& a, const Args&... a_args) {
+    return bin_encode(bin_arg_traits<typename std::decay<T>::type>::encode(a_buf, a),
+                      a_args...);
+}
+
+//------------------------------------------------------------------------------
+/// Layout of a binary log file written by the "binfile" logger back-end.
+/// The file starts with MAGIC and VERSION (uint32_t), followed by records
+/// beginning with the rec_type byte:
+///   FORMAT:   uint32_t id, uint8_t nargs, nargs type tags,
+///             uint16_t len + format string, uint16_t len + src location,
+///             uint16_t len + src function name
+///   BIN_MSG:  int64_t time (ns), uint32_t level, uint32_t format id,
+///             uint16_t len + category, uint16_t len + encoded arguments
+///   TEXT_MSG: int64_t time (ns), uint32_t level,
+///             uint16_t len + category, uint32_t len + formatted message
+//------------------------------------------------------------------------------
+namespace bin_log {
+    static const char     MAGIC[8] = {'U','T','X','X','B','L','O','G'};
+    static const uint32_t VERSION  = 1;
+
+    enum rec_type : uint8_t {
+          FORMAT    = 1
+        , BIN_MSG   = 2
+        , TEXT_MSG  = 3
+    };
+
+    /// Decode binary log file \a a_filename writing the text lines formatted
+    /// as "Timestamp|Level|Category|Message [File:Line Function]" to \a a_out.
+    /// The category and location are only written if they are non-empty and
+    /// \a a_show_location is true respectively. TEXT_MSG records are written
+    /// as they were formatted by the logger.
+    /// @return number of decoded messages
+    size_t decode(const std::string& a_filename, std::ostream& a_out,
+                  stamp_type a_ts = DATE_TIME_WITH_USEC, bool a_show_location = false);
+}
+
+} // namespace utxx
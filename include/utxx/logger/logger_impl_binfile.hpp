@@ -0,0 +1,98 @@
+//----------------------------------------------------------------------------
+/// \file   logger_impl_binfile.hpp
+/// \author Serge Aleynikov
+//----------------------------------------------------------------------------
+/// \brief Back-end plugin writing log messages in binary form for the
+///        <logger> class.
+///
+/// Messages logged with UTXX_BLOG()/UTXX_BCLOG() are written with their raw
+/// arguments, and other messages are written as formatted text. The file
+/// can be decoded offline with bin_log::decode() or the "logdecode" tool.
+//----------------------------------------------------------------------------
+// Copyright (C) 2026 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-16
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the utxx open-source project.
+
+Copyright (C) 2026 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+#ifndef _UTXX_LOGGER_BINFILE_HPP_
+#define _UTXX_LOGGER_BINFILE_HPP_
+
+#include <utxx/logger.hpp>
+#include <utxx/buffer.hpp>
+#include <unordered_map>
+
+namespace utxx {
+
+class logger_impl_binfile: public logger_impl {
+    std::string       m_name;
+    std::string       m_filename;
+    bool              m_append;
+    uint32_t          m_levels;
+    mode_t            m_mode;
+    int               m_fd;
+    dynamic_io_buffer m_buf;
+    /// Ids of formats already written to the file
+    std::unordered_map<const bin_format*, uint32_t> m_formats;
+
+    logger_impl_binfile(const char* a_name)
+        : m_name(a_name), m_append(true)
+        , m_levels(LEVEL_NO_DEBUG)
+        , m_mode(0644), m_fd(-1), m_buf(64*1024)
+    {}
+
+    void finalize() {
+        if (m_fd > -1) { close(m_fd); m_fd = -1; }
+        m_formats.clear();
+    }
+
+    template <typename T>
+    void put(const T& a_val)                     { put(&a_val, sizeof(T)); }
+    void put(const void* a_data, size_t a_size);
+    void put_str16(const char* a_str, size_t a_size);
+
+    /// @return id of the format, writing its definition to the file if needed
+    uint32_t format_id(const bin_format& a_fmt);
+
+public:
+    static logger_impl_binfile* create(const char* a_name) {
+        return new logger_impl_binfile(a_name);
+    }
+
+    virtual ~logger_impl_binfile() {
+        finalize();
+    }
+
+    const std::string& name() const { return m_name; }
+
+    /// Dump all settings to stream
+    std::ostream& dump(std::ostream& out, const std::string& a_prefix) const;
+
+    bool init(const variant_tree& a_config);
+
+    void log_batch(const logger::msg_batch& a_batch);
+};
+
+} // namespace utxx
+
+#endif
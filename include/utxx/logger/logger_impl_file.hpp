@@ -97,6 +97,8 @@ class logger_impl_file: public logger_impl {
 
     void        create_symbolic_link();
     bool        open_file(bool rotated);
+    size_t      file_size() const;
+    void        write_iov(const iovec* a_iov, size_t a_cnt);
 public:
     static logger_impl_file* create(const char* a_name) {
         return new logger_impl_file(a_name);
@@ -118,6 +120,9 @@ public:
 
     void log_msg(const logger::msg& a_msg, const char* a_buf, size_t a_size);
 
+    /// Write a batch of formatted messages with as few writev(2) calls as
+    /// possible, honoring the file splitting setting.
+    void log_batch(const logger::msg_batch& a_batch);
 
 };
 
@@ -6,6 +6,9 @@
 /// The logger logs data to multiple streams asynchronously
 /// It is optimized for performance of the producer to ensure minimal latency.
 /// The producer of log messages never blocks during submission of a message.
+/// Streams can be sharded across several writer threads, so that a slow
+/// stream (e.g. on NFS or a pipe) doesn't delay writing of the streams
+/// assigned to other writer threads.
 //----------------------------------------------------------------------------
 // Copyright (c) 2012 Omnibius, LLC
 // Author: Serge Aleynikov <saleyn@gmail.com>
@@ -44,6 +47,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include <utxx/compiler_hints.hpp>
 #include <utxx/time_val.hpp>
 #include <utxx/logger.hpp>
+#include <utxx/gzstream.hpp>
 #include <iostream>
 #include <memory>
 #include <atomic>
@@ -60,10 +64,6 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include <fcntl.h>
 #include <sched.h>
 
-#ifdef PERF_STATS
-#include <utxx/perf_histogram.hpp>
-#endif
-
 namespace utxx {
 #if DEBUG_ASYNC_LOGGER == 2
 #   include <utxx/timestamp.hpp>
@@ -125,6 +125,9 @@ struct basic_multi_file_async_logger {
     /// Callback executed when stream needs to be reconnected
     using stream_reconnecter = std::function<int(stream_info& a_si)>;
 
+    /// Callback executed before the stream's file descriptor is closed
+    using stream_closer      = std::function<void(stream_info& a_si)>;
+
     using event_type    = typename traits::event_type;
     using stream_opener = std::function<int (const std::string& name,
                                              stream_state_base* state,
@@ -132,6 +135,15 @@ struct basic_multi_file_async_logger {
     using close_event_type     = synch::posix_event;
     using close_event_type_ptr = std::shared_ptr<close_event_type>;
 
+    /// Statistics of a stream
+    struct stream_stats {
+        long    queue_depth;        ///< Messages enqueued but not yet written
+        long    max_queue_depth;    ///< Max queue depth seen by the writer
+        size_t  msgs_written;       ///< Total messages written
+        size_t  bytes_written;      ///< Total bytes written
+        double  bytes_per_sec;      ///< Write rate over the last second
+    };
+
 private:
     struct stream_info_eq {
         bool operator()(const stream_info* a, const stream_info* b) const { return a == b; }
@@ -149,27 +161,33 @@ private:
 
     using stream_info_vec = std::vector<stream_info*>;
 
+    /// Writer thread draining the command queue of the streams assigned to it
+    struct writer_t {
+        std::atomic<command_t*>     head;
+        event_type                  event;
+        std::thread                 thread;
+        pending_data_streams_set    pending_data_streams;
+        int                         max_queue_size;
+
+        writer_t() : head(nullptr), event(0), max_queue_size(0) {}
+    };
+
+    using writer_vec = std::vector<std::unique_ptr<writer_t>>;
+
     std::mutex                                      m_mutex;
     std::condition_variable                         m_cond_var;
-    std::shared_ptr<std::thread>                    m_thread;
+    writer_vec                                      m_writers;
+    size_t                                          m_started;
     cmd_allocator                                   m_cmd_allocator;
     msg_allocator                                   m_msg_allocator;
-    std::atomic<command_t*>                         m_head;
     std::atomic<bool>                               m_cancel;
-    int                                             m_max_queue_size;
     std::atomic<long>                               m_total_msgs_processed;
-    event_type                                      m_event;
     std::atomic<long>                               m_active_count;
     stream_info_vec                                 m_files;
-    pending_data_streams_set                        m_pending_data_streams;
     int                                             m_last_version;
     double                                          m_reconnect_sec;
     err_handler                                     m_err_handler;
     bool                                            m_use_sched_yield;
-#ifdef PERF_STATS
-    std::atomic<size_t>                             m_stats_enque_spins;
-    std::atomic<size_t>                             m_stats_deque_spins;
-#endif
 
     // Default output writer
     static int writev(stream_info& a_si, const char** a_categories,
@@ -184,19 +202,24 @@ private:
 
     bool internal_update_stream(stream_info* a_si, int a_fd);
 
-    // Invoked by the async thread to flush messages from queue to file
-    int  commit(const struct timespec* tsp = NULL);
-    // Invoked by the async thread
-    void run(bool a_block_signals);
+    // Invoked by the writer thread to flush messages from queue to file
+    int  commit(writer_t& a_writer, const struct timespec* tsp = NULL);
+    // Invoked by the writer thread
+    void run(writer_t& a_writer, bool a_block_signals);
     // Enqueues msg to internal queue
     int  internal_enqueue(command_t* a_cmd, const stream_info* a_si);
     // Writes data to internal queue
     int  internal_write(const file_id& a_id, const char* a_cat, size_t a_cat_sz,
                         char* a_data, size_t a_sz, bool copied);
 
-    void internal_close();
+    // Close the streams assigned to the writer
+    void internal_close(const writer_t& a_writer);
     void internal_close(stream_info* p, int a_errno = 0);
 
+    writer_t& writer_of(const stream_info* a_si) {
+        return *m_writers[a_si->m_writer];
+    }
+
     command_t* allocate_message(const stream_info* a_si,
                                 const char* a_cat,  size_t a_cat_sz,
                                 const char* a_data, size_t a_size)
@@ -235,10 +258,15 @@ public:
     /// @param a_max_files is the max number of file descriptors
     /// @param a_reconnect_msec is the stream reconnection delay
     /// @param alloc is the message allocator to use
+    /// @param a_writers is the number of writer threads. Streams are assigned
+    ///             to writer threads round-robin in the order of opening, and
+    ///             a stream that blocks on write only delays the streams of
+    ///             its own writer thread
     explicit basic_multi_file_async_logger(
         size_t a_max_files = 1024,
         int    a_reconnect_msec = 5000,
-        const msg_allocator& alloc = msg_allocator());
+        const msg_allocator& alloc = msg_allocator(),
+        size_t a_writers = 1);
 
     ~basic_multi_file_async_logger() {
         stop();
@@ -248,11 +276,19 @@ public:
     /// @param a_block_signals if true all signals will be blocked in thread.
     int  start(bool a_block_signals = true);
 
-    /// Stop asynchronous file writing thread
+    /// Stop asynchronous file writing threads
     void stop();
 
-    /// Returns true if the async logger's thread is running
-    bool running() { return m_thread.get(); }
+    /// Returns true if any of the async logger's threads is running
+    bool running() const {
+        for (auto& w : m_writers)
+            if (w->thread.joinable())
+                return true;
+        return false;
+    }
+
+    /// Number of writer threads
+    size_t writers() const { return m_writers.size(); }
 
     /// Start a new log file
     /// @param a_filename is the name of the output file
@@ -273,6 +309,32 @@ public:
         int                a_mode = S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP
     );
 
+#ifdef UTXX_HAVE_LIBZ
+    /// Start a new log file compressed in gzip format by the logger's thread
+    ///
+    /// Every batch of messages is compressed and flushed, so that the file
+    /// can be decompressed up to the last batch written even if the process
+    /// crashes (see gzframe_writer).  The bytes written in the stream's
+    /// statistics are uncompressed bytes.
+    /// @param a_filename   is the name of the output file
+    /// @param a_append     if true the file is open in append mode, and
+    ///                     a gzip member left truncated by a crash is
+    ///                     terminated first (see gzframe_writer::recover).
+    ///                     A file not in gzip format is not appended to
+    ///                     (errno is set to EILSEQ)
+    /// @param a_level      compression level
+    /// @param a_frame_size max size of uncompressed data in a gzip member
+    /// @param a_mode       file permission mode (default 660)
+    file_id open_gz_file
+    (
+        const std::string& a_filename,
+        bool               a_append     = true,
+        int                a_level      = Z_BEST_SPEED,
+        size_t             a_frame_size = 4*1024*1024,
+        int                a_mode = S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP
+    );
+#endif
+
     /// Start a new logging stream
     ///
     /// The logger won't write any data to file but will call \a a_writer
@@ -331,6 +393,10 @@ public:
     /// Set a callback for reconnecting to stream
     void set_reconnect(file_id& a_id, stream_reconnecter a_reconnector);
 
+    /// Set a callback executed before the stream's file descriptor is closed.
+    /// It can be used by the writer to write out its buffered state.
+    void set_closer(file_id& a_id, stream_closer a_closer);
+
     /// Enable usage of sched_yield() instead of usleep() in the logging thread.
     /// Occasionally when running processing thread on max priority the use of
     /// sched_yield() can cause system resource starvation.
@@ -416,25 +482,24 @@ public:
     int write(const file_id& a_id, const std::string& a_category, const std::string& a_msg);
     int write(const file_id& a_id, const char*        a_category, const std::string& a_msg);
 
-    /// @return max size of the commit queue
-    const int   max_queue_size()        const { return m_max_queue_size; }
+    /// @return max size of the commit queue of all writer threads
+    const int   max_queue_size()        const;
     const long  total_msgs_processed()  const { return m_total_msgs_processed
                                                 .load(std::memory_order_relaxed); }
     const int   open_files_count()      const { return m_active_count
                                                 .load(std::memory_order_relaxed); }
     /// Signaling event that can be used to wake up the logging I/O thread
-    const event_type& event()           const { return m_event; }
+    const event_type& event(size_t a_writer = 0) const {
+        return m_writers[a_writer]->event;
+    }
 
     /// True when the logger has unprocessed data in its queue
-    bool  has_pending_data()            const { return m_head
-                                                .load(std::memory_order_relaxed); }
-#ifdef PERF_STATS
-    size_t stats_enque_spins()           const { return m_stats_enque_spins
-                                                .load(std::memory_order_relaxed); }
-    size_t stats_deque_spins()           const { return m_stats_deque_spins
-                                                .load(std::memory_order_relaxed); }
-#endif
+    bool  has_pending_data()            const;
 
+    /// @return statistics of the given stream (all zeros if it's not open)
+    stream_stats stats(const file_id& a_id) const {
+        return a_id.stream() ? a_id.stream()->stats() : stream_stats();
+    }
 };
 
 /// Default implementation of multi_file_async_logger
@@ -543,10 +608,21 @@ stream_info {
 
     // Time of last reconnect attempt
     time_val                                m_last_reconnect_attempt;
+    // Index of the writer thread that owns this stream
+    size_t                                  m_writer;
+    // Statistics updated by producers (queue depth) and the writer thread
+    mutable std::atomic<long>               m_queue_depth;
+    std::atomic<long>                       m_max_queue_depth;
+    std::atomic<size_t>                     m_msgs_written;
+    std::atomic<size_t>                     m_bytes_written;
+    std::atomic<size_t>                     m_rate_bytes;   // At m_rate_time
+    std::atomic<long>                       m_rate_time;    // Nanoseconds
+    std::atomic<double>                     m_bytes_per_sec;
     close_event_type_ptr                    on_close;      // Event to signal on close
     msg_formatter                           on_format;     // "before-write" formatter
     msg_writer                              on_write;      // Message writer functor
     stream_reconnecter                      on_reconnect;  // Stream reconnecter
+    stream_closer                           on_fd_close;   // Called before close(fd)
 
     template <typename T> friend struct basic_multi_file_async_logger;
 
@@ -596,12 +672,28 @@ public:
 
     const time_val& last_reconnect_attempt() const      { return m_last_reconnect_attempt; }
 
+    /// Index of the writer thread writing this stream
+    size_t          writer()                 const      { return m_writer; }
+
+    /// Statistics of this stream. It is safe to call from any thread.
+    stream_stats    stats()                  const;
+
     /// Erase single \a item command from the internal queue
     void erase(command_t* item);
 
     /// Erase commands from \a first till \a end from the internal
     /// queue of pending commands
     void erase(command_t* first, const command_t* end);
+
+private:
+    static long now_nsec() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    void reset_stats();
+    // Account for a_msgs messages of a_bytes written by the writer thread
+    void written(size_t a_msgs, size_t a_bytes);
 };
 
 //-----------------------------------------------------------------------------
@@ -613,11 +705,14 @@ basic_multi_file_async_logger<traits>::
 stream_info::stream_info(stream_state_base* a_state)
     : m_logger(NULL)
     , m_pending_writes_head(NULL), m_pending_writes_tail(NULL)
+    , m_writer(0)
     , on_format(&stream_info::def_on_format)
     , on_write(&basic_multi_file_async_logger<traits>::writev)
     , fd(-1), error(0), version(0), max_batch_sz(IOV_MAX)
     , state(a_state)
-{}
+{
+    reset_stats();
+}
 
 template<typename traits>
 basic_multi_file_async_logger<traits>::
@@ -628,12 +723,67 @@ stream_info::stream_info(
     stream_state_base* a_state
 )   : m_logger(a_logger)
     , m_pending_writes_head(NULL), m_pending_writes_tail(NULL)
+    , m_writer(size_t(a_version) % a_logger->m_writers.size())
     , on_format(&stream_info::def_on_format)
     , on_write(a_writer)
     , name(a_name), fd(a_fd), error(0)
     , version(a_version), max_batch_sz(IOV_MAX)
     , state(a_state)
-{}
+{
+    reset_stats();
+}
+
+template<typename traits>
+void basic_multi_file_async_logger<traits>::
+stream_info::reset_stats() {
+    m_queue_depth.store(0);
+    m_max_queue_depth.store(0);
+    m_msgs_written.store(0);
+    m_bytes_written.store(0);
+    m_rate_bytes.store(0);
+    m_rate_time.store(now_nsec());
+    m_bytes_per_sec.store(0.0);
+}
+
+template<typename traits>
+void basic_multi_file_async_logger<traits>::
+stream_info::written(size_t a_msgs, size_t a_bytes) {
+    m_msgs_written.fetch_add(a_msgs, std::memory_order_relaxed);
+    auto bytes = m_bytes_written.fetch_add(a_bytes, std::memory_order_relaxed)
+               + a_bytes;
+
+    // Resample the write rate at most once a second
+    auto now   = now_nsec();
+    auto nsecs = now - m_rate_time.load(std::memory_order_relaxed);
+    if (nsecs < 1000000000l)
+        return;
+    auto n = bytes - m_rate_bytes.load(std::memory_order_relaxed);
+    m_bytes_per_sec.store(double(n) * 1e9 / nsecs, std::memory_order_relaxed);
+    m_rate_bytes.store(bytes, std::memory_order_relaxed);
+    m_rate_time.store(now, std::memory_order_release);
+}
+
+template<typename traits>
+typename basic_multi_file_async_logger<traits>::stream_stats
+basic_multi_file_async_logger<traits>::
+stream_info::stats() const {
+    stream_stats s;
+    auto time           = m_rate_time.load(std::memory_order_acquire);
+    s.queue_depth       = m_queue_depth.load(std::memory_order_relaxed);
+    s.max_queue_depth   = m_max_queue_depth.load(std::memory_order_relaxed);
+    s.msgs_written      = m_msgs_written.load(std::memory_order_relaxed);
+    s.bytes_written     = m_bytes_written.load(std::memory_order_relaxed);
+    s.bytes_per_sec     = m_bytes_per_sec.load(std::memory_order_relaxed);
+
+    // The rate is resampled only on writes, so for a stream that hasn't been
+    // written to in a while compute the rate since the last sample
+    auto nsecs = now_nsec() - time;
+    if (nsecs > 2000000000l) {
+        auto n = s.bytes_written - m_rate_bytes.load(std::memory_order_relaxed);
+        s.bytes_per_sec = double(n) * 1e9 / nsecs;
+    }
+    return s;
+}
 
 template<typename traits>
 void basic_multi_file_async_logger<traits>::
@@ -645,6 +795,8 @@ stream_info::reset(int a_errno) {
         set_error(a_errno, NULL);
 
     if (fd != -1) {
+        if (on_fd_close)
+            on_fd_close(*this);
         (void)::close(fd);
         fd = -1;
     }
@@ -661,15 +813,13 @@ basic_multi_file_async_logger<traits>::
 stream_info::reset(const std::string& a_name, msg_writer a_writer,
                    stream_state_base* a_state, int a_fd)
 {
-#ifdef PERF_STATS
-    m_stats_enque_spins.store(0u);
-    m_stats_deque_spins.store(0u);
-#endif
-    name     = a_name;
-    fd       = a_fd;
-    error    = 0;
-    state    = a_state;
-    on_write = a_writer;
+    reset_stats();
+    name        = a_name;
+    fd          = a_fd;
+    error       = 0;
+    state       = a_state;
+    on_write    = a_writer;
+    on_fd_close = nullptr;
     return this;
 }
 
@@ -748,24 +898,42 @@ stream_info::erase(command_t* first, const command_t* end) {
 template<typename traits>
 basic_multi_file_async_logger<traits>::
 basic_multi_file_async_logger(
-    size_t a_max_files, int a_reconnect_msec, const msg_allocator& alloc)
-    : m_thread(nullptr)
+    size_t a_max_files, int a_reconnect_msec, const msg_allocator& alloc,
+    size_t a_writers)
+    : m_started(0)
     , m_msg_allocator(alloc)
-    , m_head(nullptr)
     , m_cancel(false)
-    , m_max_queue_size(0)
     , m_total_msgs_processed(0)
-    , m_event(0)
     , m_active_count(0)
     , m_files(a_max_files, nullptr)
     , m_last_version(0)
     , m_reconnect_sec((double)a_reconnect_msec / 1000)
     , m_use_sched_yield(true)
-#ifdef PERF_STATS
-    , m_stats_enque_spins(0)
-    , m_stats_deque_spins(0)
-#endif
-{}
+{
+    if (!a_writers)
+        UTXX_THROW_BADARG_ERROR("Number of writer threads must be positive");
+
+    for (size_t i = 0; i < a_writers; ++i)
+        m_writers.emplace_back(new writer_t());
+}
+
+template<typename traits>
+const int basic_multi_file_async_logger<traits>::
+max_queue_size() const {
+    int n = 0;
+    for (auto& w : m_writers)
+        n = std::max(n, w->max_queue_size);
+    return n;
+}
+
+template<typename traits>
+bool basic_multi_file_async_logger<traits>::
+has_pending_data() const {
+    for (auto& w : m_writers)
+        if (w->head.load(std::memory_order_relaxed))
+            return true;
+    return false;
+}
 
 template<typename traits>
 inline int basic_multi_file_async_logger<traits>::
@@ -786,12 +954,17 @@ start(bool a_block_signals) {
     if (running())
         return -1;
 
-    m_event.reset();
-    m_cancel = false;
+    m_cancel               = false;
+    m_started              = 0;
+    m_total_msgs_processed = 0;
 
-    m_thread.reset(new std::thread([=]() { run(a_block_signals); }));
+    for (auto& w : m_writers) {
+        writer_t* p = w.get();
+        p->event.reset();
+        p->thread = std::thread([=]() { run(*p, a_block_signals); });
+    }
 
-    m_cond_var.wait(lock);
+    m_cond_var.wait(lock, [this]() { return m_started == m_writers.size(); });
 
     return 0;
 }
@@ -802,20 +975,22 @@ stop() {
     if (!running())
         return;
 
-    UTXX_ASYNC_TRACE((">>> Stopping async logger (head %p)\n", m_head.load()));
+    UTXX_ASYNC_TRACE((">>> Stopping async logger (head %p)\n",
+                      m_writers[0]->head.load()));
 
-    std::shared_ptr<std::thread> t = m_thread;
-    if (t) {
-        m_cancel.store(true, std::memory_order_release);
-        m_event.signal();
+    m_cancel.store(true, std::memory_order_release);
 
-        t->join();
-    }
+    for (auto& w : m_writers)
+        w->event.signal();
+
+    for (auto& w : m_writers)
+        if (w->thread.joinable())
+            w->thread.join();
 }
 
 template<typename traits>
 void basic_multi_file_async_logger<traits>::
-run(bool a_block_signals) {
+run(writer_t& a_writer, bool a_block_signals) {
 
     if (a_block_signals) {
         sigset_t    set;
@@ -826,6 +1001,7 @@ run(bool a_block_signals) {
     // Notify the caller that we are ready
     {
         std::unique_lock<std::mutex> lock(m_mutex);
+        ++m_started;
         m_cond_var.notify_all();
     }
 
@@ -835,20 +1011,18 @@ run(bool a_block_signals) {
     static const timespec ts =
         {traits::commit_timeout / 1000, (traits::commit_timeout % 1000) * 1000000 };
 
-    m_total_msgs_processed = 0;
-
     while (true) {
         #if defined(DEBUG_ASYNC_LOGGER) && DEBUG_ASYNC_LOGGER != 2
         int rc =
         #endif
-        commit(&ts);
+        commit(a_writer, &ts);
 
         UTXX_ASYNC_TRACE(( "Async thread commit result: %d (head: %p, cancel=%s)\n",
-            rc, m_head.load(), m_cancel ? "true" : "false" ));
+            rc, a_writer.head.load(), m_cancel ? "true" : "false" ));
 
         // CPU-friendly spin for 250us
         time_val deadline(rel_time(0, 250));
-        while (!m_head.load(std::memory_order_relaxed)) {
+        while (!a_writer.head.load(std::memory_order_relaxed)) {
             if (m_cancel.load(std::memory_order_relaxed))
                 goto DONE;
             if (now_utc() > deadline)
@@ -865,20 +1039,19 @@ run(bool a_block_signals) {
 
 DONE:
     UTXX_ASYNC_TRACE(("Logger loop finished - calling close()\n"));
-    internal_close();
-    UTXX_ASYNC_DEBUG_TRACE(("Logger notifying all of exiting (%ld) active_files=%d\n",
-                       m_thread.use_count(), open_files_count()));
-
-    m_thread.reset();
+    internal_close(a_writer);
+    UTXX_ASYNC_DEBUG_TRACE(("Logger notifying all of exiting active_files=%d\n",
+                       open_files_count()));
 }
 
 template<typename traits>
 void basic_multi_file_async_logger<traits>::
-internal_close() {
+internal_close(const writer_t& a_writer) {
     UTXX_ASYNC_TRACE(("Logger is closing\n"));
     std::unique_lock<std::mutex> lock(m_mutex);
     for (auto* si : m_files)
-        internal_close(si, 0);
+        if (si && &writer_of(si) == &a_writer)
+            internal_close(si, 0);
 }
 
 template<typename traits>
@@ -949,6 +1122,13 @@ set_reconnect(file_id& a_id, stream_reconnecter a_reconnecter) {
     a_id.stream()->on_reconnect = a_reconnecter;
 }
 
+template<typename traits>
+void basic_multi_file_async_logger<traits>::
+set_closer(file_id& a_id, stream_closer a_closer) {
+    BOOST_ASSERT(a_id.stream());
+    a_id.stream()->on_fd_close = a_closer;
+}
+
 template<typename traits>
 typename basic_multi_file_async_logger<traits>::file_id
 basic_multi_file_async_logger<traits>::
@@ -976,6 +1156,41 @@ open_file_or_throw(const std::string& a_filename, bool a_append, int a_mode)
     return internal_register_stream(a_filename, &writev, NULL, n);
 }
 
+#ifdef UTXX_HAVE_LIBZ
+template<typename traits>
+typename basic_multi_file_async_logger<traits>::file_id
+basic_multi_file_async_logger<traits>::
+open_gz_file(const std::string& a_filename, bool a_append, int a_level,
+             size_t a_frame_size, int a_mode)
+{
+    // Appending starts a new gzip member after the last one terminated by
+    // recover() if the previous writer crashed.  A failed write terminates
+    // the current member at the end of the last successful write, so the
+    // output of a stream reconnected by on_reconnect also stays valid.
+    auto gz = std::make_shared<gzframe_writer>(a_level, a_frame_size);
+    int  fd = ::open(a_filename.c_str(),
+                a_append ? O_CREAT|O_APPEND|O_RDWR|O_LARGEFILE
+                         : O_CREAT|O_WRONLY|O_TRUNC|O_LARGEFILE,
+                a_mode);
+    if (fd >= 0 && a_append && gzframe_writer::recover(fd) < 0) {
+        int e = errno;
+        ::close(fd);
+        fd    = -1;
+        errno = e;
+    }
+    auto id = internal_register_stream(a_filename, &writev, NULL, fd);
+    if (!id)
+        return id;
+
+    set_writer(id, [gz](stream_info& a_si, const char**, const iovec* a_data,
+                        size_t a_size) {
+        return int(gz->write(a_si.fd, a_data, a_size));
+    });
+    set_closer(id, [gz](stream_info& a_si) { gz->finish(a_si.fd); });
+    return id;
+}
+#endif
+
 template<typename traits>
 typename basic_multi_file_async_logger<traits>::file_id
 basic_multi_file_async_logger<traits>::
@@ -1068,7 +1283,7 @@ close_file(file_id& a_id, bool a_immediate, int a_wait_secs) {
 
     stream_info* si = a_id.stream();
 
-    if (!m_thread) {
+    if (!running()) {
         si->reset();
         a_id.reset();
         return 0;
@@ -1087,7 +1302,7 @@ close_file(file_id& a_id, bool a_immediate, int a_wait_secs) {
     if (!n && ev) {
         UTXX_ASYNC_TRACE(("----> close_file(%d) is waiting for ack secs=%d (event_val={%ld,%d})\n",
                      fd, a_wait_secs, event_val, ev->value()));
-        if (m_thread) {
+        if (running()) {
             if (a_wait_secs < 0)
                 n = ev->wait(&event_val);
             else {
@@ -1112,34 +1327,23 @@ int basic_multi_file_async_logger<traits>::
 internal_enqueue(command_t* a_cmd, const stream_info* a_si) {
     BOOST_ASSERT(a_cmd);
 
+    // The command goes to the queue of the writer owning its stream
+    writer_t&  w = writer_of(a_cmd->stream);
     command_t* old_head;
 
-#ifdef PERF_STATS
-    size_t i = 0;
-#endif
     // Replace the head with msg
     do {
-#ifdef PERF_STATS
-        i++;
-
-        if (i > 25)
-            sched_yield();
-#endif
-        old_head = const_cast<command_t*>(m_head.load(std::memory_order_relaxed));
+        old_head = const_cast<command_t*>(w.head.load(std::memory_order_relaxed));
         a_cmd->next = old_head;
-    } while(!m_head.compare_exchange_weak(old_head, a_cmd,
+    } while(!w.head.compare_exchange_weak(old_head, a_cmd,
                 std::memory_order_release, std::memory_order_relaxed));
 
     if (!old_head)
-        m_event.signal();
-
-#ifdef PERF_STATS
-    if (i > 1) m_stats_enque_spins.fetch_add(i, std::memory_order_relaxed);
-#endif
+        w.event.signal();
 
     UTXX_ASYNC_TRACE(("--> internal_enqueue cmd %p (type=%s) - "
                  "cur head: %p, prev head: %p%s\n",
-        a_cmd, a_cmd->type_str(), m_head.load(),
+        a_cmd, a_cmd->type_str(), w.head.load(),
         old_head, !old_head ? " (signaled)" : ""));
 
     return 0;
@@ -1157,6 +1361,7 @@ internal_write(const file_id& a_id, const char* a_cat, size_t a_cat_sz,
     }
 
     command_t* p = allocate_message(a_id.stream(), a_cat, a_cat_sz, a_data, a_sz);
+    a_id.stream()->m_queue_depth.fetch_add(1, std::memory_order_relaxed);
     UTXX_ASYNC_TRACE(("->write(%p, %lu) - %s\n", a_data, a_sz, copied ? "allocated" : "no copy"));
     return internal_enqueue(p, a_id.stream());
 }
@@ -1200,6 +1405,7 @@ do_writev_and_free(stream_info* a_si, command_t* a_end,
     UTXX_ASYNC_TRACE(("Written %d bytes to stream %s\n", n, a_si->name.c_str()));
 
     if (likely(n >= 0)) {
+        a_si->written(a_sz, n);
         // Data was successfully written to stream - adjust internal queue's head/tail
         a_si->erase(a_si->pending_writes_head(), a_end);
         a_si->pending_writes_head(a_end);
@@ -1224,7 +1430,7 @@ deallocate_command(command_t* a_cmd) {
             deallocate(
                 static_cast<char*>(a_cmd->args.msg.data.iov_base),
                 a_cmd->args.msg.data.iov_len);
-
+            a_cmd->stream->m_queue_depth.fetch_sub(1, std::memory_order_relaxed);
             break;
         default:
             break;
@@ -1237,48 +1443,37 @@ deallocate_command(command_t* a_cmd) {
 
 template<typename traits>
 int basic_multi_file_async_logger<traits>::
-commit(const struct timespec* tsp)
+commit(writer_t& a_writer, const struct timespec* tsp)
 {
-    UTXX_ASYNC_TRACE(("Committing head: %p\n", m_head.load()));
+    auto& head    = a_writer.head;
+    auto& event   = a_writer.event;
+    auto& pending = a_writer.pending_data_streams;
 
-    int event_val = m_event.value();
+    UTXX_ASYNC_TRACE(("Committing head: %p\n", head.load()));
+
+    int event_val = event.value();
 
     while (!m_cancel.load(std::memory_order_relaxed) &&
-           !m_head.  load(std::memory_order_relaxed)) {
+           !head.    load(std::memory_order_relaxed)) {
         #ifdef DEBUG_ASYNC_LOGGER
         wakeup_result n =
         #endif
-        m_event.wait(tsp, &event_val);
+        event.wait(tsp, &event_val);
 
         UTXX_ASYNC_DEBUG_TRACE(
             ("  %s COMMIT awakened (res=%s, val=%d, futex=%d), cancel=%d, head=%p\n",
-             timestamp::to_string().c_str(), to_string(n), event_val, m_event.value(),
-             m_cancel.load(std::memory_order_relaxed), m_head.load())
+             timestamp::to_string().c_str(), to_string(n), event_val, event.value(),
+             m_cancel.load(std::memory_order_relaxed), head.load())
         );
     }
 
-    if (m_cancel.load(std::memory_order_relaxed) && !m_head.load(std::memory_order_relaxed))
+    if (m_cancel.load(std::memory_order_relaxed) && !head.load(std::memory_order_relaxed))
         return 0;
 
-    command_t* cur_head;
+    // Take the current list and reset the head to be NULL
+    command_t* cur_head = head.exchange(nullptr, std::memory_order_acquire);
 
-#ifdef PERF_STATS
-    size_t i = 0;
-#endif
-
-    // Find current head and reset the old head to be NULL
-    do {
-#ifdef PERF_STATS
-        i++;
-#endif
-        cur_head = const_cast<command_t*>(m_head.load(std::memory_order_relaxed));
-    } while(!m_head.compare_exchange_strong(cur_head, static_cast<command_t*>(nullptr),
-                std::memory_order_release, std::memory_order_relaxed));
-
-#ifdef PERF_STATS
-    if (i > 1) m_stats_deque_spins.fetch_add(i, std::memory_order_relaxed);
-#endif
-    UTXX_ASYNC_TRACE((" --> cur head: %p, new head: %p\n", cur_head, m_head.load()));
+    UTXX_ASYNC_TRACE((" --> cur head: %p, new head: %p\n", cur_head, head.load()));
 
     BOOST_ASSERT(cur_head);
 
@@ -1297,26 +1492,30 @@ commit(const struct timespec* tsp)
         // (this function advances p until there is a stream change)
         n = si->push(p);
         // Update the index of fds that have pending data
-        m_pending_data_streams.insert(si);
+        pending.insert(si);
+
+        long depth = si->m_queue_depth.load(std::memory_order_relaxed);
+        if (si->m_max_queue_depth.load(std::memory_order_relaxed) < depth)
+            si->m_max_queue_depth.store(depth, std::memory_order_relaxed);
         UTXX_ASYNC_TRACE(("Set stream %p fd[%d].pending_writes(%p) -> %d, head(%p), next(%p)\n",
                      si, si->fd, last, n, si->pending_writes_head(), p));
     }
 
     // Process each fd's pending command queue
-    if (m_max_queue_size < count)
-        m_max_queue_size = count;
+    if (a_writer.max_queue_size < count)
+        a_writer.max_queue_size = count;
 
     m_total_msgs_processed.fetch_add(count, std::memory_order_relaxed);
 
     UTXX_ASYNC_DEBUG_TRACE(("Processed count: %d / %ld. (MaxQsz = %d)\n",
-                       count, m_total_msgs_processed.load(), m_max_queue_size));
+                       count, m_total_msgs_processed.load(), a_writer.max_queue_size));
 
     // Since inside the loop there is a posibility of erasing an element from
-    // m_pending_data_streams, we need to conditionally increment the iterator
+    // the pending streams, we need to conditionally increment the iterator
     bool increment = true;
     auto inc = [&](auto& it) { if (increment) ++it; };
 
-    for(auto it=m_pending_data_streams.begin(); it != m_pending_data_streams.end(); inc(it))
+    for(auto it=pending.begin(); it != pending.end(); inc(it))
     {
         stream_info* si = *it;
         increment       = true;
@@ -1422,10 +1621,12 @@ commit(const struct timespec* tsp)
 
             if (destroy_si || si->fd < 0) {
                 UTXX_ASYNC_DEBUG_TRACE(("Removing %p stream from list of pending data streams\n", si));
-                it = m_pending_data_streams.erase(it);
+                it = pending.erase(it);
                 increment = false;
             }
 
+            // Other writer threads may be scanning m_files in internal_close()
+            std::unique_lock<std::mutex> lock(m_mutex);
             internal_close(si, si->error);
 
             if (destroy_si) {
@@ -59,6 +59,11 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include <cstdlib>
 #include <atomic>
 #include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/vfs.h>
+#include <linux/magic.h>
 
 namespace utxx {
 
@@ -74,6 +79,31 @@ namespace utxx {
         READ_WRITE          // Create or open
     };
 
+    /// Huge page backing of a memory-mapped persist_array file
+    enum class persist_huge_pages {
+        NONE,       // Regular pages
+        MADVISE,    // Transparent huge pages requested by madvise(2)
+        HUGETLBFS   // The file resides on hugetlbfs (sizes are rounded up to
+                    // the huge page size of the mount)
+    };
+
+    /// Options of mapping a persist_array file
+    struct persist_map_opts {
+        /// Max number of records the array may grow to online (0 - don't
+        /// grow in allocate_rec()).  This much address space is reserved
+        /// up front, so that growing doesn't move the mapping.  Readers of
+        /// a file grown by another process should set it too: past the
+        /// reservation refresh() moves the mapping (see refresh()).
+        size_t              max_grow_recs = 0;
+        /// Factor by which allocate_rec() grows the capacity when exhausted
+        double              grow_factor   = 2.0;
+        persist_huge_pages  huge_pages    = persist_huge_pages::NONE;
+        /// Address at which to map the file (or NULL)
+        void const*         map_address   = nullptr;
+        /// Extra mmap(2) flags
+        int                 map_flags     = 0;
+    };
+
     template <
         typename    T,
         std::size_t NLocks          = 32,
@@ -82,13 +112,16 @@ namespace utxx {
     struct persist_array {
         struct header : public ExtraHeaderData {
             static const uint32_t s_version = 0xa0b1c2d3;
-            uint32_t            version;
-            std::atomic<long>   rec_count;
-            size_t              max_recs;
-            size_t              rec_size;
-            size_t              recs_offset;
-            Lock                locks[NLocks];
-            T                   records[0];
+            uint32_t              version;
+            /// Incremented when the file is grown, so that other processes
+            /// attached to it remap the records lazily
+            std::atomic<uint32_t> generation;
+            std::atomic<long>     rec_count;
+            size_t                max_recs;
+            size_t                rec_size;
+            size_t                recs_offset;
+            Lock                  locks[NLocks];
+            T                     records[0];
         };
 
         static const size_t s_locks = NLocks;
@@ -98,48 +131,84 @@ namespace utxx {
         static_assert((NLocks & (NLocks-1)) == 0, "Must be power of 2");
 
         static const size_t s_lock_mask = NLocks-1;
-        // Shared memory file mapping
-        bip::file_mapping   m_file;
-        // Shared memory mapped region
-        bip::mapped_region  m_region;
         // Name of the memory-mapped file or shm segment
         std::string         m_storage_name;
 
         // Locks that guard access to internal record structures.
         header* m_header;
         T*      m_begin;
-        T*      m_end;
+
+        // Descriptor of the memory-mapped file (-1 for shm storage)
+        int                 m_fd;
+        bool                m_read_only;
+        persist_map_opts    m_opts;
+        size_t              m_page_size;
+        // Size of the address space reserved for the mapping
+        size_t              m_reserved;
+        // Size of the file mapped in this process
+        mutable size_t      m_mapped;
+        // Number of records mapped in this process
+        mutable std::atomic<size_t>   m_capacity;
+        // Generation of the file known to this process
+        mutable std::atomic<uint32_t> m_generation;
+        // Serializes remapping among threads of this process
+        mutable std::mutex  m_remap_lock;
 
         void check_range(size_t a_id) const {
-            size_t n = m_header->max_recs;
-            if (likely(a_id < n))
+            if (likely(a_id < capacity()) || (refresh() && a_id < capacity()))
                 return;
+            size_t n = capacity();
             throw badarg_error("Invalid record id specified ", a_id, " (max=", n-1, ')');
         }
 
+        size_t map_size(size_t a_max_recs) const {
+            auto sz = sizeof(header) + a_max_recs * sizeof(T);
+            return (sz + m_page_size - 1) / m_page_size * m_page_size;
+        }
+
+        size_t page_size() const;
+        void   map(size_t a_size);
+        void   map_to(size_t a_size) const;
+        void   unmap();
+        bool   do_refresh() const;
+        void   grow_for(size_t a_rec_id);
+
     public:
         using lock_type   = Lock;
         using scoped_lock = std::lock_guard<Lock>;
 
         persist_array()
-            : m_header(NULL), m_begin(NULL), m_end(NULL)
+            : m_header(NULL), m_begin(NULL), m_fd(-1), m_read_only(false)
+            , m_page_size(getpagesize()), m_reserved(0), m_mapped(0)
+            , m_capacity(0), m_generation(0)
         {}
 
+        ~persist_array() { unmap(); }
+
 #if __cplusplus >= 201103L
-        persist_array(persist_array&& a_rhs) {
+        persist_array(persist_array&& a_rhs) : persist_array() {
             *this = std::move(a_rhs);
         }
 
         void operator=(persist_array&& a_rhs) {
+            unmap();
             m_storage_name = std::move(a_rhs.m_storage_name);
             m_header       = a_rhs.m_header;
             m_begin        = a_rhs.m_begin;
-            m_end          = a_rhs.m_end;
-            m_file  .swap(a_rhs.m_file);
-            m_region.swap(a_rhs.m_region);
-            a_rhs.m_header = nullptr;
-            a_rhs.m_begin  = nullptr;
-            a_rhs.m_end    = nullptr;
+            m_fd           = a_rhs.m_fd;
+            m_read_only    = a_rhs.m_read_only;
+            m_opts         = a_rhs.m_opts;
+            m_page_size    = a_rhs.m_page_size;
+            m_reserved     = a_rhs.m_reserved;
+            m_mapped       = a_rhs.m_mapped;
+            m_capacity    .store(a_rhs.m_capacity.load());
+            m_generation  .store(a_rhs.m_generation.load());
+            a_rhs.m_header   = nullptr;
+            a_rhs.m_begin    = nullptr;
+            a_rhs.m_fd       = -1;
+            a_rhs.m_reserved = 0;
+            a_rhs.m_mapped   = 0;
+            a_rhs.m_capacity.store(0);
         }
 #endif
         /// Default permission mask used for opening a file
@@ -158,7 +227,22 @@ namespace utxx {
         /// @return true if the storage file didn't exist and was created
         bool init(const char* a_filename, size_t a_max_recs, bool a_read_only = false,
             int a_mode = default_file_mode(), void const* a_map_address = nullptr,
-            int a_map_options = 0);
+            int a_map_options = 0)
+        {
+            persist_map_opts opts;
+            opts.map_address = a_map_address;
+            opts.map_flags   = a_map_options;
+            return init(a_filename, a_max_recs, opts, a_read_only, a_mode);
+        }
+
+        /// Initialize the storage with given mapping options.
+        /// If the file exists, its capacity is increased to \a a_max_recs
+        /// unless open in read-only mode, in which case \a a_max_recs is
+        /// ignored.
+        /// @return true if the storage file didn't exist and was created
+        bool init(const char* a_filename, size_t a_max_recs,
+                  const persist_map_opts& a_opts, bool a_read_only = false,
+                  int a_mode = default_file_mode());
 
         /// Initialize the storage in shared memory.
         /// @param a_segment  the shared memory segment
@@ -171,28 +255,58 @@ namespace utxx {
                   const char* a_name, persist_attach_type a_flag, size_t a_max_recs);
 
         size_t count()    const { return m_header->rec_count.load(std::memory_order_relaxed); }
-        size_t capacity() const { return m_header->max_recs; }
+        /// Number of records mapped in this process (the file may have been
+        /// grown by another process since the last refresh())
+        size_t capacity() const { return m_capacity.load(std::memory_order_acquire); }
+
+        /// Number of records accessible in this process, remapping the file
+        /// if it was grown by another process
+        size_t mapped_count() const {
+            size_t n = count();
+            if (unlikely(n > capacity()))
+                refresh();
+            return std::min(n, capacity());
+        }
+
+        /// Map the records added by another process growing the file.
+        /// This is done lazily by get(), operator[] and mapped_count() of a
+        /// record beyond capacity().  If the file outgrows the address space
+        /// reserved by persist_map_opts::max_grow_recs (e.g. it's 0), the
+        /// mapping is moved by mremap(2), invalidating pointers to records,
+        /// so then these calls must not race with other threads of this
+        /// process accessing the array.
+        /// @return true if the capacity has changed
+        bool refresh() const {
+            if (likely(m_fd < 0 || m_header->generation.load(std::memory_order_acquire)
+                                == m_generation.load(std::memory_order_relaxed)))
+                return false;
+            std::lock_guard<std::mutex> g(m_remap_lock);
+            return do_refresh();
+        }
+
+        /// Grow the capacity of the file to \a a_max_recs records.  The
+        /// mapping is extended in place within the reserved address space
+        /// (see persist_map_opts::max_grow_recs), otherwise it's moved by
+        /// mremap(2), invalidating the pointers to records, so it must not
+        /// race with other threads of this process accessing the array.
+        /// @return false if the capacity is already sufficient
+        bool grow(size_t a_max_recs);
 
         /// Return internal storage header.
         /// Use only for debugging
         const header& header_data() const { assert(m_header); return *m_header; }
 
-        /// Allocate next record and return its ID.
+        /// Options the storage file was mapped with
+        const persist_map_opts& map_opts() const { return m_opts; }
+
+        /// Allocate next record and return its ID.  If the capacity is
+        /// exhausted and persist_map_opts::max_grow_recs permits, the file is
+        /// grown by persist_map_opts::grow_factor.
         /// @return
         size_t allocate_rec() {
-            auto error = [this]() {
-                throw utxx::runtime_error
-                    ("persist_array: Out of storage capacity (", this->m_storage_name, ")!");
-            };
-
-            if (unlikely(count() >= capacity()))
-                error();
             size_t n = size_t(m_header->rec_count.fetch_add(1, std::memory_order_relaxed));
-            if (unlikely(n >= capacity())) {
-                m_header->rec_count.store(capacity(), std::memory_order_relaxed);
-                error();
-            }
-
+            if (unlikely(n >= capacity()))
+                grow_for(n);
             return n;
         }
 
@@ -242,30 +356,34 @@ namespace utxx {
         }
 
         const T* get(size_t a_rec_id) const {
-            return likely(a_rec_id < capacity()) ? m_begin+a_rec_id : NULL;
+            return likely(a_rec_id < capacity()) ||
+                   (refresh() && a_rec_id < capacity()) ? m_begin+a_rec_id : NULL;
         }
 
         T* get(size_t a_rec_id) {
-            return likely(a_rec_id < capacity()) ? m_begin+a_rec_id : NULL;
+            return likely(a_rec_id < capacity()) ||
+                   (refresh() && a_rec_id < capacity()) ? m_begin+a_rec_id : NULL;
         }
 
         /// Flush header to disk
-        bool flush_header() { return m_region.flush(0, sizeof(header)); }
-
-        /// Flush region of cached records to disk
-        bool flush(size_t a_from_rec = 0, size_t a_num_recs = 0) {
-            return m_region.flush(a_from_rec, a_num_recs*sizeof(T));
+        bool flush_header() {
+            return m_fd >= 0 && ::msync(m_header, m_page_size, MS_ASYNC) == 0;
         }
 
+        /// Flush region of cached records to disk (all records if
+        /// \a a_num_recs is 0)
+        bool flush(size_t a_from_rec = 0, size_t a_num_recs = 0);
+
         /// Remove memory mapped file from disk
         void remove() {
-            m_file.remove(m_file.get_name());
+            if (m_fd >= 0)
+                ::unlink(m_storage_name.c_str());
         }
 
         const T*    begin() const { return m_begin; }
-        const T*    end()   const { return m_end; }
+        const T*    end()   const { return m_begin + capacity(); }
         T*          begin()       { return m_begin; }
-        T*          end()         { return m_end; }
+        T*          end()         { return m_begin + capacity(); }
 
         /// Name of the unlerlying storage (either mmap file or shm)
         std::string const& storage_name() const { return m_storage_name; }
@@ -278,9 +396,10 @@ namespace utxx {
         /// @return number of records processed.
         template <class Visitor>
         size_t for_each(const Visitor& a_visitor, size_t a_min_rec = 0, size_t a_count = 0) const {
+            size_t   n = mapped_count();
             const T* b = begin() + a_min_rec;
             const T* p = b;
-            const T* e = std::min<const T*>(b + (a_count ? a_count : count()), begin() + count());
+            const T* e = std::min<const T*>(b + (a_count ? a_count : n), begin() + n);
             if (p >= e)
                 return 0;
             for (int i = 0; p != e; ++p, ++i)
@@ -290,9 +409,10 @@ namespace utxx {
 
         template <class Visitor>
         size_t for_each(const Visitor& a_visitor, size_t a_min_rec = 0, size_t a_count = 0) {
+            size_t   n = mapped_count();
             T*       b = begin() + a_min_rec;
             T*       p = b;
-            const T* e = std::min<const T*>(p + (a_count ? a_count : count()), begin() + count());
+            const T* e = std::min<const T*>(p + (a_count ? a_count : n), begin() + n);
             if (p >= e)
                 return 0;
             for (int i = 0; p != e; ++p, ++i)
@@ -301,7 +421,7 @@ namespace utxx {
         }
 
         std::ostream& dump(std::ostream& out, const std::string& a_prefix="") const {
-            for (const T* p = begin(), *e = p + count(); p != e; ++p)
+            for (const T* p = begin(), *e = p + mapped_count(); p != e; ++p)
                 out << a_prefix << *p << std::endl;
             return out;
         }
@@ -313,10 +433,12 @@ namespace utxx {
 
     template <typename T, size_t NLocks, typename Lock, typename Ext>
     bool persist_array<T,NLocks,Lock,Ext>::
-    init(const char* a_filename, size_t a_max_recs, bool a_read_only, int a_mode,
-         void const* a_map_address, int a_map_options)
+    init(const char* a_filename, size_t a_max_recs, const persist_map_opts& a_opts,
+         bool a_read_only, int a_mode)
     {
-        auto sz = total_size(a_max_recs);
+        unmap();
+        m_opts      = a_opts;
+        m_read_only = a_read_only;
 
         bool l_exists;
         try {
@@ -328,97 +450,84 @@ namespace utxx {
                     l_name.parent_path(), ": ", e.what());
             }
 
-            {
-                std::filebuf f;
-                f.open(a_filename, std::ios_base::in | std::ios_base::out
-                    | std::ios_base::binary);
-                l_exists = f.is_open();
-
-                if (l_exists && !a_read_only) {
-                    bip::file_lock flock(a_filename);
-                    bip::scoped_lock<bip::file_lock> g_lock(flock);
-
-                    header h;
-                    f.sgetn(reinterpret_cast<char*>(&h), sizeof(header));
-
-                    if (h.version != header::s_version)
-                        throw utxx::runtime_error
-                            ("Invalid file format ", a_filename);
-                    if (h.rec_size != sizeof(T))
-                        throw utxx::runtime_error
-                            ("Invalid item size in file ", a_filename,
-                             " (expected ", sizeof(T), " got ", h.rec_size, ')');
-                    if (h.recs_offset != sizeof(header))
-                        throw utxx::runtime_error
-                            ("Mismatch in the records offset in ",
-                             a_filename, " (expected=",
-                             sizeof(header), ", got=", h.recs_offset, ')');
-                    // Increase the file size if instructed to do so.
-                    if (h.max_recs < a_max_recs) {
-                        h.max_recs = a_max_recs;
-                        f.pubseekoff(0, std::ios_base::beg);
-                        f.sputn(reinterpret_cast<char*>(&h), sizeof(header));
-                        f.pubseekoff(sz-1, std::ios_base::beg);
-                        f.sputc(0);
-                    }
-                }
-            }
-
-            if (!l_exists && !a_read_only) {
-                int l_fd = ::open(a_filename, O_RDWR | O_CREAT | O_TRUNC, a_mode);
-                if (l_fd < 0)
-                    throw io_error(errno, "Error creating file ", a_filename);
-
-                UTXX_SCOPE_EXIT([=]{ ::close(l_fd); });
-
-                bip::file_lock flock(a_filename);
-                bip::scoped_lock<bip::file_lock> g_lock(flock);
-
-                header h;
-                h.version     = header::s_version;
-                h.rec_count.store(0, std::memory_order_release);
-                h.max_recs    = a_max_recs;
-                h.rec_size    = sizeof(T);
-                h.recs_offset = sizeof(header);
+            m_fd = a_read_only ? ::open(a_filename, O_RDONLY)
+                               : ::open(a_filename, O_RDWR | O_CREAT, a_mode);
+            if (m_fd < 0)
+                throw io_error(errno, "Error opening file ", a_filename);
 
-                if (::write(l_fd, &h, sizeof(h)) < 0)
-                    throw io_error(errno, "Error writing to file ", a_filename);
-
-                if (::ftruncate(l_fd, sz) < 0)
-                    throw io_error(errno, "Error setting file ",
-                        a_filename, " to size ", sz);
+            m_storage_name = a_filename;
+            m_page_size    = page_size();
 
-                ::fsync(l_fd);
+            // Writers serialize initialization of the file
+            bip::file_lock flock;
+            if (!a_read_only) {
+                bip::file_lock(a_filename).swap(flock);
+                flock.lock();
             }
+            UTXX_SCOPE_EXIT([&]{ if (!a_read_only) flock.unlock(); });
 
-            auto mode = a_read_only ? bip::read_only : bip::read_write;
-            bip::file_mapping  shmf  (a_filename, mode);
-            bip::mapped_region region(shmf, mode, 0, sz, a_map_address, a_map_options);
+            struct stat st;
+            if (::fstat(m_fd, &st) < 0)
+                throw io_error(errno, "Cannot stat file ", a_filename);
 
-            //Get the address of the mapped region
-            void*  addr  = region.get_address();
-            #ifndef NDEBUG
-            size_t size  = region.get_size();
-            assert(addr != nullptr && (a_map_address == nullptr || a_map_address == addr));
-            assert(size == sz);
-            #endif
+            l_exists = size_t(st.st_size) >= sizeof(header);
+            if (!l_exists && a_read_only)
+                throw utxx::runtime_error
+                    ("persist_array: file ", a_filename, " is not initialized");
+
+            header h;
+            size_t recs = a_max_recs;
+            if (l_exists) {
+                if (::pread(m_fd, &h, sizeof(header), 0) != ssize_t(sizeof(header)))
+                    throw io_error(errno, "Error reading file ", a_filename);
+                if (h.version != header::s_version)
+                    throw utxx::runtime_error
+                        ("Invalid file format ", a_filename);
+                if (h.rec_size != sizeof(T))
+                    throw utxx::runtime_error
+                        ("Invalid item size in file ", a_filename,
+                         " (expected ", sizeof(T), " got ", h.rec_size, ')');
+                if (h.recs_offset != sizeof(header))
+                    throw utxx::runtime_error
+                        ("Mismatch in the records offset in ",
+                         a_filename, " (expected=",
+                         sizeof(header), ", got=", h.recs_offset, ')');
+                // Increase the file size if instructed to do so.
+                if (a_read_only || h.max_recs >= a_max_recs)
+                    recs = h.max_recs;
+            }
 
-            m_file  .swap(shmf);
-            m_region.swap(region);
-            m_storage_name = a_filename;
+            auto sz = map_size(recs);
+            if (!a_read_only && size_t(st.st_size) < sz && ::ftruncate(m_fd, sz) < 0)
+                throw io_error(errno, "Error setting file ",
+                    a_filename, " to size ", sz);
+
+            map(sz);
+
+            // The header is initialized through the mapping, since
+            // hugetlbfs doesn't support write(2)
+            if (!l_exists) {
+                m_header->version     = header::s_version;
+                m_header->generation.store(0, std::memory_order_relaxed);
+                m_header->rec_count.store(0, std::memory_order_release);
+                m_header->max_recs    = recs;
+                m_header->rec_size    = sizeof(T);
+                m_header->recs_offset = sizeof(header);
+                ::fsync(m_fd);
+            } else if (m_header->max_recs < recs) {
+                m_header->max_recs = recs;
+                m_header->generation.fetch_add(1, std::memory_order_release);
+            }
 
-            //if (!exists && !a_read_only)
-            //    memset(static_cast<char*>(addr) + sizeof(header), 0, size - sizeof(header));
-            m_header = static_cast<header*>(addr);
-            m_begin  = m_header->records;
-            m_end    = m_begin + m_header->max_recs;
-            BOOST_ASSERT(reinterpret_cast<char*>(m_end) <= static_cast<char*>(addr)+size);
+            // Catch up with other processes growing the file since its
+            // header was read
+            {
+                std::lock_guard<std::mutex> g(m_remap_lock);
+                m_capacity.store(recs, std::memory_order_release);
+                do_refresh();
+            }
 
-            //if (!l_exists && !a_read_only) {
             if (!a_read_only) {
-                bip::file_lock flock(a_filename);
-                bip::scoped_lock<bip::file_lock> g_lock(flock);
-
                 // If the file is open for writing, initialize the locks
                 // since previous program crash might have left locks in inconsistent state
                 for (Lock* l = m_header->locks, *e = l + NLocks; l != e; ++l)
@@ -426,19 +535,221 @@ namespace utxx {
             }
 
         } catch (io_error& e) {
+            unmap();
             throw;
         } catch (std::exception& e) {
+            unmap();
             throw runtime_error(e.what());
         }
 
         return !l_exists;
     }
 
+    template <typename T, size_t NLocks, typename Lock, typename Ext>
+    size_t persist_array<T,NLocks,Lock,Ext>::
+    page_size() const
+    {
+        if (m_opts.huge_pages != persist_huge_pages::HUGETLBFS)
+            return getpagesize();
+
+        struct statfs fs;
+        if (::fstatfs(m_fd, &fs) < 0)
+            throw io_error(errno, "Cannot stat file system of ", m_storage_name);
+        if (fs.f_type != HUGETLBFS_MAGIC)
+            throw badarg_error("persist_array: file ", m_storage_name,
+                               " is not on hugetlbfs");
+        return fs.f_bsize;
+    }
+
+    template <typename T, size_t NLocks, typename Lock, typename Ext>
+    void persist_array<T,NLocks,Lock,Ext>::
+    map(size_t a_size)
+    {
+        // Reserve address space for growing the mapping in place.  Like the
+        // kernel does for large file mappings, align it at the PMD size, so
+        // that large page cache folios can be mapped by fewer faults (it's
+        // ~5x faster to populate on ext4).  An address given by the caller
+        // is used as is.
+        static const size_t s_pmd_size = 2*1024*1024;
+
+        auto res  = std::max(a_size, map_size(m_opts.max_grow_recs));
+        auto hint = const_cast<void*>(m_opts.map_address);
+        auto algn = hint ? m_page_size : std::max(m_page_size, s_pmd_size);
+        auto pad  = hint ? 0 : algn - getpagesize();
+        auto p    = ::mmap(hint, res + pad, PROT_NONE,
+                           MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (p == MAP_FAILED)
+            throw io_error(errno, "Cannot reserve ", res, " bytes for ",
+                           m_storage_name);
+
+        auto raw  = static_cast<char*>(p);
+        if (hint && (raw != hint || uintptr_t(raw) % algn)) {
+            ::munmap(raw, res + pad);
+            throw utxx::runtime_error
+                ("persist_array: cannot map ", m_storage_name, " at ", hint);
+        }
+
+        auto base = reinterpret_cast<char*>
+                    ((uintptr_t(raw) + pad) / algn * algn);
+        if (base > raw)
+            ::munmap(raw, base - raw);
+        if (raw + res + pad > base + res)
+            ::munmap(base + res, raw + pad - base);
+
+        m_header   = reinterpret_cast<header*>(base);
+        m_begin    = m_header->records;
+        m_reserved = res;
+        m_mapped   = 0;
+
+        map_to(a_size);
+    }
+
+    template <typename T, size_t NLocks, typename Lock, typename Ext>
+    void persist_array<T,NLocks,Lock,Ext>::
+    map_to(size_t a_size) const
+    {
+        // The records added may fit in the last page mapped
+        if (a_size <= m_mapped)
+            return;
+
+        auto base = reinterpret_cast<char*>(m_header);
+        auto prot = m_read_only ? PROT_READ : PROT_READ | PROT_WRITE;
+
+        if (a_size <= m_reserved) {
+            // Map the added tail of the file without touching the mapped part
+            auto p = ::mmap(base + m_mapped, a_size - m_mapped, prot,
+                            MAP_SHARED | MAP_FIXED | m_opts.map_flags,
+                            m_fd, m_mapped);
+            if (p == MAP_FAILED)
+                throw io_error(errno, "Cannot map ", a_size, " bytes of ",
+                               m_storage_name);
+        } else {
+            // Out of the reserved address space: move the mapping
+            if (m_reserved > m_mapped)
+                ::munmap(base + m_mapped, m_reserved - m_mapped);
+            auto p = ::mremap(base, m_mapped, a_size, MREMAP_MAYMOVE);
+            if (p == MAP_FAILED)
+                throw io_error(errno, "Cannot remap ", a_size, " bytes of ",
+                               m_storage_name);
+            auto self = const_cast<self_type*>(this);
+            self->m_header   = static_cast<header*>(p);
+            self->m_begin    = self->m_header->records;
+            self->m_reserved = a_size;
+            base             = static_cast<char*>(p);
+        }
+
+        if (m_opts.huge_pages == persist_huge_pages::MADVISE)
+            ::madvise(base, a_size, MADV_HUGEPAGE);
+
+        m_mapped = a_size;
+    }
+
+    template <typename T, size_t NLocks, typename Lock, typename Ext>
+    void persist_array<T,NLocks,Lock,Ext>::
+    unmap()
+    {
+        if (m_fd < 0)
+            return;
+        if (m_header)
+            ::munmap(m_header, std::max(m_reserved, m_mapped));
+        ::close(m_fd);
+        m_fd       = -1;
+        m_header   = nullptr;
+        m_begin    = nullptr;
+        m_reserved = 0;
+        m_mapped   = 0;
+        m_capacity.store(0);
+    }
+
+    template <typename T, size_t NLocks, typename Lock, typename Ext>
+    bool persist_array<T,NLocks,Lock,Ext>::
+    do_refresh() const
+    {
+        // Called with m_remap_lock held.  The generation is loaded before
+        // max_recs, which the grower updates before the generation.
+        auto gen  = m_header->generation.load(std::memory_order_acquire);
+        auto recs = m_header->max_recs;
+        bool res  = recs > capacity();
+        if (res) {
+            map_to(map_size(recs));
+            m_capacity.store(recs, std::memory_order_release);
+        }
+        m_generation.store(gen, std::memory_order_relaxed);
+        return res;
+    }
+
+    template <typename T, size_t NLocks, typename Lock, typename Ext>
+    bool persist_array<T,NLocks,Lock,Ext>::
+    grow(size_t a_max_recs)
+    {
+        if (m_fd < 0 || m_read_only)
+            throw utxx::runtime_error
+                ("persist_array: cannot grow read-only or shm storage (",
+                 m_storage_name, ')');
+
+        // Serialize with threads of this process and with other processes
+        std::lock_guard<std::mutex> g(m_remap_lock);
+        bip::file_lock flock(m_storage_name.c_str());
+        bip::scoped_lock<bip::file_lock> g_lock(flock);
+
+        do_refresh();
+        if (m_header->max_recs >= a_max_recs)
+            return false;
+
+        auto sz = map_size(a_max_recs);
+        if (::ftruncate(m_fd, sz) < 0)
+            throw io_error(errno, "Error setting file ",
+                m_storage_name, " to size ", sz);
+
+        map_to(sz);
+        m_header->max_recs = a_max_recs;
+        m_generation.store(m_header->generation.fetch_add
+                           (1, std::memory_order_release) + 1);
+        m_capacity.store(a_max_recs, std::memory_order_release);
+        return true;
+    }
+
+    template <typename T, size_t NLocks, typename Lock, typename Ext>
+    void persist_array<T,NLocks,Lock,Ext>::
+    grow_for(size_t a_rec_id)
+    {
+        // Another process might have grown the file already
+        if (refresh() && a_rec_id < capacity())
+            return;
+
+        auto max = m_opts.max_grow_recs;
+        if (m_fd < 0 || m_read_only || a_rec_id >= max) {
+            m_header->rec_count.store(capacity(), std::memory_order_relaxed);
+            throw utxx::runtime_error
+                ("persist_array: Out of storage capacity (", m_storage_name, ")!");
+        }
+
+        auto recs = std::max(a_rec_id+1, size_t(capacity() * m_opts.grow_factor));
+        grow(std::min(recs, max));
+    }
+
+    template <typename T, size_t NLocks, typename Lock, typename Ext>
+    bool persist_array<T,NLocks,Lock,Ext>::
+    flush(size_t a_from_rec, size_t a_num_recs)
+    {
+        if (m_fd < 0)
+            return false;
+        auto base = reinterpret_cast<char*>(m_header);
+        auto from = a_num_recs ? reinterpret_cast<char*>(m_begin + a_from_rec) : base;
+        auto to   = a_num_recs ? reinterpret_cast<char*>(m_begin + a_from_rec + a_num_recs)
+                               : base + m_mapped;
+        from      = base + size_t(from - base) / m_page_size * m_page_size;
+        to        = std::min(to, base + m_mapped);
+        return from < to && ::msync(from, to - from, MS_ASYNC) == 0;
+    }
+
+
     template <typename T, size_t NLocks, typename Lock, typename Ext>
     bool persist_array<T,NLocks,Lock,Ext>::
     init(bip::fixed_managed_shared_memory& a_segment,
          const char* a_name, persist_attach_type a_flag, size_t a_max_recs)
     {
+        unmap();
         std::pair<char*, size_t> fres = a_segment.find<char>(a_name);
 
         bool found   = fres.first != nullptr;
@@ -458,13 +769,13 @@ namespace utxx {
                     //assert(fres.second == 1);
                     m_header = reinterpret_cast<header*>(fres.first);
                     m_begin  = m_header->records;
-                    m_end    = m_begin + m_header->max_recs;
+                    m_capacity.store(m_header->max_recs);
                     if (m_header->recs_offset != sizeof(header))
                         throw runtime_error("Mismatch in the records offset in '",
                                             a_name, "' (expected=",
                                             sizeof(header), ", got=",
                                             m_header->recs_offset, ')');
-                    BOOST_ASSERT(reinterpret_cast<char*>(m_end) <=
+                    BOOST_ASSERT(reinterpret_cast<const char*>(end()) <=
                                  reinterpret_cast<char*>(m_header)+fres.second);
                     created = false;
                     goto INIT_LOCKS;
@@ -503,17 +814,18 @@ namespace utxx {
             //    memset(static_cast<char*>(addr) + sizeof(header), 0, size - sizeof(header));
             m_header = reinterpret_cast<header*>(mem);
             m_header->version     = header::s_version;
+            m_header->generation.store(0, std::memory_order_relaxed);
             m_header->rec_count.store(0, std::memory_order_release);
             m_header->max_recs    = a_max_recs;
             m_header->rec_size    = sizeof(T);
             m_header->recs_offset = sizeof(header);
 
             m_begin  = m_header->records;
-            m_end    = m_begin + a_max_recs;
+            m_capacity.store(a_max_recs);
 
             m_storage_name = a_name;
 
-            BOOST_ASSERT(reinterpret_cast<char*>(m_end) <=
+            BOOST_ASSERT(reinterpret_cast<const char*>(end()) <=
                          reinterpret_cast<char*>(mem)+size);
             created = true;
         }
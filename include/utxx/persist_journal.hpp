@@ -0,0 +1,284 @@
+// vim:ts=4:et:sw=4
+//----------------------------------------------------------------------------
+/// \file   persist_journal.hpp
+/// \author Serge Aleynikov
+//----------------------------------------------------------------------------
+/// \brief Persistent append-only journal of fixed-size records.
+///
+/// The journal is a persist_array of records, each prefixed by a commit
+/// state.  Writers (threads or processes sharing the file) reserve a record
+/// with one atomic fetch_add on the record count and publish it by setting
+/// its state to committed, so the write path has no locks.  Readers, possibly
+/// in other processes, tail the journal by visiting committed records in
+/// order and stopping at the first record that is reserved but not yet
+/// committed:
+/// \code
+///     persist_journal<event> w;
+///     w.init("/tmp/events.bin", 1000000);
+///     w.append(event{...});
+///
+///     persist_journal<event> r;                   // In another process
+///     r.init_read_only("/tmp/events.bin");
+///     for (size_t next = 0;;)
+///         next = r.read(next, [](size_t id, const event& e) { ... });
+/// \endcode
+/// A record reserved by a writer that crashed before committing it would
+/// stop the readers, so opening the journal for writing marks such records,
+/// as well as the committed records whose checksum doesn't match their data
+/// (torn by a system crash), as skipped.
+//----------------------------------------------------------------------------
+// Created: 2026-10-16
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the utxx open-source project.
+
+Copyright (C) 2026 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+#pragma once
+
+#include <utxx/persist_array.hpp>
+#include <utxx/hashmap.hpp>
+#include <utxx/synch.hpp>
+#include <type_traits>
+
+namespace utxx {
+
+    /// Commit state of a journal record
+    enum class journal_state : uint32_t {
+        RESERVED  = 0,  // Reserved by a writer, but not yet committed
+        COMMITTED = 1,  // Published to readers
+        SKIPPED   = 2   // Torn record skipped by recovery
+    };
+
+    namespace detail {
+        template <typename T>
+        struct journal_rec {
+            std::atomic<uint32_t> state;
+            uint32_t              checksum;
+            T                     data;
+        };
+    }
+
+    template <
+        typename T,
+        typename ExtraHeaderData = detail::empty_data>
+    class persist_journal {
+    public:
+        using rec_type   = detail::journal_rec<T>;
+        using array_type = persist_array<rec_type, 1, synch::null_lock,
+                                         ExtraHeaderData>;
+        using header     = typename array_type::header;
+
+        static_assert(std::is_trivially_copyable<T>::value,
+                      "Journal records must be trivially copyable");
+        static_assert(std::atomic<uint32_t>::is_always_lock_free,
+                      "Lock-free atomics are required in shared memory");
+
+        /// Open the journal for writing, creating the file if needed, and
+        /// skip the torn records (see recover())
+        /// @return true if the journal file didn't exist and was created
+        bool init(const char* a_filename, size_t a_max_recs,
+                  int a_mode = array_type::default_file_mode()) {
+            return init(a_filename, a_max_recs, persist_map_opts(), a_mode);
+        }
+
+        /// Open the journal for writing with given mapping options (e.g.
+        /// to let it grow beyond \a a_max_recs records)
+        bool init(const char* a_filename, size_t a_max_recs,
+                  const persist_map_opts& a_opts,
+                  int a_mode = array_type::default_file_mode());
+
+        /// Address space reserved by init_read_only() for the mapping of
+        /// the journal by default (64G on 64-bit platforms)
+        static constexpr size_t s_read_reserve =
+            sizeof(void*) >= 8 ? size_t(64) << 30 : 0;
+
+        /// Open an existing journal for reading.  Unless \a a_opts sets
+        /// max_grow_recs, address space for s_read_reserve bytes of records
+        /// is reserved, so that the records added by writers growing the
+        /// file are mapped without moving the mapping (see
+        /// persist_array::refresh()).
+        void init_read_only(const char*             a_filename,
+                            const persist_map_opts& a_opts = {}) {
+            auto opts = a_opts;
+            if (!opts.max_grow_recs)
+                opts.max_grow_recs = s_read_reserve / sizeof(rec_type);
+            m_array.init(a_filename, 0, opts, true);
+        }
+
+        /// Reserve the next record
+        /// @return the record to be initialized and passed to commit() and
+        ///         its id
+        std::pair<T*, size_t> reserve() {
+            size_t n = m_array.allocate_rec();
+            return std::make_pair(&m_array.get(n)->data, n);
+        }
+
+        /// Publish the reserved record to readers
+        /// @return false if recovery in another process has skipped the
+        ///         record in the meantime
+        bool commit(size_t a_id) {
+            rec_type& r = *m_array.get(a_id);
+            r.checksum  = checksum(r.data);
+            auto s      = uint32_t(journal_state::RESERVED);
+            return r.state.compare_exchange_strong(s,
+                        uint32_t(journal_state::COMMITTED),
+                        std::memory_order_release, std::memory_order_relaxed);
+        }
+
+        /// Append a copy of the record
+        /// @return id of the record
+        size_t append(const T& a_rec) {
+            return append_with([&](size_t, T* a_data) { *a_data = a_rec; });
+        }
+
+        /// Append a record initialized by <void(size_t id, T* rec)>
+        /// @return id of the record
+        template <typename InitFun>
+        size_t append_with(const InitFun& a_init) {
+            while (true) {
+                auto p = reserve();
+                a_init(p.second, p.first);
+                if (likely(commit(p.second)))
+                    return p.second;
+            }
+        }
+
+        /// Call \a a_visitor for committed records in order of their ids
+        /// starting with \a a_from, skipping records marked as skipped and
+        /// stopping at the first record not yet committed.
+        /// @param a_visitor functor accepting (size_t id, const T& rec)
+        /// @param a_max     max number of records to visit (0 - all)
+        /// @return id of the next record to read
+        template <class Visitor>
+        size_t read(size_t a_from, const Visitor& a_visitor,
+                    size_t a_max = 0) const;
+
+        /// Mark records reserved but not committed, and committed records
+        /// whose checksum doesn't match, as skipped.  It's safe to call
+        /// while other processes are writing, but records still being
+        /// written by them are skipped and appended again by append().
+        /// @return number of records skipped
+        size_t recover();
+
+        /// Commit state of a record
+        journal_state state(size_t a_id) const {
+            return journal_state(m_array.get(a_id)->state
+                                 .load(std::memory_order_acquire));
+        }
+
+        /// @return committed record or NULL
+        const T* get(size_t a_id) const {
+            auto r = m_array.get(a_id);
+            return r && state(a_id) == journal_state::COMMITTED
+                 ? &r->data : nullptr;
+        }
+
+        /// Number of reserved records (committed or not)
+        size_t count() const { return m_array.mapped_count(); }
+        size_t capacity() const { return m_array.capacity(); }
+
+        /// Flush records to disk
+        bool flush() { return m_array.flush(0, m_array.capacity()); }
+
+        /// Remove journal file from disk
+        void remove() { m_array.remove(); }
+
+        /// Underlying storage
+        const array_type& storage() const { return m_array; }
+        array_type&       storage()       { return m_array; }
+
+        std::string const& storage_name() const {
+            return m_array.storage_name();
+        }
+
+    private:
+        array_type m_array;
+
+        static uint32_t checksum(const T& a_data) {
+            return detail::murmur_hash32(&a_data, sizeof(T), 0x9e3779b9);
+        }
+    };
+
+    //-------------------------------------------------------------------------
+    // Implementation
+    //-------------------------------------------------------------------------
+
+    template <typename T, typename Ext>
+    bool persist_journal<T,Ext>::
+    init(const char* a_filename, size_t a_max_recs,
+         const persist_map_opts& a_opts, int a_mode)
+    {
+        bool created = m_array.init(a_filename, a_max_recs, a_opts, false,
+                                    a_mode);
+        if (!created)
+            recover();
+        return created;
+    }
+
+    template <typename T, typename Ext>
+    template <class Visitor>
+    size_t persist_journal<T,Ext>::
+    read(size_t a_from, const Visitor& a_visitor, size_t a_max) const
+    {
+        size_t end = count();
+        if (a_max && a_from + a_max < end)
+            end = a_from + a_max;
+
+        size_t i = a_from;
+        for (; i < end; ++i) {
+            auto& r = *m_array.get(i);
+            auto  s = journal_state(r.state.load(std::memory_order_acquire));
+            if (s == journal_state::COMMITTED)
+                a_visitor(i, r.data);
+            else if (s == journal_state::RESERVED)
+                break;
+        }
+        return i;
+    }
+
+    template <typename T, typename Ext>
+    size_t persist_journal<T,Ext>::
+    recover()
+    {
+        size_t n = 0;
+        for (size_t i = 0, e = count(); i < e; ++i) {
+            auto& r = *m_array.get(i);
+            auto  s = r.state.load(std::memory_order_acquire);
+
+            if (s == uint32_t(journal_state::COMMITTED)) {
+                if (r.checksum == checksum(r.data))
+                    continue;
+                r.state.store(uint32_t(journal_state::SKIPPED),
+                              std::memory_order_release);
+                ++n;
+            } else if (s != uint32_t(journal_state::SKIPPED)) {
+                // Unless the writer commits it concurrently
+                if (r.state.compare_exchange_strong(s,
+                        uint32_t(journal_state::SKIPPED),
+                        std::memory_order_release, std::memory_order_relaxed))
+                    ++n;
+            }
+        }
+        return n;
+    }
+
+} // namespace utxx
@@ -497,10 +497,10 @@ public:
         if (m_pos + n <= m_end) return;
         auto sz = max_size() + n + N;
         char* p = Alloc::allocate(sz);
-        strncpy(p, m_begin, size());
+        memcpy(p, m_begin, size());
         m_pos   = p + size();
+        deallocate();
         m_end   = p + sz;
-        if (m_begin != m_data)  delete [] m_begin;
         m_begin = p;
     }
 
@@ -0,0 +1,599 @@
+// vim:ts=4:et:sw=4
+//----------------------------------------------------------------------------
+/// \file   sharded_atomic_hash_map.hpp
+/// \author Serge Aleynikov
+//----------------------------------------------------------------------------
+/// \brief Concurrent hash map with integer keys, which grows online and
+/// reclaims the cells of erased entries.
+///
+/// Unlike atomic_hash_map, whose capacity is fixed at construction (beyond
+/// the chain of ~18 sub-maps) and whose erased cells are never reused, this
+/// map is split into shards, each of which is an open-addressing table that
+/// is replaced by a new one when it becomes too full.  The size of the new
+/// table depends on the number of live entries, so the same step grows the
+/// shard when it holds many entries, and compacts the tombstones of erased
+/// entries when it doesn't.  Live entries are moved to the new table
+/// incrementally, a chunk of cells by every insert/erase of the shard.
+///
+/// Readers (find(), exists()) never block and don't write to the tables: they
+/// look the key up in the shard's current table and, while a migration is in
+/// progress, in the previous one.  Writers of a shard are serialized by a
+/// light mutex.  Old tables are freed by writers after all readers that could
+/// have seen them are gone (each shard counts its readers in two counters
+/// selected by the parity of an epoch, which is advanced when tables are
+/// retired).
+///
+/// Values are copied to the new tables, and returned by find() by copy.
+//----------------------------------------------------------------------------
+// Created: 2026-10-16
+//----------------------------------------------------------------------------
+/*
+ ***** BEGIN LICENSE BLOCK *****
+
+ This file is part of the utxx open-source project.
+
+ Copyright (C) 2026 Serge Aleynikov <saleyn@gmail.com>
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public
+ License as published by the Free Software Foundation; either
+ version 2.1 of the License, or (at your option) any later version.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+ ***** END LICENSE BLOCK *****
+*/
+#pragma once
+
+#include <utxx/config.h>
+#include <utxx/math.hpp>
+#include <utxx/error.hpp>
+#include <utxx/futex.hpp>
+#include <utxx/compiler_hints.hpp>
+#include <boost/noncopyable.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace utxx {
+
+template <class KeyT,
+          class ValueT,
+          class HashFcn   = std::hash<KeyT>,
+          class EqualFcn  = std::equal_to<KeyT>,
+          class Allocator = std::allocator<char>>
+class sharded_atomic_hash_map : private boost::noncopyable
+{
+    static_assert((std::is_convertible<KeyT, int32_t>::value ||
+                   std::is_convertible<KeyT, int64_t>::value ||
+                   std::is_convertible<KeyT, const void*>::value),
+                 "You are trying to use sharded_atomic_hash_map with "
+                 "disallowed key types.  You must use atomically "
+                 "compare-and-swappable integer keys, or a different "
+                 "container class.");
+public:
+    typedef KeyT                key_type;
+    typedef ValueT              mapped_type;
+    typedef HashFcn             hasher;
+    typedef EqualFcn            key_equal;
+    typedef std::size_t         size_type;
+    typedef typename std::allocator_traits<Allocator>::
+        template rebind_alloc<char> char_alloc;
+
+    struct config {
+        KeyT     m_empty_key;
+        KeyT     m_erased_key;
+        HashFcn  m_hash_fun;
+        EqualFcn m_eq_fun;
+        double   m_max_load_factor; // Cells (live + erased) triggering growth
+        uint32_t m_shards;          // Number of shards (rounded up to 2^N)
+        uint32_t m_migrate_chunk;   // Cells migrated by every write operation
+
+        config()
+            : m_empty_key      (KeyT(-1))
+            , m_erased_key     (KeyT(-3))
+            , m_max_load_factor(0.8)
+            , m_shards         (16)
+            , m_migrate_chunk  (64)
+        {}
+    };
+
+    /// Create a map for about \a a_size_hint entries, which is also the
+    /// minimal capacity the map shrinks to when compacting erased entries.
+    explicit sharded_atomic_hash_map(size_t            a_size_hint,
+                                     const config&     a_cfg   = config(),
+                                     const char_alloc& a_alloc = char_alloc())
+        : m_cfg       (a_cfg)
+        , m_alloc     (a_alloc)
+        , m_migrations(0)
+    {
+        if (a_cfg.m_max_load_factor <= 0.0 || a_cfg.m_max_load_factor >= 1.0)
+            UTXX_THROW_BADARG_ERROR("Invalid max load factor: ",
+                                    a_cfg.m_max_load_factor);
+        if (a_cfg.m_shards == 0 || a_cfg.m_shards > (1u << 16))
+            UTXX_THROW_BADARG_ERROR("Invalid number of shards: ",
+                                    a_cfg.m_shards);
+        if (m_cfg.m_eq_fun(a_cfg.m_empty_key, a_cfg.m_erased_key))
+            UTXX_THROW_BADARG_ERROR("Empty and erased keys must differ");
+
+        m_cfg.m_shards        = math::upper_power(a_cfg.m_shards, 2);
+        m_cfg.m_migrate_chunk = std::max(1u, a_cfg.m_migrate_chunk);
+        m_shard_shift         = 64 - math::log2(m_cfg.m_shards);
+        m_min_capacity        = table_capacity(a_size_hint / m_cfg.m_shards);
+        m_shards.reset(new shard[m_cfg.m_shards]);
+
+        for (uint32_t i = 0; i < m_cfg.m_shards; ++i)
+            m_shards[i].m_table.store(create(m_min_capacity),
+                                      std::memory_order_relaxed);
+    }
+
+    ~sharded_atomic_hash_map()
+    {
+        for (uint32_t i = 0; i < m_cfg.m_shards; ++i)
+            destroy(m_shards[i]);
+    }
+
+    //-----------------------------------------------------------------------//
+    // Lookup (lock-free)                                                    //
+    //-----------------------------------------------------------------------//
+    /// Copy the value of the \a a_key to \a a_value.
+    /// @return false if the key is not found
+    bool find(const KeyT& a_key, ValueT& a_value) const
+    {
+        return lookup(a_key, &a_value);
+    }
+
+    bool exists(const KeyT& a_key) const { return lookup(a_key, nullptr); }
+
+    //-----------------------------------------------------------------------//
+    // Modification (serialized per shard)                                   //
+    //-----------------------------------------------------------------------//
+    /// Insert a new entry.
+    /// @return false if the \a a_key already exists
+    bool insert(const KeyT& a_key, const ValueT& a_value)
+    {
+        return emplace(a_key, a_value);
+    }
+
+    bool insert(const KeyT& a_key, ValueT&& a_value)
+    {
+        return emplace(a_key, std::move(a_value));
+    }
+
+    template <class... Args>
+    bool emplace(const KeyT& a_key, Args&&... a_args)
+    {
+        check_key(a_key);
+        auto   h = hash(a_key);
+        shard& s = shard_of(h);
+        light_mutex::scoped_lock guard(s.m_lock);
+
+        table* t = s.m_table.load(std::memory_order_relaxed);
+        table* p = t->m_prev.load(std::memory_order_relaxed);
+
+        if (t->find(a_key, h, m_cfg) || (p && p->find(a_key, h, m_cfg)))
+            return false;
+
+        if (t->m_used + (p ? s.m_live.load(std::memory_order_relaxed) : 0)
+            >= t->m_max_used) {
+            if (p) {
+                finish_migration(s);
+                p = nullptr;
+            }
+            if (t->m_used >= t->m_max_used)
+                t = start_migration(s);
+        }
+
+        t->add(a_key, h, m_cfg, std::forward<Args>(a_args)...);
+        s.m_live.store(s.m_live.load(std::memory_order_relaxed) + 1,
+                       std::memory_order_relaxed);
+
+        if (p)
+            migrate(s, m_cfg.m_migrate_chunk);
+        reclaim(s);
+        return true;
+    }
+
+    /// Erase the \a a_key.
+    /// @return the number of erased entries (0 or 1)
+    size_t erase(const KeyT& a_key)
+    {
+        check_key(a_key);
+        auto   h = hash(a_key);
+        shard& s = shard_of(h);
+        light_mutex::scoped_lock guard(s.m_lock);
+
+        table* t = s.m_table.load(std::memory_order_relaxed);
+        table* p = t->m_prev.load(std::memory_order_relaxed);
+
+        // The key may be in both tables if it was already migrated
+        bool found = t->remove(a_key, h, m_cfg);
+        if (p)
+            found = p->remove(a_key, h, m_cfg) || found;
+
+        if (found)
+            s.m_live.store(s.m_live.load(std::memory_order_relaxed) - 1,
+                           std::memory_order_relaxed);
+        if (p)
+            migrate(s, m_cfg.m_migrate_chunk);
+        reclaim(s);
+        return found;
+    }
+
+    /// Remove all entries and shrink the map to its initial capacity.
+    /// Not thread-safe.
+    void clear()
+    {
+        for (uint32_t i = 0; i < m_cfg.m_shards; ++i) {
+            auto& s = m_shards[i];
+            destroy(s);
+            s.m_live.store(0, std::memory_order_relaxed);
+            s.m_table.store(create(m_min_capacity), std::memory_order_relaxed);
+        }
+    }
+
+    //-----------------------------------------------------------------------//
+    // Status                                                                //
+    //-----------------------------------------------------------------------//
+    /// Number of entries in the map (approximate when modified concurrently)
+    size_t size() const
+    {
+        size_t n = 0;
+        for (uint32_t i = 0; i < m_cfg.m_shards; ++i)
+            n += m_shards[i].m_live.load(std::memory_order_relaxed);
+        return n;
+    }
+
+    bool empty() const { return size() == 0; }
+
+    /// Total number of cells of the current tables of all shards
+    size_t capacity() const
+    {
+        size_t n = 0;
+        for (uint32_t i = 0; i < m_cfg.m_shards; ++i)
+            n += m_shards[i].m_table.load(std::memory_order_acquire)
+                            ->m_capacity;
+        return n;
+    }
+
+    /// Number of table migrations (growths or compactions) since creation
+    size_t migrations() const
+    {
+        return m_migrations.load(std::memory_order_relaxed);
+    }
+
+    uint32_t      shards() const { return m_cfg.m_shards; }
+    const config& cfg()    const { return m_cfg;          }
+
+private:
+    //-----------------------------------------------------------------------//
+    // Cell: a key and the storage of its value                              //
+    //-----------------------------------------------------------------------//
+    // The value is constructed before the key is published, and is destroyed
+    // together with the table, as readers may copy it after the key is erased
+    struct cell
+    {
+        typedef typename std::aligned_storage
+            <sizeof(ValueT), alignof(ValueT)>::type storage;
+
+        std::atomic<KeyT> m_key;
+        storage           m_data;
+
+        ValueT*       value()
+            { return reinterpret_cast<ValueT*>(&m_data); }
+        ValueT const* value() const
+            { return reinterpret_cast<ValueT const*>(&m_data); }
+    };
+
+    //-----------------------------------------------------------------------//
+    // Table: open addressing with linear probing over 2^N cells             //
+    //-----------------------------------------------------------------------//
+    struct table
+    {
+        size_t              m_capacity;
+        size_t              m_mask;
+        size_t              m_max_used;     // m_used triggering a migration
+        size_t              m_used;         // Cells with live or erased keys
+        std::atomic<table*> m_prev;         // Table being migrated from
+        table*              m_next;         // Next in the list of retired ones
+        cell                m_cells[0];
+
+        cell const* lookup(const KeyT& a_key, size_t a_hash,
+                           const config& a_cfg) const
+        {
+            for (size_t i = a_hash & m_mask, n = 0; n < m_capacity;
+                 i = (i+1) & m_mask, ++n) {
+                auto& c = m_cells[i];
+                KeyT  k = c.m_key.load(std::memory_order_acquire);
+                if (a_cfg.m_eq_fun(k, a_key))
+                    return &c;
+                if (a_cfg.m_eq_fun(k, a_cfg.m_empty_key))
+                    break;
+            }
+            return nullptr;
+        }
+
+        bool find(const KeyT& a_key, size_t a_hash, const config& a_cfg) const
+        {
+            return lookup(a_key, a_hash, a_cfg) != nullptr;
+        }
+
+        // Called by the writer holding the shard's lock for an absent key.
+        // Erased cells are not reused, since a reader may be copying the
+        // value of the erased key.
+        template <class... Args>
+        void add(const KeyT& a_key, size_t a_hash, const config& a_cfg,
+                 Args&&... a_args)
+        {
+            for (size_t i = a_hash & m_mask; ; i = (i+1) & m_mask) {
+                auto& c = m_cells[i];
+                if (!a_cfg.m_eq_fun(c.m_key.load(std::memory_order_relaxed),
+                                    a_cfg.m_empty_key))
+                    continue;
+                new (c.value()) ValueT(std::forward<Args>(a_args)...);
+                c.m_key.store(a_key, std::memory_order_release);
+                ++m_used;
+                return;
+            }
+        }
+
+        bool remove(const KeyT& a_key, size_t a_hash, const config& a_cfg)
+        {
+            auto c = const_cast<cell*>(lookup(a_key, a_hash, a_cfg));
+            if (!c)
+                return false;
+            c->m_key.store(a_cfg.m_erased_key, std::memory_order_release);
+            return true;
+        }
+    };
+
+    //-----------------------------------------------------------------------//
+    // Shard: current table and the state of its migration and reclamation   //
+    //-----------------------------------------------------------------------//
+    struct alignas(UTXX_CL_SIZE) shard
+    {
+        // Read by readers
+        std::atomic<table*>   m_table     {nullptr};
+        std::atomic<uint32_t> m_epoch     {0};
+        // Written by readers
+        alignas(UTXX_CL_SIZE)
+        std::atomic<int64_t>  m_readers[2]{{0}, {0}};
+        // Writers' state
+        alignas(UTXX_CL_SIZE)
+        light_mutex           m_lock;
+        std::atomic<size_t>   m_live      {0};
+        size_t                m_migrated  {0};        // Next cell of m_prev
+        table*                m_retired   {nullptr};  // Retired since flip
+        table*                m_draining  {nullptr};  // Awaiting readers
+        uint32_t              m_parity    {0};        // Of draining readers
+    };
+
+    // Reader's registration in the shard's reader counter of the current
+    // epoch.  The epoch is re-checked after incrementing the counter, so that
+    // the counter of the previous epoch, once observed to drop to 0 after the
+    // epoch was advanced, is never incremented by a reader seeing the tables
+    // retired after that.
+    class read_guard
+    {
+        std::atomic<int64_t>* m_counter;
+    public:
+        explicit read_guard(shard& a_shard)
+        {
+            while (true) {
+                auto e    = a_shard.m_epoch.load(std::memory_order_seq_cst);
+                m_counter = &a_shard.m_readers[e & 1];
+                m_counter->fetch_add(1, std::memory_order_seq_cst);
+                if (likely(a_shard.m_epoch.load(std::memory_order_seq_cst)
+                           == e))
+                    break;
+                m_counter->fetch_sub(1, std::memory_order_release);
+            }
+        }
+        ~read_guard() { m_counter->fetch_sub(1, std::memory_order_release); }
+    };
+
+    config                   m_cfg;
+    char_alloc               m_alloc;
+    std::unique_ptr<shard[]> m_shards;
+    uint32_t                 m_shard_shift;
+    size_t                   m_min_capacity;
+    std::atomic<size_t>      m_migrations;
+
+    void check_key(const KeyT& a_key) const
+    {
+        if (unlikely(m_cfg.m_eq_fun(a_key, m_cfg.m_empty_key) ||
+                     m_cfg.m_eq_fun(a_key, m_cfg.m_erased_key)))
+            UTXX_THROW_BADARG_ERROR("Reserved key value");
+    }
+
+    // The 64-bit finalizer of MurmurHash3: std::hash of integers is the
+    // identity, while the shard is selected by the high bits of the hash, and
+    // the cell by the low ones.
+    size_t hash(const KeyT& a_key) const
+    {
+        uint64_t h = m_cfg.m_hash_fun(a_key);
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ULL;
+        h ^= h >> 33;
+        return h;
+    }
+
+    shard& shard_of(size_t a_hash) const
+    {
+        return m_shards[m_shard_shift == 64 ? 0 : a_hash >> m_shard_shift];
+    }
+
+    size_t table_capacity(size_t a_entries) const
+    {
+        auto n = size_t(double(a_entries) / m_cfg.m_max_load_factor) + 1;
+        return math::upper_power(std::max<size_t>(n, 8), 2);
+    }
+
+    bool lookup(const KeyT& a_key, ValueT* a_value) const
+    {
+        if (unlikely(m_cfg.m_eq_fun(a_key, m_cfg.m_empty_key) ||
+                     m_cfg.m_eq_fun(a_key, m_cfg.m_erased_key)))
+            return false;
+
+        auto   h = hash(a_key);
+        shard& s = shard_of(h);
+        read_guard guard(s);
+
+        // The previous table is loaded before scanning the current one: if
+        // it were loaded after a miss, the key could have been migrated to
+        // the current table behind the scan, and the previous table retired
+        // before the load.  The read guard keeps the previous table alive.
+        table* t = s.m_table.load(std::memory_order_acquire);
+        table* p = t->m_prev.load(std::memory_order_acquire);
+        auto   c = t->lookup(a_key, h, m_cfg);
+        if (!c && (!p || !(c = p->lookup(a_key, h, m_cfg))))
+            return false;
+        if (a_value)
+            *a_value = *c->value();
+        return true;
+    }
+
+    table* create(size_t a_capacity)
+    {
+        auto sz = sizeof(table) + a_capacity * sizeof(cell);
+        auto t  = reinterpret_cast<table*>(m_alloc.allocate(sz));
+        t->m_capacity = a_capacity;
+        t->m_mask     = a_capacity - 1;
+        t->m_max_used = std::min(a_capacity - 1,
+                          size_t(double(a_capacity) * m_cfg.m_max_load_factor));
+        t->m_used     = 0;
+        t->m_next     = nullptr;
+        new (&t->m_prev) std::atomic<table*>(nullptr);
+        for (size_t i = 0; i < a_capacity; ++i)
+            new (&t->m_cells[i].m_key) std::atomic<KeyT>(m_cfg.m_empty_key);
+        return t;
+    }
+
+    void free(table* a_table)
+    {
+        if (!std::is_trivially_destructible<ValueT>::value)
+            for (size_t i = 0; i < a_table->m_capacity; ++i) {
+                auto& c = a_table->m_cells[i];
+                if (!m_cfg.m_eq_fun(c.m_key.load(std::memory_order_relaxed),
+                                    m_cfg.m_empty_key))
+                    c.value()->~ValueT();
+            }
+        m_alloc.deallocate(reinterpret_cast<char*>(a_table),
+                           sizeof(table) + a_table->m_capacity * sizeof(cell));
+    }
+
+    void free_list(table* a_list)
+    {
+        while (a_list) {
+            auto next = a_list->m_next;
+            free(a_list);
+            a_list = next;
+        }
+    }
+
+    void destroy(shard& a_shard)
+    {
+        auto t = a_shard.m_table.load(std::memory_order_relaxed);
+        if (auto p = t->m_prev.load(std::memory_order_relaxed))
+            free(p);
+        free(t);
+        free_list(a_shard.m_retired);
+        free_list(a_shard.m_draining);
+        a_shard.m_retired  = nullptr;
+        a_shard.m_draining = nullptr;
+        a_shard.m_migrated = 0;
+    }
+
+    // Replace the current table (which has no migration in progress) with a
+    // table sized for twice the number of live entries.  Depending on the
+    // number of erased cells this grows the shard, or compacts it.
+    table* start_migration(shard& a_shard)
+    {
+        auto t    = a_shard.m_table.load(std::memory_order_relaxed);
+        auto live = a_shard.m_live.load(std::memory_order_relaxed);
+        auto cap  = std::max(m_min_capacity, table_capacity(2 * (live + 1)));
+        auto n    = create(cap);
+        n->m_prev.store(t, std::memory_order_relaxed);
+        a_shard.m_migrated = 0;
+        a_shard.m_table.store(n, std::memory_order_release);
+        m_migrations.fetch_add(1, std::memory_order_relaxed);
+        return n;
+    }
+
+    // Copy live entries from up to a_cells cells of the previous table
+    void migrate(shard& a_shard, size_t a_cells)
+    {
+        auto t = a_shard.m_table.load(std::memory_order_relaxed);
+        auto p = t->m_prev.load(std::memory_order_relaxed);
+        auto e = std::min(p->m_capacity, a_shard.m_migrated + a_cells);
+
+        for (auto i = a_shard.m_migrated; i < e; ++i) {
+            auto& c = p->m_cells[i];
+            KeyT  k = c.m_key.load(std::memory_order_relaxed);
+            if (m_cfg.m_eq_fun(k, m_cfg.m_empty_key) ||
+                m_cfg.m_eq_fun(k, m_cfg.m_erased_key))
+                continue;
+            t->add(k, hash(k), m_cfg, *c.value());
+        }
+        a_shard.m_migrated = e;
+
+        if (e < p->m_capacity)
+            return;
+
+        // Readers that don't see the previous table anymore can't get to it
+        t->m_prev.store(nullptr, std::memory_order_seq_cst);
+        p->m_next         = a_shard.m_retired;
+        a_shard.m_retired = p;
+    }
+
+    void finish_migration(shard& a_shard)
+    {
+        migrate(a_shard, size_t(-1));
+    }
+
+    // Free the retired tables once no reader can be accessing them: advance
+    // the epoch, so that new readers register in the other counter, and wait
+    // (at subsequent write operations) for the old epoch's counter to drop
+    // to zero.
+    void reclaim(shard& a_shard)
+    {
+        if (a_shard.m_draining) {
+            if (a_shard.m_readers[a_shard.m_parity]
+                       .load(std::memory_order_seq_cst) != 0)
+                return;
+            free_list(a_shard.m_draining);
+            a_shard.m_draining = nullptr;
+        }
+        if (!a_shard.m_retired)
+            return;
+
+        auto e = a_shard.m_epoch.load(std::memory_order_relaxed);
+        a_shard.m_draining = a_shard.m_retired;
+        a_shard.m_retired  = nullptr;
+        a_shard.m_parity   = e & 1;
+        a_shard.m_epoch.store(e + 1, std::memory_order_seq_cst);
+
+        if (a_shard.m_readers[a_shard.m_parity]
+                   .load(std::memory_order_seq_cst) == 0) {
+            free_list(a_shard.m_draining);
+            a_shard.m_draining = nullptr;
+        }
+    }
+};
+
+} // namespace utxx
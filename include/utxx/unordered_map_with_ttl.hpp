@@ -11,6 +11,12 @@
 ///
 /// For performance reasons it's desirable to call the `refresh()` method
 /// every time the caller is idle.
+///
+/// compact_map_with_ttl is a version of the map for large caches (e.g. for
+/// deduplication of millions of sequence numbers), which stores the items in
+/// one preallocated arena: a ring of items in the order of their addition and
+/// an open-addressing index of the ring, without allocations per item.  It
+/// can also have a fixed capacity, evicting the oldest items when full.
 //----------------------------------------------------------------------------
 // Copyright (c) 2016 Serge Aleynikov <saleyn@gmail.com>
 // Created: 2023-04-14
@@ -40,11 +46,16 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 */
 #pragma once
 
+#include <utxx/error.hpp>
+#include <utxx/math.hpp>
+#include <utxx/compiler_hints.hpp>
 #include <type_traits>
+#include <functional>
 #include <memory>
 #include <unordered_map>
 #include <list>
 #include <cassert>
+#include <cstdint>
 
 namespace utxx {
     namespace {
@@ -204,4 +215,349 @@ namespace utxx {
     }
 
 
+    //--------------------------------------------------------------------------
+    /// Map with TTL for each key stored in a preallocated arena
+    /// @tparam K        key type
+    /// @tparam T        value type
+    /// @tparam Alloc    custom allocator of the arena
+    ///
+    /// The items are appended to a ring in the order of their addition, so
+    /// that the expired items are always at the head of the ring, and
+    /// refresh() evicts each of them in O(1).  The keys are found by an
+    /// open-addressing (linear probing) index of ring positions, whose load
+    /// factor is at most 1/2, and whose entries are removed without leaving
+    /// tombstones.  Erased and updated items leave a dead entry in the ring
+    /// until it reaches the head.
+    ///
+    /// When the ring is full, the map either doubles the arena (moving the
+    /// live items), or, in the fixed-capacity mode, evicts the oldest item.
+    //--------------------------------------------------------------------------
+    template <
+        class K,
+        class T,
+        class Hash      = std::hash<K>,
+        class KeyEqual  = std::equal_to<K>,
+        class ValUpdate = val_assigner<T>,
+        class Allocator = std::allocator<char>
+    >
+    class compact_map_with_ttl {
+        struct entry {
+            K           key;
+            val_node<T> node;
+            uint64_t    added;      // Time of addition to the ring
+            uint32_t    hash;
+            bool        live;
+        };
+
+        using storage    = typename std::aligned_storage<sizeof(entry),
+                                                        alignof(entry)>::type;
+        using char_alloc = typename std::allocator_traits<Allocator>::
+                           template rebind_alloc<char>;
+    public:
+        /// @param ttl      time to live of the items
+        /// @param capacity initial capacity of the ring (rounded up to 2^N)
+        /// @param fixed    when true, the oldest item is evicted when the
+        ///                 ring is full, otherwise the ring grows
+        compact_map_with_ttl(
+            uint64_t         ttl,
+            size_t           capacity,
+            bool             fixed = false,
+            const Hash&      hash  = Hash(),
+            const KeyEqual&  equal = KeyEqual(),
+            const Allocator& alloc = Allocator()
+        )
+            : m_ttl(ttl), m_fixed(fixed), m_hash(hash), m_equal(equal)
+            , m_alloc(alloc)
+        {
+            if (capacity == 0 || capacity > (1u << 30))
+                UTXX_THROW_BADARG_ERROR("Invalid capacity: ", capacity);
+            allocate(math::upper_power(std::max<size_t>(capacity, 8), 2));
+        }
+
+        compact_map_with_ttl(const compact_map_with_ttl&) = delete;
+        compact_map_with_ttl& operator=(const compact_map_with_ttl&) = delete;
+
+        ~compact_map_with_ttl() { clear(); deallocate(); }
+
+        /// @brief Try to add a given key/value to the map.
+        /// @return true if the value was added
+        bool try_add(const K& key, T&& value, uint64_t now);
+
+        /// @brief Evict expired key/value pairs
+        /// @param now - current timestamp
+        /// @return the number of evicted items
+        size_t refresh(uint64_t now);
+
+        /// @brief Find the value of the given key
+        /// @return nullptr if the key is not found
+        val_node<T>* find(const K& k)
+        {
+            auto i = index_find(k, hash_of(k));
+            return i == s_npos ? nullptr : &at(m_index[i]-1).node;
+        }
+
+        const val_node<T>* find(const K& k) const
+        {
+            return const_cast<compact_map_with_ttl*>(this)->find(k);
+        }
+
+        /// @brief Erase the given key from the map
+        /// @return true when the key was evicted
+        bool erase(const K& k);
+
+        /// @brief Clear the map
+        void clear();
+
+        /// @brief Call \a f(key, val_node) for all items in the order of
+        ///        their addition
+        template <class Visitor>
+        void for_each(Visitor&& f)
+        {
+            for (auto pos = m_head; pos != m_tail; ++pos) {
+                auto& e = at(pos & m_mask);
+                if (e.live)
+                    f(const_cast<const K&>(e.key), e.node);
+            }
+        }
+
+        size_t   size()     const { return m_size;     }
+        bool     empty()    const { return !m_size;    }
+        /// Number of items the ring can hold without growing/evicting
+        size_t   capacity() const { return m_mask + 1; }
+        bool     fixed()    const { return m_fixed;    }
+        /// Number of items evicted before expiration by the fixed-capacity map
+        uint64_t evicted()  const { return m_evicted;  }
+
+    private:
+        static constexpr size_t s_npos = size_t(-1);
+
+        uint64_t   m_ttl;
+        bool       m_fixed;
+        Hash       m_hash;
+        KeyEqual   m_equal;
+        ValUpdate  m_assign;
+        char_alloc m_alloc;
+        char*      m_arena   = nullptr;
+        storage*   m_ring    = nullptr; // Items in the order of addition
+        uint32_t*  m_index   = nullptr; // Ring positions + 1 (0 - empty)
+        size_t     m_mask    = 0;       // Ring capacity - 1
+        size_t     m_imask   = 0;       // Index capacity - 1
+        uint64_t   m_head    = 0;       // Position of the oldest entry
+        uint64_t   m_tail    = 0;       // Position of the next entry
+        size_t     m_size    = 0;
+        uint64_t   m_evicted = 0;
+
+        entry& at(size_t i) const
+        {
+            return *reinterpret_cast<entry*>(m_ring + i);
+        }
+
+        // Fibonacci hashing spreads identity hashes of integer keys
+        uint32_t hash_of(const K& k) const
+        {
+            return uint32_t(uint64_t(m_hash(k)) * 0x9E3779B97F4A7C15ull >> 32);
+        }
+
+        static size_t arena_size(size_t cap)
+        {
+            return cap * sizeof(storage) + 2 * cap * sizeof(uint32_t);
+        }
+
+        void allocate(size_t cap)
+        {
+            m_arena = m_alloc.allocate(arena_size(cap));
+            m_ring  = reinterpret_cast<storage*>(m_arena);
+            m_index = reinterpret_cast<uint32_t*>(m_ring + cap);
+            m_mask  = cap - 1;
+            m_imask = 2 * cap - 1;
+            memset(m_index, 0, 2 * cap * sizeof(uint32_t));
+        }
+
+        void deallocate()
+        {
+            m_alloc.deallocate(m_arena, arena_size(m_mask + 1));
+            m_arena = nullptr;
+        }
+
+        size_t index_find(const K& k, uint32_t h) const
+        {
+            for (size_t i = h & m_imask; m_index[i]; i = (i+1) & m_imask) {
+                auto& e = at(m_index[i]-1);
+                if (e.hash == h && m_equal(e.key, k))
+                    return i;
+            }
+            return s_npos;
+        }
+
+        void index_insert(size_t a_ring_idx, uint32_t h)
+        {
+            auto i = h & m_imask;
+            while (m_index[i])
+                i = (i+1) & m_imask;
+            m_index[i] = uint32_t(a_ring_idx + 1);
+        }
+
+        // Remove index entry i, shifting back the following entries of the
+        // probe run that can move closer to their home position
+        void index_remove(size_t i)
+        {
+            for (size_t j = (i+1) & m_imask; m_index[j]; j = (j+1) & m_imask) {
+                auto home = at(m_index[j]-1).hash & m_imask;
+                // Keep the entry j if its home is cyclically in (i, j]
+                if (i <= j ? (i < home && home <= j) : (i < home || home <= j))
+                    continue;
+                m_index[i] = m_index[j];
+                i = j;
+            }
+            m_index[i] = 0;
+        }
+
+        // Remove the live entry at ring index r from the map
+        void kill(size_t r)
+        {
+            auto& e = at(r);
+            auto  i = e.hash & m_imask;
+            while (m_index[i] != r + 1)
+                i = (i+1) & m_imask;
+            index_remove(i);
+            // The dead entry stays in the ring until it's dropped from the
+            // head, so only the key and the value are destroyed, and the
+            // flag remains readable
+            e.key.~K();
+            e.node.~val_node<T>();
+            e.live = false;
+            --m_size;
+        }
+
+        // Make room for one entry at the tail of the ring
+        void make_room();
+    };
+
+    //--------------------------------------------------------------------------
+    // IMPLEMENTATION
+    //--------------------------------------------------------------------------
+
+    template <class K, class T, class Hash, class KeyEq, class ValUpdate, class Allocator>
+    size_t compact_map_with_ttl<K,T,Hash,KeyEq,ValUpdate,Allocator>
+    ::refresh(uint64_t now)
+    {
+        if (now <= m_ttl)
+            return 0;
+
+        size_t res = 0;
+        auto   ttl = now - m_ttl;
+
+        for (; m_head != m_tail; ++m_head) {
+            auto r = m_head & m_mask;
+            auto& e = at(r);
+            if (!e.live)
+                continue;
+            if (e.added > ttl)
+                break;
+            kill(r);                // Evict expired entry
+            ++res;
+        }
+
+        return res;
+    }
+
+    template <class K, class T, class Hash, class KeyEq, class ValUpdate, class Allocator>
+    bool compact_map_with_ttl<K,T,Hash,KeyEq,ValUpdate,Allocator>
+    ::try_add(const K& key, T&& value, uint64_t now)
+    {
+        refresh(now);
+
+        auto h = hash_of(key);
+        auto i = index_find(key, h);
+
+        if (i != s_npos) {
+            auto  r = m_index[i] - 1;
+            auto& e = at(r);
+            // maybe_add the existing entry: if it's updated, it's moved to
+            // the tail of the ring
+            if (!m_assign(e.node, std::move(value), now))
+                return false;
+            val_node<T> node(std::move(e.node));
+            kill(r);
+            make_room();
+            auto t = m_tail++ & m_mask;
+            new (m_ring + t) entry{key, std::move(node), now, h, true};
+            index_insert(t, h);
+            ++m_size;
+            return true;
+        }
+
+        make_room();
+        auto t = m_tail++ & m_mask;
+        new (m_ring + t) entry{key, val_node<T>(std::move(value), now), now, h, true};
+        index_insert(t, h);
+        ++m_size;
+        return true;
+    }
+
+    template <class K, class T, class Hash, class KeyEq, class ValUpdate, class Allocator>
+    bool compact_map_with_ttl<K,T,Hash,KeyEq,ValUpdate,Allocator>
+    ::erase(const K& k)
+    {
+        auto i = index_find(k, hash_of(k));
+        if (i == s_npos)
+            return false;
+        kill(m_index[i] - 1);
+        return true;
+    }
+
+    template <class K, class T, class Hash, class KeyEq, class ValUpdate, class Allocator>
+    void compact_map_with_ttl<K,T,Hash,KeyEq,ValUpdate,Allocator>
+    ::clear()
+    {
+        for (; m_head != m_tail; ++m_head) {
+            auto& e = at(m_head & m_mask);
+            if (e.live)
+                e.~entry();
+        }
+        memset(m_index, 0, (m_imask + 1) * sizeof(uint32_t));
+        m_head = m_tail = 0;
+        m_size = 0;
+    }
+
+    template <class K, class T, class Hash, class KeyEq, class ValUpdate, class Allocator>
+    void compact_map_with_ttl<K,T,Hash,KeyEq,ValUpdate,Allocator>
+    ::make_room()
+    {
+        // Dead entries at the head are dropped first
+        while (m_head != m_tail && !at(m_head & m_mask).live)
+            ++m_head;
+
+        if (likely(m_tail - m_head <= m_mask))
+            return;
+
+        if (m_fixed) {
+            kill(m_head++ & m_mask);
+            ++m_evicted;
+            return;
+        }
+
+        // Move the live entries to a new arena, which is doubled unless at
+        // least half of the ring is taken by dead entries
+        auto old_arena = m_arena;
+        auto old_ring  = m_ring;
+        auto old_mask  = m_mask;
+        auto cap       = m_size > m_mask / 2 ? 2 * (m_mask + 1) : m_mask + 1;
+        allocate(cap);
+
+        size_t n = 0;
+        for (auto pos = m_head; pos != m_tail; ++pos) {
+            auto& e = *reinterpret_cast<entry*>(old_ring + (pos & old_mask));
+            if (!e.live)
+                continue;
+            new (m_ring + n) entry(std::move(e));
+            e.~entry();
+            index_insert(n, at(n).hash);
+            ++n;
+        }
+        m_head = 0;
+        m_tail = n;
+        m_alloc.deallocate(old_arena, arena_size(old_mask + 1));
+    }
+
 } // namespace utxx
@@ -37,6 +37,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include <utxx/scope_exit.hpp>
 #include <utxx/signal_block.hpp>
 #include <cassert>
+#include <climits>
 #include <regex>
 #include <sys/types.h>
 #include <sys/socket.h>
@@ -55,12 +56,30 @@ namespace io   {
 
 using namespace std;
 
+namespace {
+  inline long NowNs() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000L + ts.tv_nsec;
+  }
+
+  inline void CpuPause() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield" ::: "memory");
+#endif
+  }
+}
+
 //------------------------------------------------------------------------------
 // Reactor
 //------------------------------------------------------------------------------
 Reactor
 ::~Reactor()
 {
+  m_post_queue.clear();
+
   if (m_own_efd) {
     (void) close(m_epoll_fd);
     m_epoll_fd = -1;
@@ -136,7 +155,10 @@ FdInfo* Reactor
 {
   assert(a_fd >= 0);
 
-  EPollAdd(a_fd, a_name, a_events, std::move(a_src));
+  // With io_uring the requests are issued on the next call to Wait(), when
+  // the handler type of the fd is known
+  if (!m_uring)
+    EPollAdd(a_fd, a_name, a_events, std::move(a_src));
 
   if (a_fd >= int(m_fds.size())) {
     size_t n = a_fd + 64;
@@ -147,9 +169,116 @@ FdInfo* Reactor
                       a_instance,    a_opaque, a_rd_bufsz, a_wr_bufsz, a_wr_buf,
                       a_read_sz_fun, a_trig);
   m_fds[a_fd].reset(p);
+  p->m_events = a_events;
+
+  if (m_uring) {
+    p->m_uring_gen = ++m_uring_gen & s_uring_gen_mask;
+    m_uring_arm.push_back(a_fd);
+  }
+
+  if (m_spin && m_spin_opts.busy_poll_us > 0)
+    SetBusyPoll(*p);
+
   return p;
 }
 
+//------------------------------------------------------------------------------
+void Reactor
+::SetBusyPoll(FdInfo& a_fi)
+{
+  UTXX_PRETTY_FUNCTION(); // Cache pretty function name
+
+  if (a_fi.m_fd_type != FdTypeT::Stream   &&
+      a_fi.m_fd_type != FdTypeT::Datagram &&
+      a_fi.m_fd_type != FdTypeT::SeqPacket)
+    return;
+
+  int us = m_spin ? m_spin_opts.busy_poll_us : 0;
+
+  // Raising the value above net.core.busy_read requires CAP_NET_ADMIN
+  if (setsockopt(a_fi.FD(), SOL_SOCKET, SO_BUSY_POLL, &us, sizeof(us)) < 0)
+    UTXX_RLOG(this, WARNING, "cannot set SO_BUSY_POLL=", us, " on '",
+              a_fi.Name(), "', fd=", a_fi.FD(), ": ", strerror(errno));
+}
+
+//------------------------------------------------------------------------------
+void Reactor
+::SpinMode(bool a_on, SpinOpts const& a_opts)
+{
+  bool busy_poll  = (m_spin && m_spin_opts.busy_poll_us > 0) ||
+                    (a_on   && a_opts.busy_poll_us > 0);
+  m_spin          = a_on;
+  m_spin_opts     = a_opts;
+  m_spin_idle_since = NowNs();
+
+  if (busy_poll)
+    for (auto& p : m_fds)
+      if (p && p->FD() >= 0)
+        SetBusyPoll(*p);
+}
+
+//------------------------------------------------------------------------------
+int Reactor
+::SpinWait(int a_timeout_msec)
+{
+  auto poll = [this](int a_timeout) {
+    return m_uring ? IOUringWait(a_timeout) : EPollWait(a_timeout);
+  };
+
+  auto& st  = m_spin_stats;
+  long  t   = NowNs(); // Start of the current poll
+  long  end = a_timeout_msec < 0 ? LONG_MAX : t + a_timeout_msec * 1000000L;
+
+  while (true) {
+    int  n   = poll(0);
+    long now = NowNs();
+    st.polls++;
+
+    if (n > 0) {
+      st.events        += n;
+      st.work_ns       += now - t;
+      m_spin_idle_since = now;
+      return n;
+    }
+
+    st.empty++;
+
+    if (now >= end) {
+      st.spin_ns += now - t;
+      return 0;
+    }
+
+    auto idle = now - m_spin_idle_since;
+
+    if (idle < long(m_spin_opts.spin_us) * 1000)
+      ;
+    else if (idle < long(m_spin_opts.pause_us) * 1000) {
+      CpuPause();
+      st.pauses++;
+    } else if (idle < long(m_spin_opts.yield_us) * 1000) {
+      sched_yield();
+      st.yields++;
+    } else {
+      // Idle for too long - block for the remaining time
+      st.spin_ns += now - t;
+      st.blocks++;
+      n           = poll(a_timeout_msec < 0 ? -1 : int((end - now + 999999) / 1000000));
+      t           = NowNs();
+      st.block_ns+= t - now;
+      if (n > 0) {
+        st.events        += n;
+        m_spin_idle_since = t;
+      }
+      return n;
+    }
+
+    // Account for the time of the empty poll and the backoff
+    now         = NowNs();
+    st.spin_ns += now - t;
+    t           = now;
+  }
+}
+
 //------------------------------------------------------------------------------
 FdInfo& Reactor
 ::Add
@@ -220,6 +349,43 @@ FdInfo& Reactor
   return *p;
 }
 
+//------------------------------------------------------------------------------
+FdInfo& Reactor
+::AddDgramBatch
+(
+  std::string       const& a_name,
+  int                      a_fd,
+  DgramBatchHandler const& a_on_read,
+  ErrHandler        const& a_on_error,
+  void*                    a_opaque,
+  size_t                   a_max_batch,
+  size_t                   a_pkt_size
+)
+{
+  UTXX_PRETTY_FUNCTION(); // Cache pretty function name
+
+  int       type;
+  socklen_t len = sizeof(type);
+
+  if (UNLIKELY(a_fd < 0))
+    UTXX_THROWX_BADARG_ERROR("invalid fd=", a_fd);
+  if (getsockopt(a_fd, SOL_SOCKET, SO_TYPE, &type, &len) < 0 || type != SOCK_DGRAM)
+    UTXX_THROWX_BADARG_ERROR("fd=", a_fd, " is not a datagram socket");
+
+  std::unique_ptr<DgramRecvRing> ring(new DgramRecvRing(a_max_batch, a_pkt_size));
+
+  UTXX_RLOG(this, TRACE5, "adding DgramBatch handler '", a_name, "', fd=", a_fd,
+     ", MaxBatch=", a_max_batch, ", PktSize=", a_pkt_size, ", Opaque=", a_opaque);
+
+  auto p = Set(a_name, a_fd, FdTypeT::Datagram,
+               EPOLLIN|EPOLLET|EPOLLERR, UTXX_SRCX,
+               a_on_error, nullptr, a_opaque);
+  p->SetHandler(HType::DgramBatch, a_on_read);
+  p->m_dgram_ring.reset(ring.release());
+
+  return *p;
+}
+
 //------------------------------------------------------------------------------
 FdInfo& Reactor
 ::AddFile
@@ -377,6 +543,123 @@ FdInfo& Reactor
   return *p;
 }
 
+//------------------------------------------------------------------------------
+FdInfo& Reactor
+::AddListener
+(
+  std::string   const& a_name,
+  std::string   const& a_address,
+  int                  a_port,
+  AcceptHandler const& a_on_accept,
+  ErrHandler    const& a_on_error,
+  void*                a_opaque,
+  bool                 a_reuse_port,
+  int                  a_backlog
+)
+{
+  UTXX_PRETTY_FUNCTION(); // Cache pretty function name
+
+  struct sockaddr_in address{};
+  address.sin_family      = AF_INET;
+  address.sin_port        = htons(a_port);
+  address.sin_addr.s_addr = htonl(INADDR_ANY);
+
+  if (!a_address.empty() &&
+      inet_pton(AF_INET, a_address.c_str(), &address.sin_addr) != 1)
+    UTXX_THROWX_BADARG_ERROR('[', a_name, "] invalid address: ", a_address);
+
+  int listen_fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+  if (listen_fd < 0)
+    UTXX_THROWX_IO_ERROR(errno, '[', a_name,
+                 "] couldn't create a TCP server socket");
+
+  utxx::scope_exit guard([listen_fd]() { ::close(listen_fd); });
+
+  int on = 1;
+  setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+
+  if (a_reuse_port &&
+      setsockopt(listen_fd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on)) < 0)
+    UTXX_THROWX_IO_ERROR(errno, '[', a_name,
+                 "] couldn't set SO_REUSEPORT on fd=", listen_fd);
+
+  if (bind(listen_fd, (struct sockaddr*)&address, sizeof(address)) < 0)
+    UTXX_THROWX_IO_ERROR(errno, '[', a_name, "] bind of fd=", listen_fd,
+                 " to ", a_address, ':', a_port, " failed");
+
+  if (listen(listen_fd, a_backlog) < 0)
+    UTXX_THROWX_IO_ERROR(errno, '[', a_name,
+                 "] listen on fd=" , listen_fd, " failed");
+
+  uint events = EPOLLIN | EPOLLET | EPOLLERR;
+
+  UTXX_RLOG(this, TRACE5, "adding TCP Listener '", a_name, "' on ",
+      a_address, ':', a_port, ", Events=", EPollEvents(events), ", fd=",
+      listen_fd, ", Opaque=", a_opaque);
+
+  auto p = Set(a_name, listen_fd, FdTypeT::UNDEFINED,
+               events, UTXX_SRCX, a_on_error, nullptr, a_opaque);
+  p->SetHandler(HType::Accept, a_on_accept);
+
+  guard.disable();
+
+  return *p;
+}
+
+//------------------------------------------------------------------------------
+void Reactor
+::EnablePost()
+{
+  if (m_post_fd >= 0)
+    return;
+
+  auto& fi  = AddEvent("post", [this](FdInfo&, long) { RunPosted(); }, nullptr);
+  m_post_fd = fi.FD();
+}
+
+//------------------------------------------------------------------------------
+bool Reactor
+::Post(PostTask&& a_task)
+{
+  UTXX_PRETTY_FUNCTION(); // Cache pretty function name
+
+  if (UNLIKELY(m_post_fd < 0))
+    UTXX_THROWX_RUNTIME_ERROR("posting to a reactor is not enabled");
+
+  if (!m_post_queue.emplace(std::move(a_task)))
+    return false;
+
+  // Only the first task posted after the queue was drained wakes up the
+  // reactor
+  if (!m_post_wake.exchange(true)) {
+    uint64_t v = 1;
+    while (::write(m_post_fd, &v, sizeof(v)) < 0 && errno == EINTR);
+  }
+
+  return true;
+}
+
+//------------------------------------------------------------------------------
+void Reactor
+::RunPosted()
+{
+  UTXX_PRETTY_FUNCTION(); // Cache pretty function name
+
+  // The flag is reset before draining the queue, so that a task posted
+  // after the queue is drained wakes up the reactor
+  m_post_wake.store(false);
+
+  for (auto p = m_post_queue.pop_all(), next = p; p; p = next) {
+    next = p->next();
+    try {
+      p->data()();
+    } catch (std::exception& e) {
+      UTXX_RLOG(this, ERROR, "exception in posted task: ", e.what());
+    }
+    m_post_queue.free(p);
+  }
+}
+
 //------------------------------------------------------------------------------
 FdInfo& Reactor
 ::AddEvent
@@ -449,6 +732,118 @@ FdInfo& Reactor
   return *p;
 }
 
+//------------------------------------------------------------------------------
+uint64_t Reactor
+::TimerTick() const
+{
+  return (NowNs() - m_timers_start) / 1000000;
+}
+
+//------------------------------------------------------------------------------
+void Reactor
+::TimerWheelArm()
+{
+  UTXX_PRETTY_FUNCTION(); // Cache pretty function name
+
+  auto next = m_timers->NextExpiry();
+  if  (next == m_timers_next)
+    return;
+
+  // The timerfd fires once at the next expiration (a zero value disarms it)
+  struct itimerspec timeout{};
+  if (next != ~0ul) {
+    auto ns = m_timers_start + long(next) * 1000000;
+    timeout.it_value = {ns / 1000000000, ns % 1000000000};
+  }
+
+  if (timerfd_settime(m_timers_fd, TFD_TIMER_ABSTIME, &timeout, NULL) < 0)
+    UTXX_THROWX_IO_ERROR(errno, "timerfd_settime");
+
+  m_timers_next = next;
+}
+
+//------------------------------------------------------------------------------
+void Reactor
+::TimerWheelFire(FdInfo& a_fi)
+{
+  UTXX_PRETTY_FUNCTION(); // Cache pretty function name
+
+  m_timers->Advance(TimerTick(), [this, &a_fi](EventHandler const& a_fun, TimerID a_id) {
+    try {
+      a_fun(a_fi, long(a_id));
+    } catch (std::exception& e) {
+      UTXX_RLOG(this, ERROR, "exception in handler of timer ", a_id, ": ", e.what());
+    }
+  });
+
+  // The one-shot timerfd has expired
+  m_timers_next = ~0ul;
+  TimerWheelArm();
+}
+
+//------------------------------------------------------------------------------
+TimerID Reactor
+::ScheduleTimer
+(
+  uint32_t            a_initial_msec,
+  uint32_t            a_interval_msec,
+  EventHandler const& a_on_timer
+)
+{
+  UTXX_PRETTY_FUNCTION(); // Cache pretty function name
+
+  if (UNLIKELY(!a_on_timer))
+    UTXX_THROWX_BADARG_ERROR("undefined timer handler");
+
+  if (!m_timers) {
+    int fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
+    if (fd < 0)
+      UTXX_THROWX_IO_ERROR(errno, "cannot create timer");
+
+    UTXX_RLOG(this, TRACE5, "adding timer wheel, fd=", fd);
+
+    auto p = Set("timer-wheel", fd, FdTypeT::Timer, EPOLLIN|EPOLLET|EPOLLERR,
+                 UTXX_SRCX, nullptr, nullptr, nullptr, 0, 0, nullptr, nullptr,
+                 LEVEL_TRIGGERED);
+    p->SetHandler(HType::Timer,
+                  EventHandler([this](FdInfo& a_fi, long) { TimerWheelFire(a_fi); }));
+
+    m_timers.reset(new TimerWheel());
+    m_timers_fd    = fd;
+    m_timers_start = NowNs();
+  }
+
+  auto now = TimerTick();
+
+  // An empty wheel is fast-forwarded to the current tick
+  if (!m_timers->Size())
+    m_timers->Advance(now, [](EventHandler const&, TimerID) {});
+
+  auto id  = m_timers->Add(now + a_initial_msec, a_interval_msec, a_on_timer);
+
+  TimerWheelArm();
+  return id;
+}
+
+//------------------------------------------------------------------------------
+bool Reactor
+::RescheduleTimer(TimerID a_id, uint32_t a_initial_msec, uint32_t a_interval_msec)
+{
+  if (!m_timers ||
+      !m_timers->Reschedule(a_id, TimerTick() + a_initial_msec, a_interval_msec))
+    return false;
+
+  TimerWheelArm();
+  return true;
+}
+
+//------------------------------------------------------------------------------
+bool Reactor
+::CancelTimer(TimerID a_id)
+{
+  return m_timers && m_timers->Cancel(a_id);
+}
+
 //------------------------------------------------------------------------------
 FdInfo& Reactor
 ::AddSignal
@@ -510,6 +905,8 @@ void Reactor
 
   if (a_clear_fdinfo)
     CloseFD(a_fd);
+  else if (m_uring)
+    m_uring->PrepCancelFD(a_fd, UData(a_fd, URingOp::Cancel, 0));
 
   p->FD(-1);
   p->Clear();
@@ -534,14 +931,36 @@ dynamic_io_buffer* Reactor
   if (UNLIKELY(!info.m_wr_buff))
     UTXX_THROWX_BADARG_ERROR("write buffer not assigned!");
 
+  // The user's interest is kept in m_events, and the write queue's one in
+  // m_wr_armed, so that neither of them turns off the events needed by the
+  // other one
+  if (a_on)
+    info.m_events |=  EPOLLOUT;
+  else
+    info.m_events &= ~EPOLLOUT;
+
+  WriteEvents(info, a_on || info.m_wr_armed);
+  return info.WrBuff();
+}
+
+//------------------------------------------------------------------------------
+void Reactor
+::WriteEvents(FdInfo& a_fi, bool a_on)
+{
+  UTXX_PRETTY_FUNCTION(); // Cache pretty function name
+
+  if (m_uring) {
+    IOUringSubscribeWrite(a_fi, a_on);
+    return;
+  }
+
   auto mask = EPOLLIN | EPOLLET | EPOLLERR | EPOLLRDHUP | (a_on ? EPOLLOUT:0);
 
   epoll_event ev{ .events = mask, .data{0} };
-  ev.data.fd = a_fd;
+  ev.data.fd = a_fi.FD();
 
-  if (epoll_ctl(m_epoll_fd, EPOLL_CTL_MOD, a_fd, &ev) == -1)
-    UTXX_THROWX_IO_ERROR(errno, "failed to modify events on fd=", a_fd);
-  return info.WrBuff();
+  if (epoll_ctl(m_epoll_fd, EPOLL_CTL_MOD, a_fi.FD(), &ev) == -1)
+    UTXX_THROWX_IO_ERROR(errno, "failed to modify events on fd=", a_fi.FD());
 }
 
 } // namespace io
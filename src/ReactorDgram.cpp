@@ -0,0 +1,216 @@
+// vim:ts=2:sw=2:et
+//------------------------------------------------------------------------------
+/// \file  ReactorDgram.cpp
+//------------------------------------------------------------------------------
+/// \brief Batched datagram I/O using recvmmsg(2) and sendmmsg(2)
+//------------------------------------------------------------------------------
+// Copyright (c) 2026 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-16
+//------------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the utxx open-source project.
+
+Copyright (C) 2026 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+#include <utxx/io/ReactorDgram.hpp>
+#include <cstring>
+#include <cerrno>
+
+namespace utxx {
+namespace io   {
+
+//------------------------------------------------------------------------------
+// DgramRecvRing
+//------------------------------------------------------------------------------
+DgramRecvRing::
+DgramRecvRing(size_t a_max_batch, size_t a_pkt_size)
+  : m_pkt_size(a_pkt_size)
+  , m_data    (a_max_batch * a_pkt_size)
+  , m_ctl     (a_max_batch * s_ctl_size)
+  , m_iov     (a_max_batch)
+  , m_hdrs    (a_max_batch)
+  , m_pkts    (a_max_batch, DgramPkt{})
+{
+  if (!a_max_batch || !a_pkt_size)
+    UTXX_THROW_BADARG_ERROR("invalid batch size ", a_max_batch,
+                            " or packet size ", a_pkt_size);
+
+  memset(m_hdrs.data(), 0, m_hdrs.size() * sizeof(mmsghdr));
+
+  for (size_t i=0; i < a_max_batch; ++i) {
+    auto& h          = m_hdrs[i].msg_hdr;
+    m_iov[i].iov_base= &m_data[i * a_pkt_size];
+    m_iov[i].iov_len = a_pkt_size;
+    h.msg_iov        = &m_iov[i];
+    h.msg_iovlen     = 1;
+    // The source address is written by the kernel directly to the packet
+    h.msg_name       = &m_pkts[i].src;
+    h.msg_namelen    = sizeof(sockaddr_in);
+    m_pkts[i].data   = &m_data[i * a_pkt_size];
+  }
+
+  m_last = a_max_batch;
+}
+
+//------------------------------------------------------------------------------
+int DgramRecvRing::
+Recv(int a_fd, bool a_ctl_msgs)
+{
+  // Restore the fields of the headers modified by the kernel on last call
+  if (a_ctl_msgs != m_with_ctl) {
+    m_with_ctl = a_ctl_msgs;
+    m_last     = m_hdrs.size();
+  }
+
+  for (int i=0; i < m_last; ++i) {
+    auto& h          = m_hdrs[i].msg_hdr;
+    h.msg_namelen    = sizeof(sockaddr_in);
+    h.msg_control    = a_ctl_msgs ? &m_ctl[i * s_ctl_size] : nullptr;
+    h.msg_controllen = a_ctl_msgs ? s_ctl_size : 0;
+    h.msg_flags      = 0;
+  }
+
+  int n;
+  do    { n = ::recvmmsg(a_fd, m_hdrs.data(), m_hdrs.size(), MSG_DONTWAIT, nullptr); }
+  while (n < 0 && errno == EINTR);
+
+  if (n <= 0) {
+    m_last = 0;
+    return n < 0 && errno != EAGAIN && errno != EWOULDBLOCK ? -1 : 0;
+  }
+
+  m_last = n;
+
+  for (int i=0; i < n; ++i) {
+    auto& h   = m_hdrs[i].msg_hdr;
+    auto& pkt = m_pkts[i];
+    pkt.len   = m_hdrs[i].msg_len;
+    pkt.flags = h.msg_flags;
+
+    if (!a_ctl_msgs)
+      continue;
+
+    pkt.dst_addr = 0;
+    pkt.if_addr  = 0;
+    pkt.ts_wire.clear();
+
+    for (auto cm = CMSG_FIRSTHDR(&h); cm; cm = CMSG_NXTHDR(&h, cm)) {
+      if (cm->cmsg_level == IPPROTO_IP && cm->cmsg_type == IP_PKTINFO) {
+        auto pi      = reinterpret_cast<const in_pktinfo*>(CMSG_DATA(cm));
+        pkt.if_addr  = pi->ipi_spec_dst.s_addr; // Iface addr
+        pkt.dst_addr = pi->ipi_addr.s_addr;     // Mcast addr
+      } else if (cm->cmsg_level == SOL_SOCKET && cm->cmsg_type == SO_TIMESTAMPNS)
+        pkt.ts_wire  = time_val(*reinterpret_cast<const timespec*>(CMSG_DATA(cm)));
+    }
+  }
+
+  return n;
+}
+
+//------------------------------------------------------------------------------
+// DgramSendBatch
+//------------------------------------------------------------------------------
+DgramSendBatch::
+DgramSendBatch(size_t a_capacity)
+  : m_iov (a_capacity)
+  , m_dst (a_capacity)
+  , m_hdrs(a_capacity)
+{
+  if (!a_capacity)
+    UTXX_THROW_BADARG_ERROR("invalid batch capacity");
+
+  memset(m_hdrs.data(), 0, m_hdrs.size() * sizeof(mmsghdr));
+
+  for (size_t i=0; i < a_capacity; ++i) {
+    m_hdrs[i].msg_hdr.msg_iov    = &m_iov[i];
+    m_hdrs[i].msg_hdr.msg_iovlen = 1;
+  }
+}
+
+//------------------------------------------------------------------------------
+bool DgramSendBatch::
+Add(const void* a_data, size_t a_len, const sockaddr_in* a_dst)
+{
+  if (Full())
+    return false;
+
+  auto& h          = m_hdrs[m_size].msg_hdr;
+  auto& iov        = m_iov [m_size];
+  iov.iov_base     = const_cast<void*>(a_data);
+  iov.iov_len      = a_len;
+
+  if (a_dst) {
+    m_dst[m_size]  = *a_dst;
+    h.msg_name     = &m_dst[m_size];
+    h.msg_namelen  = sizeof(sockaddr_in);
+  } else {
+    h.msg_name     = nullptr;
+    h.msg_namelen  = 0;
+  }
+
+  ++m_size;
+  return true;
+}
+
+//------------------------------------------------------------------------------
+int DgramSendBatch::
+Send(int a_fd, int a_flags)
+{
+  size_t sent = 0;
+  int    err  = 0;
+
+  while (sent < m_size) {
+    int n = ::sendmmsg(a_fd, &m_hdrs[sent], m_size - sent, a_flags);
+    if (n < 0) {
+      if (errno == EINTR)
+        continue;
+      if (errno != EAGAIN && errno != EWOULDBLOCK)
+        err = errno;
+      break;
+    }
+    sent += n;
+  }
+
+  if (sent == m_size) {
+    m_size = 0;
+    return sent;
+  }
+
+  // Move the remaining datagrams to the front of the batch.  This is also
+  // done on error, so that a retry doesn't send the already sent ones twice
+  for (size_t i = sent, j = 0; i < m_size; ++i, ++j) {
+    m_iov[j]                     = m_iov[i];
+    m_dst[j]                     = m_dst[i];
+    m_hdrs[j].msg_hdr.msg_name   = m_hdrs[i].msg_hdr.msg_name ? &m_dst[j] : nullptr;
+    m_hdrs[j].msg_hdr.msg_namelen= m_hdrs[i].msg_hdr.msg_namelen;
+  }
+
+  m_size -= sent;
+
+  if (err) {
+    errno = err;
+    return -1;
+  }
+  return sent;
+}
+
+} // namespace io
+} // namespace utxx
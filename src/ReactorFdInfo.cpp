@@ -37,6 +37,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include <sys/timerfd.h>
 #include <sys/socket.h>
 #include <sys/un.h>
+#include <arpa/inet.h>
 
 namespace utxx {
 namespace io   {
@@ -81,6 +82,13 @@ Reset()
   m_rd_debug      = nullptr;
   m_file_reader.reset();
   m_exec_cmd.reset();
+  m_dgram_ring.reset();
+  m_wr_queue.reset();
+  m_on_watermark  = nullptr;
+  m_low_wm        = 0;
+  m_high_wm       = 0;
+  m_wr_high       = false;
+  m_wr_armed      = false;
   m_with_pkt_info = false;
   m_sock_src_addr = 0;
   m_sock_src_port = 0;
@@ -110,13 +118,22 @@ FdInfo(FdInfo&& a_rhs) noexcept
   , m_wr_buff       (a_rhs.m_wr_buff)
   , m_rd_debug      (std::move(a_rhs.m_rd_debug))
   , m_trigger       (a_rhs.m_trigger)
+  , m_dgram_ring    (std::move(a_rhs.m_dgram_ring))
+  , m_wr_queue      (std::move(a_rhs.m_wr_queue))
+  , m_on_watermark  (std::move(a_rhs.m_on_watermark))
+  , m_low_wm        (a_rhs.m_low_wm)
+  , m_high_wm       (a_rhs.m_high_wm)
+  , m_wr_high       (a_rhs.m_wr_high)
+  , m_wr_armed      (a_rhs.m_wr_armed)
   , m_with_pkt_info (a_rhs.m_with_pkt_info)
   , m_sock_src_addr (a_rhs.m_sock_src_addr)
   , m_sock_src_port (a_rhs.m_sock_src_port)
   , m_sock_dst_addr (a_rhs.m_sock_dst_addr)
   , m_sock_dst_port (a_rhs.m_sock_dst_port)
   , m_sock_if_addr  (a_rhs.m_sock_if_addr )
-
+  , m_events        (a_rhs.m_events)
+  , m_uring_gen     (a_rhs.m_uring_gen)
+  , m_uring_wr      (a_rhs.m_uring_wr)
 {
   a_rhs.m_fd = -1;
 }
@@ -144,6 +161,13 @@ operator= (FdInfo&& a_rhs)
   m_rd_debug      = std::move(a_rhs.m_rd_debug);
   m_file_reader   = std::move(a_rhs.m_file_reader);
   m_exec_cmd      = std::move(a_rhs.m_exec_cmd);
+  m_dgram_ring    = std::move(a_rhs.m_dgram_ring);
+  m_wr_queue      = std::move(a_rhs.m_wr_queue);
+  m_on_watermark  = std::move(a_rhs.m_on_watermark);
+  m_low_wm        = a_rhs.m_low_wm;
+  m_high_wm       = a_rhs.m_high_wm;
+  m_wr_high       = a_rhs.m_wr_high;
+  m_wr_armed      = a_rhs.m_wr_armed;
   m_trigger       = a_rhs.m_trigger;
   m_with_pkt_info = a_rhs.m_with_pkt_info;
   m_sock_src_addr = a_rhs.m_sock_src_addr;
@@ -151,6 +175,9 @@ operator= (FdInfo&& a_rhs)
   m_sock_dst_addr = a_rhs.m_sock_dst_addr;
   m_sock_dst_port = a_rhs.m_sock_dst_port;
   m_sock_if_addr  = a_rhs.m_sock_if_addr ;
+  m_events        = a_rhs.m_events;
+  m_uring_gen     = a_rhs.m_uring_gen;
+  m_uring_wr      = a_rhs.m_uring_wr;
 
   return *this;
 }
@@ -183,6 +210,11 @@ EnableDgramPktInfo(bool a_enable)
     getsockname(m_fd, (sockaddr*)&si, const_cast<socklen_t*>(&si_len)) < 0
       ? 0
       : si.sin_port;
+
+  // The packet info is only available with recvmsg(2), so the io_uring
+  // backend has to read this socket on readiness instead of using recv
+  if (m_owner && m_owner->m_uring)
+    m_owner->IOUringRearm(*this);
 }
 
 //------------------------------------------------------------------------------
@@ -204,6 +236,90 @@ EnablePktTimeStamps(bool a_enable)
   m_ts_wire.clear();
 }
 
+//------------------------------------------------------------------------------
+int FdInfo::
+SendBatch(DgramSendBatch& a_batch, int a_flags)
+{
+  UTXX_PRETTY_FUNCTION(); // Cache pretty function name
+
+  int n = a_batch.Send(m_fd, a_flags);
+  if (UNLIKELY(n < 0))
+    return ReportError(IOType::Write, errno, "error in sendmmsg", UTXX_SRCX, false);
+  return n;
+}
+
+//------------------------------------------------------------------------------
+void FdInfo::
+EnableWrQueue(size_t a_low_wm, size_t a_high_wm, WatermarkHandler const& a_on_wm)
+{
+  UTXX_PRETTY_FUNCTION(); // Cache pretty function name
+
+  if (m_handler.Type() != HType::IO)
+    UTXX_THROWX_RUNTIME_ERROR("Write queue requires an IO handler of ", m_name);
+  if (a_high_wm && a_low_wm > a_high_wm)
+    UTXX_THROWX_BADARG_ERROR("low watermark ", a_low_wm,
+                             " exceeds high watermark ", a_high_wm);
+  if (!m_wr_queue)
+    m_wr_queue.reset(new WrQueue());
+
+  m_low_wm       = a_low_wm;
+  m_high_wm      = a_high_wm;
+  m_on_watermark = a_on_wm;
+}
+
+//------------------------------------------------------------------------------
+long FdInfo::
+Send(const void* a_data, size_t a_len, WrQueue::Owner const& a_owner)
+{
+  assert(m_wr_queue);
+  // A non-empty queue is waiting for the fd to become writable
+  bool write = m_wr_queue->Empty();
+  m_wr_queue->Push(a_data, a_len, a_owner);
+  return FlushWrQueue(write);
+}
+
+//------------------------------------------------------------------------------
+long FdInfo::
+Send(iovector const& a_vec, WrQueue::Owner const& a_owner)
+{
+  assert(m_wr_queue);
+  bool write = m_wr_queue->Empty();
+  m_wr_queue->Push(a_vec, a_owner);
+  return FlushWrQueue(write);
+}
+
+//------------------------------------------------------------------------------
+long FdInfo::
+FlushWrQueue(bool a_write)
+{
+  UTXX_PRETTY_FUNCTION(); // Cache pretty function name
+
+  if (a_write && UNLIKELY(m_wr_queue->Flush(m_fd) < 0))
+    return ReportError(IOType::Write, errno, "error in writev", UTXX_SRCX, false);
+
+  auto pending = m_wr_queue->Bytes();
+
+  // Write events are only needed while some data is pending, unless they
+  // are requested by the user (see Reactor::SubscribeWrite())
+  if (bool(pending) != m_wr_armed) {
+    m_wr_armed = pending;
+    if (!(m_events & EPOLLOUT))
+      m_owner->WriteEvents(*this, m_wr_armed);
+  }
+
+  if (m_on_watermark && m_high_wm) {
+    if (!m_wr_high && pending > m_high_wm) {
+      m_wr_high = true;
+      m_on_watermark(*this, true);
+    } else if (m_wr_high && pending <= m_low_wm) {
+      m_wr_high = false;
+      m_on_watermark(*this, false);
+    }
+  }
+
+  return pending;
+}
+
 //------------------------------------------------------------------------------
 int FdInfo::
 ReportError(IOType a_tp, int a_ec, const std::string& a_err,
@@ -211,7 +327,12 @@ ReportError(IOType a_tp, int a_ec, const std::string& a_err,
 {
   UTXX_PRETTY_FUNCTION();
 
-  UTXX_SCOPE_EXIT([this]() { Clear(); });
+  // The reactor closes the fd when the handler fails with errno other than
+  // EAGAIN, so a stale EAGAIN left by an earlier read must not leak the fd
+  UTXX_SCOPE_EXIT(([this, a_ec]() {
+    Clear();
+    if (errno == EAGAIN) errno = a_ec == EAGAIN ? 0 : a_ec;
+  }));
 
   auto err = a_ec
            ? utxx::to_string(a_err, " (", a_ec, ": ", strerror(a_ec), ')')
@@ -446,17 +567,14 @@ HandleAccept(uint32_t a_events)
   if (UNLIKELY(!Reactor::IsReadable(a_events)))
     return 0;
 
-  // TODO: Since at this time there's only AddUDSListener and no INET listener
-  // we only handle accepts for UDS sockets
-
-  struct sockaddr_un addr;
-  struct sockaddr*   paddr = (struct sockaddr*)&addr;
-  socklen_t          len   = sizeof(addr);
-  addr.sun_family          = AF_UNIX;
+  struct sockaddr_storage addr;
+  struct sockaddr*        paddr = (struct sockaddr*)&addr;
+  char                    name[sizeof(sockaddr_un)];
 
   // FD error condition is handled by the caller prior to making this call
   while (true) {
-    int cli_fd;
+    socklen_t len = sizeof(addr);
+    int       cli_fd;
 
     while (UNLIKELY((cli_fd = accept(m_fd, paddr, &len)) < 0 && errno==EINTR));
 
@@ -466,14 +584,26 @@ HandleAccept(uint32_t a_events)
       return ReportError(IOType::Accept, errno, "error in accept(2)", UTXX_SRCX);
     }
 
-    len -= offsetof(struct sockaddr_un, sun_path); // len of pathname
-    addr.sun_path[len] = 0;
+    if (addr.ss_family == AF_INET) {
+      // Client's address is reported as "Address:Port"
+      auto a = (const sockaddr_in*)paddr;
+      inet_ntop(AF_INET, &a->sin_addr, name, sizeof(name));
+      auto n = strlen(name);
+      snprintf(name + n, sizeof(name) - n, ":%d", ntohs(a->sin_port));
+    } else {
+      auto a   = (const sockaddr_un*)paddr;
+      auto off = offsetof(struct sockaddr_un, sun_path);
+      len      = len > off ? len - off : 0;              // len of pathname
+      len      = std::min<socklen_t>(len, sizeof(a->sun_path) - 1);
+      memcpy(name, a->sun_path, len);
+      name[len] = '\0';
+    }
 
     Blocking(cli_fd, false);
 
     // If callback returns true, client added this new fd to the reactor.
     // Else - close the socket.
-    if (!m_handler.AsAccept()(*this, addr.sun_path, cli_fd))
+    if (!m_handler.AsAccept()(*this, name, cli_fd))
       ::close(cli_fd);
   }
 
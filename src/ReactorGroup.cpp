@@ -0,0 +1,230 @@
+// vim:ts=2:sw=2:et
+//------------------------------------------------------------------------------
+/// \file  ReactorGroup.cpp
+//------------------------------------------------------------------------------
+/// \brief Group of reactors each running in its own thread
+//------------------------------------------------------------------------------
+// Copyright (c) 2026 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-16
+//------------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the utxx open-source project.
+
+Copyright (C) 2026 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+#include <utxx/io/ReactorGroup.hpp>
+#include <utxx/io/ReactorLog.hpp>
+#include <pthread.h>
+#include <sched.h>
+
+namespace utxx {
+namespace io   {
+
+//------------------------------------------------------------------------------
+ReactorGroup::
+ReactorGroup
+(
+  std::string      const& a_ident,
+  size_t                  a_count,
+  std::vector<int> const& a_cpus,
+  BackendT                a_backend,
+  int                     a_debug
+)
+  : m_cpus   (a_cpus)
+  , m_running(false)
+{
+  if (!a_count)
+    UTXX_THROW_BADARG_ERROR("invalid number of reactors: ", a_count);
+
+  m_cpus.resize(a_count, -1);
+
+  for (size_t i=0; i < a_count; ++i) {
+    m_reactors.emplace_back
+      (new Reactor(utxx::to_string(a_ident, i+1), a_debug, -1, 128, a_backend));
+    m_reactors.back()->EnablePost();
+  }
+}
+
+//------------------------------------------------------------------------------
+ReactorGroup::
+~ReactorGroup()
+{
+  Stop();
+}
+
+//------------------------------------------------------------------------------
+void ReactorGroup::
+Start(int a_wait_msec)
+{
+  if (m_running.exchange(true))
+    return;
+
+  for (size_t i=0; i < m_reactors.size(); ++i)
+    m_threads.emplace_back([this, i, a_wait_msec]() { Run(i, a_wait_msec); });
+}
+
+//------------------------------------------------------------------------------
+void ReactorGroup::
+Stop()
+{
+  if (!m_running.exchange(false))
+    return;
+
+  // Wake up the reactors so that they notice the change of m_running
+  for (auto& r : m_reactors)
+    r->Post([]() {});
+
+  for (auto& t : m_threads)
+    if (t.joinable())
+      t.join();
+
+  m_threads.clear();
+}
+
+//------------------------------------------------------------------------------
+void ReactorGroup::
+Run(size_t a_id, int a_wait_msec)
+{
+  auto& r = *m_reactors[a_id];
+
+  if (m_cpus[a_id] >= 0) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(m_cpus[a_id], &set);
+    int rc = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    if (rc)
+      r.Log(utxx::LEVEL_WARNING, UTXX_SRC, r.Ident(), "cannot pin thread to cpu ",
+            m_cpus[a_id], ": ", strerror(rc));
+  }
+
+  while (m_running.load(std::memory_order_relaxed)) {
+    try {
+      r.Wait(a_wait_msec);
+    } catch (std::exception& e) {
+      r.Log(utxx::LEVEL_ERROR, UTXX_SRC, r.Ident(), "reactor error: ", e.what());
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+bool ReactorGroup::
+Post(size_t a_id, PostTask&& a_task)
+{
+  if (UNLIKELY(a_id >= m_reactors.size()))
+    UTXX_THROW_BADARG_ERROR("invalid reactor id: ", a_id);
+
+  return m_reactors[a_id]->Post(std::move(a_task));
+}
+
+//------------------------------------------------------------------------------
+int ReactorGroup::
+AddListener
+(
+  std::string   const& a_name,
+  std::string   const& a_address,
+  int                  a_port,
+  AcceptHandler const& a_on_accept,
+  ErrHandler    const& a_on_error,
+  void*                a_opaque,
+  int                  a_backlog
+)
+{
+  auto add = [=](size_t a_id, int a_port) {
+    auto& fi = m_reactors[a_id]->AddListener(a_name, a_address, a_port,
+                                            a_on_accept, a_on_error, a_opaque,
+                                            true, a_backlog);
+    return fi.FD();
+  };
+
+  // When called by a reactor's thread, its own listener is added first
+  auto self  = Self();
+  bool own   = self < m_reactors.size();
+  auto first = own ? self : 0;
+
+  // The first listener is added before the others to report errors and to
+  // learn the port assigned by the kernel
+  int fd = Call(first, [=]() { return add(first, a_port); }).get();
+
+  struct sockaddr_in addr;
+  socklen_t          len = sizeof(addr);
+  if (getsockname(fd, (sockaddr*)&addr, &len) < 0)
+    UTXX_THROW_IO_ERROR(errno, '[', a_name, "] getsockname failed");
+  int port = ntohs(addr.sin_port);
+
+  std::vector<std::future<int>> fds;
+  for (size_t i=0; i < m_reactors.size(); ++i) {
+    if (i == first)
+      continue;
+    if (own) {
+      // A reactor's thread must not wait for other reactors, which may be
+      // waiting for it, so their listeners are added asynchronously
+      auto& r = *m_reactors[i];
+      Call(i, [=, &r]() {
+        try { return add(i, port); }
+        catch (std::exception& e) {
+          r.Log(utxx::LEVEL_ERROR, UTXX_SRC, r.Ident(), "cannot add listener ",
+                a_name, " on port ", port, ": ", e.what());
+          return -1;
+        }
+      });
+    } else
+      fds.push_back(Call(i, [=]() { return add(i, port); }));
+  }
+
+  // Wait for all listeners to be added (rethrows the first error)
+  for (auto& f : fds)
+    f.get();
+
+  return port;
+}
+
+//------------------------------------------------------------------------------
+size_t ReactorGroup::
+Self() const
+{
+  auto id = std::this_thread::get_id();
+  for (size_t i=0; i < m_threads.size(); ++i)
+    if (m_threads[i].get_id() == id)
+      return i;
+  return m_reactors.size();
+}
+
+//------------------------------------------------------------------------------
+std::future<int> ReactorGroup::
+Call(size_t a_id, std::function<int()> const& a_fun)
+{
+  auto res = std::make_shared<std::promise<int>>();
+  auto fut = res->get_future();
+  auto run = [res, a_fun]() {
+    try         { res->set_value(a_fun());                   }
+    catch (...) { res->set_exception(std::current_exception()); }
+  };
+
+  if (!m_running || Self() == a_id)
+    run();
+  else if (!m_reactors[a_id]->Post(run))
+    UTXX_THROW_RUNTIME_ERROR("cannot post a task to reactor ", a_id);
+
+  return fut;
+}
+
+} // namespace io
+} // namespace utxx
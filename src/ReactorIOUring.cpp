@@ -0,0 +1,568 @@
+// vim:ts=2:sw=2:et
+//------------------------------------------------------------------------------
+/// \file  ReactorIOUring.cpp
+//------------------------------------------------------------------------------
+/// \brief io_uring backend of the I/O multiplexing event reactor
+//------------------------------------------------------------------------------
+// Copyright (c) 2026 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-16
+//------------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the utxx open-source project.
+
+Copyright (C) 2026 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+#include <utxx/io/ReactorIOUring.hpp>
+#include <utxx/io/ReactorLog.hpp>
+#include <utxx/io/Reactor.hpp>
+#include <utxx/scope_exit.hpp>
+#include <sys/syscall.h>
+#include <sys/mman.h>
+#include <poll.h>
+#include <unistd.h>
+#include <signal.h>
+#include <algorithm>
+
+namespace utxx {
+namespace io   {
+
+//------------------------------------------------------------------------------
+// IOUring
+//------------------------------------------------------------------------------
+IOUring::IOUring(unsigned a_entries, unsigned a_nbufs, unsigned a_buf_size)
+  : m_fd(-1), m_sqe_head(0), m_sqe_tail(0)
+  , m_sqes(static_cast<io_uring_sqe*>(MAP_FAILED))
+  , m_sq_ptr(MAP_FAILED), m_sq_size(0), m_cq_ptr(MAP_FAILED), m_cq_size(0)
+  , m_sqes_size(0)
+  , m_buf_ring(static_cast<io_uring_buf_ring*>(MAP_FAILED)), m_buf_ring_size(0)
+  , m_bufs(static_cast<char*>(MAP_FAILED))
+  , m_nbufs(1), m_buf_size(a_buf_size), m_buf_tail(0)
+{
+  while (m_nbufs < a_nbufs && m_nbufs < 32768)
+    m_nbufs <<= 1;
+
+  io_uring_params params{};
+  params.flags = IORING_SETUP_SUBMIT_ALL | IORING_SETUP_COOP_TASKRUN;
+  m_fd = syscall(__NR_io_uring_setup, a_entries, &params);
+
+  if (m_fd < 0 && errno == EINVAL) {
+    // Older kernel not supporting the setup flags
+    params = io_uring_params{};
+    m_fd   = syscall(__NR_io_uring_setup, a_entries, &params);
+  }
+  if (m_fd < 0)
+    UTXX_THROW_IO_ERROR(errno, "io_uring_setup failed");
+
+  if (auto what = Unsupported(m_fd, params.features)) {
+    Close();
+    UTXX_THROW_RUNTIME_ERROR("io_uring backend requires Linux kernel 6.0+: ",
+                             what);
+  }
+
+  m_sq_size   = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  m_cq_size   = params.cq_off.cqes  + params.cq_entries * sizeof(io_uring_cqe);
+  m_sqes_size = params.sq_entries   * sizeof(io_uring_sqe);
+
+  if (params.features & IORING_FEAT_SINGLE_MMAP)
+    m_sq_size = m_cq_size = std::max(m_sq_size, m_cq_size);
+
+  auto map = [this](size_t a_size, uint64_t a_offset) {
+    auto p = mmap(nullptr, a_size, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE,
+                  m_fd, a_offset);
+    if (p == MAP_FAILED) {
+      auto ec = errno;
+      Close();
+      UTXX_THROW_IO_ERROR(ec, "io_uring mmap failed");
+    }
+    return p;
+  };
+
+  m_sq_ptr = map(m_sq_size, IORING_OFF_SQ_RING);
+  m_cq_ptr = (params.features & IORING_FEAT_SINGLE_MMAP)
+           ? m_sq_ptr : map(m_cq_size, IORING_OFF_CQ_RING);
+  m_sqes   = static_cast<io_uring_sqe*>(map(m_sqes_size, IORING_OFF_SQES));
+
+  auto sq      = static_cast<char*>(m_sq_ptr);
+  m_sq_head    = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+  m_sq_tail    = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+  m_sq_mask    = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+  m_sq_entries = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_entries);
+  m_sq_array   = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+  m_sqe_head   = m_sqe_tail = *m_sq_tail;
+
+  auto cq      = static_cast<char*>(m_cq_ptr);
+  m_cq_head    = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+  m_cq_tail    = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+  m_cq_mask    = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+  m_cqes       = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+  // Register the ring of provided buffers
+  auto page       = size_t(sysconf(_SC_PAGESIZE));
+  m_buf_ring_size = (m_nbufs * sizeof(io_uring_buf) + page-1) & ~(page-1);
+  m_buf_ring      = static_cast<io_uring_buf_ring*>(
+                      mmap(nullptr, m_buf_ring_size, PROT_READ|PROT_WRITE,
+                           MAP_PRIVATE|MAP_ANONYMOUS, -1, 0));
+  m_bufs          = static_cast<char*>(
+                      mmap(nullptr, size_t(m_nbufs)*m_buf_size, PROT_READ|PROT_WRITE,
+                           MAP_PRIVATE|MAP_ANONYMOUS, -1, 0));
+  if (m_buf_ring == MAP_FAILED || m_bufs == MAP_FAILED) {
+    auto ec = errno;
+    Close();
+    UTXX_THROW_IO_ERROR(ec, "cannot allocate io_uring buffers");
+  }
+
+  io_uring_buf_reg reg{};
+  reg.ring_addr    = uint64_t(uintptr_t(m_buf_ring));
+  reg.ring_entries = m_nbufs;
+  reg.bgid         = s_buf_group;
+
+  if (syscall(__NR_io_uring_register, m_fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+    auto ec = errno;
+    Close();
+    UTXX_THROW_IO_ERROR(ec, "cannot register io_uring provided buffers");
+  }
+
+  for (unsigned i=0; i < m_nbufs; ++i)
+    AddBuffer(i);
+  __atomic_store_n(&m_buf_ring->tail, m_buf_tail, __ATOMIC_RELEASE);
+}
+
+//------------------------------------------------------------------------------
+IOUring::~IOUring()
+{
+  Close();
+}
+
+//------------------------------------------------------------------------------
+const char* IOUring::Unsupported(int a_fd, unsigned a_features)
+{
+  if (!(a_features & IORING_FEAT_EXT_ARG))
+    return "no wait timeout argument (IORING_FEAT_EXT_ARG)";
+  if (!(a_features & IORING_FEAT_FAST_POLL))
+    return "no internal polling (IORING_FEAT_FAST_POLL)";
+
+  static const struct { uint8_t op; const char* name; } s_ops[] = {
+    { IORING_OP_RECV,         "IORING_OP_RECV"         },
+    { IORING_OP_POLL_ADD,     "IORING_OP_POLL_ADD"     },
+    { IORING_OP_POLL_REMOVE,  "IORING_OP_POLL_REMOVE"  },
+    { IORING_OP_ASYNC_CANCEL, "IORING_OP_ASYNC_CANCEL" },
+  };
+
+  char buf[sizeof(io_uring_probe) + IORING_OP_LAST*sizeof(io_uring_probe_op)]{};
+  auto probe = reinterpret_cast<io_uring_probe*>(buf);
+
+  if (syscall(__NR_io_uring_register, a_fd, IORING_REGISTER_PROBE,
+              probe, IORING_OP_LAST) < 0)
+    return "no opcode probe (IORING_REGISTER_PROBE)";
+
+  auto has = [probe](unsigned a_op) {
+    return a_op <= probe->last_op && (probe->ops[a_op].flags & IO_URING_OP_SUPPORTED);
+  };
+
+  for (auto& op : s_ops)
+    if (!has(op.op))
+      return op.name;
+
+  // Multishot recv doesn't have an opcode of its own, and is supported by
+  // the same kernel release (6.0) that added IORING_OP_SEND_ZC
+  if (!has(IORING_OP_SEND_ZC))
+    return "no multishot recv (IORING_RECV_MULTISHOT)";
+
+  return nullptr;
+}
+
+//------------------------------------------------------------------------------
+bool IOUring::Supported()
+{
+  static const bool s_supported = [] {
+    io_uring_params params{};
+    int fd = syscall(__NR_io_uring_setup, 2, &params);
+    if (fd < 0)
+      return false;
+
+    bool ok = !Unsupported(fd, params.features);
+
+    // Register a ring of provided buffers with a single entry
+    auto  page = size_t(sysconf(_SC_PAGESIZE));
+    void* ring = MAP_FAILED;
+    if (ok) {
+      ring = mmap(nullptr, page, PROT_READ|PROT_WRITE,
+                  MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+      ok   = ring != MAP_FAILED;
+    }
+    if (ok) {
+      io_uring_buf_reg reg{};
+      reg.ring_addr    = uint64_t(uintptr_t(ring));
+      reg.ring_entries = 1;
+      reg.bgid         = s_buf_group;
+      ok = syscall(__NR_io_uring_register, fd, IORING_REGISTER_PBUF_RING,
+                   &reg, 1) == 0;
+    }
+
+    ::close(fd);
+    if (ring != MAP_FAILED)
+      munmap(ring, page);
+    return ok;
+  }();
+
+  return s_supported;
+}
+
+//------------------------------------------------------------------------------
+void IOUring::Close()
+{
+  if (m_bufs != MAP_FAILED)
+    munmap(m_bufs, size_t(m_nbufs)*m_buf_size);
+  if (m_buf_ring != MAP_FAILED)
+    munmap(m_buf_ring, m_buf_ring_size);
+  if (m_sqes != MAP_FAILED)
+    munmap(m_sqes, m_sqes_size);
+  if (m_cq_ptr != MAP_FAILED && m_cq_ptr != m_sq_ptr)
+    munmap(m_cq_ptr, m_cq_size);
+  if (m_sq_ptr != MAP_FAILED)
+    munmap(m_sq_ptr, m_sq_size);
+  if (m_fd >= 0)
+    ::close(m_fd);
+
+  m_bufs     = static_cast<char*>(MAP_FAILED);
+  m_buf_ring = static_cast<io_uring_buf_ring*>(MAP_FAILED);
+  m_sqes     = static_cast<io_uring_sqe*>(MAP_FAILED);
+  m_cq_ptr   = m_sq_ptr = MAP_FAILED;
+  m_fd       = -1;
+}
+
+//------------------------------------------------------------------------------
+io_uring_sqe* IOUring::GetSQE()
+{
+  if (m_sqe_tail - __atomic_load_n(m_sq_head, __ATOMIC_ACQUIRE) >= m_sq_entries) {
+    Submit();
+    if (m_sqe_tail - __atomic_load_n(m_sq_head, __ATOMIC_ACQUIRE) >= m_sq_entries)
+      UTXX_THROW_RUNTIME_ERROR("io_uring submission queue is full");
+  }
+
+  auto idx = m_sqe_tail++ & m_sq_mask;
+  auto sqe = &m_sqes[idx];
+  memset(sqe, 0, sizeof(*sqe));
+  m_sq_array[idx] = idx;
+  return sqe;
+}
+
+//------------------------------------------------------------------------------
+int IOUring::Enter(unsigned a_wait_nr, unsigned a_flags, void* a_arg, size_t a_sz)
+{
+  // Publish the prepared entries to the kernel
+  __atomic_store_n(m_sq_tail, m_sqe_tail, __ATOMIC_RELEASE);
+
+  int rc;
+  do {
+    rc = syscall(__NR_io_uring_enter, m_fd, Pending(), a_wait_nr, a_flags, a_arg, a_sz);
+  } while (rc < 0 && errno == EINTR && !a_wait_nr);
+
+  if (rc > 0)
+    m_sqe_head += rc;
+  return rc;
+}
+
+//------------------------------------------------------------------------------
+int IOUring::Submit()
+{
+  if (!Pending())
+    return 0;
+
+  int rc = Enter(0, 0, nullptr, 0);
+  if (rc < 0 && errno != EAGAIN && errno != EBUSY)
+    UTXX_THROW_IO_ERROR(errno, "io_uring_enter failed");
+  return rc;
+}
+
+//------------------------------------------------------------------------------
+bool IOUring::SubmitAndWait(int a_timeout_msec)
+{
+  if (a_timeout_msec == 0 || HasCQE())
+    return Submit() >= 0;
+
+  __kernel_timespec        ts{a_timeout_msec / 1000, (a_timeout_msec % 1000) * 1000000L};
+  io_uring_getevents_arg   arg{};
+  arg.ts = uint64_t(uintptr_t(&ts));
+
+  int rc = a_timeout_msec > 0
+         ? Enter(1, IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &arg, sizeof(arg))
+         : Enter(1, IORING_ENTER_GETEVENTS, nullptr, _NSIG/8);
+
+  if (rc >= 0)
+    return true;
+  if (errno == ETIME || errno == EINTR)
+    return false;
+  if (errno == EAGAIN || errno == EBUSY)
+    // Completion queue is overflown - let the caller reap the entries
+    return true;
+  UTXX_THROW_IO_ERROR(errno, "io_uring_enter failed");
+}
+
+//------------------------------------------------------------------------------
+void IOUring::PrepRecvMultishot(int a_fd, uint64_t a_udata)
+{
+  auto sqe       = GetSQE();
+  sqe->opcode    = IORING_OP_RECV;
+  sqe->fd        = a_fd;
+  sqe->ioprio    = IORING_RECV_MULTISHOT;
+  sqe->flags     = IOSQE_BUFFER_SELECT;
+  sqe->buf_group = s_buf_group;
+  sqe->user_data = a_udata;
+}
+
+//------------------------------------------------------------------------------
+void IOUring::PrepPollMultishot(int a_fd, uint32_t a_events, uint64_t a_udata)
+{
+  auto sqe           = GetSQE();
+  sqe->opcode        = IORING_OP_POLL_ADD;
+  sqe->fd            = a_fd;
+  sqe->len           = IORING_POLL_ADD_MULTI;
+  sqe->poll32_events = a_events;
+  sqe->user_data     = a_udata;
+}
+
+//------------------------------------------------------------------------------
+void IOUring::PrepPollRemove(uint64_t a_target, uint64_t a_udata)
+{
+  auto sqe       = GetSQE();
+  sqe->opcode    = IORING_OP_POLL_REMOVE;
+  sqe->fd        = -1;
+  sqe->addr      = a_target;
+  sqe->user_data = a_udata;
+}
+
+//------------------------------------------------------------------------------
+void IOUring::PrepCancelFD(int a_fd, uint64_t a_udata)
+{
+  auto sqe          = GetSQE();
+  sqe->opcode       = IORING_OP_ASYNC_CANCEL;
+  sqe->fd           = a_fd;
+  sqe->cancel_flags = IORING_ASYNC_CANCEL_FD | IORING_ASYNC_CANCEL_ALL;
+  sqe->user_data    = a_udata;
+}
+
+//------------------------------------------------------------------------------
+// Reactor's io_uring backend
+//------------------------------------------------------------------------------
+void Reactor
+::IOUringArm(FdInfo& a_fi)
+{
+  UTXX_PRETTY_FUNCTION(); // Cache pretty function name
+
+  int  fd  = a_fi.FD();
+  auto gen = a_fi.m_uring_gen;
+
+  switch (a_fi.Type()) {
+    case HType::IO:
+      // Sockets are read by the kernel into provided buffers. The packet
+      // info requires recvmsg(2), so such sockets are read on readiness.
+      if (a_fi.m_rd_buff && !a_fi.m_with_pkt_info &&
+         (a_fi.m_fd_type == FdTypeT::Stream   ||
+          a_fi.m_fd_type == FdTypeT::Datagram ||
+          a_fi.m_fd_type == FdTypeT::SeqPacket))
+      {
+        m_uring->PrepRecvMultishot(fd, UData(fd, URingOp::Recv, gen));
+        if (((a_fi.m_events & EPOLLOUT) && a_fi.m_handler.AsIO().wh) ||
+            a_fi.m_wr_armed) {
+          m_uring->PrepPollMultishot(fd, POLLOUT, UData(fd, URingOp::Write, gen));
+          a_fi.m_uring_wr = true;
+        }
+        break;
+      }
+      m_uring->PrepPollMultishot(fd, a_fi.m_events & ~(EPOLLET|EPOLLONESHOT),
+                                 UData(fd, URingOp::Poll, gen));
+      break;
+    case HType::UNDEFINED:
+      return;
+    default:
+      m_uring->PrepPollMultishot(fd, a_fi.m_events & ~(EPOLLET|EPOLLONESHOT),
+                                 UData(fd, URingOp::Poll, gen));
+      break;
+  }
+
+  UTXX_RLOG(this, TRACE5, "armed io_uring requests for fd=", fd,
+            " (", a_fi.Type().to_string(), ')');
+}
+
+//------------------------------------------------------------------------------
+void Reactor
+::IOUringRearm(FdInfo& a_fi)
+{
+  if (a_fi.FD() < 0)
+    return;
+  // Completions of the canceled requests are discarded by generation mismatch
+  m_uring->PrepCancelFD(a_fi.FD(), UData(a_fi.FD(), URingOp::Cancel, 0));
+  a_fi.m_uring_gen = ++m_uring_gen & s_uring_gen_mask;
+  a_fi.m_uring_wr  = false;
+  if (std::find(m_uring_arm.begin(), m_uring_arm.end(), a_fi.FD()) == m_uring_arm.end())
+    m_uring_arm.push_back(a_fi.FD());
+}
+
+//------------------------------------------------------------------------------
+void Reactor
+::IOUringSubscribeWrite(FdInfo& a_fi, bool a_on)
+{
+  if (a_fi.m_uring_wr == a_on)
+    return;
+  auto ud = UData(a_fi.FD(), URingOp::Write, a_fi.m_uring_gen);
+  if (a_on)
+    m_uring->PrepPollMultishot(a_fi.FD(), POLLOUT, ud);
+  else
+    m_uring->PrepPollRemove(ud, UData(a_fi.FD(), URingOp::Cancel, 0));
+  a_fi.m_uring_wr = a_on;
+}
+
+//------------------------------------------------------------------------------
+int Reactor
+::IOUringWait(int a_timeout_msec)
+{
+  UTXX_PRETTY_FUNCTION(); // Cache pretty function name
+
+  // Arm requests of file descriptors added since the last call
+  if (!m_uring_arm.empty()) {
+    for (auto fd : m_uring_arm)
+      if (fd >= 0 && fd < int(m_fds.size()) && m_fds[fd] && m_fds[fd]->FD() == fd)
+        IOUringArm(*m_fds[fd]);
+    m_uring_arm.clear();
+  }
+
+  // Submission of pending requests and reaping of completions is done in
+  // a single system call
+  m_uring->SubmitAndWait(a_timeout_msec);
+
+  long rc = 0;
+  int  i  = 0;
+  int  n  = 0;
+
+  m_uring->ForEachCQE([this, &rc, &i, &n](io_uring_cqe const& a_cqe) {
+    int     fd  = int(a_cqe.user_data & 0xFFFFFFFF);
+    auto    op  = URingOp((a_cqe.user_data >> 32) & 0xFF);
+    auto    gen = uint32_t(a_cqe.user_data >> 40);
+    int     bid = IOUring::BufferID(a_cqe);
+    int     res = a_cqe.res;
+    bool    more= a_cqe.flags & IORING_CQE_F_MORE;
+
+    // Provided buffer is returned to the kernel when the completion is done
+    UTXX_SCOPE_EXIT(([this, bid]() { if (bid >= 0) m_uring->ReturnBuffer(bid); }));
+
+    if (op == URingOp::Cancel)
+      return;
+
+    if (UNLIKELY(fd < 0 || fd >= int(m_fds.size()) || !m_fds[fd])) {
+      UTXX_RLOG(this, DEBUG, "fd=", fd, " not found!");
+      return;
+    }
+
+    FdInfo& info = *m_fds[fd];
+
+    // Ignore completions of requests issued for a closed or re-added fd
+    if (info.FD() != fd || info.m_uring_gen != gen)
+      return;
+
+    ++n;
+
+    UTXX_RLOG(this, TRACE5, "processing ", ++i, ' ', info.Name(), "(fd=", fd,
+              ", op=", int(op), ", res=", res, ", more=", more, ')');
+
+    auto cleanup = [this, &fd, &info]() {
+      UTXX_RLOG(&info, TRACE5, "closing fd ", fd, " on negative return from handler");
+      CloseFD(fd);
+      info.FD(-1);
+      info.Clear();
+    };
+
+    rc = 0;
+
+    try {
+      if (UNLIKELY(res < 0)) {
+        // Multishot requests terminate when provided buffers are exhausted,
+        // and are rearmed below
+        if (res == -ENOBUFS || res == -ECANCELED || res == -EAGAIN ||
+            res == -EINTR)
+          res = 0;
+        else {
+          auto tp = op == URingOp::Write ? IOType::Write : IOType::Read;
+          rc = info.ReportError(tp, -res, "io_uring request failed", UTXX_SRCX, false);
+        }
+      }
+      else switch (op) {
+        case URingOp::Recv:
+          rc = info.HandleRecv(bid < 0 ? nullptr : m_uring->Buffer(bid), res);
+          break;
+        case URingOp::Poll:
+          if (UNLIKELY(IsError(res))) {
+            auto ec = SocketError(fd);
+            if (ec == EAGAIN || ec == EINTR || ec == ENOTSOCK)
+              break;
+            info.ReportError(IsWritable(res) ? IOType::Write : IOType::Read,
+                             0, strerror(ec), UTXX_SRCX, false);
+            rc = -1;
+          } else
+            rc = info.Handle(res);
+          break;
+        case URingOp::Write:
+          rc = info.Handle(EPOLLOUT);
+          break;
+        default:
+          break;
+      }
+    } catch (...) {
+      cleanup();
+      throw;
+    }
+
+    if (UNLIKELY(rc < 0 && errno != EAGAIN)) {
+      cleanup();
+      return;
+    }
+
+    // Reissue a completed request unless the fd was removed by the handler
+    if (more || info.FD() != fd || info.m_uring_gen != gen)
+      return;
+
+    switch (op) {
+      case URingOp::Recv:
+        m_uring->PrepRecvMultishot(fd, a_cqe.user_data);
+        break;
+      case URingOp::Poll:
+        m_uring->PrepPollMultishot(fd, info.m_events & ~(EPOLLET|EPOLLONESHOT),
+                                   a_cqe.user_data);
+        break;
+      case URingOp::Write:
+        if (info.m_uring_wr || (info.m_events & EPOLLOUT))
+          m_uring->PrepPollMultishot(fd, POLLOUT, a_cqe.user_data);
+        break;
+      default:
+        break;
+    }
+  });
+
+  // If there were no events and we got here on timeout,
+  // trigger the idle state handler:
+  if (rc == 0 && m_on_idle)
+    m_on_idle();
+
+  return n;
+}
+
+} // namespace io
+} // namespace utxx
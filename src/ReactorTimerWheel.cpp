@@ -0,0 +1,231 @@
+// vim:ts=2:sw=2:et
+//------------------------------------------------------------------------------
+/// \file  ReactorTimerWheel.cpp
+//------------------------------------------------------------------------------
+/// \brief Hierarchical timer wheel used by the reactor's timers
+//------------------------------------------------------------------------------
+// Copyright (c) 2026 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-16
+//------------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the utxx open-source project.
+
+Copyright (C) 2026 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+#include <utxx/io/ReactorTimerWheel.hpp>
+#include <utxx/error.hpp>
+#include <algorithm>
+
+namespace utxx {
+namespace io   {
+
+//------------------------------------------------------------------------------
+TimerWheel::
+TimerWheel(uint64_t a_now, size_t a_reserve)
+  : m_now(a_now)
+{
+  std::fill(m_slots, m_slots + LEVELS*SLOTS, NIL);
+  m_nodes.reserve(a_reserve);
+}
+
+//------------------------------------------------------------------------------
+uint32_t TimerWheel::
+Alloc()
+{
+  if (m_free != NIL) {
+    auto i = m_free;
+    m_free = m_nodes[i].next;
+    return i;
+  }
+
+  if (UNLIKELY(m_nodes.size() >= NIL - 1))
+    UTXX_THROW_RUNTIME_ERROR("too many timers: ", m_nodes.size());
+
+  m_nodes.push_back(Node{0, 0, NIL, NIL, 1, NIL, nullptr});
+  return m_nodes.size() - 1;
+}
+
+//------------------------------------------------------------------------------
+void TimerWheel::
+Free(uint32_t a_idx)
+{
+  auto& node = m_nodes[a_idx];
+  // Invalidate the outstanding TimerIDs of this node
+  if (++node.gen == 0)
+    node.gen   = 1;
+  node.fun     = nullptr;
+  node.next    = m_free;
+  m_free       = a_idx;
+  --m_size;
+}
+
+//------------------------------------------------------------------------------
+void TimerWheel::
+Link(uint32_t a_idx)
+{
+  auto& node  = m_nodes[a_idx];
+  auto  delta = node.expires - m_now;
+  int   level = delta < (1ul << BITS)   ? 0
+              : delta < (1ul << 2*BITS) ? 1
+              : delta < (1ul << 3*BITS) ? 2 : 3;
+  auto  slot  = level*SLOTS + int((node.expires >> (level*BITS)) & MASK);
+  auto& head  = m_slots[slot];
+
+  node.slot   = slot;
+  node.prev   = NIL;
+  node.next   = head;
+  if (head != NIL)
+    m_nodes[head].prev = a_idx;
+  head        = a_idx;
+}
+
+//------------------------------------------------------------------------------
+void TimerWheel::
+Unlink(uint32_t a_idx)
+{
+  auto& node = m_nodes[a_idx];
+  if (node.slot == NIL)
+    return;
+
+  if (node.prev != NIL)
+    m_nodes[node.prev].next = node.next;
+  else
+    m_slots[node.slot] = node.next;
+
+  if (node.next != NIL)
+    m_nodes[node.next].prev = node.prev;
+
+  node.slot = NIL;
+}
+
+//------------------------------------------------------------------------------
+void TimerWheel::
+Cascade(int a_level)
+{
+  // Redistribute timers of the current slot of this level to lower levels.
+  // When this level's index wraps, the next level is cascaded first.
+  for (; a_level < LEVELS; ++a_level) {
+    int  idx  = int(m_now >> (a_level*BITS)) & MASK;
+    auto i    = m_slots[a_level*SLOTS + idx];
+    m_slots[a_level*SLOTS + idx] = NIL;
+
+    while (i != NIL) {
+      auto next = m_nodes[i].next;
+      Link(i);
+      i = next;
+    }
+
+    if (idx)
+      break;
+  }
+}
+
+//------------------------------------------------------------------------------
+TimerID TimerWheel::
+Add(uint64_t a_expires, uint64_t a_interval, EventHandler const& a_fun)
+{
+  auto  i       = Alloc();
+  auto& node    = m_nodes[i];
+  node.expires  = std::max(a_expires, m_now + 1);
+  node.interval = a_interval;
+  node.fun      = a_fun;
+  ++m_size;
+  Link(i);
+  return ID(i, node.gen);
+}
+
+//------------------------------------------------------------------------------
+bool TimerWheel::
+Reschedule(TimerID a_id, uint64_t a_expires, uint64_t a_interval)
+{
+  auto i = Find(a_id);
+  if  (i == NIL)
+    return false;
+
+  auto& node    = m_nodes[i];
+  Unlink(i);
+  node.expires  = std::max(a_expires, m_now + 1);
+  node.interval = a_interval;
+  Link(i);
+  return true;
+}
+
+//------------------------------------------------------------------------------
+bool TimerWheel::
+Cancel(TimerID a_id)
+{
+  auto i = Find(a_id);
+  if  (i == NIL)
+    return false;
+
+  Unlink(i);
+  Free(i);
+  return true;
+}
+
+//------------------------------------------------------------------------------
+void TimerWheel::
+Clear()
+{
+  for (uint32_t i=0; i < m_nodes.size(); ++i)
+    if (m_nodes[i].slot != NIL) {
+      Unlink(i);
+      Free(i);
+    }
+}
+
+//------------------------------------------------------------------------------
+uint64_t TimerWheel::
+NextExpiry() const
+{
+  uint64_t next = ~0ul;
+
+  if (!m_size)
+    return next;
+
+  // A slot of a level holds the timers whose expiration ticks shifted by the
+  // level's bits are equal, so slots following the current one in order
+  // correspond to consecutive ranges of ticks. Level 0 slots hold single
+  // ticks, and the upper levels only need to be checked for ranges
+  // starting before the earliest tick found so far.
+  for (int level=0; level < LEVELS; ++level) {
+    auto shift = level*BITS;
+    auto cur   = m_now >> shift;
+
+    if (((cur+1) << shift) >= next)
+      break;
+
+    for (uint64_t b = cur+1; b <= cur+SLOTS; ++b) {
+      auto tick = b << shift;
+      if  (tick >= next)
+        break;
+      if (m_slots[level*SLOTS + int(b & MASK)] != NIL) {
+        next = tick;
+        break;
+      }
+    }
+  }
+
+  return next;
+}
+
+} // namespace io
+} // namespace utxx
@@ -0,0 +1,121 @@
+// vim:ts=2:sw=2:et
+//------------------------------------------------------------------------------
+/// \file  ReactorWrQueue.cpp
+//------------------------------------------------------------------------------
+/// \brief Gather write queue of the reactor's file descriptors
+//------------------------------------------------------------------------------
+// Copyright (c) 2026 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-16
+//------------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the utxx open-source project.
+
+Copyright (C) 2026 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+#include <utxx/io/ReactorWrQueue.hpp>
+#include <climits>
+#include <cerrno>
+#include <unistd.h>
+
+namespace utxx {
+namespace io   {
+
+//------------------------------------------------------------------------------
+WrQueue::
+WrQueue()
+  : m_iov(IOV_MAX)
+{}
+
+//------------------------------------------------------------------------------
+void WrQueue::
+Push(const void* a_data, size_t a_len, Owner const& a_owner)
+{
+  if (!a_len)
+    return;
+  m_segs.push_back(Segment{iovec{const_cast<void*>(a_data), a_len}, a_owner});
+  m_bytes += a_len;
+}
+
+//------------------------------------------------------------------------------
+void WrQueue::
+Push(iovector const& a_vec, Owner const& a_owner)
+{
+  for (auto& v : a_vec)
+    Push(v.iov_base, v.iov_len, a_owner);
+}
+
+//------------------------------------------------------------------------------
+long WrQueue::
+Flush(int a_fd)
+{
+  long total = 0;
+
+  while (!m_segs.empty()) {
+    int  cnt = 0;
+    long len = 0;
+    for (auto it = m_segs.begin(), e = m_segs.end();
+         it != e && cnt < int(m_iov.size()); ++it, ++cnt)
+    {
+      m_iov[cnt] = it->iov;
+      len       += it->iov.iov_len;
+    }
+
+    auto n = ::writev(a_fd, m_iov.data(), cnt);
+
+    if (n < 0) {
+      if (errno == EINTR)
+        continue;
+      return errno == EAGAIN ? total : -1;
+    }
+
+    total   += n;
+    m_bytes -= n;
+
+    // Release fully written segments, and advance the partially written one
+    for (size_t left = n; left; ) {
+      auto& iov = m_segs.front().iov;
+      if (left < iov.iov_len) {
+        iov.iov_base = static_cast<char*>(iov.iov_base) + left;
+        iov.iov_len -= left;
+        break;
+      }
+      left -= iov.iov_len;
+      m_segs.pop_front();
+    }
+
+    // A short write means that the socket's send buffer is full
+    if (n < len)
+      break;
+  }
+
+  return total;
+}
+
+//------------------------------------------------------------------------------
+void WrQueue::
+Clear()
+{
+  m_segs.clear();
+  m_bytes = 0;
+}
+
+} // namespace io
+} // namespace utxx
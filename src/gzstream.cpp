@@ -27,8 +27,12 @@
 //==============================================================================
 
 #include <utxx/gzstream.hpp>
+#include <utxx/error.hpp>
 #include <iostream>
 #include <string.h>  // for memcpy
+#include <errno.h>
+#include <unistd.h>
+#include <sys/stat.h>
 
 namespace utxx {
 
@@ -152,4 +156,309 @@ namespace detail {
     }
 
 } // namespace detail
+
+//------------------------------------------------------------------------------
+// class gzframe_writer:
+//------------------------------------------------------------------------------
+gzframe_writer::gzframe_writer(int a_level, size_t a_frame_size)
+    : m_level(a_level)
+    , m_frame_size(a_frame_size ? a_frame_size : 1)
+    , m_frame_in(0)
+    , m_bytes_in(0)
+    , m_bytes_out(0)
+    , m_frames(0)
+    , m_buf(256*1024)
+    , m_off(-1)
+    , m_sync_off(-1)
+    , m_sync_crc(0)
+    , m_rollback{0, 0, -1, 0, 0}
+{
+    memset(&m_zs, 0, sizeof(m_zs));
+    // 15+16 window bits produce the gzip header and trailer
+    if (deflateInit2(&m_zs, a_level, Z_DEFLATED, 15+16, 8,
+                     Z_DEFAULT_STRATEGY) != Z_OK)
+        UTXX_THROW_RUNTIME_ERROR("Cannot initialize zlib compressor: ",
+                                 m_zs.msg ? m_zs.msg : "invalid level");
+    m_zs.next_out  = reinterpret_cast<Bytef*>(m_buf.data());
+    m_zs.avail_out = m_buf.size();
+}
+
+gzframe_writer::~gzframe_writer() {
+    deflateEnd(&m_zs);
+}
+
+int gzframe_writer::flush(int a_fd) {
+    const char* p = m_buf.data();
+    size_t      n = m_buf.size() - m_zs.avail_out;
+
+    while (n) {
+        auto m = ::write(a_fd, p, n);
+        if (m < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        p += m;
+        n -= m;
+        m_off       += m;
+        m_bytes_out += m;
+    }
+
+    m_zs.next_out  = reinterpret_cast<Bytef*>(m_buf.data());
+    m_zs.avail_out = m_buf.size();
+    return 0;
+}
+
+int gzframe_writer::deflate(int a_fd, int a_flush) {
+    while (true) {
+        int rc = ::deflate(&m_zs, a_flush);
+        if (rc == Z_STREAM_ERROR) {
+            errno = EIO;
+            return -1;
+        }
+        // Stop when the input is consumed and deflate has room to spare
+        // (for Z_FINISH until the end of stream)
+        bool done = a_flush == Z_FINISH
+                  ? rc == Z_STREAM_END
+                  : !m_zs.avail_in && m_zs.avail_out;
+        if (done)
+            return 0;
+        if (!m_zs.avail_out && flush(a_fd) < 0)
+            return -1;
+    }
+}
+
+void gzframe_writer::start(int a_fd) {
+    // Only the output to a regular file can be rolled back on error
+    struct stat st;
+    if (::fstat(a_fd, &st) < 0 || !S_ISREG(st.st_mode)) {
+        m_off = m_sync_off = -1;
+        return;
+    }
+    m_off         = m_sync_off = st.st_size;
+    m_sync_crc    = crc32(0L, Z_NULL, 0);
+    m_rollback.dev = st.st_dev;
+    m_rollback.ino = st.st_ino;
+}
+
+long gzframe_writer::write(int a_fd, const iovec* a_data, size_t a_size) {
+    size_t n = 0;
+    for (size_t i = 0; i < a_size; ++i)
+        n += a_data[i].iov_len;
+
+    // Don't start a frame without data
+    if (!n)
+        return 0;
+
+    if (m_rollback.off >= 0 && roll_back(a_fd) < 0)
+        return -1;
+
+    if (!m_frame_in)
+        start(a_fd);
+
+    for (size_t i = 0; i < a_size; ++i) {
+        m_zs.next_in  = static_cast<Bytef*>(a_data[i].iov_base);
+        m_zs.avail_in = a_data[i].iov_len;
+
+        if (deflate(a_fd, Z_NO_FLUSH) < 0)
+            return fail(a_fd);
+    }
+
+    // Finish the frame when it's full, otherwise make all the input written
+    // so far decompressible
+    bool last = m_frame_in + n >= m_frame_size;
+
+    if (deflate(a_fd, last ? Z_FINISH : Z_SYNC_FLUSH) < 0 || flush(a_fd) < 0)
+        return fail(a_fd);
+
+    m_bytes_in += n;
+
+    if (last) {
+        reset();
+        ++m_frames;
+    } else {
+        m_frame_in += n;
+        m_sync_off  = m_off;
+        m_sync_crc  = m_zs.adler;   // CRC32 of the frame's input
+    }
+
+    return long(n);
+}
+
+int gzframe_writer::finish(int a_fd) {
+    if (m_rollback.off >= 0 && roll_back(a_fd) < 0)
+        return -1;
+    if (!m_frame_in)
+        return 0;
+    if (deflate(a_fd, Z_FINISH) < 0 || flush(a_fd) < 0)
+        return int(fail(a_fd));
+    reset();
+    ++m_frames;
+    return 0;
+}
+
+void gzframe_writer::reset() {
+    deflateReset(&m_zs);
+    m_zs.next_out  = reinterpret_cast<Bytef*>(m_buf.data());
+    m_zs.avail_out = m_buf.size();
+    m_frame_in     = 0;
+    m_sync_off     = -1;
+}
+
+long gzframe_writer::fail(int a_fd) {
+    int err = errno;
+
+    // Cut the partial output of this write and terminate the frame at the
+    // last sync flush point.  If that fails, it is retried by the next write
+    // to the same file, as the stream may be reconnected
+    if (m_sync_off >= 0) {
+        m_rollback.off = m_sync_off;
+        m_rollback.crc = m_sync_crc;
+        m_rollback.len = m_frame_in;
+        roll_back(a_fd);
+    }
+
+    reset();
+    errno = err;
+    return -1;
+}
+
+int gzframe_writer::roll_back(int a_fd) {
+    struct stat st;
+    if (::fstat(a_fd, &st) < 0)
+        return -1;
+
+    // A different file: the old one is fixed by recover() when reopened
+    if (st.st_dev != m_rollback.dev || st.st_ino != m_rollback.ino) {
+        m_rollback.off = -1;
+        return 0;
+    }
+
+    if (terminate(a_fd, m_rollback.off, m_rollback.crc, m_rollback.len) < 0)
+        return -1;
+
+    if (m_rollback.len)
+        ++m_frames;
+    m_rollback.off = -1;
+    return 0;
+}
+
+int gzframe_writer::terminate(int a_fd, off_t a_off, uLong a_crc, uLong a_len) {
+    if (::ftruncate(a_fd, a_off) < 0)
+        return -1;
+    if (!a_len)
+        return 0;
+
+    // The deflate stream ends on a byte boundary after a sync flush, so it's
+    // terminated by an empty final stored block followed by the gzip trailer
+    // (CRC32 and uncompressed size in little-endian order)
+    unsigned char buf[13] = {1, 0, 0, 0xFF, 0xFF};
+    for (int i = 0; i < 4; ++i) {
+        buf[5+i] = (a_crc >> (8*i)) & 0xFF;
+        buf[9+i] = (a_len >> (8*i)) & 0xFF;
+    }
+
+    // Note that with O_APPEND pwrite(2) appends to the end of file, which
+    // is a_off after the truncation
+    for (size_t n = 0; n < sizeof(buf); ) {
+        auto m = ::pwrite(a_fd, buf + n, sizeof(buf) - n, a_off + n);
+        if (m < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        n += m;
+    }
+    return 0;
+}
+
+int gzframe_writer::recover(int a_fd) {
+    struct stat st;
+    if (::fstat(a_fd, &st) < 0)
+        return -1;
+    if (!S_ISREG(st.st_mode) || !st.st_size)
+        return 0;
+
+    z_stream zs;
+    memset(&zs, 0, sizeof(zs));
+    if (inflateInit2(&zs, 15+16) != Z_OK) {
+        errno = ENOMEM;
+        return -1;
+    }
+
+    std::vector<Bytef> in(256*1024), out(256*1024);
+    off_t pos       = 0;        // File offset past the input read so far
+    off_t member    = 0;        // Offset of the current gzip member
+    off_t good      = -1;       // Offset of the last sync point in the member
+    uLong crc       = 0,  good_crc = 0;
+    uLong len       = 0,  good_len = 0;
+    bool  in_member = false;
+    int   rc        = Z_OK;
+
+    while (true) {
+        if (!zs.avail_in) {
+            auto n = ::pread(a_fd, in.data(), in.size(), pos);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                int e = errno;
+                inflateEnd(&zs);
+                errno = e;
+                return -1;
+            }
+            if (!n)
+                break;
+            zs.next_in  = in.data();
+            zs.avail_in = n;
+            pos        += n;
+        }
+
+        if (!in_member) {
+            member    = pos - zs.avail_in;
+            good      = -1;
+            crc       = crc32(0L, Z_NULL, 0);
+            len       = 0;
+            in_member = true;
+        }
+
+        // Z_BLOCK stops at every deflate block boundary
+        zs.next_out  = out.data();
+        zs.avail_out = out.size();
+        rc = inflate(&zs, Z_BLOCK);
+
+        auto produced = out.size() - zs.avail_out;
+        crc  = crc32(crc, out.data(), produced);
+        len += produced;
+
+        if (rc == Z_STREAM_END) {
+            inflateReset(&zs);
+            in_member = false;
+            continue;
+        }
+        if (rc != Z_OK && rc != Z_BUF_ERROR)
+            break;
+
+        // A sync flush ends with an empty stored block, so a point where
+        // the stream can be terminated is a byte-aligned block boundary
+        if ((zs.data_type & 128) && !(zs.data_type & (64|7))) {
+            good     = pos - zs.avail_in;
+            good_crc = crc;
+            good_len = len;
+        }
+    }
+
+    inflateEnd(&zs);
+
+    // The file ends with a complete member
+    if (!in_member)
+        return 0;
+
+    // Don't touch a file that doesn't start with a valid gzip member
+    if (!member && good < 0 && rc != Z_OK && rc != Z_BUF_ERROR) {
+        errno = EILSEQ;
+        return -1;
+    }
+
+    return good < 0 || !good_len
+         ? terminate(a_fd, member, 0, 0)
+         : terminate(a_fd, good,   good_crc, good_len);
+}
+
 } // namespace utxx
\ No newline at end of file
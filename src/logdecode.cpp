@@ -0,0 +1,122 @@
+//------------------------------------------------------------------------------
+/// \file  logdecode.cpp
+//------------------------------------------------------------------------------
+/// \brief Utility for decoding binary log files written by the "binfile"
+///        logger back-end
+//------------------------------------------------------------------------------
+// Copyright (c) 2026 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-16
+//------------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the utxx open-source project.
+
+Copyright (C) 2026 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+#include <iostream>
+#include <fstream>
+#include <utxx/logger/logger_binary.hpp>
+#include <utxx/path.hpp>
+#include <utxx/get_option.hpp>
+#include <utxx/timestamp.hpp>
+#include <utxx/version.hpp>
+
+using namespace std;
+
+//------------------------------------------------------------------------------
+void usage(std::string const& err="")
+{
+    auto prog = utxx::path::basename(
+        utxx::path::program::name().c_str(),
+        utxx::path::program::name().c_str() + utxx::path::program::name().size()
+    );
+
+    if (!err.empty())
+        cerr << "Invalid option: " << err << "\n\n";
+    else {
+        cerr << prog <<
+        " - Tool for decoding binary log files\n"
+        "Copyright (c) 2026 Serge Aleynikov\n"  <<
+        VERSION() << "\n\n"                     <<
+        "Usage: " << prog                       <<
+        " [-V] [-h] -f InputFile [-o OutputFile] [-t Timestamp] [-l]\n\n"
+        "   -V|--version            - Version\n"
+        "   -h|--help               - Help screen\n"
+        "   -f InputFile            - Input binary log file name\n"
+        "   -o OutputFile           - Ouput file name (default: stdout)\n"
+        "   -t|--timestamp Type     - Timestamp format (default: date-time-usec)\n"
+        "   -l|--location           - Include source location of messages\n\n";
+    }
+
+    exit(1);
+}
+
+//------------------------------------------------------------------------------
+void unhandled_exception() {
+  auto p = current_exception();
+  try    { rethrow_exception(p); }
+  catch  ( exception& e ) { cerr << e.what() << endl; }
+  catch  ( ... )          { cerr << "Unknown exception" << endl; }
+  exit(1);
+}
+
+//------------------------------------------------------------------------------
+//  MAIN
+//------------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+    string in_file;
+    string out_file;
+    string ts("date-time-usec");
+    bool   location = false;
+
+    set_terminate (&unhandled_exception);
+
+    utxx::opts_parser opts(argc, argv);
+
+    while (opts.next()) {
+        if (opts.match("-f", "",            &in_file))  continue;
+        if (opts.match("-o", "",            &out_file)) continue;
+        if (opts.match("-t", "--timestamp", &ts))       continue;
+        if (opts.match("-l", "--location",  &location)) continue;
+        if (opts.match("-V", "--version")) throw std::runtime_error(VERSION());
+        if (opts.is_help())                             usage();
+
+        usage(opts());
+    }
+
+    if (in_file.empty())
+        throw std::runtime_error("Must specify -f option!");
+
+    auto stamp = utxx::parse_stamp_type(ts);
+    if ((int)stamp < 0)
+        throw std::runtime_error("Invalid timestamp type: " + ts);
+
+    ofstream fout;
+    if (!out_file.empty()) {
+        fout.open(out_file);
+        if (!fout)
+            throw std::runtime_error("Error creating file " + out_file + ": " + strerror(errno));
+    }
+
+    utxx::bin_log::decode(in_file, out_file.empty() ? cout : fout, stamp, location);
+
+    return 0;
+}
@@ -229,9 +229,18 @@ void logger::init(const config_tree& a_cfg, const sigset_t* a_ignore_signals,
         m_sched_yield_us = a_cfg.get<long>       ("logger.sched-yield-us",  -1);
         m_silent_finish  = a_cfg.get<bool>       ("logger.silent-finish",   false);
         m_block_signals  = a_cfg.get<bool>       ("logger.block-signals",   true);
+        auto batch_size  = a_cfg.get<int>        ("logger.batch-size",      1024);
+        auto lane_cap    = a_cfg.get<int>        ("logger.lane-capacity",   0);
 
         if ((int)m_timestamp_type < 0)
             UTXX_THROW_RUNTIME_ERROR("Invalid logger timestamp type: ", ts);
+        if (batch_size < 0)
+            UTXX_THROW_RUNTIME_ERROR("Invalid logger batch size: ", batch_size);
+        m_batch_size     = size_t(batch_size);
+        if (lane_cap < 0)
+            UTXX_THROW_RUNTIME_ERROR("Invalid logger lane capacity: ", lane_cap);
+        m_lane_capacity  = uint32_t(lane_cap);
+        retire_lanes();
 
         // Install crash signal handlers
         // (SIGABRT, SIGFPE, SIGILL, SIGSEGV, SIGTERM)
@@ -327,23 +336,28 @@ void logger::run()
         event_val = m_event.value();
         //wakeup_result rc = wakeup_result::TIMEDOUT;
 
-        while (!m_abort && m_queue.empty()) {
+        while (!m_abort) {
+            m_sleeping.store(true, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (!queues_empty())
+                break;
             m_event.wait(&m_wait_timeout, &event_val);
 
             ASYNC_DEBUG_TRACE(
                 ("  %s LOGGER awakened (res=%s, val=%d, futex=%d), abort=%d, head=%s\n",
                  timestamp::to_string().c_str(), to_string(rc).c_str(),
                  event_val, m_event.value(), m_abort,
-                 m_queue.empty() ? "empty" : "data")
+                 queues_empty() ? "empty" : "data")
             );
         }
+        m_sleeping.store(false, std::memory_order_relaxed);
 
         // When running with maximum priority, occasionally excessive use of
         // sched_yield may cause a system slowdown, so this option is
         // configurable by m_sched_yield_us:
-        if (m_queue.empty() && m_sched_yield_us >= 0) {
+        if (queues_empty() && m_sched_yield_us >= 0) {
             time_val deadline(rel_time(0, m_sched_yield_us));
-            while (!m_abort && m_queue.empty()) {
+            while (!m_abort && queues_empty()) {
                 if (now_utc() > deadline)
                     break;
                 sched_yield();
@@ -371,30 +385,74 @@ void logger::run()
 
 bool logger::flush_internal()
 {
-    // Get all pending items from the queue
-    for (auto* item = m_queue.pop_all(), *next=item; item; item = next) {
-        next = item->next();
+    if (m_lanes->changed.load(std::memory_order_acquire))
+        refresh_lanes();
+
+    // Note the number of messages in each lane before taking the shared
+    // queue, so that when a full lane overflows to the shared queue, the
+    // overflow message is never delivered after a later message of the
+    // same thread placed in the lane
+    for (size_t i=0; i < m_active_lanes.size(); ++i)
+        m_lane_avail[i] = m_active_lanes[i]->queue.count(lane_queue::side_t::consumer);
+
+    // Get all pending items from the shared queue
+    auto* item = m_queue.pop_all();
+
+    size_t limit = m_batch_size ? m_batch_size : 1;
+
+    while (true) {
+        // Merge the shared queue and the per-thread lanes by timestamp taking
+        // the next chunk of at most m_batch_size messages.  Messages are
+        // formatted in-place, and are released after they are delivered.
+        auto* head = item;
+        m_batch_msgs.clear();
+        std::fill(m_lane_taken.begin(), m_lane_taken.end(), 0);
+
+        while (m_batch_msgs.size() < limit) {
+            const msg* next = item ? &item->data() : nullptr;
+            int        src  = -1;
+
+            for (size_t i=0; i < m_active_lanes.size(); ++i) {
+                if (m_lane_taken[i] == m_lane_avail[i])
+                    continue;
+                auto* m = m_active_lanes[i]->queue.peek(m_lane_taken[i]);
+                // On equal timestamps the shared queue goes first unless
+                // the lane message was logged earlier by the same thread
+                if (!next || m->before(*next))
+                    next = m, src = int(i);
+            }
+
+            if (!next)
+                break;
+
+            m_batch_msgs.push_back(next);
+
+            if (src < 0)
+                item = item->next();
+            else
+                m_lane_taken[src]++;
+        }
 
-        try   { dolog_msg(item->data()); }
+        if (m_batch_msgs.empty())
+            break;
+
+        try {
+            if (m_batch_size)
+                dolog_batch();
+            else
+                dolog_msg(*m_batch_msgs[0]);
+        }
         catch ( std::exception const& e  )
         {
             // Unhandled error writing data to some destination
             // Print error report to stderr (can't do anything better --
             // the error happened in the m_on_error callback!)
             const msg msg(LEVEL_INFO, "",
-                          std::string("Fatal exception in logger"),
+                          std::string("Fatal exception in logger: ") + e.what(),
                           UTXX_LOG_SRCINFO);
-            basic_buffered_print<1024> buf;
-            char  pfx[256], sfx[256];
-            char* p = format_header(msg, pfx, pfx + sizeof(pfx));
-            char* q = format_footer(msg, sfx, sfx + sizeof(sfx));
-            auto ps = p - pfx;
-            auto qs = q - sfx;
-            buf.reserve(msg.m_fun.str.size() + ps + qs + 1);
-            buf.sprint(pfx, ps);
-            buf.print(msg.m_fun.str);
-            buf.sprint(sfx, qs);
-            std::cerr << buf.str() << std::endl;
+            basic_io_buffer<1024> buf;
+            auto  sz = format_msg(msg, buf.to_dynamic());
+            std::cerr << std::string(buf.rd_ptr(), sz) << std::flush;
 
             m_abort = true;
 
@@ -402,22 +460,206 @@ bool logger::flush_internal()
             // other medium
 
             // Free all pending messages
-            while (item) {
-                m_queue.free(item);
-                item = next;
-                next = item->next();
+            for (auto* next = head; head; head = next) {
+                next = head->next();
+                m_queue.free(head);
             }
+            for (auto* l : m_active_lanes)
+                l->queue.clear();
 
             return false;
         }
 
-        m_queue.free(item);
-        item = next;
+        for (auto* next = head; head != item; head = next) {
+            next = head->next();
+            m_queue.free(head);
+        }
+        for (size_t i=0; i < m_active_lanes.size(); ++i) {
+            m_lane_avail[i] -= m_lane_taken[i];
+            for (auto n = m_lane_taken[i]; n; --n)
+                m_active_lanes[i]->queue.pop();
+        }
+    }
+
+    return true;
+}
+
+logger::lane* logger::register_lane(lane_ref& a_ref)
+{
+    a_ref.release();
+
+    std::unique_ptr<lane> l(new lane(m_lane_capacity));
+
+    std::lock_guard<std::mutex> g(m_lanes->mutex);
+    a_ref.reg = m_lanes;
+    a_ref.ptr = l.get();
+    a_ref.gen = m_lanes->gen.load(std::memory_order_relaxed);
+    m_lanes->lanes.push_back(std::move(l));
+    m_lanes->changed.store(true, std::memory_order_release);
+    return a_ref.ptr;
+}
+
+void logger::lane_ref::release()
+{
+    if (!ptr)
+        return;
+    // The lane is freed by the logger thread after it's drained, or right
+    // away if the logger was destroyed
+    {
+        std::lock_guard<std::mutex> g(reg->mutex);
+        if (reg->detached) {
+            auto& v = reg->lanes;
+            v.erase(std::find_if(v.begin(), v.end(),
+                    [this](const std::unique_ptr<lane>& l) {
+                        return l.get() == ptr;
+                    }));
+        } else {
+            ptr->orphan.store(true, std::memory_order_release);
+            reg->changed.store(true, std::memory_order_release);
+        }
     }
+    reg.reset();
+    ptr = nullptr;
+}
+
+void logger::refresh_lanes()
+{
+    auto& r = *m_lanes;
+    std::lock_guard<std::mutex> g(r.mutex);
+    r.changed.store(false, std::memory_order_relaxed);
+
+    auto it = std::remove_if(r.lanes.begin(), r.lanes.end(),
+        [&r](const std::unique_ptr<lane>& l) {
+            if (!l->orphan.load(std::memory_order_acquire))
+                return false;
+            if (l->queue.empty())
+                return true;
+            // Check this lane again on the next flush after it's drained
+            r.changed.store(true, std::memory_order_relaxed);
+            return false;
+        });
+    r.lanes.erase(it, r.lanes.end());
+
+    m_active_lanes.clear();
+    for (auto& l : r.lanes)
+        m_active_lanes.push_back(l.get());
+    m_lane_taken.resize(m_active_lanes.size());
+    m_lane_avail.resize(m_active_lanes.size());
+}
+
+bool logger::queues_empty()
+{
+    if (!m_queue.empty())
+        return false;
+
+    if (m_lanes->changed.load(std::memory_order_acquire))
+        refresh_lanes();
+
+    for (auto* l : m_active_lanes)
+        if (!l->queue.empty())
+            return false;
 
     return true;
 }
 
+void logger::dolog_batch()
+{
+    m_batch_arena.reset();
+    m_batch_iov.clear();
+
+    bool     fatal  = false;
+    uint32_t levels = 0;
+
+    for (size_t i=0; i < m_batch_msgs.size(); ++i) {
+        auto& m = *m_batch_msgs[i];
+        auto  n = needs_text(m) ? format_msg(m, m_batch_arena) : 0;
+        // The arena may be reallocated while formatting, so store the
+        // message offset in iov_base, and convert it to a pointer below
+        m_batch_iov.push_back
+            (iovec{(void*)(m_batch_arena.size() - n), n});
+        levels |= m.level();
+
+        // The fatal message terminates the process, so messages queued
+        // after it are not delivered
+        if (fatal_kill_signal() && m.level() == LEVEL_FATAL) {
+            m_batch_msgs.resize(i+1);
+            fatal = true;
+            break;
+        }
+    }
+
+    for (auto& v : m_batch_iov)
+        v.iov_base = m_batch_arena.rd_ptr() + (size_t)v.iov_base;
+
+    try {
+        dispatch(msg_batch(m_batch_msgs.data(), m_batch_iov.data(),
+                           m_batch_msgs.size(), m_batch_arena.size()),
+                 levels);
+    } catch (std::runtime_error& e) {
+        if (m_error)
+            m_error(e.what());
+        else
+            throw;
+    }
+
+    if (fatal) {
+        auto& v = m_batch_iov.back();
+        m_abort = true;
+        dolog_fatal_msg((const char*)v.iov_base, v.iov_len);
+    }
+}
+
+void logger::dispatch(const msg_batch& a_batch, uint32_t a_levels)
+{
+    for (auto& s : m_batch_sinks) {
+        // Most of the time a sink accepts all levels present in the batch
+        if ((s.levels & a_levels) == a_levels) {
+            s.sink(a_batch);
+            continue;
+        }
+        if (!(s.levels & a_levels))
+            continue;
+
+        m_batch_sel_msgs.clear();
+        m_batch_sel_iov.clear();
+        size_t bytes = 0;
+
+        for (size_t i=0; i < a_batch.size(); ++i) {
+            auto& m = a_batch.message(i);
+            if (!(s.levels & m.level()))
+                continue;
+            m_batch_sel_msgs.push_back(&m);
+            m_batch_sel_iov.push_back(a_batch.iov()[i]);
+            bytes += a_batch.iov()[i].iov_len;
+        }
+
+        s.sink(msg_batch(m_batch_sel_msgs.data(), m_batch_sel_iov.data(),
+                         m_batch_sel_msgs.size(), bytes));
+    }
+
+    for (size_t i=0; i < a_batch.size(); ++i) {
+        auto& m = a_batch.message(i);
+        auto& v = a_batch.iov()[i];
+        m_sig_slot[level_to_signal_slot(m.level())](
+            on_msg_delegate_t::invoker_type(m, (const char*)v.iov_base, v.iov_len));
+    }
+}
+
+logger::~logger()
+{
+    finalize();
+
+    // Lanes released by their threads can't be drained anymore, and the
+    // lanes still in use are freed by their threads on release
+    std::lock_guard<std::mutex> g(m_lanes->mutex);
+    m_lanes->detached = true;
+    auto& v = m_lanes->lanes;
+    v.erase(std::remove_if(v.begin(), v.end(),
+            [](const std::unique_ptr<lane>& l) {
+                return l->orphan.load(std::memory_order_relaxed);
+            }), v.end());
+}
+
 void logger::finalize()
 {
     if (!m_initialized)
@@ -449,6 +691,16 @@ void logger::do_finalize()
         delete sset;
 }
 
+void logger::retire_lanes()
+{
+    // A lane can't be freed while its thread may be pushing to it, so the
+    // messages left in it are delivered by the new logger thread, and it's
+    // freed once its thread registers a lane of the new capacity
+    std::lock_guard<std::mutex> g(m_lanes->mutex);
+    m_lanes->gen.fetch_add(1, std::memory_order_relaxed);
+    m_lanes->changed.store(true, std::memory_order_release);
+}
+
 char* logger::
 format_header(const logger::msg& a_msg, char* a_buf, const char* a_end)
 {
@@ -514,71 +766,96 @@ format_footer(const logger::msg& a_msg, char* a_buf, const char* a_end)
     return p;
 }
 
+size_t logger::format_msg(const logger::msg& a_msg, dynamic_io_buffer& a_buf)
+{
+    // Space reserved for the message header and footer
+    static const size_t s_hdr_sz = 512;
+
+    auto reserve = [&a_buf](size_t n) {
+        // Grow the buffer geometrically to amortize reallocations
+        if (a_buf.capacity() < n)
+            a_buf.reserve(std::max(n, a_buf.max_size()));
+        return a_buf.wr_ptr();
+    };
+
+    char* buf;
+    char* p;
+
+    switch (a_msg.m_type) {
+        case payload_t::CHAR_FUN: {
+            assert(a_msg.m_fun.cf);
+            static const size_t s_max_sz = 4096;
+            buf       = reserve(s_max_sz + s_hdr_sz);
+            auto* end = buf + s_max_sz;
+            p         = format_header(a_msg, buf,  end);
+            int   n   = (a_msg.m_fun.cf)(p,  end - p);
+            // The function may return the size it would've written in absence
+            // of space in the buffer (e.g. snprintf)
+            n         = std::max(0, std::min<int>(n, end - p - 1));
+            if (n && p[n-1] == '\n') --p;
+            p = format_footer(a_msg, p+n,  end + s_hdr_sz);
+            break;
+        }
+        case payload_t::BIN: {
+            auto&   b = a_msg.m_fun.bin;
+            auto  max = b.fmt->max_render_size(b.size);
+            buf       = reserve(max + 2*s_hdr_sz);
+            p         = format_header(a_msg, buf, buf + s_hdr_sz);
+            p        += b.fmt->render(b.data, b.size, p, max);
+            p         = format_footer(a_msg, p, p + s_hdr_sz);
+            break;
+        }
+        case payload_t::STR_FUN: {
+            assert(a_msg.m_fun.sf);
+            char  pfx[256], sfx[256];
+            sfx[0]    = '\0';
+            char*   q = format_header(a_msg, pfx, pfx + sizeof(pfx));
+            char*   r = format_footer(a_msg, sfx+1, sfx + sizeof(sfx));
+            auto  res = (a_msg.m_fun.sf)(pfx, q - pfx, sfx+1, r - sfx - 1);
+            buf       = reserve(res.size() + 1);
+            p         = buf + res.size();
+            memcpy(buf, res.c_str(), res.size());
+            break;
+        }
+#if __cplusplus >= 201703L
+        case payload_t::STR_VIEW:
+#endif
+        case payload_t::STR: {
+#if __cplusplus >= 201703L
+            auto s  = a_msg.m_type == payload_t::STR
+                    ? std::string_view(a_msg.m_fun.str) : a_msg.m_fun.strv;
+#else
+            auto& s = a_msg.m_fun.str;
+#endif
+            // Remove trailing new lines
+            auto sz = s.size();
+            while (sz && s[sz-1] == '\n') --sz;
+            buf     = reserve(sz + 2*s_hdr_sz);
+            p       = format_header(a_msg, buf, buf + s_hdr_sz);
+            memcpy(p, s.data(), sz);
+            p       = format_footer(a_msg, p + sz, p + sz + s_hdr_sz);
+            break;
+        }
+        default:
+            return 0;
+    }
+
+    a_buf.commit(p - buf);
+    return p - buf;
+}
+
 void logger::dolog_msg(const logger::msg& a_msg) {
     try {
-        switch (a_msg.m_type) {
-            case payload_t::CHAR_FUN: {
-                assert(a_msg.m_fun.cf);
-                char  buf[4096];
-                auto* end = buf + sizeof(buf);
-                char*   p = format_header(a_msg, buf,  end);
-                int     n = (a_msg.m_fun.cf)(p,  end - p);
-                if (p[n-1] == '\n') --p;
-                p = format_footer(a_msg, p+n,  end);
-                m_sig_slot[level_to_signal_slot(a_msg.level())](
-                    on_msg_delegate_t::invoker_type(a_msg, buf, p - buf));
-
-                if (fatal_kill_signal() && a_msg.level() == LEVEL_FATAL) {
-                    m_abort = true;
-                    dolog_fatal_msg(buf, p - buf);
-                }
+        basic_io_buffer<1024> buf;
+        auto     sz  = needs_text(a_msg) ? format_msg(a_msg, buf.to_dynamic()) : 0;
+        auto     m   = &a_msg;
+        iovec    iov{buf.rd_ptr(), sz};
 
-                break;
-            }
-            case payload_t::STR_FUN: {
-                assert(a_msg.m_fun.cf);
-                char  pfx[256], sfx[256];
-                char*   p = format_header(a_msg, pfx, pfx + sizeof(pfx));
-                char*   q = format_footer(a_msg, sfx, sfx + sizeof(sfx));
-                auto  res = (a_msg.m_fun.sf)(pfx, p - pfx, sfx, q - sfx);
-                m_sig_slot[level_to_signal_slot(a_msg.level())](
-                    on_msg_delegate_t::invoker_type(a_msg, res.c_str(), res.size()));
-
-                if (fatal_kill_signal() && a_msg.level() == LEVEL_FATAL) {
-                    m_abort = true;
-                    dolog_fatal_msg(res.c_str(), res.size());
-                }
+        dispatch(msg_batch(&m, &iov, 1, sz), a_msg.level());
 
-                break;
-            }
-#if __cplusplus >= 201703L
-            case payload_t::STR_VIEW:
-#endif
-            case payload_t::STR: {
-                basic_buffered_print<1024> buf;
-                char  pfx[256], sfx[256];
-                char* p = format_header(a_msg, pfx, pfx + sizeof(pfx));
-                char* q = format_footer(a_msg, sfx, sfx + sizeof(sfx));
-                auto ps = p - pfx;
-                auto qs = q - sfx;
-                buf.reserve(a_msg.m_fun.str.size() + ps + qs + 1);
-                buf.sprint(pfx, ps);
-                auto& s = a_msg.m_fun.str;
-                // Remove trailing new lines
-                auto sz = int(s.size());
-                while (sz && s[sz-1] == '\n') --sz;
-                buf.sprint(s.c_str(), sz);
-                buf.sprint(sfx, qs);
-                m_sig_slot[level_to_signal_slot(a_msg.level())](
-                    on_msg_delegate_t::invoker_type(a_msg, buf.str(), buf.size()));
-
-                if (fatal_kill_signal() && a_msg.level() == LEVEL_FATAL) {
-                    m_abort = true;
-                    dolog_fatal_msg(buf.c_str(), buf.size());
-                }
-
-                break;
-            }
+        if (fatal_kill_signal() && a_msg.level() == LEVEL_FATAL) {
+            m_abort = true;
+            dolog_fatal_msg(buf.rd_ptr(), sz);
         }
     } catch (std::runtime_error& e) {
         if (m_error)
@@ -640,12 +917,45 @@ void logger::set_min_level_filter(log_level a_level) {
 
 int logger::add(log_level level, on_msg_delegate_t subscriber)
 {
-    return m_sig_slot[level_to_signal_slot(level)].connect(subscriber);
+    auto id = m_sig_slot[level_to_signal_slot(level)].connect(subscriber);
+    update_text_levels();
+    return id;
 }
 
 void logger::remove(log_level a_lvl, int a_id)
 {
     m_sig_slot[level_to_signal_slot(a_lvl)].disconnect(a_id);
+    update_text_levels();
+}
+
+int logger::add_batch(uint32_t a_levels, on_batch_delegate_t a_subscriber,
+                      bool a_text)
+{
+    m_batch_sinks.push_back
+        (batch_sink{++m_batch_sink_count, a_levels, a_subscriber, a_text});
+    update_text_levels();
+    return m_batch_sink_count;
+}
+
+void logger::remove_batch(int a_id)
+{
+    m_batch_sinks.erase(
+        std::remove_if(m_batch_sinks.begin(), m_batch_sinks.end(),
+                       [a_id](auto& s) { return s.id == a_id; }),
+        m_batch_sinks.end());
+    update_text_levels();
+}
+
+void logger::update_text_levels()
+{
+    uint32_t levels = 0;
+    for (int i=0; i < NLEVELS; ++i)
+        if (!m_sig_slot[i].empty())
+            levels |= signal_slot_to_level(i);
+    for (auto& s : m_batch_sinks)
+        if (s.text)
+            levels |= s.levels;
+    m_text_levels = levels;
 }
 
 std::ostream& logger::dump(std::ostream& out) const
@@ -677,6 +987,7 @@ std::ostream& logger::dump(std::ostream& out) const
 //-----------------------------------------------------------------------------
 logger_impl::logger_impl()
     : m_log_mgr(NULL)
+    , m_batch_sink_id(-1)
 {
     for (int i=0; i < logger::NLEVELS; ++i)
         m_msg_sink_id[i] = -1;
@@ -691,13 +1002,27 @@ logger_impl::~logger_impl()
                 m_log_mgr->remove(level, m_msg_sink_id[i]);
                 m_msg_sink_id[i] = -1;
             }
+        if (m_batch_sink_id != -1) {
+            m_log_mgr->remove_batch(m_batch_sink_id);
+            m_batch_sink_id = -1;
+        }
     }
 }
 
 void logger_impl::add(log_level level, logger::on_msg_delegate_t subscriber)
 {
+    if (!m_log_mgr)
+        UTXX_THROW_RUNTIME_ERROR("Logger implementation is not attached to a logger");
     m_msg_sink_id[logger::level_to_signal_slot(level)] =
         m_log_mgr->add(level, subscriber);
 }
 
+void logger_impl::add_batch(uint32_t a_levels, logger::on_batch_delegate_t subscriber,
+                            bool a_text)
+{
+    if (!m_log_mgr)
+        UTXX_THROW_RUNTIME_ERROR("Logger implementation is not attached to a logger");
+    m_batch_sink_id = m_log_mgr->add_batch(a_levels, subscriber, a_text);
+}
+
 } // namespace utxx
@@ -0,0 +1,352 @@
+//------------------------------------------------------------------------------
+/// \file   logger_binary.cpp
+/// \author Serge Aleynikov
+//------------------------------------------------------------------------------
+/// \brief Rendering and decoding of binary (deferred) log messages.
+//------------------------------------------------------------------------------
+// Copyright (C) 2026 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-16
+//------------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the utxx open-source project.
+
+Copyright (C) 2026 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+#include <utxx/logger/logger_binary.hpp>
+#include <utxx/logger/logger_enums.hpp>
+#include <utxx/logger/logger_util.hpp>
+#include <utxx/convert.hpp>
+#include <utxx/error.hpp>
+#include <utxx/path.hpp>
+#include <utxx/timestamp.hpp>
+#include <unordered_map>
+#include <ostream>
+#include <vector>
+#include <stdio.h>
+
+namespace utxx {
+
+namespace {
+    /// @return size of the encoded argument of type \a a_type located at
+    ///         \a a_data or 0 if it doesn't fit before \a a_end
+    size_t bin_arg_size(bin_arg_type a_type, const char* a_data, const char* a_end)
+    {
+        size_t n;
+        switch (a_type) {
+            case bin_arg_type::BOOL:
+            case bin_arg_type::CHAR:    n = 1; break;
+            case bin_arg_type::INT32:
+            case bin_arg_type::UINT32:  n = 4; break;
+            case bin_arg_type::INT64:
+            case bin_arg_type::UINT64:
+            case bin_arg_type::DOUBLE:
+            case bin_arg_type::PTR:     n = 8; break;
+            case bin_arg_type::STR: {
+                uint16_t len;
+                if (a_end - a_data < (long)sizeof(len))
+                    return 0;
+                memcpy(&len, a_data, sizeof(len));
+                n = sizeof(len) + len;
+                break;
+            }
+            default:
+                return 0;
+        }
+        return a_end - a_data < (long)n ? 0 : n;
+    }
+
+    template <typename T>
+    T bin_get(const char* a_data) { T v; memcpy(&v, a_data, sizeof(T)); return v; }
+}
+
+size_t bin_format::bin_render(const char* a_fmt, size_t a_fmt_len,
+                              const bin_arg_type* a_args, size_t a_nargs,
+                              const char* a_data, size_t a_len,
+                              char* a_buf, size_t a_size)
+{
+    char*       p   = a_buf;
+    char* const end = a_buf + a_size;
+    const char* f   = a_fmt;
+    const char* fe  = a_fmt + a_fmt_len;
+    const char* d   = a_data;
+    const char* de  = a_data + a_len;
+    size_t      arg = 0;
+
+    auto put = [&p, end](const char* s, size_t n) {
+        n = std::min<size_t>(n, end - p);
+        memcpy(p, s, n);
+        p += n;
+    };
+
+    while (f < fe && p < end) {
+        auto q = static_cast<const char*>(memchr(f, '%', fe - f));
+        if (!q) {
+            put(f, fe - f);
+            break;
+        }
+        put(f, q - f);
+        f = q + 1;
+
+        if (f < fe && *f == '%') {
+            put(f++, 1);
+            continue;
+        }
+
+        // Parse the "%[flags][width][.precision][length]conversion" spec
+        auto s = f;
+        while (s < fe && strchr("-+ #0'", *s)) ++s;
+        while (s < fe && *s >= '0' && *s <= '9') ++s;
+        bool simple = s == f;   // No flags and width
+        int  prec   = -1;
+        if (s < fe && *s == '.')
+            for (++s, prec = 0; s < fe && *s >= '0' && *s <= '9'; ++s)
+                prec = prec*10 + (*s - '0');
+        auto opts   = std::string(f, s);  // Flags, width and precision
+        while (s < fe && strchr("hlLqjzt", *s)) ++s;
+
+        if (s == fe || arg == a_nargs) {
+            // Incomplete spec or missing argument: print the spec verbatim
+            put(q, s - q);
+            f = s;
+            continue;
+        }
+
+        char conv = *s++;
+        f = s;
+
+        auto type = a_args[arg++];
+        auto sz   = bin_arg_size(type, d, de);
+        if (!sz)
+            break;
+        auto v    = d;
+        d        += sz;
+
+        char tmp[512];
+        int  n    = -1;
+        char sp[64];
+        auto fmt  = [&](const char* a_len, char a_conv) {
+            snprintf(sp, sizeof(sp), "%%%s%s%c", opts.c_str(), a_len, a_conv);
+            return sp;
+        };
+
+        switch (type) {
+            case bin_arg_type::BOOL:
+                if (conv == 's') {
+                    bool b = *v != 0;
+                    n = snprintf(tmp, sizeof(tmp), fmt("", 's'), b ? "true" : "false");
+                    break;
+                }
+                // fall-through
+            case bin_arg_type::CHAR:
+            case bin_arg_type::INT32:
+            case bin_arg_type::INT64: {
+                int64_t i = type == bin_arg_type::INT32 ? bin_get<int32_t>(v)
+                          : type == bin_arg_type::INT64 ? bin_get<int64_t>(v)
+                          : type == bin_arg_type::CHAR  ? int64_t(*v)
+                          : int64_t(uint8_t(*v));
+                if (conv == 'c')
+                    n = snprintf(tmp, sizeof(tmp), fmt("", 'c'), int(i));
+                else if (simple && prec < 0 && (conv == 'd' || conv == 'i'))
+                    n = itoa_left(tmp, i) - tmp;
+                else
+                    n = snprintf(tmp, sizeof(tmp),
+                                 fmt("ll", strchr("diouxX", conv) ? conv : 'd'),
+                                 (long long)i);
+                break;
+            }
+            case bin_arg_type::UINT32:
+            case bin_arg_type::UINT64: {
+                uint64_t u = type == bin_arg_type::UINT32 ? bin_get<uint32_t>(v)
+                                                          : bin_get<uint64_t>(v);
+                if (simple && prec < 0 && (conv == 'u' || conv == 'd' || conv == 'i'))
+                    n = itoa_left(tmp, u) - tmp;
+                else
+                    n = snprintf(tmp, sizeof(tmp),
+                                 fmt("ll", strchr("diouxX", conv) ? conv : 'u'),
+                                 (unsigned long long)u);
+                break;
+            }
+            case bin_arg_type::DOUBLE: {
+                auto x = bin_get<double>(v);
+                if (simple && conv == 'f')
+                    n = ftoa_left<false>(x, tmp, sizeof(tmp), prec < 0 ? 6 : prec, false);
+                if (n < 0)
+                    n = snprintf(tmp, sizeof(tmp),
+                                 fmt("", strchr("eEfFgGaA", conv) ? conv : 'g'), x);
+                break;
+            }
+            case bin_arg_type::PTR:
+                n = snprintf(tmp, sizeof(tmp), fmt("", 'p'),
+                             reinterpret_cast<void*>(bin_get<uint64_t>(v)));
+                break;
+            case bin_arg_type::STR: {
+                auto str = v  + sizeof(uint16_t);
+                auto len = sz - sizeof(uint16_t);
+                if (prec >= 0 && size_t(prec) < len)
+                    len  = prec;
+                if (simple) {
+                    put(str, len);
+                    continue;
+                }
+                // Replace the precision with the string length
+                auto dot = opts.find('.');
+                if  (dot != std::string::npos)
+                    opts.erase(dot);
+                opts += ".*";
+                n = snprintf(tmp, sizeof(tmp), fmt("", 's'), int(len), str);
+                break;
+            }
+            default:
+                break;
+        }
+
+        if (n > 0)
+            put(tmp, std::min<size_t>(n, sizeof(tmp)-1));
+    }
+
+    return p - a_buf;
+}
+
+namespace bin_log {
+
+size_t decode(const std::string& a_filename, std::ostream& a_out,
+              stamp_type a_ts, bool a_show_location)
+{
+    struct format {
+        std::string               fmt;
+        std::vector<bin_arg_type> args;
+        std::string               src_loc;
+        std::string               src_fun;
+    };
+
+    auto data = path::read_file(a_filename);
+    auto p    = data.c_str();
+    auto end  = p + data.size();
+
+    if (data.size() < sizeof(MAGIC) + sizeof(VERSION) ||
+        memcmp(p, MAGIC, sizeof(MAGIC)) != 0)
+        UTXX_THROW_RUNTIME_ERROR("Invalid binary log file: ", a_filename);
+
+    p += sizeof(MAGIC);
+    auto ver = bin_get<uint32_t>(p);
+    p += sizeof(VERSION);
+    if (ver != VERSION)
+        UTXX_THROW_RUNTIME_ERROR("Unsupported binary log file version ", ver,
+                                 ": ", a_filename);
+
+    auto get = [&p, end, &a_filename](auto& a_val) {
+        if (end - p < (long)sizeof(a_val))
+            UTXX_THROW_RUNTIME_ERROR("Truncated binary log file: ", a_filename);
+        memcpy(&a_val, p, sizeof(a_val));
+        p += sizeof(a_val);
+    };
+    auto get_str = [&p, end, &a_filename](size_t a_len) {
+        if (size_t(end - p) < a_len)
+            UTXX_THROW_RUNTIME_ERROR("Truncated binary log file: ", a_filename);
+        auto s = p;
+        p += a_len;
+        return std::string(s, a_len);
+    };
+
+    std::unordered_map<uint32_t, format> formats;
+    std::vector<char>                    buf(64*1024);
+    size_t                               count = 0;
+
+    while (p < end) {
+        uint8_t  type;
+        uint16_t len;
+        get(type);
+
+        if (type == FORMAT) {
+            uint32_t id;
+            uint8_t  nargs;
+            get(id);
+            get(nargs);
+            auto& f = formats[id];
+            f.args.resize(nargs);
+            for (auto& a : f.args)
+                get(a);
+            get(len); f.fmt     = get_str(len);
+            get(len); f.src_loc = get_str(len);
+            get(len); f.src_fun = get_str(len);
+            continue;
+        }
+
+        if (type != BIN_MSG && type != TEXT_MSG)
+            UTXX_THROW_RUNTIME_ERROR("Invalid record type ", int(type),
+                                     " at offset ", p - data.c_str() - 1,
+                                     " of binary log file: ", a_filename);
+        int64_t  ns;
+        uint32_t level;
+        get(ns);
+        get(level);
+
+        if (type == TEXT_MSG) {
+            uint32_t n;
+            get(len);
+            get_str(len);
+            get(n);
+            a_out << get_str(n);
+            ++count;
+            continue;
+        }
+
+        uint32_t id;
+        get(id);
+        get(len);
+        auto cat  = get_str(len);
+        get(len);
+        auto args = get_str(len);
+
+        auto it = formats.find(id);
+        if  (it == formats.end())
+            UTXX_THROW_RUNTIME_ERROR("Undefined format id ", id,
+                                     " in binary log file: ", a_filename);
+        auto& f = it->second;
+
+        char* q = buf.data();
+        if (a_ts != NO_TIMESTAMP) {
+            q   += timestamp::format(a_ts, time_val(nsecs(long(ns))), q, 64);
+            *q++ = '|';
+        }
+        *q++ = log_level_to_abbrev(log_level(level))[0];
+        *q++ = '|';
+        if (!cat.empty()) {
+            q    = stpncpy(q, cat.c_str(), std::min<size_t>(cat.size(), 256));
+            *q++ = '|';
+        }
+        auto  e = buf.data() + buf.size() - 1024;
+        q      += bin_format::bin_render(f.fmt.c_str(), f.fmt.size(),
+                                         f.args.data(), f.args.size(),
+                                         args.c_str(), args.size(), q, e - q);
+        a_out.write(buf.data(), q - buf.data());
+        if (a_show_location && !f.src_loc.empty())
+            a_out << " [" << f.src_loc << ' ' << f.src_fun << ']';
+        a_out << '\n';
+        ++count;
+    }
+
+    return count;
+}
+
+} // namespace bin_log
+
+} // namespace utxx
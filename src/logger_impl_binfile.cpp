@@ -0,0 +1,196 @@
+//----------------------------------------------------------------------------
+/// \file  logger_impl_binfile.cpp
+//----------------------------------------------------------------------------
+/// \brief Back-end plugin writing log messages in binary form for the
+/// <tt>logger</tt> class.
+//----------------------------------------------------------------------------
+// Copyright (c) 2026 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-16
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the utxx open-source project.
+
+Copyright (C) 2026 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <fcntl.h>
+#include <utxx/logger/logger_impl_binfile.hpp>
+#include <utxx/logger/logger_impl.hpp>
+#include <utxx/path.hpp>
+
+namespace utxx {
+
+static logger_impl_mgr::impl_callback_t f = &logger_impl_binfile::create;
+static logger_impl_mgr::registrar reg("binfile", f);
+
+std::ostream& logger_impl_binfile::dump(std::ostream& out,
+    const std::string& a_prefix) const
+{
+    out << a_prefix << "logger." << name() << '\n'
+        << a_prefix << "    filename       = " << m_filename << '\n'
+        << a_prefix << "    append         = " << (m_append ? "true" : "false") << '\n'
+        << a_prefix << "    mode           = " << m_mode << '\n'
+        << a_prefix << "    levels         = " << log_levels_to_str(m_levels) << '\n';
+    return out;
+}
+
+bool logger_impl_binfile::init(const variant_tree& a_config)
+{
+    BOOST_ASSERT(this->m_log_mgr);
+    finalize();
+
+    try {
+        m_filename = a_config.get<std::string>("logger.binfile.filename");
+        m_filename = m_log_mgr->replace_env_and_macros(m_filename);
+    } catch (boost::property_tree::ptree_bad_data&) {
+        UTXX_THROW_BADARG_ERROR("logger.binfile.filename not specified");
+    }
+
+    m_append     = a_config.get("logger.binfile.append", true);
+    m_mode       = a_config.get("logger.binfile.mode",   0644);
+    auto levels  = a_config.get("logger.binfile.levels", "");
+
+    m_levels     = levels.empty()
+                 ? m_log_mgr->level_filter()
+                 : parse_log_levels(levels);
+
+    if (m_levels == NOLOGGING)
+        return true;
+
+    // The header of an existing file is read back to validate it
+    m_fd = open(m_filename.c_str(),
+                O_CREAT|O_RDWR|O_LARGEFILE | (m_append ? O_APPEND : O_TRUNC),
+                m_mode);
+
+    if (m_fd < 0)
+        UTXX_THROW_IO_ERROR(errno, "Error opening file ", m_filename);
+
+    struct stat st;
+    if (fstat(m_fd, &st) < 0)
+        UTXX_THROW_IO_ERROR(errno, "Error getting size of file ", m_filename);
+
+    // Format ids are reassigned in every session, and since a format
+    // definition precedes its use, appending to an existing file is safe
+    if (st.st_size == 0) {
+        m_buf.reset();
+        put(bin_log::MAGIC, sizeof(bin_log::MAGIC));
+        put(bin_log::VERSION);
+        if (write(m_fd, m_buf.rd_ptr(), m_buf.size()) != long(m_buf.size()))
+            UTXX_THROW_IO_ERROR(errno, "Error writing to file: ", m_filename);
+    } else {
+        // Don't append to a foreign file or one of a different version
+        char     magic[sizeof(bin_log::MAGIC)];
+        uint32_t version;
+        iovec    hdr[] = {{magic, sizeof(magic)}, {&version, sizeof(version)}};
+        auto     n     = preadv(m_fd, hdr, 2, 0);
+        if (n < 0)
+            UTXX_THROW_IO_ERROR(errno, "Error reading file ", m_filename);
+        if (size_t(n) != sizeof(magic) + sizeof(version) ||
+            memcmp(magic, bin_log::MAGIC, sizeof(magic)) != 0)
+            UTXX_THROW_RUNTIME_ERROR("File ", m_filename,
+                                     " is not a binary log file");
+        if (version != bin_log::VERSION)
+            UTXX_THROW_RUNTIME_ERROR("Binary log file ", m_filename,
+                                     " has unsupported version ", version,
+                                     " (expected ", bin_log::VERSION, ')');
+    }
+
+    // BIN messages are written in binary form, so they don't need rendering
+    this->add_batch(m_levels,
+        logger::on_batch_delegate_t::from_method
+            <logger_impl_binfile, &logger_impl_binfile::log_batch>(this),
+        false);
+    return true;
+}
+
+void logger_impl_binfile::put(const void* a_data, size_t a_size)
+{
+    if (m_buf.capacity() < a_size)
+        m_buf.reserve(std::max(a_size, m_buf.max_size()));
+    memcpy(m_buf.wr_ptr(), a_data, a_size);
+    m_buf.commit(a_size);
+}
+
+void logger_impl_binfile::put_str16(const char* a_str, size_t a_size)
+{
+    auto n = uint16_t(std::min<size_t>(a_size, 0xFFFF));
+    put(n);
+    put(a_str, n);
+}
+
+uint32_t logger_impl_binfile::format_id(const bin_format& a_fmt)
+{
+    auto it = m_formats.find(&a_fmt);
+    if  (it != m_formats.end())
+        return it->second;
+
+    uint32_t id = m_formats.size() + 1;
+    m_formats.emplace(&a_fmt, id);
+
+    put(uint8_t(bin_log::FORMAT));
+    put(id);
+    put(uint8_t(a_fmt.nargs));
+    put(a_fmt.args, a_fmt.nargs);
+    put_str16(a_fmt.fmt,     a_fmt.fmt_len);
+    put_str16(a_fmt.src_loc, a_fmt.src_loc_len);
+    put_str16(a_fmt.src_fun, a_fmt.src_fun_len);
+    return id;
+}
+
+void logger_impl_binfile::log_batch(const logger::msg_batch& a_batch)
+{
+    m_buf.reset();
+
+    for (size_t i=0; i < a_batch.size(); ++i) {
+        auto& msg = a_batch.message(i);
+        auto  fmt = msg.bin_fmt();
+        auto  cat = msg.category();
+        // The format definition must precede the message record
+        auto  id  = fmt ? format_id(*fmt) : 0;
+
+        put(uint8_t(fmt ? bin_log::BIN_MSG : bin_log::TEXT_MSG));
+        put(int64_t(msg.timestamp().nanoseconds()));
+        put(uint32_t(msg.level()));
+
+        if (fmt) {
+            put(id);
+            put_str16(cat.c_str(), cat.size());
+            put_str16(msg.bin_data(), msg.bin_size());
+        } else {
+            auto& v = a_batch.iov()[i];
+            put_str16(cat.c_str(), cat.size());
+            put(uint32_t(v.iov_len));
+            put(v.iov_base, v.iov_len);
+        }
+    }
+
+    for (auto p = m_buf.rd_ptr(), e = p + m_buf.size(); p < e; ) {
+        auto n = write(m_fd, p, e - p);
+        if (n >= 0)
+            p += n;
+        else if (errno != EINTR)
+            UTXX_THROW_IO_ERROR(errno, "Error writing to file: ", m_filename);
+    }
+}
+
+} // namespace utxx
@@ -34,7 +34,9 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include <time.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <fcntl.h>
+#include <limits.h>
 #include <utxx/logger/logger_impl_file.hpp>
 #include <utxx/logger/logger_impl.hpp>
 #include <utxx/path.hpp>
@@ -148,14 +150,10 @@ bool logger_impl_file::init(const variant_tree& a_config)
     if (m_levels != NOLOGGING) {
         open_file(false);
 
-        // Install log_msg callbacks from appropriate levels
-        for(int lvl = 0; lvl < logger::NLEVELS; ++lvl) {
-            log_level level = logger::signal_slot_to_level(lvl);
-            if ((m_levels & static_cast<int>(level)) != 0)
-                this->add(level,
-                    logger::on_msg_delegate_t::from_method
-                        <logger_impl_file, &logger_impl_file::log_msg>(this));
-        }
+        // Install the log_batch callback for appropriate levels
+        this->add_batch(m_levels,
+            logger::on_batch_delegate_t::from_method
+                <logger_impl_file, &logger_impl_file::log_batch>(this));
     }
     return true;
 }
@@ -323,6 +321,72 @@ void logger_impl_file::log_msg(const logger::msg& a_msg, const char* a_buf, size
         UTXX_THROW_IO_ERROR(errno, "Error writing to file: ", m_filename, ' ', a_msg.src_location());
 }
 
+size_t logger_impl_file::file_size() const
+{
+    struct stat stat_buf;
+    if (fstat(m_fd, &stat_buf) < 0)
+        UTXX_THROW_RUNTIME_ERROR("Unable to read file size for file "+m_filename);
+    return stat_buf.st_size;
+}
+
+void logger_impl_file::write_iov(const iovec* a_iov, size_t a_cnt)
+{
+    while (a_cnt) {
+        auto n = writev(m_fd, a_iov, std::min<size_t>(a_cnt, IOV_MAX));
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            UTXX_THROW_IO_ERROR(errno, "Error writing to file: ", m_filename);
+        }
+
+        // Skip fully written vectors
+        for (; a_cnt && size_t(n) >= a_iov->iov_len; --a_cnt)
+            n -= a_iov++->iov_len;
+
+        if (!n)
+            continue;
+
+        // Partial write: finish writing the current vector
+        auto p = (const char*)a_iov->iov_base + n;
+        auto e = (const char*)a_iov->iov_base + a_iov->iov_len;
+        while (p < e) {
+            auto m = write(m_fd, p, e - p);
+            if (m >= 0)
+                p += m;
+            else if (errno != EINTR)
+                UTXX_THROW_IO_ERROR(errno, "Error writing to file: ", m_filename);
+        }
+        ++a_iov;
+        --a_cnt;
+    }
+}
+
+void logger_impl_file::log_batch(const logger::msg_batch& a_batch)
+{
+    auto* iov = a_batch.iov();
+    auto  cnt = a_batch.size();
+
+    if (m_split_size) {
+        // Messages are written to the current file until its size reaches
+        // m_split_size, at which point the file is rotated
+        auto sz = file_size();
+        for (size_t i=0; i < cnt; sz += iov[i++].iov_len) {
+            if (sz < m_split_size)
+                continue;
+            write_iov(iov, i);
+            iov += i;
+            cnt -= i;
+            i    = 0;
+            finalize();
+            modify_file_name();
+            open_file(true);
+            sz   = file_size();
+        }
+    }
+
+    write_iov(iov, cnt);
+}
+
 bool logger_impl_file::open_file(bool rotated)
 {
     auto exists = path::file_exists(m_filename);
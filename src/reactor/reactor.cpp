@@ -142,7 +142,7 @@ FdInfo& Reactor::Add(
 FdInfo& Reactor::AddFile(
     std::string const& a_name, std::string const& a_filename, FileHandler const& a_on_read,
     ErrHandler const& a_on_error, void* a_instance, void* a_opaque, size_t a_bufsz,
-    ReadSizeEstim a_read_at_least, TriggerT a_trigger)
+    ReadSizeEstim a_read_at_least, TriggerT a_trigger, int a_queue_depth, bool a_direct)
 {
   REACTOR_PRETTY_FUNCTION();
 
@@ -163,10 +163,19 @@ FdInfo& Reactor::AddFile(
 
   guard.disable();
 
+  assert(p->RdBuff());
+
+  if (a_queue_depth > 1 || a_direct) {
+    auto reader = new AIOReader();
+    p->SetFileReader(reader);
+    reader->Init(efd, a_filename.c_str(), a_queue_depth, a_bufsz, a_direct);
+    if (reader->Submit() < 0) REACTOR_THROWX_IO_ERROR(errno, "error reading file ", a_filename);
+    return *p;
+  }
+
   auto reader = new AIOReader(efd, a_filename.c_str());
   p->SetFileReader(reader);
 
-  assert(p->RdBuff());
   p->FileReader()->AsyncRead(p->RdBuff()->wr_ptr(), p->RdBuff()->capacity());
 
   return *p;
@@ -10,6 +10,7 @@
 #include <poll.h>
 #include <reactor/reactor_aio_reader.hxx>
 #include <reactor/reactor_platform.hpp>
+#include <chrono>
 #include <string>
 
 using namespace utxx;
@@ -155,6 +156,112 @@ TEST_CASE(aio_reader_clear_is_idempotent)
   reactor_eventfd_close(efd);
 }
 
+// ---- AIOReader read-ahead queue --------------------------------------------
+
+/// Read the whole file in the read-ahead queue mode, calling \a a_fun with
+/// each chunk in file order.
+/// @return number of bytes read, or -1 on error
+template <class Fun>
+static long read_queued(utxx::AIOReader& a_reader, Fun a_fun)
+{
+  if (a_reader.Submit() < 0) return -1;
+
+  long total = 0;
+  while (a_reader.Remaining() > 0) {
+    if (wait_efd(a_reader.EventFD()) < 0) return -1;
+    int n = a_reader.CheckEvents();
+    if (n <= 0 || a_reader.Reap(n) < 0) return -1;
+
+    for (auto chunk = a_reader.Front(); chunk.first; chunk = a_reader.Front()) {
+      if (chunk.second < 0) return -1;
+      a_fun(chunk.first, chunk.second);
+      total += chunk.second;
+      a_reader.Pop();
+      if (a_reader.Submit() < 0) return -1;
+    }
+  }
+  return total;
+}
+
+TEST_CASE(aio_reader_queue_in_order)
+{
+  // A size that is not a multiple of the chunk size nor of the alignment
+  const size_t FILE_SZ = 1000 * 1000 + 7;
+  TempFile     f("/tmp/__reactor_aio_queue__.bin", FILE_SZ);
+
+  for (bool direct : {false, true}) {
+    int             efd = reactor_eventfd_create();
+    utxx::AIOReader reader;
+    reader.Init(efd, f.path.c_str(), 8, 10000, direct);
+
+    CHECK(reader.Queued());
+    CHECK_EQUAL(8, reader.Depth());
+    CHECK_EQUAL(size_t(3 * utxx::AIOReader::s_align), reader.ChunkSize());
+    CHECK_EQUAL((long)FILE_SZ, reader.Size());
+
+    size_t errors = 0, pos = 0;
+    long   got    = read_queued(reader, [&](const char* a_data, long a_len) {
+      for (long i = 0; i < a_len; i++, pos++)
+        if (a_data[i] != static_cast<char>('A' + pos % 26)) errors++;
+    });
+
+    CHECK_EQUAL((long)FILE_SZ, got);
+    CHECK_EQUAL(FILE_SZ, pos);
+    CHECK_EQUAL(size_t(0), errors);
+    CHECK_EQUAL(0L, reader.Remaining());
+    // Front() doesn't return anything past the end of file
+    CHECK(reader.Front().first == nullptr);
+  }
+}
+
+TEST_CASE(aio_reader_queue_bad_args)
+{
+  TempFile        f("/tmp/__reactor_aio_qargs__.bin", 16);
+  int             efd = reactor_eventfd_create();
+  utxx::AIOReader reader;
+  CHECK_THROWS(reader.Init(efd, f.path.c_str(), 0, 4096));
+  CHECK_THROWS(reader.Init(efd, f.path.c_str(), 4, 0));
+  reactor_eventfd_close(efd);
+}
+
+// Throughput of reading a file with different queue depths.
+// The file size in MB (4 by default) can be set with AIO_BENCH_MB
+// environment variable.
+TEST_CASE(aio_reader_queue_throughput)
+{
+  auto         env   = getenv("AIO_BENCH_MB");
+  const size_t MB    = env ? std::max(1, atoi(env)) : 4;
+  const size_t CHUNK = 1024 * 1024;
+  const char*  path  = "/tmp/__reactor_aio_bench__.bin";
+
+  TempFile guard(path, 0);
+  {
+    std::ofstream     out(path, std::ios::binary);
+    std::vector<char> buf(CHUNK);
+    for (size_t i = 0; i < buf.size(); i++) buf[i] = static_cast<char>(i);
+    for (size_t i = 0; i < MB; i++) out.write(buf.data(), buf.size());
+  }
+
+  for (bool direct : {false, true})
+    for (int depth : {1, 4, 16}) {
+      int             efd = reactor_eventfd_create();
+      utxx::AIOReader reader;
+      reader.Init(efd, path, depth, CHUNK, direct);
+
+      long sum   = 0;
+      auto start = std::chrono::steady_clock::now();
+      long got   = read_queued(reader, [&sum](const char* a_data, long a_len) {
+        sum += a_data[0] + a_data[a_len - 1];
+      });
+      auto secs  = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+      CHECK_EQUAL(long(MB * CHUNK), got);
+      fprintf(
+          stdout, "  depth=%-2d direct=%d: %zu MB in %.3fs (%.2f GB/s)\n", depth,
+          int(reader.Direct()), MB, secs, double(got) / secs / 1e9);
+    }
+}
+
 // ---- main -------------------------------------------------------------------
 
 int main()
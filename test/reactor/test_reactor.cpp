@@ -246,6 +246,48 @@ TEST_CASE(reactor_rdbuff_valid_after_add)
   ::close(fds[1]);
 }
 
+// ---- AddFile with read-ahead queue -----------------------------------------
+
+TEST_CASE(reactor_add_file_queued)
+{
+  const char*  path    = "/tmp/__reactor_add_file_queued__.bin";
+  const size_t FILE_SZ = 1000 * 1000 + 3;
+  {
+    FILE* f = fopen(path, "wb");
+    for (size_t i = 0; i < FILE_SZ; i++) fputc('a' + i % 26, f);
+    fclose(f);
+  }
+
+  Reactor r("file", 0);
+
+  size_t pos = 0, errors = 0;
+  bool   eof = false;
+
+  // Consume only whole 10-byte records to exercise data carried over
+  // between chunks
+  r.AddFile(
+      "f", path,
+      [&](FdInfo&, dynamic_io_buffer& a_buf) {
+        size_t n = a_buf.size() / 10 * 10;
+        for (size_t i = 0; i < n; i++, pos++)
+          if (a_buf.rd_ptr()[i] != char('a' + pos % 26)) errors++;
+        a_buf.read_and_crunch(n);
+        return int(n);
+      },
+      [&](FdInfo&, IOType a_tp, const std::string&, src_info&&) {
+        eof = a_tp == IOType::EndOfFile;
+      },
+      nullptr, nullptr, 64 * 1024, nullptr, LEVEL_TRIGGERED, 4);
+
+  for (int i = 0; i < 1000 && !eof; i++) r.Wait(10);
+
+  CHECK(eof);
+  CHECK_EQUAL(FILE_SZ / 10 * 10, pos);
+  CHECK_EQUAL(size_t(0), errors);
+
+  ::unlink(path);
+}
+
 // ---- UDS listener ----------------------------------------------------------
 
 TEST_CASE(reactor_uds_listener_accepts_client)
@@ -0,0 +1,231 @@
+//----------------------------------------------------------------------------
+/// \file  test_alloc_arena.cpp
+//----------------------------------------------------------------------------
+/// \brief Test cases for the monotonic_arena.
+//----------------------------------------------------------------------------
+// Copyright (c) 2026 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-16
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the utxx open-source project.
+
+Copyright (C) 2026 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+
+#include <boost/test/unit_test.hpp>
+#include <utxx/alloc_arena.hpp>
+#include <utxx/short_vector.hpp>
+#include <utxx/container/assoc_vector.hpp>
+#include <utxx/print.hpp>
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+using namespace utxx;
+using namespace utxx::memory;
+
+namespace {
+    size_t iterations() { return getenv("ITERATIONS") ? atoi(getenv("ITERATIONS")) : 0; }
+
+    /// Upstream resource counting the allocations of arena blocks
+    struct counting_resource : std::pmr::memory_resource {
+        long allocs = 0, frees = 0;
+
+        void* do_allocate(size_t n, size_t a) override {
+            ++allocs;
+            return std::pmr::new_delete_resource()->allocate(n, a);
+        }
+        void do_deallocate(void* p, size_t n, size_t a) override {
+            ++frees;
+            std::pmr::new_delete_resource()->deallocate(p, n, a);
+        }
+        bool do_is_equal(const memory_resource& a) const noexcept override {
+            return this == &a;
+        }
+    };
+
+    template <class T>
+    using arena_vector = std::vector<T, arena_allocator<T>>;
+}
+
+BOOST_AUTO_TEST_CASE( test_alloc_arena_basic )
+{
+    counting_resource up;
+    {
+        monotonic_arena arena(256, true, &up);
+        BOOST_CHECK_EQUAL(1, up.allocs);
+        BOOST_CHECK_EQUAL(1u, arena.blocks());
+        BOOST_CHECK_EQUAL(0u, arena.used());
+
+        auto p1 = arena.allocate(3, 1);
+        auto p2 = arena.allocate(8, 8);
+        BOOST_CHECK_EQUAL(0u, reinterpret_cast<uintptr_t>(p2) & 7);
+        BOOST_CHECK(static_cast<char*>(p2) > static_cast<char*>(p1));
+        BOOST_CHECK_EQUAL(16u, arena.used());
+
+        // The most recent allocation is rolled back
+        arena.deallocate(p2, 8);
+        BOOST_CHECK_EQUAL(8u, arena.used());
+        BOOST_CHECK_EQUAL(p2, arena.allocate(8, 8));
+        arena.deallocate(p1, 3);            // Not the last one: ignored
+        BOOST_CHECK_EQUAL(16u, arena.used());
+
+        // Chained growth, including allocations larger than a block
+        for (int i = 0; i < 100; ++i)
+            memset(arena.allocate(100), i, 100);
+        memset(arena.allocate(10000), 0, 10000);
+        auto blocks = arena.blocks();
+        BOOST_CHECK(blocks > 2u);
+        BOOST_CHECK_EQUAL(long(blocks), up.allocs);
+        BOOST_CHECK(arena.capacity() >= 20000u);
+
+        // reset() keeps the blocks, and the same cycle of allocations
+        // doesn't go to the upstream resource
+        arena.reset();
+        BOOST_CHECK_EQUAL(0u, arena.used());
+        for (int i = 0; i < 100; ++i)
+            memset(arena.allocate(100), i, 100);
+        memset(arena.allocate(10000), 0, 10000);
+        BOOST_CHECK_EQUAL(long(blocks), up.allocs);
+
+        arena.release();
+        BOOST_CHECK_EQUAL(1u, arena.blocks());
+        BOOST_CHECK_EQUAL(long(blocks) - 1, up.frees);
+    }
+    BOOST_CHECK_EQUAL(up.allocs, up.frees);
+
+    // Fixed arena over a caller's buffer
+    char buf[512];
+    monotonic_arena fixed(buf, sizeof(buf), false, &up);
+    auto allocs = up.allocs;
+    auto p = static_cast<char*>(fixed.allocate(100));
+    BOOST_CHECK(p >= buf && p + 100 <= buf + sizeof(buf));
+    BOOST_CHECK_THROW(fixed.allocate(1000), std::bad_alloc);
+    fixed.reset();
+    BOOST_CHECK_EQUAL(p, fixed.allocate(100));
+    BOOST_CHECK_EQUAL(allocs, up.allocs);
+
+    BOOST_CHECK_THROW(monotonic_arena(buf, 8), badarg_error);
+}
+
+BOOST_AUTO_TEST_CASE( test_alloc_arena_containers )
+{
+    counting_resource up;
+    monotonic_arena   arena(1024, true, &up);
+
+    for (int cycle = 0; cycle < 3; ++cycle) {
+        {
+            // std::pmr containers
+            std::pmr::vector<std::pmr::string> v(&arena);
+            for (int i = 0; i < 50; ++i)
+                v.emplace_back("a string too long for the small buffer: " +
+                               std::to_string(i));
+            BOOST_CHECK_EQUAL("a string too long for the small buffer: 49",
+                              v.back());
+
+            // Containers taking an allocator type
+            basic_short_vector<int, 4, arena_allocator<int>>
+                s((arena_allocator<int>(arena)));
+            for (int i = 0; i < 100; ++i)
+                s.push_back(i);
+            BOOST_CHECK_EQUAL(100, s.size());
+            BOOST_CHECK_EQUAL(99, s[99]);
+
+            assoc_vector<int, int, std::less<int>,
+                         arena_allocator<std::pair<int, int>>>
+                m(std::less<int>{}, arena_allocator<std::pair<int,int>>(arena));
+            for (int i = 100; i > 0; --i)
+                m[i] = i * 2;
+            BOOST_CHECK_EQUAL(100u, m.size());
+            BOOST_CHECK_EQUAL(20, m[10]);
+            BOOST_CHECK_EQUAL(1, m.begin()->first);
+
+            basic_buffered_print<16, arena_allocator<char>>
+                b((arena_allocator<char>(arena)));
+            for (int i = 0; i < 20; ++i)
+                b.print("value=", i, ' ');
+            BOOST_CHECK_EQUAL(0, strncmp("value=0 value=1 ", b.str(), 16));
+            BOOST_CHECK(b.size() > 100u);
+
+            arena_vector<long> a((arena_allocator<long>(arena)));
+            a.assign(1000, 7);
+            BOOST_CHECK_EQUAL(7, a[999]);
+        }
+        // All memory comes from the arena's blocks, which are allocated on
+        // the first cycle only
+        static long s_allocs;
+        if (cycle == 0)
+            s_allocs = up.allocs;
+        BOOST_CHECK_EQUAL(s_allocs, up.allocs);
+        arena.reset();
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_alloc_arena_perf )
+{
+    // Decoding of a message into a few short-lived containers
+    auto   n     = iterations();
+    size_t count = n ? n : 200000;
+    long   sum   = 0;
+
+    auto run = [&](const char* a_name, auto&& a_fun) {
+        auto t0 = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < count; ++i)
+            sum += a_fun(i);
+        auto secs = std::chrono::duration<double>
+                    (std::chrono::steady_clock::now() - t0).count();
+        BOOST_TEST_MESSAGE(a_name << ": " << int(double(count) / secs / 1e3)
+                           << " Kmsgs/s");
+    };
+
+    run("std::allocator ", [](size_t i) {
+        std::vector<long>  v;
+        std::vector<int>   w;
+        std::string        s;
+        for (size_t j = 0; j < 32; ++j) {
+            v.push_back(long(i + j));
+            w.push_back(int(j));
+        }
+        s.append(64, 'x');
+        return v.back() + w.size() + s.size();
+    });
+
+    monotonic_arena arena(16 * 1024);
+    run("monotonic_arena", [&](size_t i) {
+        long res;
+        {
+            std::pmr::vector<long> v(&arena);
+            std::pmr::vector<int>  w(&arena);
+            std::pmr::string       s(&arena);
+            for (size_t j = 0; j < 32; ++j) {
+                v.push_back(long(i + j));
+                w.push_back(int(j));
+            }
+            s.append(64, 'x');
+            res = v.back() + w.size() + s.size();
+        }
+        arena.reset();
+        return res;
+    });
+
+    BOOST_CHECK(sum > 0);
+}
@@ -0,0 +1,286 @@
+//----------------------------------------------------------------------------
+/// \file  test_alloc_magazine_pool.cpp
+//----------------------------------------------------------------------------
+/// \brief Test cases for the magazine_object_pool.
+//----------------------------------------------------------------------------
+// Copyright (c) 2026 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-16
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the utxx open-source project.
+
+Copyright (C) 2026 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+
+#include <boost/test/unit_test.hpp>
+#include <utxx/alloc_magazine_pool.hpp>
+#include <utxx/alloc_fixed_pool.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <set>
+#include <thread>
+#include <vector>
+
+using namespace utxx;
+using namespace utxx::memory;
+
+namespace {
+    size_t iterations() { return getenv("ITERATIONS") ? atoi(getenv("ITERATIONS")) : 0; }
+
+    /// Spinning barrier of a_count threads, which yields the CPU
+    class barrier {
+        std::atomic<int> m_count;
+        std::atomic<int> m_gen;
+        const int        m_total;
+    public:
+        explicit barrier(int a_count) : m_count(a_count), m_gen(0), m_total(a_count) {}
+
+        void wait() {
+            int gen = m_gen.load();
+            if (--m_count == 0) {
+                m_count = m_total;
+                ++m_gen;
+            } else
+                while (m_gen.load() == gen)
+                    std::this_thread::yield();
+        }
+    };
+
+    /// Run two allocation patterns on a_threads threads:
+    ///  - local:  each thread allocates a burst of objects and frees them in
+    ///            a shuffled order;
+    ///  - remote: each thread allocates a burst of objects, which are freed
+    ///            by the next thread (producer/consumer handoff).
+    /// @return pair of millions of allocate+free pairs per second
+    template <class Alloc, class Free>
+    std::pair<double, double>
+    run_pattern(int a_threads, size_t a_rounds, size_t a_burst,
+                Alloc&& a_alloc, Free&& a_free)
+    {
+        std::vector<std::vector<void*>> slots(a_threads,
+                                              std::vector<void*>(a_burst));
+        std::atomic<long> errors(0);
+        double res[2];
+
+        for (int remote = 0; remote < 2; ++remote) {
+            barrier b(a_threads + 1);
+            std::vector<std::thread> threads;
+
+            for (int t = 0; t < a_threads; ++t)
+                threads.emplace_back([&, t] {
+                    std::mt19937 rnd(t);
+                    auto& mine = slots[t];
+                    auto& next = slots[(t + 1) % a_threads];
+                    b.wait();
+                    for (size_t r = 0; r < a_rounds; ++r) {
+                        for (auto& p : mine) {
+                            p = a_alloc();
+                            if (!p) { ++errors; continue; }
+                            *static_cast<long*>(p) = t;
+                        }
+                        if (!remote) {
+                            std::shuffle(mine.begin(), mine.end(), rnd);
+                            for (auto p : mine)
+                                a_free(p);
+                            continue;
+                        }
+                        b.wait();
+                        for (auto p : next) {
+                            if (!p || *static_cast<long*>(p) != (t + 1) % a_threads)
+                                ++errors;
+                            a_free(p);
+                        }
+                        b.wait();
+                    }
+                });
+
+            auto t0 = std::chrono::steady_clock::now();
+            b.wait();
+            if (remote)
+                for (size_t r = 0; r < a_rounds; ++r) {
+                    b.wait();
+                    b.wait();
+                }
+            for (auto& t : threads)
+                t.join();
+            auto secs = std::chrono::duration<double>
+                        (std::chrono::steady_clock::now() - t0).count();
+            res[remote] = double(a_threads * a_rounds * a_burst) / secs / 1e6;
+        }
+
+        BOOST_CHECK_EQUAL(0, errors.load());
+        return std::make_pair(res[0], res[1]);
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_alloc_magazine_pool_basic )
+{
+    magazine_object_pool::config cfg;
+    cfg.m_batch     = 4;
+    cfg.m_slab_size = 4096;
+    magazine_object_pool pool(40, cfg);
+
+    BOOST_CHECK_EQUAL(48u, pool.object_size());
+    BOOST_CHECK(pool.nodes() >= 1u);
+    BOOST_CHECK_EQUAL(0u, pool.slabs());
+
+    // All objects of a slab are distinct and properly aligned
+    std::set<void*> objs;
+    for (int i = 0; i < 200; ++i) {
+        auto p = pool.allocate();
+        BOOST_REQUIRE(p);
+        BOOST_REQUIRE_EQUAL(0u, reinterpret_cast<uintptr_t>(p) & 15);
+        memset(p, 0xAB, pool.object_size());
+        BOOST_REQUIRE(objs.insert(p).second);
+    }
+    BOOST_CHECK_EQUAL(3u, pool.slabs());    // 84 objects per slab
+    BOOST_CHECK_EQUAL(3u * 4096, pool.bytes());
+
+    // Freed objects are reused without new slabs
+    for (auto p : objs)
+        pool.free(p);
+    pool.free(nullptr);
+    for (int i = 0; i < 200; ++i)
+        BOOST_REQUIRE(objs.count(pool.allocate()));
+    BOOST_CHECK_EQUAL(3u, pool.slabs());
+
+    // The pool is limited by m_max_bytes
+    cfg.m_max_bytes = 2 * 4096;
+    magazine_object_pool lim(40, cfg);
+    size_t n = 0;
+    while (lim.allocate())
+        ++n;
+    BOOST_CHECK_EQUAL(2u * 84, n);
+
+    cfg.m_slab_size = 5000;
+    BOOST_CHECK_THROW(magazine_object_pool(40, cfg), badarg_error);
+    cfg.m_slab_size = 4096;
+    BOOST_CHECK_THROW(magazine_object_pool(4096, cfg), badarg_error);
+}
+
+BOOST_AUTO_TEST_CASE( test_alloc_magazine_pool_threads )
+{
+    // Objects cached by an exited thread are reused by other threads
+    magazine_object_pool::config cfg;
+    cfg.m_batch      = 16;
+    cfg.m_slab_size  = 1 << 16;
+    cfg.m_max_bytes  = 1 << 16;
+    magazine_object_pool pool(64, cfg);
+
+    std::vector<void*> objs;
+    std::thread([&] {
+        for (void* p; (p = pool.allocate()); )
+            objs.push_back(p);
+        for (auto p : objs)
+            pool.free(p);
+    }).join();
+
+    BOOST_CHECK(objs.size() > 1000u);
+    std::set<void*> seen;
+    for (void* p; (p = pool.allocate()); )
+        seen.insert(p);
+    BOOST_CHECK_EQUAL(objs.size(), seen.size());
+    pool.flush();
+
+    // Concurrent allocations from several threads never hand out an object
+    // twice
+    cfg.m_max_bytes = 0;
+    magazine_object_pool mt(64, cfg);
+    auto r = run_pattern(4, 200, 256,
+        [&] { return mt.allocate(); },
+        [&](void* p) { mt.free(p); });
+    BOOST_CHECK(r.first > 0 && r.second > 0);
+
+    // The memory limit holds for concurrent allocations
+    cfg.m_max_bytes = 4 << 16;
+    magazine_object_pool cl(64, cfg);
+    std::atomic<size_t>      total(0);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 4; ++i)
+        threads.emplace_back([&] {
+            size_t n = 0;
+            while (cl.allocate())
+                ++n;
+            total += n;
+        });
+    for (auto& t : threads)
+        t.join();
+    BOOST_CHECK(cl.bytes() <= cfg.m_max_bytes);
+    BOOST_CHECK_EQUAL(cl.bytes() / cfg.m_slab_size, cl.slabs());
+    BOOST_CHECK(total > 0u && total <= cl.slabs() * ((1u << 16) / 64));
+}
+
+BOOST_AUTO_TEST_CASE( test_alloc_magazine_pool_hugepages )
+{
+    // Without reserved huge pages the slabs fall back to regular pages
+    magazine_object_pool::config cfg;
+    cfg.m_huge_pages = true;
+    magazine_object_pool pool(128, cfg);
+
+    std::vector<void*> objs;
+    for (int i = 0; i < 100000; ++i)
+        objs.push_back(pool.allocate());
+    BOOST_CHECK(std::find(objs.begin(), objs.end(), nullptr) == objs.end());
+    for (auto p : objs)
+        pool.free(p);
+    BOOST_TEST_MESSAGE("Slabs: " << pool.slabs() << ", huge: "
+                       << pool.huge_slabs() << ", nodes: " << pool.nodes());
+}
+
+BOOST_AUTO_TEST_CASE( test_alloc_magazine_pool_perf )
+{
+    auto   n      = iterations();
+    size_t rounds = n ? n : 2000;
+    size_t burst  = 256;
+    size_t size   = 64;
+
+    for (int threads : {1, 2, 4}) {
+        auto print = [&](const char* a_name, std::pair<double, double> a_res) {
+            BOOST_TEST_MESSAGE(a_name << " threads=" << threads
+                               << ": local=" << a_res.first
+                               << " remote=" << a_res.second << " (Mops/s)");
+        };
+
+        print("malloc              ", run_pattern(threads, rounds, burst,
+            [&] { return ::malloc(size); },
+            [&](void* p) { ::free(p); }));
+
+        {
+            magazine_object_pool pool(size);
+            print("magazine_object_pool", run_pattern(threads, rounds, burst,
+                [&] { return pool.allocate(); },
+                [&](void* p) { pool.free(p); }));
+        }
+        {
+            // The free list of fixed_size_object_pool is shared by all threads
+            size_t bytes = (size + 64) * (threads * burst + 16);
+            std::unique_ptr<char[]> mem(new char[bytes]);
+            auto& pool = heap_fixed_size_object_pool::create(mem.get(), bytes,
+                                                             size);
+            print("fixed_size_obj_pool ", run_pattern(threads, rounds, burst,
+                [&] { return pool.allocate(); },
+                [&](void* p) { pool.free(p); }));
+        }
+    }
+}
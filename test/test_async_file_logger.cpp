@@ -37,6 +37,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 //#define BOOST_TEST_MAIN
 #include <boost/test/unit_test.hpp>
 #include <utxx/logger/async_file_logger.hpp>
+#include <utxx/time_val.hpp>
 #include <utxx/perf_histogram.hpp>
 #include <utxx/verbosity.hpp>
 
@@ -265,3 +266,206 @@ BOOST_AUTO_TEST_CASE( test_async_file_logger_concurrent )
 
     ::unlink(s_filename);
 }
+
+//-----------------------------------------------------------------------------
+namespace {
+    // Small extents to exercise moving of the mapped window
+    struct small_mmap_logger_traits : public async_mmap_logger_traits {
+        static file_type file_open(const std::string& a_filename,
+                                   int a_perm  = def_permissions) {
+            return mmap_file_writer::open(a_filename, a_perm, 8192, 4096);
+        }
+    };
+
+    std::string file_content(const char* a_filename) {
+        std::ifstream f(a_filename, std::ios::in | std::ios::binary);
+        return std::string(std::istreambuf_iterator<char>(f),
+                           std::istreambuf_iterator<char>());
+    }
+
+    // Time to log ITERATIONS messages and drain the logger's queue
+    template <class Traits>
+    double logger_drain_time(const char* a_name)
+    {
+        ::unlink(s_filename);
+        size_t total = 0;
+        timer  tm;
+        {
+            text_file_logger<Traits> logger;
+            BOOST_REQUIRE_EQUAL(0, logger.start(s_filename));
+            for (int i = 0; i < ITERATIONS; i++)
+                BOOST_REQUIRE(logger.fwrite(s_str1, i) > 0);
+            logger.stop();
+        }
+        double elapsed = tm.elapsed();
+
+        char buf[128];
+        for (int i = 0; i < ITERATIONS; i++)
+            total += sprintf(buf, s_str1, i);
+
+        // All messages were written, and nothing else
+        BOOST_CHECK_EQUAL(total, file_content(s_filename).size());
+
+        BOOST_TEST_MESSAGE(a_name << ": " << std::fixed << std::setprecision(3)
+                           << elapsed * 1000 << "ms, "
+                           << int(double(ITERATIONS) / elapsed) << " msgs/s");
+        ::unlink(s_filename);
+        return elapsed;
+    }
+
+    // Time of writing ITERATIONS messages by the logger's writer thread,
+    // which flushes the file on every commit of a batch of messages
+    template <class Traits>
+    double traits_write_time(const char* a_name, int a_batch)
+    {
+        ::unlink(s_filename);
+        char buf[128];
+        int  n    = sprintf(buf, s_str1, 123456);
+        auto file = Traits::file_open(s_filename);
+        BOOST_REQUIRE(file != Traits::null_file_value);
+
+        timer tm;
+        for (int i = 0; i < ITERATIONS; i++) {
+            BOOST_REQUIRE(Traits::file_write(file, buf, n) >= 0);
+            if (i % a_batch == 0)
+                BOOST_REQUIRE(Traits::file_flush(file) >= 0);
+        }
+        Traits::file_close(file);
+        double elapsed = tm.elapsed();
+
+        BOOST_CHECK_EQUAL(size_t(n) * ITERATIONS,
+                          file_content(s_filename).size());
+
+        BOOST_TEST_MESSAGE(a_name << " file_write: " << std::fixed
+                           << std::setprecision(1)
+                           << elapsed * 1e9 / ITERATIONS << " ns/msg");
+        ::unlink(s_filename);
+        return elapsed;
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_async_file_logger_mmap_writer )
+{
+    ::unlink(s_filename);
+
+    std::string expect;
+    {
+        auto w = mmap_file_writer::open(s_filename, 0640, 5000, 1000);
+        BOOST_REQUIRE(w);
+        std::unique_ptr<mmap_file_writer> guard(w);
+
+        BOOST_CHECK_EQUAL(0u, w->size());
+        BOOST_CHECK_EQUAL(0u, w->extent() % sysconf(_SC_PAGESIZE));
+
+        // Writes of odd sizes crossing the window boundaries
+        for (int i = 0; i < 3000; i++) {
+            std::string s(1 + i % 97, 'a' + i % 26);
+            BOOST_REQUIRE_EQUAL(int(s.size()), w->write(s.c_str(), s.size()));
+            expect += s;
+            BOOST_REQUIRE_EQUAL(0, w->flush());
+        }
+        BOOST_CHECK_EQUAL(expect.size(), w->size());
+        BOOST_CHECK(w->allocated() >= w->size());
+        BOOST_CHECK_EQUAL(0u, w->allocated() % w->extent());
+        BOOST_CHECK_EQUAL(0, w->flush(true));
+
+        BOOST_CHECK_EQUAL(0, w->close());
+        BOOST_CHECK_EQUAL(0, w->close());
+    }
+    BOOST_CHECK(expect == file_content(s_filename));
+
+    // Reopening appends to the data truncated on close
+    {
+        std::unique_ptr<mmap_file_writer> w
+            (mmap_file_writer::open(s_filename, 0640, 4096, 1000));
+        BOOST_REQUIRE(w);
+        BOOST_CHECK_EQUAL(expect.size(), w->size());
+        BOOST_CHECK_EQUAL(5, w->write("abcde", 5));
+        expect += "abcde";
+    }
+    BOOST_CHECK(expect == file_content(s_filename));
+
+    // Zero padding left preallocated by a crash is trimmed on reopen
+    BOOST_REQUIRE_EQUAL(0, ::truncate(s_filename, expect.size() + 10000));
+    {
+        std::unique_ptr<mmap_file_writer> w
+            (mmap_file_writer::open(s_filename, 0640, 4096, 1000));
+        BOOST_REQUIRE(w);
+        BOOST_CHECK_EQUAL(expect.size(), w->size());
+        BOOST_CHECK_EQUAL(3, w->write("xyz", 3));
+        expect += "xyz";
+    }
+    BOOST_CHECK(expect == file_content(s_filename));
+
+    // Trailing NUL bytes of flushed data survive a crash, in which the file
+    // keeps its preallocated size (the writer is left open to simulate it)
+    {
+        std::unique_ptr<mmap_file_writer> w
+            (mmap_file_writer::open(s_filename, 0640, 4096, 1000));
+        BOOST_REQUIRE(w);
+        BOOST_CHECK_EQUAL(5, w->write("ab\0\0\0", 5));
+        expect += std::string("ab\0\0\0", 5);
+
+        // The size is only recorded when writeback is started
+        uint64_t n = 0;
+        BOOST_CHECK_EQUAL(0, w->flush());
+        if (::fgetxattr(w->fd(), "user.utxx.data_size", &n, sizeof(n)) < 0) {
+            BOOST_TEST_MESSAGE("Extended attributes are not supported");
+        } else {
+            BOOST_CHECK_EQUAL(expect.size() - 5, n);
+            BOOST_CHECK_EQUAL(0, w->flush(true));
+            BOOST_REQUIRE_EQUAL(int(sizeof(n)), ::fgetxattr
+                (w->fd(), "user.utxx.data_size", &n, sizeof(n)));
+            BOOST_CHECK_EQUAL(expect.size(), n);
+            BOOST_REQUIRE_EQUAL(0, ::truncate(s_filename, expect.size()+10000));
+
+            std::unique_ptr<mmap_file_writer> w2
+                (mmap_file_writer::open(s_filename, 0640, 4096, 1000));
+            BOOST_REQUIRE(w2);
+            BOOST_CHECK_EQUAL(expect.size(), w2->size());
+            w.reset();
+            BOOST_CHECK_EQUAL(3, w2->write("xyz", 3));
+            expect += "xyz";
+        }
+    }
+    BOOST_CHECK(expect == file_content(s_filename));
+
+    BOOST_CHECK(!mmap_file_writer::open("/proc/xxxx/yyyy", 0640));
+    ::unlink(s_filename);
+}
+
+BOOST_AUTO_TEST_CASE( test_async_file_logger_mmap )
+{
+    ::unlink(s_filename);
+
+    std::string expect;
+    for (int k = 0; k < 2; k++) {
+        text_file_logger<small_mmap_logger_traits> logger;
+        BOOST_REQUIRE_EQUAL(0, logger.start(s_filename));
+
+        for (int i = 0; i < 1000; i++) {
+            BOOST_REQUIRE(logger.fwrite(s_str1, i) > 0);
+            char buf[128];
+            expect += std::string(buf, sprintf(buf, s_str1, i));
+        }
+        logger.stop();
+
+        // The file is truncated to the size of the data on close
+        BOOST_CHECK(expect == file_content(s_filename));
+    }
+
+    ::unlink(s_filename);
+}
+
+BOOST_AUTO_TEST_CASE( test_async_file_logger_mmap_perf )
+{
+    // Timings are only reported, the helpers check the size of the output
+    logger_drain_time<async_file_logger_traits>("FILE* logger");
+    logger_drain_time<async_fd_logger_traits>  ("fd    logger");
+    logger_drain_time<async_mmap_logger_traits>("mmap  logger");
+
+    const int batch = 16;
+    traits_write_time<async_file_logger_traits>("FILE*", batch);
+    traits_write_time<async_fd_logger_traits>  ("fd   ", batch);
+    traits_write_time<async_mmap_logger_traits>("mmap ", batch);
+}
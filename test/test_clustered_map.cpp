@@ -42,6 +42,12 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 #if __cplusplus >= 201103L
 #include <random>
+#include <map>
+#include <array>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <vector>
 #else
 #include <boost/random.hpp>
 #endif
@@ -192,3 +198,155 @@ BOOST_AUTO_TEST_CASE( test_clustered_map ) {
 }
 
 
+
+#ifndef UTXX_STANDALONE
+
+BOOST_AUTO_TEST_CASE( test_clustered_map_const_concurrent ) {
+    // Const lookups don't update the mru slots, so they can run concurrently
+    cmap m;
+    for (size_t k = 0; k < 64*100; k += 3)
+        m.insert(k, 1);
+
+    const cmap& cm = m;
+    std::vector<std::thread> threads;
+    std::atomic<long> errors(0);
+    for (int t = 0; t < 4; t++)
+        threads.emplace_back([&cm, &errors, t]() {
+            for (int i = 0; i < 100000; i++) {
+                size_t k = ((i * 7 + t) % 100) * 64;
+                size_t n = (64 + 2 - k % 3) / 3;
+                if (cm.item_count(k) != n)
+                    errors++;
+            }
+        });
+    for (auto& t : threads)
+        t.join();
+    BOOST_CHECK_EQUAL(0, errors.load());
+}
+
+BOOST_AUTO_TEST_CASE( test_clustered_map_order ) {
+    // Random operations give the same results and the same iteration order
+    // as std::map in both sort orders
+    utxx::clustered_map<long, long>                      a;
+    utxx::clustered_map<long, long, 6, utxx::desending>  d;
+    std::map<long, long>                                 m;
+    std::mt19937                                         rnd(1);
+
+    for (int i = 0; i < 200000; ++i) {
+        long k = rnd() % 20000;
+        if (rnd() % 3) {
+            a[k] = d[k] = m[k] = i;
+        } else {
+            bool erased = m.erase(k);
+            BOOST_REQUIRE_EQUAL(erased, a.erase(k));
+            BOOST_REQUIRE_EQUAL(erased, d.erase(k));
+        }
+        long k2 = rnd() % 20000;
+        auto it = m.find(k2);
+        long* p = a.at(k2);
+        BOOST_REQUIRE_EQUAL(it == m.end(), p == NULL);
+        if (p)
+            BOOST_REQUIRE_EQUAL(it->second, *p);
+    }
+
+    auto mi = m.begin();
+    for (auto it = a.begin(), e = a.end(); it != e; ++it, ++mi) {
+        BOOST_REQUIRE(mi != m.end());
+        BOOST_REQUIRE_EQUAL(mi->first,  it.key());
+        BOOST_REQUIRE_EQUAL(mi->second, it.data());
+    }
+    BOOST_REQUIRE(mi == m.end());
+
+    auto ri = m.rbegin();
+    for (auto it = d.begin(), e = d.end(); it != e; ++it, ++ri) {
+        BOOST_REQUIRE(ri != m.rend());
+        BOOST_REQUIRE_EQUAL(ri->first,  it.key());
+        BOOST_REQUIRE_EQUAL(ri->second, it.data());
+    }
+    BOOST_REQUIRE(ri == m.rend());
+
+    // References to the data are stable while other groups are added
+    long& r = a[1000000];
+    r = -1;
+    for (long k = 0; k < 100000; k += 64)
+        a[2000000 + k] = k;
+    BOOST_REQUIRE_EQUAL(-1, *a.at(1000000));
+    BOOST_REQUIRE_EQUAL(&r, a.at(1000000));
+}
+
+namespace {
+    // Level-1 index by std::map (the prior implementation of clustered_map)
+    // to compare the cost of group lookups
+    struct map_l1_index {
+        struct group { utxx::bitmap_low<64> index; std::array<long, 64> data; };
+        std::map<long, group> m_map;
+
+        long& operator[](long k) {
+            auto& g = m_map[k & ~63l];
+            g.index.set(k & 63);
+            return g.data[k & 63];
+        }
+        long* at(long k) {
+            auto it = m_map.find(k & ~63l);
+            return it != m_map.end() && it->second.index[k & 63]
+                 ? &it->second.data[k & 63] : NULL;
+        }
+    };
+
+    template <class Fun>
+    double mops(long a_count, Fun&& a_fun) {
+        auto t0 = std::chrono::steady_clock::now();
+        for (long i = 0; i < a_count; ++i)
+            a_fun(i);
+        auto secs = std::chrono::duration<double>
+                    (std::chrono::steady_clock::now() - t0).count();
+        return double(a_count) / secs / 1e6;
+    }
+
+    /// Book-like access patterns over a_levels price levels (in ticks)
+    template <class Map>
+    void bench_book(const char* a_name, long a_count, long a_levels) {
+        Map             m;
+        std::mt19937_64 rnd(1);
+        long            mid = 1 << 20, sum = 0;
+
+        // Sparse book: about every 3rd price level is populated
+        for (long k = mid - a_levels; k < mid + a_levels; k += 1 + rnd() % 5)
+            m[k] = k;
+
+        std::vector<long> uniform(a_count), top(a_count);
+        std::normal_distribution<double> near(0, 20);
+        for (long i = 0; i < a_count; ++i) {
+            uniform[i] = mid - a_levels + long(rnd() % (2 * a_levels));
+            top[i]     = mid + long(near(rnd));
+        }
+
+        auto u = mops(a_count, [&](long i) {
+            long* p = m.at(uniform[i]); sum += p ? *p : 0;
+        });
+        auto t = mops(a_count, [&](long i) {
+            long* p = m.at(top[i]);     sum += p ? *p : 0;
+        });
+        // Orders added/cancelled around a drifting mid price
+        auto c = mops(a_count, [&](long i) {
+            long k = top[i] + (i >> 12) % 64;
+            if (i & 1) m[k] += 1;
+            else if (long* p = m.at(k)) sum += *p;
+        });
+        BOOST_CHECK(sum > 0);
+        BOOST_TEST_MESSAGE(a_name << ": random=" << u << " top=" << t
+                           << " churn=" << c << " (Mops/s)");
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_clustered_map_book_perf ) {
+    const long n = getenv("ITERATIONS") ? atoi(getenv("ITERATIONS")) : 1000000;
+
+    for (long levels : {1000, 20000, 500000}) {
+        BOOST_TEST_MESSAGE("Book depth: " << 2 * levels << " ticks");
+        bench_book<utxx::clustered_map<long, long>>("  clustered_map   ", n, levels);
+        bench_book<map_l1_index>                   ("  std::map groups ", n, levels);
+    }
+}
+
+#endif
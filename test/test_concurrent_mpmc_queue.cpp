@@ -0,0 +1,289 @@
+#include <boost/test/unit_test.hpp>
+#include <utxx/concurrent_mpmc_queue.hpp>
+
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <algorithm>
+
+namespace utxx {
+
+namespace {
+    size_t iterations() { return getenv("ITERATIONS") ? atoi(getenv("ITERATIONS")) : 0; }
+
+    struct DtorChecker {
+        static int numInstances;
+        DtorChecker() noexcept { ++numInstances; }
+        DtorChecker(const DtorChecker&) noexcept { ++numInstances; }
+        DtorChecker& operator=(const DtorChecker&) = default;
+        ~DtorChecker() { --numInstances; }
+    };
+
+    int DtorChecker::numInstances = 0;
+
+    struct NoDefaultChecker : DtorChecker {
+        explicit NoDefaultChecker(int) noexcept {}
+    };
+
+    // Item whose construction from a negative value throws
+    struct Thrower {
+        long value = 0;
+        Thrower() = default;
+        Thrower(long a) : value(a) {
+            if (a < 0) throw std::runtime_error("negative value");
+        }
+        Thrower(const Thrower& a) : Thrower(a.value) {}
+        Thrower(Thrower&&) noexcept = default;
+        Thrower& operator=(Thrower&&) noexcept = default;
+    };
+
+    /// Push a_count values per producer through the queue and verify that
+    /// each one is popped exactly once, and that the values of any producer
+    /// are popped by a consumer in the order they were pushed.
+    /// @return number of popped items per second
+    template <class Queue>
+    double run_contention(Queue& a_queue, int a_producers, int a_consumers,
+                          uint64_t a_count, size_t a_batch)
+    {
+        std::atomic<uint64_t> popped(0), sum(0), errors(0);
+        std::atomic<bool>     start(false);
+        uint64_t const        total = a_count * a_producers;
+
+        std::vector<std::thread> threads;
+
+        for (int p = 0; p < a_producers; ++p)
+            threads.emplace_back([&, p] {
+                while (!start) std::this_thread::yield();
+                std::vector<uint64_t> items(a_batch);
+                for (uint64_t i = 0; i < a_count; ) {
+                    if (a_batch == 1) {
+                        if (a_queue.try_push(uint64_t(p) << 40 | i))
+                            ++i;
+                        else
+                            std::this_thread::yield();
+                        continue;
+                    }
+                    size_t n = std::min<uint64_t>(a_batch, a_count - i);
+                    for (size_t j = 0; j < n; ++j)
+                        items[j] = uint64_t(p) << 40 | (i + j);
+                    size_t k = 0;
+                    while (k < n) {
+                        auto m = a_queue.try_push_n(items.begin() + k, n - k);
+                        if (!m)
+                            std::this_thread::yield();
+                        k += m;
+                    }
+                    i += n;
+                }
+            });
+
+        for (int c = 0; c < a_consumers; ++c)
+            threads.emplace_back([&] {
+                while (!start) std::this_thread::yield();
+                std::vector<uint64_t> last(a_producers, 0);
+                std::vector<uint64_t> items(a_batch);
+                uint64_t local_sum = 0, local_errors = 0;
+                while (popped.load(std::memory_order_relaxed) < total) {
+                    size_t n = a_batch == 1
+                             ? size_t(a_queue.try_pop(items[0]))
+                             : a_queue.try_pop_n(items.begin(), a_batch);
+                    for (size_t j = 0; j < n; ++j) {
+                        auto p = items[j] >> 40;
+                        auto v = items[j] & ((1ul << 40) - 1);
+                        if (v + 1 <= last[p])
+                            ++local_errors;
+                        last[p]    = v + 1;
+                        local_sum += v;
+                    }
+                    if (n)
+                        popped.fetch_add(n, std::memory_order_relaxed);
+                    else
+                        std::this_thread::yield();
+                }
+                sum    += local_sum;
+                errors += local_errors;
+            });
+
+        auto t0 = std::chrono::steady_clock::now();
+        start   = true;
+        for (auto& t : threads)
+            t.join();
+        auto secs = std::chrono::duration<double>
+                    (std::chrono::steady_clock::now() - t0).count();
+
+        BOOST_CHECK_EQUAL(total, popped.load());
+        BOOST_CHECK_EQUAL(a_producers * (a_count * (a_count - 1) / 2), sum.load());
+        BOOST_CHECK_EQUAL(0u, errors.load());
+        BOOST_CHECK(a_queue.empty());
+        return double(total) / secs;
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_concurrent_mpmc_queue_basic )
+{
+    concurrent_mpmc_queue<int> q(5);   // Rounded down to 4
+    BOOST_CHECK_EQUAL(4u, q.capacity());
+    BOOST_CHECK(q.empty());
+
+    for (int i = 0; i < 4; ++i)
+        BOOST_CHECK(q.try_push(i));
+    BOOST_CHECK(!q.try_push(4));
+    BOOST_CHECK_EQUAL(4u, q.size());
+
+    int v;
+    for (int i = 0; i < 4; ++i) {
+        BOOST_CHECK(q.try_pop(v));
+        BOOST_CHECK_EQUAL(i, v);
+    }
+    BOOST_CHECK(!q.try_pop(v));
+    BOOST_CHECK(q.empty());
+
+    BOOST_CHECK_THROW(concurrent_mpmc_queue<int>(1), badarg_error);
+}
+
+BOOST_AUTO_TEST_CASE( test_concurrent_mpmc_queue_batch )
+{
+    concurrent_spmc_queue<std::string> q(8);
+
+    std::vector<std::string> in{"a", "b", "c", "d", "e", "f"};
+    BOOST_CHECK_EQUAL(6u, q.try_push_n(in.begin(), in.size()));
+    // Only the free cells are claimed
+    BOOST_CHECK_EQUAL(2u, q.try_push_n(in.begin(), in.size()));
+    BOOST_CHECK_EQUAL(0u, q.try_push_n(in.begin(), in.size()));
+
+    std::vector<std::string> out(5);
+    BOOST_CHECK_EQUAL(5u, q.try_pop_n(out.begin(), out.size()));
+    BOOST_CHECK(std::equal(out.begin(), out.end(), in.begin()));
+    BOOST_CHECK_EQUAL(3u, q.try_pop_n(out.begin(), out.size()));
+    BOOST_CHECK_EQUAL("f", out[0]);
+    BOOST_CHECK_EQUAL("a", out[1]);
+    BOOST_CHECK_EQUAL("b", out[2]);
+    BOOST_CHECK_EQUAL(0u, q.try_pop_n(out.begin(), out.size()));
+
+    // Wrap around the ring
+    for (int i = 0; i < 100; ++i) {
+        BOOST_REQUIRE_EQUAL(3u, q.try_push_n(in.begin() + i % 3, 3));
+        BOOST_REQUIRE_EQUAL(3u, q.try_pop_n(out.begin(), 3));
+        BOOST_REQUIRE(std::equal(out.begin(), out.begin() + 3, in.begin() + i % 3));
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_concurrent_mpmc_queue_dtor )
+{
+    {
+        concurrent_mpmc_queue<DtorChecker> q(16);
+        for (int i = 0; i < 10; ++i)
+            q.try_push();
+        BOOST_CHECK_EQUAL(10, DtorChecker::numInstances);
+        DtorChecker d;
+        BOOST_CHECK(q.try_pop(d));
+        BOOST_CHECK_EQUAL(10, DtorChecker::numInstances);
+    }
+    BOOST_CHECK_EQUAL(0, DtorChecker::numInstances);
+
+    // Remaining items are destroyed in place, so T needs no default ctor
+    {
+        concurrent_mpmc_queue<NoDefaultChecker> q(8);
+        for (int i = 0; i < 5; ++i)
+            q.try_push(i);
+        BOOST_CHECK_EQUAL(5, DtorChecker::numInstances);
+        q.clear();
+        BOOST_CHECK_EQUAL(0, DtorChecker::numInstances);
+        BOOST_CHECK(q.empty());
+        for (int i = 0; i < 8; ++i)
+            BOOST_CHECK(q.try_push(i));
+        BOOST_CHECK(!q.try_push(8));
+    }
+    BOOST_CHECK_EQUAL(0, DtorChecker::numInstances);
+}
+
+BOOST_AUTO_TEST_CASE( test_concurrent_mpmc_queue_throwing_ctor )
+{
+    concurrent_mpmc_queue<Thrower> q(4);
+
+    // A failed construction doesn't leave a claimed cell behind
+    BOOST_CHECK(q.try_push(1L));
+    BOOST_CHECK_THROW(q.try_push(-1L), std::runtime_error);
+    BOOST_CHECK(q.try_push(2L));
+
+    std::vector<Thrower> in{Thrower(3), Thrower(4), Thrower(5)};
+    in[1].value = -4;
+    BOOST_CHECK_THROW(q.try_push_n(in.begin(), in.size()), std::runtime_error);
+    BOOST_CHECK_EQUAL(3u, q.size());
+
+    Thrower v;
+    for (long i : {1, 2, 3}) {
+        BOOST_REQUIRE(q.try_pop(v));
+        BOOST_CHECK_EQUAL(i, v.value);
+    }
+    BOOST_CHECK(!q.try_pop(v));
+    BOOST_CHECK(q.try_push(6L));
+    BOOST_REQUIRE(q.try_pop(v));
+    BOOST_CHECK_EQUAL(6, v.value);
+}
+
+BOOST_AUTO_TEST_CASE( test_concurrent_mpmc_queue_shmem )
+{
+    typedef concurrent_spmc_queue<long> queue;
+
+    auto size = queue::memory_size(64);
+    void* mem;
+    BOOST_REQUIRE_EQUAL(0, ::posix_memalign(&mem, UTXX_CL_SIZE, size));
+    std::unique_ptr<void, decltype(&::free)> guard(mem, &::free);
+
+    queue producer(mem, size, true);
+    queue consumer(mem, size, false);
+    BOOST_CHECK_EQUAL(64u, consumer.capacity());
+
+    for (long i = 0; i < 10; ++i)
+        BOOST_CHECK(producer.try_push(i));
+
+    long v;
+    for (long i = 0; i < 10; ++i) {
+        BOOST_CHECK(consumer.try_pop(v));
+        BOOST_CHECK_EQUAL(i, v);
+    }
+    BOOST_CHECK(producer.empty());
+
+    // Attaching with a different item type fails
+    BOOST_CHECK_THROW(concurrent_spmc_queue<int>(mem, size, false), runtime_error);
+
+    // Attaching to uninitialized memory fails
+    memset(mem, 0, size);
+    BOOST_CHECK_THROW(queue(mem, size, false), runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE( test_concurrent_mpmc_queue_perf )
+{
+    auto     n     = iterations();
+    uint64_t count = n ? n : 1000000;
+    int      ncpu  = std::max(2u, std::thread::hardware_concurrency());
+
+    // Spinning threads yield the CPU, so that the sweep also works with more
+    // threads than CPUs
+    for (size_t batch : {1, 16}) {
+        for (int threads = 1; threads <= std::max(4, std::min(ncpu / 2, 8));
+             threads *= 2) {
+            {
+                concurrent_spmc_queue<uint64_t> q(1024);
+                auto rate = run_contention(q, 1, threads, count, batch);
+                BOOST_TEST_MESSAGE("SPMC 1x" << threads << " batch=" << batch
+                                   << ": " << int(rate / 1e3) << " Kops/s");
+            }
+            {
+                concurrent_mpmc_queue<uint64_t> q(1024);
+                auto rate = run_contention(q, threads, threads,
+                                           count / threads, batch);
+                BOOST_TEST_MESSAGE("MPMC " << threads << 'x' << threads
+                                   << " batch=" << batch << ": "
+                                   << int(rate / 1e3) << " Kops/s");
+            }
+        }
+    }
+}
+
+} // namespace utxx
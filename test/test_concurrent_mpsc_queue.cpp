@@ -6,6 +6,7 @@
 #include <chrono>
 #include <memory>
 #include <thread>
+#include <set>
 
 namespace utxx {
 
@@ -76,4 +77,160 @@ BOOST_AUTO_TEST_CASE( test_concurrent_mpsc_queue ) {
     }
 }
 
+namespace {
+    size_t iterations() { return getenv("ITERATIONS") ? atoi(getenv("ITERATIONS")) : 0; }
+
+    struct counted {
+        static std::atomic<int> instances;
+        uint64_t value;
+        counted(uint64_t a_val) : value(a_val) { ++instances; }
+        counted(const counted& a) : value(a.value) { ++instances; }
+        ~counted() { --instances; }
+    };
+
+    std::atomic<int> counted::instances(0);
+
+    /// Push a_count values per producer (in chains of a_chain nodes when
+    /// a_chain > 1), and verify that the consumer gets each producer's values
+    /// in order.
+    /// @return number of items per second
+    double run_mpsc(int a_producers, uint64_t a_count, size_t a_chain)
+    {
+        typedef concurrent_mpsc_queue<counted> queue;
+        typedef typename queue::node           node;
+
+        queue                q;
+        std::atomic<int>     done(0);
+        std::vector<std::thread> threads;
+
+        auto t0 = std::chrono::steady_clock::now();
+
+        for (int p = 0; p < a_producers; ++p)
+            threads.emplace_back([&, p] {
+                for (uint64_t i = 0; i < a_count; ) {
+                    if (a_chain < 2) {
+                        if (q.emplace(uint64_t(p) << 40 | i))
+                            ++i;
+                        continue;
+                    }
+                    node* first = nullptr, *last = nullptr;
+                    for (size_t j = 0; j < a_chain && i < a_count; ++j, ++i) {
+                        node* n = q.allocate(uint64_t(p) << 40 | i);
+                        if (last) last->next(n); else first = n;
+                        last = n;
+                    }
+                    q.push_chain(first, last);
+                }
+                ++done;
+            });
+
+        std::vector<uint64_t> next(a_producers, 0);
+        uint64_t total = 0, errors = 0;
+
+        while (true) {
+            bool  finished = done == a_producers;
+            node* n        = q.pop_all();
+            if (!n && finished)
+                break;
+            if (!n)
+                std::this_thread::yield();
+            for (node* tmp; n; n = tmp) {
+                tmp    = n->next();
+                auto p = n->data().value >> 40;
+                auto v = n->data().value & ((1ul << 40) - 1);
+                if (v != next[p]++)
+                    ++errors;
+                ++total;
+                q.free(n);
+            }
+        }
+        for (auto& t : threads)
+            t.join();
+
+        auto secs = std::chrono::duration<double>
+                    (std::chrono::steady_clock::now() - t0).count();
+
+        BOOST_CHECK_EQUAL(a_producers * a_count, total);
+        BOOST_CHECK_EQUAL(0u, errors);
+        return double(total) / secs;
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_concurrent_mpsc_queue_chain ) {
+    typedef typename concurrent_mpsc_queue<int>::node node;
+
+    concurrent_mpsc_queue<int> queue;
+
+    queue.push(1);
+    node* a = queue.allocate(2);
+    node* b = queue.allocate(3);
+    node* c = queue.allocate(4);
+    a->next(b);
+    b->next(c);
+    queue.push_chain(a, c);
+    queue.push(5);
+
+    // A single node chain
+    node* d = queue.allocate(6);
+    queue.push_chain(d, d);
+
+    int i = 0;
+    for (node* n = queue.pop_all(), *tmp; n; n = tmp, ++i) {
+        BOOST_CHECK_EQUAL(i+1, n->data());
+        tmp = n->next();
+        queue.free(n);
+    }
+    BOOST_CHECK_EQUAL(6, i);
+    BOOST_CHECK(queue.empty());
+}
+
+BOOST_AUTO_TEST_CASE( test_concurrent_mpsc_queue_recycle ) {
+    typedef concurrent_mpsc_queue<counted> queue;
+    typedef typename queue::node           node;
+
+    {
+        queue q;
+        std::vector<node*> nodes;
+        for (size_t i = 0; i < queue::s_recycle_batch; ++i)
+            nodes.push_back(q.allocate(i));
+        BOOST_CHECK_EQUAL(int(queue::s_recycle_batch), counted::instances.load());
+
+        for (auto n : nodes)
+            q.push(n);
+        for (node* n = q.pop_all(), *tmp; n; n = tmp) {
+            tmp = n->next();
+            q.free(n);
+        }
+        BOOST_CHECK_EQUAL(0, counted::instances.load());
+
+        // Freed nodes are given back to a producer thread once its own free
+        // list runs out
+        std::set<node*> freed(nodes.begin(), nodes.end());
+        std::thread([&] {
+            for (size_t i = 0; i < queue::s_recycle_batch; ++i) {
+                node* n = q.allocate(i);
+                BOOST_CHECK(freed.count(n));
+                q.push(n);
+            }
+        }).join();
+
+        // The nodes left in the queue are destroyed by the queue's dtor
+        BOOST_CHECK_EQUAL(int(queue::s_recycle_batch), counted::instances.load());
+    }
+    BOOST_CHECK_EQUAL(0, counted::instances.load());
+}
+
+BOOST_AUTO_TEST_CASE( test_concurrent_mpsc_queue_perf ) {
+    auto     n     = iterations();
+    uint64_t count = n ? n : 500000;
+
+    for (int producers : {1, 2, 4})
+        for (size_t chain : {1, 16}) {
+            auto rate = run_mpsc(producers, count, chain);
+            BOOST_TEST_MESSAGE("MPSC " << producers << " producers, chain="
+                               << chain << ": " << int(rate / 1e3) << " Kops/s");
+        }
+    BOOST_CHECK_EQUAL(0, counted::instances.load());
+}
+
 } // namespace utxx
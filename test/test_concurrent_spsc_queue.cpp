@@ -7,6 +7,8 @@
 #include <memory>
 #include <thread>
 #include <math.h>
+#include <sys/wait.h>
+#include <unistd.h>
 
 namespace utxx {
 
@@ -180,6 +182,139 @@ struct DtorChecker {
 
 int DtorChecker::numInstances = 0;
 
+namespace {
+    /// Item of a given size for the throughput benchmark
+    template <size_t N>
+    struct blob {
+        uint64_t seq;
+        char     data[N - sizeof(uint64_t)];
+
+        blob(uint64_t a_seq = 0) : seq(a_seq) {}
+    };
+
+    /// Reference queue loading the other side's index on every operation,
+    /// with the head and the tail on the same cache line (the way
+    /// concurrent_spsc_queue used to work) for comparison in the benchmark
+    template <class T>
+    struct uncached_spsc_queue {
+        std::atomic<uint32_t> m_head{0};
+        std::atomic<uint32_t> m_tail{0};
+        uint32_t              m_mask;
+        std::vector<T>        m_recs;
+
+        explicit uncached_spsc_queue(uint32_t a_cap)
+            : m_mask(a_cap - 1), m_recs(a_cap) {}
+
+        bool push(T const& a_item) {
+            uint32_t t    = m_tail.load(std::memory_order_relaxed);
+            uint32_t next = (t + 1) & m_mask;
+            if (next == m_head.load(std::memory_order_acquire))
+                return false;
+            m_recs[t] = a_item;
+            m_tail.store(next, std::memory_order_release);
+            return true;
+        }
+
+        bool pop(T& a_item) {
+            uint32_t h = m_head.load(std::memory_order_relaxed);
+            if (h == m_tail.load(std::memory_order_acquire))
+                return false;
+            a_item = m_recs[h];
+            m_head.store((h + 1) & m_mask, std::memory_order_release);
+            return true;
+        }
+    };
+
+    /// Pass \a a_count items from a producer to a consumer thread.
+    /// \a a_push and \a a_pop transfer items starting at a given sequence
+    /// number, and return the number of transferred items.
+    /// @return number of items per second
+    template <class Push, class Pop>
+    double spsc_throughput(uint64_t a_count, Push a_push, Pop a_pop)
+    {
+        auto t0 = std::chrono::steady_clock::now();
+
+        std::thread producer([&] {
+            for (uint64_t i = 0; i < a_count; ) {
+                auto n = a_push(i, a_count - i);
+                if (!n)
+                    std::this_thread::yield();
+                i += n;
+            }
+        });
+
+        for (uint64_t i = 0; i < a_count; ) {
+            auto n = a_pop(i);
+            if (!n)
+                std::this_thread::yield();
+            i += n;
+        }
+        producer.join();
+
+        return double(a_count) / std::chrono::duration<double>
+               (std::chrono::steady_clock::now() - t0).count();
+    }
+
+    template <class T, class Queue>
+    double spsc_throughput(Queue& a_queue, uint64_t a_count, uint64_t& a_errs)
+    {
+        T item;
+        return spsc_throughput(a_count,
+            [&](uint64_t i, uint64_t)  { return a_queue.push(T(i)) ? 1 : 0; },
+            [&](uint64_t i) {
+                if (!a_queue.pop(item))
+                    return 0;
+                a_errs += item.seq != i;
+                return 1;
+            });
+    }
+
+    template <class T, class Queue>
+    double spsc_batch_throughput(Queue& a_queue, uint64_t a_count,
+                                 uint32_t a_batch, uint64_t& a_errs)
+    {
+        return spsc_throughput(a_count,
+            [&](uint64_t i, uint64_t a_left) {
+                uint32_t n = std::min<uint64_t>(a_batch, a_left);
+                T*       p = a_queue.begin_write(n);
+                for (uint32_t j = 0; j < n; ++j)
+                    new (p + j) T(i + j);
+                if (n)
+                    a_queue.commit_write(n);
+                return n;
+            },
+            [&](uint64_t i) {
+                uint32_t n = a_batch;
+                T*       p = a_queue.peek_batch(n);
+                for (uint32_t j = 0; j < n; ++j)
+                    a_errs += p[j].seq != i + j;
+                if (n)
+                    a_queue.release(n);
+                return n;
+            });
+    }
+
+    template <size_t N>
+    void spsc_throughput_sizes(uint64_t a_count)
+    {
+        typedef blob<N> item;
+        auto rate = [](double a) { return int(a / 1e3); };
+
+        uncached_spsc_queue<item>   q1(1024);
+        concurrent_spsc_queue<item> q2(1024);
+
+        uint64_t errs = 0;
+        auto r1 = spsc_throughput<item>(q1, a_count, errs);
+        auto r2 = spsc_throughput<item>(q2, a_count, errs);
+        auto r3 = spsc_batch_throughput<item>(q2, a_count, 32, errs);
+        BOOST_CHECK_EQUAL(0u, errs);
+
+        BOOST_TEST_MESSAGE("SPSC item size " << N << ": uncached "
+                           << rate(r1) << " Kops/s, cached " << rate(r2)
+                           << " Kops/s, batch(32) " << rate(r3) << " Kops/s");
+    }
+}
+
 //////////////////////////////////////////////////////////////////////
 
 BOOST_AUTO_TEST_CASE( test_concurrent_spsc_empty ) {
@@ -308,4 +443,204 @@ BOOST_AUTO_TEST_CASE( test_concurrent_spsc_iterator )
     }
 }
 
+BOOST_AUTO_TEST_CASE( test_concurrent_spsc_shm )
+{
+    typedef concurrent_spsc_queue<long> queue;
+
+    auto name = "/utxx-spsc-test-" + std::to_string(::getpid());
+    queue::remove_shm(name);
+
+    BOOST_CHECK_THROW(queue::attach_shm(name, queue::side_t::consumer),
+                      io_error);
+
+    auto producer = queue::create_in_shm(name, 10, queue::side_t::producer);
+    BOOST_CHECK_EQUAL(8u, producer->capacity());
+    BOOST_CHECK(!producer->blocking());
+
+    // The segment already exists
+    BOOST_CHECK_THROW(queue::create_in_shm(name, 8, queue::side_t::producer),
+                      io_error);
+
+    // Attaching to a queue of items of a different size
+    BOOST_CHECK_THROW(concurrent_spsc_queue<char>::attach_shm
+                        (name, concurrent_spsc_queue<char>::side_t::consumer),
+                      runtime_error);
+
+    auto consumer = queue::attach_shm(name, queue::side_t::consumer);
+    BOOST_CHECK_EQUAL(8u, consumer->capacity());
+
+    for (long i = 0; i < 7; ++i)
+        BOOST_CHECK(producer->push(i));
+    BOOST_CHECK(!producer->push(7));
+
+    long v;
+    for (long i = 0; i < 7; ++i) {
+        BOOST_CHECK(consumer->pop(v));
+        BOOST_CHECK_EQUAL(i, v);
+    }
+    BOOST_CHECK(consumer->empty());
+
+    BOOST_CHECK(queue::remove_shm(name));
+    BOOST_CHECK(!queue::remove_shm(name));
+
+    // The queue is still usable after the segment is removed
+    BOOST_CHECK(producer->push(10));
+    BOOST_CHECK(consumer->pop(v));
+    BOOST_CHECK_EQUAL(10, v);
+}
+
+BOOST_AUTO_TEST_CASE( test_concurrent_spsc_pop_wait )
+{
+    using namespace std::chrono;
+
+    concurrent_spsc_queue<int> nb(8);
+    int v;
+    BOOST_CHECK_THROW(nb.pop_wait(v, milliseconds(1)), runtime_error);
+
+    concurrent_spsc_queue<int> q(8, true);
+    BOOST_CHECK(q.blocking());
+
+    auto t0 = steady_clock::now();
+    BOOST_CHECK(!q.pop_wait(v, milliseconds(20)));
+    BOOST_CHECK(steady_clock::now() - t0 >= milliseconds(20));
+
+    // The consumer blocks until the producer pushes an item
+    std::thread producer([&] {
+        for (int i = 0; i < 3; ++i) {
+            std::this_thread::sleep_for(milliseconds(10));
+            q.push(i);
+        }
+    });
+
+    for (int i = 0; i < 3; ++i) {
+        BOOST_CHECK(q.pop_wait(v, seconds(5), 0));
+        BOOST_CHECK_EQUAL(i, v);
+    }
+    producer.join();
+}
+
+BOOST_AUTO_TEST_CASE( test_concurrent_spsc_shm_ipc )
+{
+    using namespace std::chrono;
+    typedef concurrent_spsc_queue<uint64_t> queue;
+
+    auto name  = "/utxx-spsc-ipc-" + std::to_string(::getpid());
+    auto n     = iterations();
+    uint64_t count = n ? n : 1000000;
+
+    queue::remove_shm(name);
+
+    pid_t pid = ::fork();
+    BOOST_REQUIRE(pid >= 0);
+
+    if (pid == 0) {
+        // Producer process: wait for the consumer to create the queue
+        int rc = 0;
+        try {
+            auto q = queue::attach_shm(name, queue::side_t::producer,
+                                       seconds(5));
+            for (uint64_t i = 0; i < count; ++i)
+                while (!q->push(i))
+                    std::this_thread::yield();
+        } catch (...) {
+            rc = 1;
+        }
+        ::_exit(rc);
+    }
+
+    auto q = queue::create_in_shm(name, 1024, queue::side_t::consumer, true);
+
+    auto     t0     = steady_clock::now();
+    uint64_t errors = 0, v;
+    uint64_t i      = 0;
+    for (; i < count && q->pop_wait(v, seconds(5)); ++i)
+        if (v != i)
+            ++errors;
+    auto secs = duration<double>(steady_clock::now() - t0).count();
+
+    int status;
+    BOOST_REQUIRE_EQUAL(pid, ::waitpid(pid, &status, 0));
+    BOOST_CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    BOOST_CHECK_EQUAL(count, i);
+    BOOST_CHECK_EQUAL(0u, errors);
+    BOOST_CHECK(queue::remove_shm(name));
+
+    BOOST_TEST_MESSAGE("SPSC shm IPC: " << int(double(i) / secs / 1e3)
+                       << " Kops/s");
+}
+
+BOOST_AUTO_TEST_CASE( test_concurrent_spsc_batch )
+{
+    concurrent_spsc_queue<std::string> q(8);
+
+    // At most capacity-1 slots are available
+    uint32_t n = 10;
+    std::string* p = q.begin_write(n);
+    BOOST_REQUIRE(p);
+    BOOST_CHECK_EQUAL(7u, n);
+    for (uint32_t i = 0; i < 5; ++i)
+        new (p + i) std::string(1, char('a' + i));
+    q.commit_write(5);
+    BOOST_CHECK_EQUAL(5u, q.count());
+
+    n = 3;
+    p = q.peek_batch(n);
+    BOOST_REQUIRE(p);
+    BOOST_CHECK_EQUAL(3u, n);
+    BOOST_CHECK_EQUAL("a", p[0]);
+    BOOST_CHECK_EQUAL("c", p[2]);
+    q.release(3);
+
+    // The free space wraps around the end of the ring: only the slots up to
+    // the end are returned
+    n = 10;
+    p = q.begin_write(n);
+    BOOST_CHECK_EQUAL(3u, n);
+    for (uint32_t i = 0; i < n; ++i)
+        new (p + i) std::string(1, char('f' + i));
+    q.commit_write(n);
+
+    n = 10;
+    p = q.begin_write(n);
+    BOOST_CHECK_EQUAL(2u, n);
+    new (p) std::string("i");
+    q.commit_write(1);
+    BOOST_CHECK(q.push("j"));
+    BOOST_CHECK(q.full());
+
+    n = 1;
+    BOOST_CHECK(!q.begin_write(n));
+    BOOST_CHECK_EQUAL(0u, n);
+
+    // Items d..h are before the end of the ring, i..j - after the wrap
+    n = 10;
+    p = q.peek_batch(n);
+    BOOST_CHECK_EQUAL(5u, n);
+    BOOST_CHECK_EQUAL("d", p[0]);
+    BOOST_CHECK_EQUAL("h", p[4]);
+    q.release(n);
+
+    n = 10;
+    p = q.peek_batch(n);
+    BOOST_CHECK_EQUAL(2u, n);
+    BOOST_CHECK_EQUAL("i", p[0]);
+    BOOST_CHECK_EQUAL("j", p[1]);
+    q.release(n);
+
+    BOOST_CHECK(q.empty());
+    n = 10;
+    BOOST_CHECK(!q.peek_batch(n));
+    BOOST_CHECK_EQUAL(0u, n);
+}
+
+BOOST_AUTO_TEST_CASE( test_concurrent_spsc_throughput )
+{
+    auto     n     = iterations();
+    uint64_t count = n ? n : 2000000;
+
+    spsc_throughput_sizes<8>  (count);
+    spsc_throughput_sizes<64> (count);
+    spsc_throughput_sizes<256>(count);
+}
+
 } // namespace utxx
@@ -0,0 +1,320 @@
+#include <boost/test/unit_test.hpp>
+#include <utxx/flat_hash_map.hpp>
+#include <utxx/atomic_hash_map.hpp>
+#include <utxx/hashmap.hpp>
+
+#include <vector>
+#include <chrono>
+#include <random>
+#include <string>
+#include <unordered_map>
+
+namespace utxx {
+
+namespace {
+    size_t iterations() { return getenv("ITERATIONS") ? atoi(getenv("ITERATIONS")) : 0; }
+
+    struct DtorChecker {
+        static int numInstances;
+        DtorChecker() { ++numInstances; }
+        DtorChecker(const DtorChecker&) { ++numInstances; }
+        DtorChecker& operator=(const DtorChecker&) = default;
+        ~DtorChecker() { --numInstances; }
+    };
+
+    int DtorChecker::numInstances = 0;
+
+    /// Value whose move may throw, and whose copy throws on demand
+    struct ThrowingCopy {
+        static int copiesLeft;
+        int value;
+        ThrowingCopy(int a = 0) : value(a) {}
+        ThrowingCopy(const ThrowingCopy& a) : value(a.value) {
+            if (copiesLeft >= 0 && copiesLeft-- == 0)
+                throw std::runtime_error("copy failed");
+        }
+        ThrowingCopy(ThrowingCopy&& a) noexcept(false) : value(a.value) { a.value = -1; }
+        ThrowingCopy& operator=(const ThrowingCopy&) = default;
+    };
+
+    int ThrowingCopy::copiesLeft = -1;
+
+    /// Time a_fun(i) called for i in [0, a_count).
+    /// @return millions of calls per second
+    template <class Fun>
+    double mops(size_t a_count, Fun&& a_fun)
+    {
+        auto t0 = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < a_count; ++i)
+            a_fun(i);
+        auto secs = std::chrono::duration<double>
+                    (std::chrono::steady_clock::now() - t0).count();
+        return double(a_count) / secs / 1e6;
+    }
+
+    template <class Map>
+    void bench_int(const char* a_name, const std::vector<long>& a_keys,
+                   const std::vector<long>& a_misses)
+    {
+        auto n = a_keys.size();
+        long sum = 0;
+        Map  m(n);
+        auto ins  = mops(n, [&](size_t i) { m.insert(std::make_pair(a_keys[i], long(i))); });
+        auto hit  = mops(n, [&](size_t i) { sum += m.find(a_keys[i])   != m.end(); });
+        auto miss = mops(n, [&](size_t i) { sum += m.find(a_misses[i]) != m.end(); });
+        auto era  = mops(n, [&](size_t i) { sum += m.erase(a_keys[i]); });
+        BOOST_CHECK_EQUAL(long(2 * n), sum);
+        BOOST_TEST_MESSAGE(a_name << ": insert=" << ins << " find=" << hit
+                           << " miss=" << miss << " erase=" << era
+                           << " (Mops/s)");
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_flat_hash_map_basic )
+{
+    flat_hash_map<long, long> m;
+    BOOST_CHECK(m.empty());
+    BOOST_CHECK_EQUAL(0u, m.capacity());
+    BOOST_CHECK(m.begin() == m.end());
+    BOOST_CHECK(m.find(1) == m.end());
+    BOOST_CHECK_EQUAL(0u, m.erase(1));
+
+    BOOST_CHECK(m.insert(std::make_pair(1, 10)).second);
+    BOOST_CHECK(!m.insert(std::make_pair(1, 11)).second);
+    BOOST_CHECK(m.emplace(2, 20).second);
+    BOOST_CHECK(m.try_emplace(3, 30).second);
+    m[4] = 40;
+    BOOST_CHECK_EQUAL(4u, m.size());
+    BOOST_CHECK_EQUAL(10, m[1]);
+    BOOST_CHECK_EQUAL(40, m.at(4));
+    BOOST_CHECK_THROW(m.at(5), std::out_of_range);
+    BOOST_CHECK(m.contains(3));
+    BOOST_CHECK_EQUAL(0u, m.count(5));
+
+    m.insert_or_assign(1, 12);
+    BOOST_CHECK_EQUAL(12, m.find(1)->second);
+
+    long sum = 0;
+    for (auto& v : m)
+        sum += v.first;
+    BOOST_CHECK_EQUAL(10, sum);
+
+    BOOST_CHECK_EQUAL(1u, m.erase(2));
+    BOOST_CHECK(m.find(2) == m.end());
+    BOOST_CHECK_EQUAL(3u, m.size());
+
+    // Erasing with iterators visits all remaining values
+    for (auto it = m.begin(); it != m.end(); )
+        it = it->first == 3 ? m.erase(it) : std::next(it);
+    BOOST_CHECK_EQUAL(2u, m.size());
+    BOOST_CHECK(!m.contains(3));
+
+    auto copy = m;
+    auto moved(std::move(m));
+    BOOST_CHECK(m.empty());
+    BOOST_CHECK_EQUAL(2u, copy.size());
+    BOOST_CHECK_EQUAL(12, moved[1]);
+
+    auto cap = copy.capacity();
+    copy.clear();
+    BOOST_CHECK(copy.empty());
+    BOOST_CHECK_EQUAL(cap, copy.capacity());
+
+    flat_hash_map<long, long> r{{1, 1}, {2, 2}};
+    r.reserve(1000);
+    cap = r.capacity();
+    BOOST_CHECK(cap >= 1000u);
+    for (long i = 0; i < 1000; ++i)
+        r[i] = i;
+    BOOST_CHECK_EQUAL(cap, r.capacity());
+    for (long i = 100; i < 1000; ++i)
+        r.erase(i);
+    r.rehash(0);
+    BOOST_CHECK(r.capacity() < cap);
+    BOOST_CHECK_EQUAL(100u, r.size());
+    BOOST_CHECK_EQUAL(99, r.at(99));
+}
+
+BOOST_AUTO_TEST_CASE( test_flat_hash_map_compat )
+{
+    // Same usage as of detail::basic_hash_map
+    typedef flat_hash_map<const char*, int, detail::hash_fun<const char*>>
+        hashtable1;
+
+    hashtable1 tab(10);
+    tab["abc"]                               = 1;
+    tab["Quick fox jumps over the lazy dog"] = 4;
+    BOOST_CHECK_EQUAL(1, tab["abc"]);
+    BOOST_CHECK_EQUAL(4, tab["Quick fox jumps over the lazy dog"]);
+
+    // Random operations give the same results as std::unordered_map,
+    // and erased slots are reused without unbounded growth
+    flat_hash_map<int, int>      m;
+    std::unordered_map<int, int> u;
+    std::mt19937                 rnd(1);
+
+    for (int i = 0; i < 500000; ++i) {
+        int k = rnd() % 5000;
+        switch (rnd() % 3) {
+            case 0:
+                BOOST_REQUIRE_EQUAL(u.emplace(k, i).second,
+                                    m.emplace(k, i).second);
+                break;
+            case 1:
+                BOOST_REQUIRE_EQUAL(u.erase(k), m.erase(k));
+                break;
+            default: {
+                auto a = u.find(k);
+                auto b = m.find(k);
+                BOOST_REQUIRE_EQUAL(a == u.end(), b == m.end());
+                if (b != m.end())
+                    BOOST_REQUIRE_EQUAL(a->second, b->second);
+            }
+        }
+    }
+    BOOST_CHECK_EQUAL(u.size(), m.size());
+    BOOST_CHECK(m.capacity() <= 8191u);
+    for (auto& v : m)
+        BOOST_REQUIRE_EQUAL(u[v.first], v.second);
+}
+
+BOOST_AUTO_TEST_CASE( test_flat_hash_map_heterogeneous )
+{
+    flat_hash_map<std::string, int> s;
+    s["abc"]  = 1;
+    s["abcd"] = 2;
+
+    BOOST_CHECK_EQUAL(1, s.find("abc")->second);
+    BOOST_CHECK_EQUAL(1, s.at(std::string_view("abcdef", 3)));
+    BOOST_CHECK_EQUAL(2, s.find(nchar<4>("abcd"))->second);
+    BOOST_CHECK_EQUAL(1, s.find(nchar<4>("abc"))->second);
+    BOOST_CHECK(!s.contains("ab"));
+    BOOST_CHECK_EQUAL(1u, s.erase(std::string_view("abcd")));
+
+    flat_hash_map<name_t, int> n;
+    n[name_t("IBM")]       = 1;
+    n[name_t("ABCD.EFGH")] = 2;
+
+    BOOST_CHECK_EQUAL(1, n.find("IBM")->second);
+    BOOST_CHECK_EQUAL(2, n.at(std::string("ABCD.EFGH")));
+    BOOST_CHECK_EQUAL(1, n.find(nchar<3>("IBM"))->second);
+    BOOST_CHECK(!n.contains("IB"));
+    BOOST_CHECK(!n.contains("ibm\177"));           // Invalid name
+    BOOST_CHECK(!n.contains("ABCD.EFGH.IJKL"));     // Too long name
+
+    flat_hash_map<nchar<8>, int> c;
+    c[nchar<8>("AAPL")] = 3;
+    BOOST_CHECK_EQUAL(3, c.find("AAPL")->second);
+    BOOST_CHECK(!c.contains(std::string("AAP")));
+}
+
+BOOST_AUTO_TEST_CASE( test_flat_hash_map_dtor )
+{
+    {
+        flat_hash_map<int, DtorChecker> m;
+        for (int i = 0; i < 1000; ++i)
+            m[i];
+        BOOST_CHECK_EQUAL(1000, DtorChecker::numInstances);
+        for (int i = 0; i < 500; ++i)
+            m.erase(i);
+        BOOST_CHECK_EQUAL(500, DtorChecker::numInstances);
+        m.rehash(0);
+        BOOST_CHECK_EQUAL(500, DtorChecker::numInstances);
+
+        flat_hash_map<int, std::string> s;
+        for (int i = 0; i < 1000; ++i)
+            s[i] = std::string(100, 'a' + i % 26);
+        for (int i = 0; i < 1000; ++i)
+            BOOST_REQUIRE_EQUAL(std::string(100, 'a' + i % 26), s[i]);
+    }
+    BOOST_CHECK_EQUAL(0, DtorChecker::numInstances);
+}
+
+BOOST_AUTO_TEST_CASE( test_flat_hash_map_resize_throw )
+{
+    flat_hash_map<int, ThrowingCopy> m;
+    for (int i = 0; i < 100; ++i)
+        m.emplace(i, ThrowingCopy(i));
+
+    // A failed resize leaves the map unchanged
+    ThrowingCopy::copiesLeft = 50;
+    BOOST_CHECK_THROW(m.rehash(1000), std::runtime_error);
+    ThrowingCopy::copiesLeft = -1;
+
+    BOOST_CHECK_EQUAL(100u, m.size());
+    for (int i = 0; i < 100; ++i)
+        BOOST_REQUIRE_EQUAL(i, m.at(i).value);
+
+    m.rehash(1000);
+    BOOST_CHECK(m.bucket_count() >= 1000);
+    for (int i = 0; i < 100; ++i)
+        BOOST_REQUIRE_EQUAL(i, m.at(i).value);
+}
+
+BOOST_AUTO_TEST_CASE( test_flat_hash_map_perf )
+{
+    auto   n     = iterations();
+    size_t count = n ? n : 1000000;
+
+    std::mt19937_64   rnd(1);
+    std::vector<long> keys(count), misses(count);
+    for (size_t i = 0; i < count; ++i) {
+        keys[i]   = long(rnd() >> 2);
+        misses[i] = long(rnd() >> 2);
+    }
+
+    BOOST_TEST_MESSAGE("Group width: " << detail::flat_group::s_width
+                       << ", " << count << " int64 keys");
+    bench_int<flat_hash_map<long, long>>     ("flat_hash_map     ", keys, misses);
+    bench_int<std::unordered_map<long, long>>("std::unordered_map", keys, misses);
+    bench_int<atomic_hash_map<long, long>>   ("atomic_hash_map   ", keys, misses);
+
+    // Symbol lookups by a string_view from a decoded message: flat_hash_map
+    // finds it without allocating a std::string
+    std::vector<std::string> syms(std::min<size_t>(count, 100000));
+    for (size_t i = 0; i < syms.size(); ++i)
+        syms[i] = "SYM" + std::to_string(i);
+
+    long sum = 0;
+    {
+        flat_hash_map<std::string, long> m(syms.size());
+        for (size_t i = 0; i < syms.size(); ++i)
+            m[syms[i]] = i;
+        auto r = mops(count, [&](size_t i) {
+            std::string_view sv(syms[i % syms.size()]);
+            sum += m.find(sv)->second;
+        });
+        BOOST_TEST_MESSAGE("flat_hash_map<string>      find(string_view): " << r);
+    }
+    {
+        std::unordered_map<std::string, long> m(syms.size());
+        for (size_t i = 0; i < syms.size(); ++i)
+            m[syms[i]] = i;
+        auto r = mops(count, [&](size_t i) {
+            std::string_view sv(syms[i % syms.size()]);
+            sum += m.find(std::string(sv))->second;
+        });
+        BOOST_TEST_MESSAGE("std::unordered_map<string> find(string_view): " << r);
+    }
+    {
+        flat_hash_map<name_t, long> m(syms.size());
+        for (size_t i = 0; i < syms.size(); ++i)
+            m[name_t(syms[i])] = i;
+        auto r = mops(count, [&](size_t i) {
+            sum += m.find(name_t(syms[i % syms.size()]))->second;
+        });
+        BOOST_TEST_MESSAGE("flat_hash_map<name_t>      find(name_t):      " << r);
+    }
+    {
+        std::unordered_map<name_t, long> m(syms.size());
+        for (size_t i = 0; i < syms.size(); ++i)
+            m[name_t(syms[i])] = i;
+        auto r = mops(count, [&](size_t i) {
+            sum += m.find(name_t(syms[i % syms.size()]))->second;
+        });
+        BOOST_TEST_MESSAGE("std::unordered_map<name_t> find(name_t):      " << r);
+    }
+    BOOST_CHECK(sum > 0);
+}
+
+} // namespace utxx
@@ -38,6 +38,13 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include <utxx/string.hpp>
 #include <iostream>
 #include <fstream>
+#include <random>
+#include <chrono>
+#include <ctime>
+#include <fcntl.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sys/resource.h>
 
 using namespace utxx;
 
@@ -109,4 +116,266 @@ BOOST_AUTO_TEST_CASE( test_gzstream_gzip )
     }
 }
 
+namespace {
+    // Count lines of a gzip file equal to line(i) for i = 0, 1, ...
+    template <class Line>
+    int read_gz_lines(const std::string& a_file, const Line& a_line)
+    {
+        igzstream in(a_file);
+        int       n = 0;
+        for (std::string s; std::getline(in, s); ++n)
+            if (s + '\n' != a_line(n))
+                break;
+        return n;
+    }
+
+    // Check that a file is a sequence of complete gzip members
+    bool gz_members_complete(const std::string& a_file)
+    {
+        auto data = path::read_file(a_file);
+        if (data.empty())
+            return false;
+
+        z_stream zs;
+        memset(&zs, 0, sizeof(zs));
+        if (inflateInit2(&zs, 15+16) != Z_OK)
+            return false;
+        UTXX_SCOPE_EXIT([&]() { inflateEnd(&zs); });
+
+        char out[64*1024];
+        int  rc = Z_STREAM_END;
+        zs.next_in  = reinterpret_cast<Bytef*>(&data[0]);
+        zs.avail_in = data.size();
+        while (zs.avail_in) {
+            zs.next_out  = reinterpret_cast<Bytef*>(out);
+            zs.avail_out = sizeof(out);
+            rc = inflate(&zs, Z_NO_FLUSH);
+            if (rc == Z_STREAM_END)
+                inflateReset(&zs);
+            else if (rc != Z_OK)
+                return false;
+        }
+        return rc == Z_STREAM_END;
+    }
+
+    std::string market_data_line(std::mt19937& a_rnd, int i)
+    {
+        static const char* s_syms[] = {"AAPL", "MSFT", "IBM", "GOOG", "SPY"};
+        char buf[128];
+        int  n = snprintf(buf, sizeof(buf),
+                          "2026-10-16 09:%02d:%02d.%06d|%s|%c|%u|%u.%02u|%d\n",
+                          i / 60000 % 60, i / 1000 % 60, int(a_rnd() % 1000000),
+                          s_syms[a_rnd() % 5], a_rnd() % 2 ? 'B' : 'S',
+                          unsigned(100 * (1 + a_rnd() % 10)), unsigned(100 + a_rnd() % 100),
+                          unsigned(a_rnd() % 100), i);
+        return std::string(buf, n);
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_gzstream_frame_writer )
+{
+    auto dd = temp_path("xxxx-frames.gz");
+    UTXX_SCOPE_EXIT([&]() { path::file_unlink(dd); });
+
+    int fd = ::open(dd.c_str(), O_CREAT|O_WRONLY|O_TRUNC, 0640);
+    BOOST_REQUIRE(fd >= 0);
+    UTXX_SCOPE_EXIT([&]() { ::close(fd); });
+
+    auto line = [](int i) { return utxx::to_string("this is a test", i, '\n'); };
+
+    gzframe_writer gz(Z_BEST_SPEED, 1000);
+    size_t         bytes = 0;
+
+    for (int i = 0; i < 1000; i += 2) {
+        auto s1 = line(i), s2 = line(i+1);
+        iovec v[] = {{&s1[0], s1.size()}, {&s2[0], s2.size()}};
+        BOOST_REQUIRE_EQUAL(long(s1.size() + s2.size()), gz.write(fd, v, 2));
+        bytes += s1.size() + s2.size();
+    }
+    BOOST_CHECK_EQUAL(bytes, gz.bytes_in());
+    BOOST_CHECK(gz.frames() > 10u);
+    BOOST_CHECK(gz.bytes_out() < bytes);
+    BOOST_CHECK_EQUAL(0, gz.write(fd, "", 0));
+
+    // The last frame isn't finished, yet all data written is decompressible
+    BOOST_CHECK_EQUAL(1000, read_gz_lines(dd, line));
+
+    BOOST_CHECK_EQUAL(0, gz.finish(fd));
+    BOOST_CHECK_EQUAL(0, gz.finish(fd));
+    BOOST_CHECK_EQUAL(long(gz.bytes_out()), utxx::path::file_size(dd));
+    BOOST_CHECK_EQUAL(1000, read_gz_lines(dd, line));
+
+    // Writing to an invalid descriptor fails
+    BOOST_CHECK_EQUAL(-1, gz.write(-1, "abc", 3));
+    BOOST_CHECK_EQUAL(EBADF, errno);
+
+    // The failed frame is discarded, and the output written to a new file
+    // starts with a gzip header
+    auto s = line(0);
+    int  fd2 = ::open(dd.c_str(), O_CREAT|O_WRONLY|O_TRUNC, 0640);
+    BOOST_REQUIRE(fd2 >= 0);
+    BOOST_CHECK_EQUAL(long(s.size()), gz.write(fd2, s.data(), s.size()));
+    BOOST_CHECK_EQUAL(0, gz.finish(fd2));
+    ::close(fd2);
+    BOOST_CHECK_EQUAL(1, read_gz_lines(dd, line));
+}
+
+BOOST_AUTO_TEST_CASE( test_gzstream_frame_writer_recover )
+{
+    auto dd = temp_path("xxxx-recover.gz");
+    UTXX_SCOPE_EXIT([&]() { path::file_unlink(dd); });
+
+    auto line = [](int i) { return utxx::to_string("this is a test", i, '\n'); };
+
+    {
+        int fd = ::open(dd.c_str(), O_CREAT|O_WRONLY|O_TRUNC, 0640);
+        BOOST_REQUIRE(fd >= 0);
+        UTXX_SCOPE_EXIT([&]() { ::close(fd); });
+
+        gzframe_writer gz(Z_BEST_SPEED, 1024*1024);
+        for (int i = 0; i < 100; ++i) {
+            auto s = line(i);
+            BOOST_REQUIRE_EQUAL(long(s.size()), gz.write(fd, s.data(), s.size()));
+        }
+
+        // Simulate a crash in the middle of writing a batch: only a part of
+        // its output reached the file, followed by zero-filled blocks
+        auto size = path::file_size(dd);
+        std::string batch;
+        for (int i = 100; i < 1000; ++i)
+            batch += line(i);
+        BOOST_REQUIRE(gz.write(fd, batch.data(), batch.size()) > 0);
+        BOOST_REQUIRE(path::file_size(dd) > size + 2);
+        BOOST_REQUIRE_EQUAL(0, ::ftruncate(fd, size + 2));
+        BOOST_REQUIRE_EQUAL(0, ::ftruncate(fd, size + 4096));
+    }
+
+    // Appending a new gzip member to such a file makes the rest of it
+    // undecodable unless the truncated member is terminated first
+    {
+        int fd = ::open(dd.c_str(), O_RDWR|O_APPEND);
+        BOOST_REQUIRE(fd >= 0);
+        UTXX_SCOPE_EXIT([&]() { ::close(fd); });
+
+        BOOST_CHECK_EQUAL(0, gzframe_writer::recover(fd));
+        BOOST_CHECK(gz_members_complete(dd));
+        BOOST_CHECK_EQUAL(0, gzframe_writer::recover(fd));
+
+        gzframe_writer gz(Z_BEST_SPEED, 1024*1024);
+        for (int i = 100; i < 200; ++i) {
+            auto s = line(i);
+            BOOST_REQUIRE_EQUAL(long(s.size()), gz.write(fd, s.data(), s.size()));
+        }
+        BOOST_CHECK_EQUAL(0, gz.finish(fd));
+    }
+    BOOST_CHECK(gz_members_complete(dd));
+    BOOST_CHECK_EQUAL(200, read_gz_lines(dd, line));
+
+    // A file in another format is left intact
+    BOOST_REQUIRE(path::write_file(dd, "this is not a gzip file\n"));
+    int fd = ::open(dd.c_str(), O_RDWR|O_APPEND);
+    BOOST_REQUIRE(fd >= 0);
+    BOOST_CHECK_EQUAL(-1, gzframe_writer::recover(fd));
+    BOOST_CHECK_EQUAL(EILSEQ, errno);
+    BOOST_CHECK_EQUAL(24, path::file_size(dd));
+    ::close(fd);
+}
+
+BOOST_AUTO_TEST_CASE( test_gzstream_frame_writer_failed_write )
+{
+    auto dd = temp_path("xxxx-failed.gz");
+    UTXX_SCOPE_EXIT([&]() { path::file_unlink(dd); });
+
+    int fd = ::open(dd.c_str(), O_CREAT|O_WRONLY|O_TRUNC|O_APPEND, 0640);
+    BOOST_REQUIRE(fd >= 0);
+    UTXX_SCOPE_EXIT([&]() { ::close(fd); });
+
+    auto line = [](int i) { return utxx::to_string("this is a test", i, '\n'); };
+
+    gzframe_writer gz(Z_BEST_SPEED, 1024*1024);
+    for (int i = 0; i < 100; ++i) {
+        auto s = line(i);
+        BOOST_REQUIRE_EQUAL(long(s.size()), gz.write(fd, s.data(), s.size()));
+    }
+
+    // Fail a write of incompressible data part way through by limiting the
+    // file size
+    std::mt19937 rnd(1);
+    std::string  noise(1024*1024, '\0');
+    for (auto& c : noise)
+        c = char(rnd());
+
+    auto size = path::file_size(dd);
+    auto sig  = ::signal(SIGXFSZ, SIG_IGN);
+    rlimit old_lim, lim;
+    BOOST_REQUIRE_EQUAL(0, ::getrlimit(RLIMIT_FSIZE, &old_lim));
+    lim          = old_lim;
+    lim.rlim_cur = size + 1000;
+    BOOST_REQUIRE_EQUAL(0, ::setrlimit(RLIMIT_FSIZE, &lim));
+    long rc = gz.write(fd, noise.data(), noise.size());
+    int  err = errno;
+    ::setrlimit(RLIMIT_FSIZE, &old_lim);
+    ::signal(SIGXFSZ, sig);
+
+    BOOST_CHECK_EQUAL(-1, rc);
+    BOOST_CHECK_EQUAL(EFBIG, err);
+
+    // The partial output is cut and the frame is terminated
+    BOOST_CHECK(gz_members_complete(dd));
+    BOOST_CHECK_EQUAL(100, read_gz_lines(dd, line));
+
+    // Writing to the same descriptor continues with a new member
+    for (int i = 100; i < 200; ++i) {
+        auto s = line(i);
+        BOOST_REQUIRE_EQUAL(long(s.size()), gz.write(fd, s.data(), s.size()));
+    }
+    BOOST_CHECK_EQUAL(0, gz.finish(fd));
+    BOOST_CHECK(gz_members_complete(dd));
+    BOOST_CHECK_EQUAL(200, read_gz_lines(dd, line));
+}
+
+BOOST_AUTO_TEST_CASE( test_gzstream_frame_writer_perf )
+{
+    static const int ITERATIONS =
+        getenv("ITERATIONS") ? atoi(getenv("ITERATIONS")) : 500000;
+    static const int BATCH      = 64;
+
+    std::mt19937             rnd(1);
+    std::vector<std::string> lines(ITERATIONS);
+    size_t                   bytes = 0;
+    for (int i = 0; i < ITERATIONS; i++) {
+        lines[i] = market_data_line(rnd, i);
+        bytes   += lines[i].size();
+    }
+
+    int fd = ::open("/dev/null", O_WRONLY);
+    BOOST_REQUIRE(fd >= 0);
+    UTXX_SCOPE_EXIT([&]() { ::close(fd); });
+
+    // Compress batches of lines as the async logger does
+    for (int level : {Z_BEST_SPEED, Z_DEFAULT_COMPRESSION}) {
+        gzframe_writer gz(level, 4*1024*1024);
+        iovec          v[BATCH];
+
+        auto t0 = std::chrono::steady_clock::now();
+        auto c0 = std::clock();
+        for (int i = 0; i < ITERATIONS; i += BATCH) {
+            int n = std::min(BATCH, ITERATIONS - i);
+            for (int j = 0; j < n; j++)
+                v[j] = iovec{&lines[i+j][0], lines[i+j].size()};
+            BOOST_REQUIRE(gz.write(fd, v, n) > 0);
+        }
+        BOOST_REQUIRE_EQUAL(0, gz.finish(fd));
+        auto cpu  = double(std::clock() - c0) / CLOCKS_PER_SEC;
+        auto secs = std::chrono::duration<double>
+                    (std::chrono::steady_clock::now() - t0).count();
+
+        BOOST_CHECK_EQUAL(bytes, gz.bytes_in());
+        BOOST_TEST_MESSAGE("gzframe_writer level " << level << ": "
+                           << int(double(bytes) / secs / 1e6) << " MB/s, "
+                           << cpu * 1e9 / double(bytes) << " CPU sec/GB, "
+                           << "ratio " << double(bytes) / gz.bytes_out());
+    }
+}
+
 #endif // UTXX_HAVE_LIBZ
@@ -34,8 +34,13 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #endif
 
 #include <iostream>
+#include <fstream>
+#include <sstream>
+#include <thread>
 #include <utxx/logger.hpp>
 #include <utxx/logger/logger_impl_console.hpp>
+#include <utxx/logger/logger_impl.hpp>
+#include <utxx/perf_histogram.hpp>
 #include <utxx/verbosity.hpp>
 #include <utxx/variant_tree.hpp>
 #include <signal.h>
@@ -486,6 +491,483 @@ BOOST_AUTO_TEST_CASE( test_logger2 )
 
     log.finalize();
 }
+
+namespace {
+    // Back-end measuring the delay between creation of a message and its
+    // delivery, which happens after the message is written by the file
+    // back-end (batch sinks are called before per-message sinks)
+    struct logger_impl_latency : public logger_impl {
+        static perf_histogram s_perf;
+
+        static logger_impl_latency* create(const char* a_name) {
+            return new logger_impl_latency(a_name);
+        }
+
+        const std::string& name() const override { return m_name; }
+
+        bool init(const variant_tree&) override {
+            for (int lvl = 0; lvl < logger::NLEVELS; ++lvl)
+                this->add(logger::signal_slot_to_level(lvl),
+                    logger::on_msg_delegate_t::from_method
+                        <logger_impl_latency, &logger_impl_latency::log_msg>(this));
+            return true;
+        }
+
+        std::ostream& dump(std::ostream& out, const std::string&) const override
+        { return out; }
+
+        void log_msg(const logger::msg& a_msg, const char*, size_t) {
+            s_perf.add((now_utc() - a_msg.timestamp()).seconds());
+        }
+    private:
+        logger_impl_latency(const char* a_name) : m_name(a_name) {}
+        std::string m_name;
+    };
+
+    perf_histogram logger_impl_latency::s_perf;
+
+    logger_impl_mgr::impl_callback_t s_latency_factory = &logger_impl_latency::create;
+    logger_impl_mgr::registrar       s_latency_reg("latency", s_latency_factory);
+}
+
+BOOST_AUTO_TEST_CASE( test_logger_batch_perf )
+{
+    const int ITERATIONS = getenv("ITERATIONS") ? atoi(getenv("ITERATIONS")) : 10000;
+    const char* filename = "/tmp/logger.batch.log";
+
+    variant_tree pt;
+    pt.put("logger.timestamp",          utxx::variant("time-usec"));
+    pt.put("logger.show-location",      false);
+    pt.put("logger.silent-finish",      true);
+    pt.put("logger.handle-crash-signals", false);
+    pt.put("logger.sched-yield-us",     0);
+    pt.put("logger.file.filename",      utxx::variant(filename));
+    pt.put("logger.file.append",        false);
+    pt.put("logger.file.no-header",     true);
+    pt.put("logger.latency",            true);
+
+    logger& log = logger::instance();
+
+    for (auto batch : {0, 1024}) {
+        pt.put("logger.batch-size", batch);
+
+        if (log.initialized())
+            log.finalize();
+
+        logger_impl_latency::s_perf.reset
+            (batch ? "Batched write latency" : "Per-message write latency");
+
+        log.init(pt, nullptr, false);
+
+        auto start = now_utc();
+        for (int i=0; i < ITERATIONS; ++i)
+            LOG_INFO("Test message number %d", i);
+        log.finalize();
+        auto elapsed = (now_utc() - start).seconds();
+
+        auto data  = utxx::path::read_file(filename);
+        BOOST_CHECK_EQUAL(ITERATIONS, std::count(data.begin(), data.end(), '\n'));
+        BOOST_CHECK(data.find("|I|Test message number 0\n") != std::string::npos);
+        BOOST_CHECK_EQUAL(ITERATIONS, logger_impl_latency::s_perf.count());
+
+        std::stringstream s;
+        s << (batch ? "Batched" : "Per-message") << " logger output: "
+          << ITERATIONS << " msgs in " << std::fixed << std::setprecision(3)
+          << elapsed << "s (" << long(ITERATIONS / elapsed) << " msgs/s)\n";
+        logger_impl_latency::s_perf.dump(s);
+        BOOST_TEST_MESSAGE(s.str());
+    }
+
+    log.finalize();
+    pt.put("logger.batch-size", -1);
+    BOOST_CHECK_THROW(log.init(pt, nullptr, false), utxx::runtime_error);
+    if (log.initialized())
+        log.finalize();
+
+    utxx::path::file_unlink(filename);
+}
+
+BOOST_AUTO_TEST_CASE( test_logger_thread_lanes )
+{
+    const int ITERATIONS = getenv("ITERATIONS") ? atoi(getenv("ITERATIONS")) : 20000;
+    const int THREADS    = 4;
+    const char* filename = "/tmp/logger.lanes.log";
+
+    variant_tree pt;
+    pt.put("logger.timestamp",          utxx::variant("none"));
+    pt.put("logger.show-location",      false);
+    pt.put("logger.silent-finish",      true);
+    pt.put("logger.handle-crash-signals", false);
+    // Use a small lane capacity so that some messages overflow to the
+    // shared queue
+    pt.put("logger.lane-capacity",      64);
+    pt.put("logger.file.filename",      utxx::variant(filename));
+    pt.put("logger.file.append",        false);
+    pt.put("logger.file.no-header",     true);
+
+    logger& log = logger::instance();
+    if (log.initialized())
+        log.finalize();
+
+    log.init(pt, nullptr, false);
+    BOOST_CHECK_EQUAL(64u, log.lane_capacity());
+
+    std::vector<std::thread> threads;
+    for (int t=0; t < THREADS; ++t)
+        threads.emplace_back([=]() {
+            for (int i=0; i < ITERATIONS; ++i)
+                LOG_INFO("%d %d", t, i);
+        });
+    for (auto& t : threads)
+        t.join();
+
+    log.finalize();
+
+    // Every thread's messages must be written in the order they were logged
+    std::ifstream in(filename);
+    std::vector<int> next(THREADS, 0);
+    std::string s;
+    int lines = 0;
+    while (getline(in, s)) {
+        int t, i;
+        BOOST_REQUIRE_EQUAL(2, sscanf(s.c_str(), "I|%d %d", &t, &i));
+        BOOST_REQUIRE(t >= 0 && t < THREADS);
+        BOOST_REQUIRE_EQUAL(next[t], i);
+        next[t]++;
+        lines++;
+    }
+    BOOST_CHECK_EQUAL(THREADS * ITERATIONS, lines);
+
+    utxx::path::file_unlink(filename);
+}
+
+BOOST_AUTO_TEST_CASE( test_logger_thread_lanes_reinit )
+{
+    const char* filename = "/tmp/logger.lanes.log";
+
+    variant_tree pt;
+    pt.put("logger.timestamp",          utxx::variant("none"));
+    pt.put("logger.show-location",      false);
+    pt.put("logger.silent-finish",      true);
+    pt.put("logger.handle-crash-signals", false);
+    pt.put("logger.file.filename",      utxx::variant(filename));
+    pt.put("logger.file.append",        true);
+    pt.put("logger.file.no-header",     true);
+
+    logger& log = logger::instance();
+    if (log.initialized())
+        log.finalize();
+    utxx::path::file_unlink(filename);
+
+    // A thread keeps logging across re-initializations of the logger with
+    // different lane capacities, and exits after the last finalize()
+    std::mutex              mtx;
+    std::condition_variable cv;
+    int                     stage = 0, done = 0;
+
+    auto wait = [&](int& a_var, int a_val) {
+        std::unique_lock<std::mutex> g(mtx);
+        cv.wait(g, [&]() { return a_var >= a_val; });
+    };
+    auto next = [&](int& a_var) {
+        std::lock_guard<std::mutex> g(mtx);
+        ++a_var;
+        cv.notify_all();
+    };
+
+    std::thread thread([&]() {
+        for (int k=1; k <= 3; ++k) {
+            wait(stage, k);
+            for (int i=0; i < 1000; ++i)
+                LOG_INFO("%d %d", k, i);
+            next(done);
+        }
+    });
+
+    const int caps[] = { 64, 256, 0 };
+    for (int k=1; k <= 3; ++k) {
+        pt.put("logger.lane-capacity", caps[k-1]);
+        log.init(pt, nullptr, false);
+        BOOST_CHECK_EQUAL(uint32_t(caps[k-1]), log.lane_capacity());
+        next(stage);
+        wait(done, k);
+        for (int i=0; i < 1000; ++i)
+            LOG_INFO("%d %d", 0, i);
+        log.finalize();
+    }
+    thread.join();
+
+    std::ifstream in(filename);
+    std::vector<int> count(4, 0);
+    std::string s;
+    while (getline(in, s)) {
+        int k, i;
+        BOOST_REQUIRE_EQUAL(2, sscanf(s.c_str(), "I|%d %d", &k, &i));
+        BOOST_REQUIRE(k >= 0 && k <= 3);
+        BOOST_REQUIRE_EQUAL(count[k] % 1000, i);
+        count[k]++;
+    }
+    BOOST_CHECK_EQUAL(3000, count[0]);
+    for (int k=1; k <= 3; ++k)
+        BOOST_CHECK_EQUAL(1000, count[k]);
+
+    utxx::path::file_unlink(filename);
+}
+
+BOOST_AUTO_TEST_CASE( test_logger_thread_lanes_lifetime )
+{
+    const char* files[] = { "/tmp/logger.lanes1.log", "/tmp/logger.lanes2.log" };
+
+    auto make_cfg = [](const char* a_file) {
+        variant_tree pt;
+        pt.put("logger.timestamp",          utxx::variant("none"));
+        pt.put("logger.show-location",      false);
+        pt.put("logger.silent-finish",      true);
+        pt.put("logger.handle-crash-signals", false);
+        pt.put("logger.lane-capacity",      64);
+        pt.put("logger.file.filename",      utxx::variant(a_file));
+        pt.put("logger.file.append",        true);
+        pt.put("logger.file.no-header",     true);
+        return pt;
+    };
+    for (auto f : files)
+        utxx::path::file_unlink(f);
+
+    std::unique_ptr<logger> log1(new logger);
+    std::unique_ptr<logger> log2(new logger);
+    log1->init(make_cfg(files[0]), nullptr, false);
+    log2->init(make_cfg(files[1]), nullptr, false);
+
+    std::mutex              mtx;
+    std::condition_variable cv;
+    int                     stage = 0, done = 0;
+
+    auto wait = [&](int& a_var, int a_val) {
+        std::unique_lock<std::mutex> g(mtx);
+        cv.wait(g, [&]() { return a_var >= a_val; });
+    };
+    auto next = [&](int& a_var) {
+        std::lock_guard<std::mutex> g(mtx);
+        ++a_var;
+        cv.notify_all();
+    };
+    auto log = [](logger& a_log, int a_k) {
+        for (int i=0; i < 10; ++i)
+            a_log.log(LEVEL_INFO, "", std::to_string(a_k), UTXX_LOG_SRCINFO);
+    };
+
+    std::thread thread([&]() {
+        log(*log1, 1);
+        next(done);
+        // Messages put in the lane while the logger is finalized are
+        // delivered after it's initialized again
+        wait(stage, 1);
+        log(*log1, 2);
+        next(done);
+        // The lane of the destroyed logger is released when the thread
+        // switches to another logger, and the other lane on thread exit
+        wait(stage, 2);
+        log(*log2, 3);
+    });
+
+    wait(done, 1);
+    log1->finalize();
+    next(stage);
+    wait(done, 2);
+    log1->init(make_cfg(files[0]), nullptr, false);
+    log1.reset();
+    next(stage);
+    thread.join();
+    log2.reset();
+
+    auto count = [](const char* a_file, const char* a_line) {
+        std::ifstream in(a_file);
+        std::string   s;
+        int           n = 0;
+        while (getline(in, s))
+            n += s == a_line;
+        return n;
+    };
+    BOOST_CHECK_EQUAL(10, count(files[0], "I|1"));
+    BOOST_CHECK_EQUAL(10, count(files[0], "I|2"));
+    BOOST_CHECK_EQUAL(10, count(files[1], "I|3"));
+
+    for (auto f : files)
+        utxx::path::file_unlink(f);
+}
+
+BOOST_AUTO_TEST_CASE( test_logger_binary )
+{
+    const char* filename = "/tmp/logger.binary.log";
+    const char* binfile  = "/tmp/logger.binary.bin";
+
+    variant_tree pt;
+    pt.put("logger.timestamp",          utxx::variant("none"));
+    pt.put("logger.show-location",      false);
+    pt.put("logger.silent-finish",      true);
+    pt.put("logger.handle-crash-signals", false);
+    pt.put("logger.file.filename",      utxx::variant(filename));
+    pt.put("logger.file.append",        false);
+    pt.put("logger.file.no-header",     true);
+    pt.put("logger.binfile.filename",   utxx::variant(binfile));
+    pt.put("logger.binfile.append",     false);
+
+    logger& log = logger::instance();
+    if (log.initialized())
+        log.finalize();
+
+    log.init(pt, nullptr, false);
+
+    std::string str("abc");
+    std::string big(100, 'x');
+    const char* nul = nullptr;
+
+    // Every binary message is followed by the same message formatted by printf
+    #define BIN_AND_TEXT(Fmt, ...) \
+        UTXX_BLOG(LEVEL_INFO, Fmt, __VA_ARGS__); \
+        LOG_INFO(Fmt, __VA_ARGS__)
+
+    BIN_AND_TEXT("int: %d %i %u %ld %lu", -12, 345, 6u, -7890123456789L, 1234567890123UL);
+    BIN_AND_TEXT("fmt: [%5d] [%-5d] [%05d] [%x] [%X] [%o] [%+d]", 1, 2, 3, 255, 255, 8, 9);
+    BIN_AND_TEXT("dbl: %f %.2f %.0f %8.3f %e %g", 1.5, 2.345, 3.5, -4.25, 12345.678, 0.0001);
+    BIN_AND_TEXT("str: %s [%5s] [%-5s] [%.2s]", "xyz", str.c_str(), "ab", "long");
+    BIN_AND_TEXT("chr: %c%c %d%%", 'o', 'k', 100);
+    UTXX_BLOG(LEVEL_INFO, "std: %s %d", str, 1);
+    LOG_INFO("std: %s %d", str.c_str(), 1);
+    // Arguments exceeding the message capacity are formatted by the caller
+    UTXX_BLOG(LEVEL_INFO, "big: %s %d", big, 1);
+    LOG_INFO("big: %s %d", big.c_str(), 1);
+    UTXX_BLOG(LEVEL_INFO, "nul: %s", nul);
+    LOG_INFO("nul: %s", "(null)");
+    UTXX_BLOG(LEVEL_INFO, "no args");
+    LOG_INFO("no args");
+    UTXX_BCLOG(LEVEL_WARNING, "Cat", "cat: %d", 10);
+    UTXX_BLOG(LEVEL_DEBUG, "filtered: %d", 1);
+
+    #undef BIN_AND_TEXT
+
+    log.finalize();
+
+    std::ifstream in(filename);
+    std::vector<std::string> lines;
+    for (std::string s; getline(in, s); lines.push_back(s));
+
+    BOOST_REQUIRE_EQUAL(19u, lines.size());
+    for (size_t i=0; i < 18; i += 2)
+        BOOST_CHECK_EQUAL(lines[i+1], lines[i]);
+    BOOST_CHECK_EQUAL("W|cat: 10", lines[18]);
+
+    // The binary file decoded offline must match the text file
+    std::stringstream out;
+    BOOST_CHECK_EQUAL(19u, bin_log::decode(binfile, out, NO_TIMESTAMP));
+    std::vector<std::string> decoded;
+    for (std::string s; getline(out, s); decoded.push_back(s));
+    BOOST_REQUIRE_EQUAL(lines.size(), decoded.size());
+    for (size_t i=0; i < 18; ++i)
+        BOOST_CHECK_EQUAL(lines[i], decoded[i]);
+    BOOST_CHECK_EQUAL("W|Cat|cat: 10", decoded[18]);
+
+    std::stringstream loc;
+    bin_log::decode(binfile, loc, NO_TIMESTAMP, true);
+    BOOST_CHECK(loc.str().find("test_logger.cpp:") != std::string::npos);
+
+    utxx::path::file_unlink(filename);
+    utxx::path::file_unlink(binfile);
+}
+
+namespace {
+    // Batch back-end consuming BIN messages in binary form, which counts
+    // messages delivered with rendered text
+    struct logger_impl_bincount : public logger_impl {
+        static int s_bin, s_bin_text, s_text;
+
+        static logger_impl_bincount* create(const char* a_name) {
+            return new logger_impl_bincount(a_name);
+        }
+
+        const std::string& name() const override { return m_name; }
+
+        bool init(const variant_tree&) override {
+            s_bin = s_bin_text = s_text = 0;
+            this->add_batch(LEVEL_NO_DEBUG,
+                logger::on_batch_delegate_t::from_method
+                    <logger_impl_bincount, &logger_impl_bincount::log_batch>(this),
+                false);
+            return true;
+        }
+
+        std::ostream& dump(std::ostream& out, const std::string&) const override
+        { return out; }
+
+        void log_batch(const logger::msg_batch& a_batch) {
+            for (size_t i=0; i < a_batch.size(); ++i) {
+                bool text = a_batch.iov()[i].iov_len > 0;
+                if (!a_batch.message(i).bin_fmt())
+                    s_text += text;
+                else {
+                    ++s_bin;
+                    s_bin_text += text;
+                }
+            }
+        }
+    private:
+        logger_impl_bincount(const char* a_name) : m_name(a_name) {}
+        std::string m_name;
+    };
+
+    int logger_impl_bincount::s_bin;
+    int logger_impl_bincount::s_bin_text;
+    int logger_impl_bincount::s_text;
+
+    logger_impl_mgr::impl_callback_t s_bincount_factory = &logger_impl_bincount::create;
+    logger_impl_mgr::registrar       s_bincount_reg("bincount", s_bincount_factory);
+}
+
+BOOST_AUTO_TEST_CASE( test_logger_binary_only )
+{
+    const char* binfile  = "/tmp/logger.binary-only.bin";
+    utxx::path::file_unlink(binfile);
+
+    variant_tree pt;
+    pt.put("logger.timestamp",          utxx::variant("none"));
+    pt.put("logger.silent-finish",      true);
+    pt.put("logger.handle-crash-signals", false);
+    pt.put("logger.binfile.filename",   utxx::variant(binfile));
+    pt.put("logger.binfile.append",     true);
+    pt.put("logger.bincount",           "");
+
+    logger& log = logger::instance();
+    if (log.initialized())
+        log.finalize();
+
+    // Without text sinks BIN messages are not rendered.  Appending to the
+    // file of the same format is allowed
+    for (int i = 0; i < 2; ++i) {
+        log.init(pt, nullptr, false);
+        UTXX_BLOG(LEVEL_INFO, "bin: %d %s", i, "abc");
+        UTXX_BLOG(LEVEL_WARNING, "bin: %.2f", 1.5);
+        LOG_INFO("text: %d", i);
+        log.finalize();
+
+        BOOST_CHECK_EQUAL(2, logger_impl_bincount::s_bin);
+        BOOST_CHECK_EQUAL(0, logger_impl_bincount::s_bin_text);
+        BOOST_CHECK_EQUAL(1, logger_impl_bincount::s_text);
+    }
+
+    std::stringstream out;
+    BOOST_CHECK_EQUAL(6u, bin_log::decode(binfile, out, NO_TIMESTAMP));
+    BOOST_CHECK_EQUAL("I|bin: 0 abc\nW|bin: 1.50\nI|text: 0\n"
+                      "I|bin: 1 abc\nW|bin: 1.50\nI|text: 1\n", out.str());
+
+    // A file in a different format is not appended to
+    BOOST_REQUIRE(utxx::path::write_file(binfile, std::string("UTXXBLOG\x02\0\0\0", 12)));
+    BOOST_CHECK_THROW(log.init(pt, nullptr, false), utxx::runtime_error);
+    BOOST_REQUIRE(utxx::path::write_file(binfile, "some text file\n"));
+    BOOST_CHECK_THROW(log.init(pt, nullptr, false), utxx::runtime_error);
+    BOOST_CHECK_EQUAL(15, utxx::path::file_size(binfile));
+
+    utxx::path::file_unlink(binfile);
+}
 #endif
 
 #ifdef UTXX_STANDALONE
@@ -32,6 +32,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 #include <fstream>
 #include <iomanip>
+#include <ctime>
 #include <unistd.h>
 
 //#define DEBUG_ASYNC_LOGGER
@@ -47,6 +48,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include <utxx/multi_file_async_logger.hpp>
 #include <utxx/perf_histogram.hpp>
 #include <utxx/verbosity.hpp>
+#include <utxx/path.hpp>
 
 static const size_t s_file_num  = 2;
 static const char* s_filename[] = { "/tmp/test_multi_file_async_logger1.log",
@@ -223,12 +225,17 @@ BOOST_AUTO_TEST_CASE( test_multi_file_logger_perf )
     std::cout << "Futex wake_fast     count = " << logger.event().wake_fast_count()     << std::endl;
     std::cout << "Futex wait_fast     count = " << logger.event().wait_fast_count()     << std::endl;
     std::cout << "Futex wait_spin     count = " << logger.event().wait_spin_count()     << std::endl;
-    std::cout << std::endl;
-
-    std::cout << "Enqueue spins: " << logger.stats_enque_spins() << std::endl;
-    std::cout << "Dequeue spins: " << logger.stats_deque_spins() << std::endl;
 #endif
 
+    for (size_t i = 0; i < s_file_num; i++) {
+        auto st = logger.stats(l_fds[i]);
+        BOOST_TEST_MESSAGE("Stream " << (i+1) << ": written="
+                           << st.msgs_written      << " msgs, "
+                           << st.bytes_written     << " bytes, "
+                           << int(st.bytes_per_sec) << " bytes/s, max queue="
+                           << st.max_queue_depth);
+    }
+
 
     logger.stop();
 
@@ -377,6 +384,259 @@ BOOST_AUTO_TEST_CASE( test_multi_file_logger_formatter )
     }
 }
 
+namespace {
+    // Time it takes to write ITERATIONS messages to a fast stream while
+    // another stream blocks in every write. With a_hold_slow the writes of
+    // the slow stream are held until the fast stream is drained.
+    double fast_stream_drain_time(size_t a_writers, int a_iterations,
+                                  int a_slow_write_ms, bool a_hold_slow = false)
+    {
+        std::atomic<long> fast_bytes(0);
+        std::atomic<bool> release(!a_hold_slow);
+
+        logger_t logger(1024, 5000, logger_t::msg_allocator(), a_writers);
+        BOOST_REQUIRE_EQUAL(a_writers, logger.writers());
+
+        auto slow = logger.open_stream("slow",
+            [=, &release](logger_t::stream_info&, const char**, const iovec* a_iov,
+                size_t a_n) {
+                while (!release)
+                    usleep(1000);
+                usleep(a_slow_write_ms * 1000);
+                int n = 0;
+                for (size_t i = 0; i < a_n; i++) n += a_iov[i].iov_len;
+                return n;
+            });
+        auto fast = logger.open_stream("fast",
+            [&](logger_t::stream_info&, const char**, const iovec* a_iov,
+                size_t a_n) {
+                int n = 0;
+                for (size_t i = 0; i < a_n; i++) n += a_iov[i].iov_len;
+                fast_bytes += n;
+                return n;
+            });
+        BOOST_REQUIRE(slow && fast);
+        logger.set_batch_size(slow, 1);
+        if (a_writers > 1)
+            BOOST_REQUIRE(slow.stream()->writer() != fast.stream()->writer());
+
+        BOOST_REQUIRE_EQUAL(0, logger.start());
+
+        const std::string msg(s_str3);
+        long expected = long(msg.size()) * a_iterations;
+
+        // Keep the slow stream busy for 10 writes
+        for (int i = 0; i < 10; i++)
+            BOOST_REQUIRE_EQUAL(0, logger.write(slow, "", msg));
+        usleep(1000);
+
+        timer tm;
+        for (int i = 0; i < a_iterations; i++) {
+            BOOST_REQUIRE_EQUAL(0, logger.write(fast, "", msg));
+            if ((i & 63) == 0)
+                usleep(100);
+        }
+        for (int i = 0; i < 100000 &&
+             (fast_bytes < expected || logger.stats(fast).queue_depth); i++)
+            usleep(100);
+        double elapsed = tm.elapsed();
+
+        auto fs = logger.stats(fast);
+        BOOST_CHECK_EQUAL(size_t(a_iterations), fs.msgs_written);
+        BOOST_CHECK_EQUAL(size_t(expected),     fs.bytes_written);
+        BOOST_CHECK_EQUAL(0,                    fs.queue_depth);
+        BOOST_CHECK(fs.max_queue_depth > 0);
+
+        // The fast stream was drained while the slow one was still blocked
+        if (a_hold_slow)
+            BOOST_CHECK_EQUAL(0u, logger.stats(slow).msgs_written);
+        release = true;
+
+        logger.stop();
+        BOOST_CHECK_EQUAL(0, logger.open_files_count());
+        return elapsed;
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_multi_file_logger_writer_threads )
+{
+    // Stream statistics and assignment of streams to writers
+    logger_t logger(1024, 5000, logger_t::msg_allocator(), 3);
+
+    ::unlink(s_filename[0]);
+    auto fd = logger.open_file(s_filename[0], false);
+    BOOST_REQUIRE(fd);
+
+    auto st = logger.stats(fd);
+    BOOST_CHECK_EQUAL(0,   st.queue_depth);
+    BOOST_CHECK_EQUAL(0u,  st.bytes_written);
+
+    std::string s = std::string(s_str2) + '\n';
+
+    // Messages written before start() are queued
+    for (int i = 0; i < 5; i++)
+        BOOST_REQUIRE_EQUAL(0, logger.write(fd, "", s));
+    BOOST_CHECK_EQUAL(5, logger.stats(fd).queue_depth);
+    BOOST_CHECK(logger.has_pending_data());
+
+    BOOST_REQUIRE_EQUAL(0, logger.start());
+
+    for (int i = 0; i < 5; i++)
+        BOOST_REQUIRE_EQUAL(0, logger.write(fd, "", s));
+
+    for (int i = 0; i < 1000 && logger.stats(fd).queue_depth; i++)
+        usleep(1000);
+
+    st = logger.stats(fd);
+    BOOST_CHECK_EQUAL(0,                st.queue_depth);
+    BOOST_CHECK_EQUAL(10u,              st.msgs_written);
+    BOOST_CHECK_EQUAL(10 * s.size(),    st.bytes_written);
+    BOOST_CHECK(st.max_queue_depth >= 5);
+    BOOST_CHECK(!logger.has_pending_data());
+
+    logger.close_file(fd, false);
+    logger.stop();
+    BOOST_CHECK_EQUAL(0, logger.open_files_count());
+    BOOST_CHECK_THROW(logger_t(16, 5000, logger_t::msg_allocator(), 0),
+                      badarg_error);
+
+    ::unlink(s_filename[0]);
+}
+
+BOOST_AUTO_TEST_CASE( test_multi_file_logger_writer_isolation_perf )
+{
+    static const int ITERATIONS =
+        getenv("ITERATIONS") ? atoi(getenv("ITERATIONS")) : 10000;
+    static const int SLOW_MS    = 50;
+
+    // With a single writer thread the fast stream waits for the blocked
+    // writes of the slow stream, with two writer threads it doesn't, so
+    // it's drained even if the slow stream's writes never complete
+    double t1 = fast_stream_drain_time(1, ITERATIONS, SLOW_MS);
+    double t2 = fast_stream_drain_time(2, ITERATIONS, SLOW_MS, true);
+
+    BOOST_TEST_MESSAGE("Fast stream drain time with a slow stream: "
+                       << std::fixed << std::setprecision(3)
+                       << "1 writer = "  << t1*1000 << "ms, "
+                       << "2 writers = " << t2*1000 << "ms");
+}
+
+#ifdef UTXX_HAVE_LIBZ
+BOOST_AUTO_TEST_CASE( test_multi_file_logger_gz_file )
+{
+    static const int ITERATIONS =
+        getenv("ITERATIONS") ? atoi(getenv("ITERATIONS")) : 100000;
+
+    const std::string gz_file = std::string(s_filename[0]) + ".gz";
+    ::unlink(gz_file.c_str());
+
+    auto read_lines = [&]() {
+        igzstream in(gz_file);
+        int       n = 0;
+        char      buf[128];
+        for (std::string s; std::getline(in, s); ++n) {
+            snprintf(buf, sizeof(buf), s_str1, n);
+            if (s + '\n' != buf)
+                break;
+        }
+        return n;
+    };
+
+    logger_t logger;
+    auto fd = logger.open_gz_file(gz_file, false, Z_BEST_SPEED, 64*1024);
+    BOOST_REQUIRE(fd);
+    BOOST_REQUIRE_EQUAL(0, logger.start());
+
+    size_t bytes = 0;
+    auto   c0    = std::clock();
+    timer  tm;
+
+    for (int i = 0; i < ITERATIONS; i++) {
+        char buf[128];
+        int  n = snprintf(buf, sizeof(buf), s_str1, i);
+        BOOST_REQUIRE_EQUAL(0, logger.write(fd, "", std::string(buf, n)));
+        bytes += n;
+    }
+    while (logger.stats(fd).queue_depth)
+        usleep(1000);
+
+    double elapsed = tm.elapsed();
+    double cpu     = double(std::clock() - c0) / CLOCKS_PER_SEC;
+    BOOST_CHECK_EQUAL(bytes, logger.stats(fd).bytes_written);
+
+    // Everything written is readable before the file is closed
+    BOOST_CHECK_EQUAL(ITERATIONS, read_lines());
+
+    logger.close_file(fd, false);
+    logger.stop();
+
+    auto gz_size = path::file_size(gz_file);
+    BOOST_CHECK_EQUAL(ITERATIONS, read_lines());
+    BOOST_CHECK(gz_size > 0 && size_t(gz_size) < bytes / 4);
+
+    BOOST_TEST_MESSAGE("Compressed logging: "
+                       << int(double(bytes) / elapsed / 1e6) << " MB/s, "
+                       << cpu * 1e9 / double(bytes) << " CPU sec/GB, ratio "
+                       << double(bytes) / double(gz_size));
+
+    ::unlink(gz_file.c_str());
+}
+
+BOOST_AUTO_TEST_CASE( test_multi_file_logger_gz_file_append_after_crash )
+{
+    const std::string gz_file = std::string(s_filename[0]) + ".gz";
+    ::unlink(gz_file.c_str());
+
+    auto line = [](int i) {
+        char buf[128];
+        return std::string(buf, snprintf(buf, sizeof(buf), s_str1, i));
+    };
+
+    // A writer that crashed in the middle of a batch: its last gzip member
+    // has no trailer and ends with a part of the batch's output
+    {
+        int fd = ::open(gz_file.c_str(), O_CREAT|O_WRONLY|O_TRUNC, 0640);
+        BOOST_REQUIRE(fd >= 0);
+        gzframe_writer gz(Z_BEST_SPEED);
+        for (int i = 0; i < 100; i++) {
+            auto s = line(i);
+            BOOST_REQUIRE(gz.write(fd, s.data(), s.size()) > 0);
+        }
+        auto size = path::file_size(gz_file);
+        std::string batch;
+        for (int i = 100; i < 1000; i++)
+            batch += line(i);
+        BOOST_REQUIRE(gz.write(fd, batch.data(), batch.size()) > 0);
+        BOOST_REQUIRE_EQUAL(0, ::ftruncate(fd, size + 3));
+        ::close(fd);
+    }
+
+    logger_t logger;
+    auto fd = logger.open_gz_file(gz_file, true, Z_BEST_SPEED);
+    BOOST_REQUIRE(fd);
+    BOOST_REQUIRE_EQUAL(0, logger.start());
+    for (int i = 100; i < 200; i++)
+        BOOST_REQUIRE_EQUAL(0, logger.write(fd, "", line(i)));
+    while (logger.stats(fd).queue_depth)
+        usleep(1000);
+    logger.close_file(fd, false);
+    logger.stop();
+
+    // Everything flushed before the crash and appended after it is readable
+    igzstream in(gz_file);
+    int       n = 0;
+    for (std::string s; std::getline(in, s) && s + '\n' == line(n); ++n);
+    BOOST_CHECK_EQUAL(200, n);
+
+    // A file in another format isn't appended to
+    BOOST_REQUIRE(path::write_file(gz_file, "not a gzip file\n"));
+    BOOST_CHECK(!logger.open_gz_file(gz_file, true));
+    BOOST_CHECK_EQUAL(EILSEQ, errno);
+
+    ::unlink(gz_file.c_str());
+}
+#endif
+
 //-----------------------------------------------------------------------------
 /*
 BOOST_AUTO_TEST_CASE( 
@@ -32,13 +32,16 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 #include <iostream>
 #include <iomanip>
+#include <fstream>
 #include <unistd.h>
+#include <sys/wait.h>
 #include <boost/shared_ptr.hpp>
 #include <boost/thread.hpp>
 #include <utxx/persist_array.hpp>
 #include <utxx/string.hpp>
 #include <utxx/verbosity.hpp>
 #include <utxx/lock.hpp>
+#include <utxx/time_val.hpp>
 
 #include <boost/test/unit_test.hpp>
 #include <utxx/test_helper.hpp>
@@ -246,3 +249,253 @@ BOOST_AUTO_TEST_CASE( test_persist_array_concurrent )
     }
     ::unlink(s_filename);
 }
+
+//-----------------------------------------------------------------------------
+BOOST_AUTO_TEST_CASE( test_persist_array_grow )
+{
+    ::unlink(s_filename);
+    {
+        persist_map_opts opts;
+        opts.max_grow_recs = 1000;
+
+        persist_type w;
+        BOOST_REQUIRE(w.init(s_filename, 10, opts));
+
+        // Readers attached before the growth with and without the address
+        // space reserved for it
+        persist_type r1, r2;
+        BOOST_REQUIRE(!r1.init(s_filename, 0, opts, true));
+        BOOST_REQUIRE(!r2.init(s_filename, 0, true));
+        BOOST_CHECK_EQUAL(10u, r1.capacity());
+
+        const blob* first = w.get(0);
+        for (long i = 0; i < 100; i++)
+            w.add(blob(i, i*2));
+
+        // Grown by the factor of 2 in place
+        BOOST_CHECK_EQUAL(160u, w.capacity());
+        BOOST_CHECK_EQUAL(4u,   w.header_data().generation.load());
+        BOOST_CHECK(first == w.get(0));
+
+        // Readers remap lazily
+        BOOST_CHECK_EQUAL(10u, r1.capacity());
+        BOOST_REQUIRE(r1.get(99));
+        BOOST_CHECK_EQUAL(99,   r1.get(99)->i1);
+        BOOST_CHECK_EQUAL(160u, r1.capacity());
+
+        size_t n = 0;
+        r2.for_each([&](size_t i, const blob* b) { n += b->i2 == long(i)*2; });
+        BOOST_CHECK_EQUAL(100u, n);
+        BOOST_CHECK_EQUAL(160u, r2.capacity());
+
+        BOOST_CHECK( w.grow(1000));
+        BOOST_CHECK(!w.grow(500));
+        BOOST_CHECK_EQUAL(1000u, w.capacity());
+        BOOST_CHECK(first == w.get(0));
+
+        // Can't grow beyond persist_map_opts::max_grow_recs
+        for (size_t i = w.count(); i < 1000; i++)
+            w.allocate_rec();
+        BOOST_CHECK_THROW(w.allocate_rec(), utxx::runtime_error);
+        BOOST_CHECK_THROW(r1.grow(2000),    utxx::runtime_error);
+
+        BOOST_CHECK_EQUAL(1000u, r1.mapped_count());
+        BOOST_CHECK_EQUAL(0,     r1[999].i1);
+    }
+
+    // Reopening keeps the capacity
+    persist_type w;
+    BOOST_REQUIRE(!w.init(s_filename, 10));
+    BOOST_CHECK_EQUAL(1000u, w.capacity());
+    BOOST_CHECK_EQUAL(99,    w[99].i1);
+    BOOST_CHECK_THROW(w.allocate_rec(), utxx::runtime_error);
+    ::unlink(s_filename);
+}
+
+//-----------------------------------------------------------------------------
+BOOST_AUTO_TEST_CASE( test_persist_array_map_address )
+{
+    // A page-aligned address that isn't aligned at the 2MB PMD size
+    size_t page = getpagesize();
+    size_t sz   = 8*1024*1024;
+    auto   p    = ::mmap(nullptr, sz, PROT_NONE,
+                         MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    BOOST_REQUIRE(p != MAP_FAILED);
+    auto hint = reinterpret_cast<char*>
+                ((uintptr_t(p) + 2*1024*1024) / (2*1024*1024) * (2*1024*1024)
+                 + page);
+    BOOST_REQUIRE_EQUAL(0, ::munmap(p, sz));
+
+    ::unlink(s_filename);
+    {
+        persist_map_opts opts;
+        opts.map_address   = hint;
+        opts.max_grow_recs = 1000;
+
+        persist_type a;
+        BOOST_REQUIRE(a.init(s_filename, 10, opts));
+        BOOST_CHECK(hint == (const char*)&a.header_data());
+        for (long i = 0; i < 100; i++)
+            a.add(blob(i, i));
+        BOOST_CHECK(hint == (const char*)&a.header_data());
+        BOOST_CHECK_EQUAL(99, a[99].i2);
+
+        // The address is taken: the mapping elsewhere is released, and the
+        // one at the address is left intact
+        persist_type b;
+        BOOST_CHECK_THROW(b.init(s_filename, 10, opts), utxx::runtime_error);
+        BOOST_CHECK_EQUAL(99, a[99].i2);
+    }
+
+    // The whole reservation was unmapped
+    p = ::mmap(hint - page, 2*page, PROT_NONE,
+               MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+    BOOST_CHECK(p == hint - page);
+    if (p != MAP_FAILED)
+        ::munmap(p, 2*page);
+    ::unlink(s_filename);
+}
+
+//-----------------------------------------------------------------------------
+BOOST_AUTO_TEST_CASE( test_persist_array_grow_cross_process )
+{
+    static const long ITERATIONS =
+        getenv("ITERATIONS") ? atoi(getenv("ITERATIONS")) : 20000;
+    static const int  WRITERS    = 2;
+
+    persist_map_opts opts;
+    opts.max_grow_recs = ITERATIONS * WRITERS;
+
+    ::unlink(s_filename);
+    {
+        persist_type a;
+        BOOST_REQUIRE(a.init(s_filename, 100, opts));
+    }
+
+    // Writer processes grow the file concurrently
+    std::vector<pid_t> pids;
+    for (int w = 0; w < WRITERS; w++) {
+        pid_t pid = ::fork();
+        BOOST_REQUIRE(pid >= 0);
+        if (pid == 0) {
+            persist_type a;
+            a.init(s_filename, 100, opts);
+            for (long i = 0; i < ITERATIONS; i++)
+                a.add(blob(w+1, i+1));
+            ::_exit(0);
+        }
+        pids.push_back(pid);
+    }
+
+    for (auto pid : pids) {
+        int status;
+        BOOST_REQUIRE_EQUAL(pid, ::waitpid(pid, &status, 0));
+        BOOST_CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    }
+
+    persist_type r;
+    r.init(s_filename, 0, true);
+    BOOST_REQUIRE_EQUAL(size_t(ITERATIONS * WRITERS), r.count());
+    BOOST_CHECK_EQUAL  (size_t(ITERATIONS * WRITERS), r.capacity());
+
+    std::vector<long> l_stats(WRITERS);
+    for (size_t i=0; i < r.count(); i++) {
+        const blob& b = r[i];
+        BOOST_REQUIRE_EQUAL(l_stats[b.i1-1], b.i2-1);
+        l_stats[b.i1-1] = b.i2;
+    }
+    ::unlink(s_filename);
+}
+
+//-----------------------------------------------------------------------------
+BOOST_AUTO_TEST_CASE( test_persist_array_huge_pages )
+{
+    ::unlink(s_filename);
+    {
+        persist_map_opts opts;
+        opts.huge_pages    = persist_huge_pages::MADVISE;
+        opts.max_grow_recs = 100000;
+
+        persist_type a;
+        BOOST_REQUIRE(a.init(s_filename, 1000, opts));
+        for (long i = 0; i < 10000; i++)
+            a.add(blob(i, i));
+        BOOST_CHECK_EQUAL(16000u, a.capacity());
+        BOOST_CHECK_EQUAL(9999,   a[9999].i2);
+
+        // Not a hugetlbfs file
+        opts.huge_pages = persist_huge_pages::HUGETLBFS;
+        persist_type h;
+        BOOST_CHECK_THROW(h.init(s_filename, 1000, opts), utxx::runtime_error);
+    }
+    ::unlink(s_filename);
+
+    // Use hugetlbfs if it's mounted and has huge pages available
+    std::string   dir, line;
+    std::ifstream mounts("/proc/mounts");
+    while (dir.empty() && std::getline(mounts, line)) {
+        std::istringstream s(line);
+        std::string dev, path, type;
+        if (s >> dev >> path >> type && type == "hugetlbfs" &&
+            ::access(path.c_str(), W_OK) == 0)
+            dir = path;
+    }
+    std::ifstream meminfo("/proc/meminfo");
+    long free_pages = 0;
+    while (std::getline(meminfo, line))
+        if (sscanf(line.c_str(), "HugePages_Free: %ld", &free_pages) == 1)
+            break;
+
+    if (dir.empty() || free_pages < 2) {
+        BOOST_TEST_MESSAGE("No hugetlbfs with free huge pages, skipping");
+        return;
+    }
+
+    auto file = dir + "/utxx-test-persist-array.bin";
+    ::unlink(file.c_str());
+    {
+        persist_map_opts opts;
+        opts.huge_pages    = persist_huge_pages::HUGETLBFS;
+        opts.max_grow_recs = 2 * 2 * 1024 * 1024 / sizeof(blob);
+
+        persist_type a;
+        BOOST_REQUIRE(a.init(file.c_str(), 10, opts));
+        // The whole huge page is available
+        BOOST_CHECK_LT(10000u, a.capacity());
+        for (size_t i = 0, n = a.capacity() + 1; i < n; i++)
+            a.add(blob(long(i), 0));
+        BOOST_CHECK_EQUAL(long(a.count()-1), a[a.count()-1].i1);
+    }
+    ::unlink(file.c_str());
+}
+
+//-----------------------------------------------------------------------------
+BOOST_AUTO_TEST_CASE( test_persist_array_grow_perf )
+{
+    static const long ITERATIONS =
+        getenv("ITERATIONS") ? atoi(getenv("ITERATIONS")) : 1000000;
+
+    // Compare adding records to a preallocated and to a growing array (the
+    // first pass warms up the page cache)
+    double elapsed[3];
+    for (int i = 0; i < 3; i++) {
+        ::unlink(s_filename);
+        persist_map_opts opts;
+        opts.max_grow_recs = ITERATIONS;
+
+        persist_nolock_type a;
+        a.init(s_filename, i < 2 ? ITERATIONS : 1024, opts);
+        timer tm;
+        for (long j = 0; j < ITERATIONS; j++)
+            a.add(blob(j, j));
+        elapsed[i] = tm.elapsed();
+        BOOST_CHECK_EQUAL(size_t(ITERATIONS), a.count());
+    }
+    ::unlink(s_filename);
+
+    BOOST_TEST_MESSAGE("persist_array::add preallocated "
+                       << int(double(ITERATIONS) / elapsed[1] / 1000)
+                       << " Kops/s, growing "
+                       << int(double(ITERATIONS) / elapsed[2] / 1000)
+                       << " Kops/s");
+}
@@ -0,0 +1,310 @@
+//----------------------------------------------------------------------------
+/// \file  test_persist_journal.cpp
+//----------------------------------------------------------------------------
+/// \brief This is a test file for validating persist_journal.hpp
+//----------------------------------------------------------------------------
+// Copyright (c) 2026 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-16
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the utxx open-source project.
+
+Copyright (C) 2026 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+
+#include <boost/test/unit_test.hpp>
+#include <utxx/persist_journal.hpp>
+#include <utxx/time_val.hpp>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <thread>
+#include <vector>
+
+using namespace utxx;
+
+namespace {
+    const char* s_journal = "/tmp/test_persist_journal.bin";
+
+    struct event {
+        long    producer;
+        long    seqno;
+        char    data[48];
+    };
+
+    using journal_type = persist_journal<event>;
+
+    event make_event(long a_producer, long a_seqno) {
+        event e;
+        e.producer = a_producer;
+        e.seqno    = a_seqno;
+        memset(e.data, int('a' + a_seqno % 26), sizeof(e.data));
+        return e;
+    }
+
+    struct file_deleter {
+        file_deleter()  { ::unlink(s_journal); }
+        ~file_deleter() { ::unlink(s_journal); }
+    };
+}
+
+BOOST_AUTO_TEST_CASE( test_persist_journal_basic )
+{
+    file_deleter del;
+
+    {
+        journal_type j;
+        BOOST_REQUIRE(j.init(s_journal, 100));
+        BOOST_CHECK_EQUAL(0u,   j.count());
+        BOOST_CHECK_EQUAL(100u, j.capacity());
+
+        for (long i = 0; i < 10; i++)
+            BOOST_REQUIRE_EQUAL(size_t(i), j.append(make_event(1, i)));
+
+        auto id = j.append_with([](size_t a_id, event* e) {
+            *e = make_event(2, long(a_id));
+        });
+        BOOST_CHECK_EQUAL(10u, id);
+        BOOST_CHECK(j.state(id) == journal_state::COMMITTED);
+        BOOST_CHECK_EQUAL(2,   j.get(id)->producer);
+        BOOST_CHECK(!j.get(11));
+    }
+
+    // Reopen for writing: nothing to recover
+    journal_type j;
+    BOOST_REQUIRE(!j.init(s_journal, 100));
+    BOOST_CHECK_EQUAL(11u, j.count());
+
+    // Read-only journal learns its capacity from the file
+    journal_type r;
+    r.init_read_only(s_journal);
+    BOOST_CHECK_EQUAL(100u, r.capacity());
+
+    long n = 0;
+    auto next = r.read(0, [&](size_t a_id, const event& e) {
+        BOOST_CHECK_EQUAL(long(a_id), e.seqno);
+        BOOST_CHECK(e.data[0] == 'a' + e.seqno % 26);
+        ++n;
+    });
+    BOOST_CHECK_EQUAL(11u, next);
+    BOOST_CHECK_EQUAL(11,  n);
+
+    // Limited read
+    BOOST_CHECK_EQUAL(5u, r.read(2, [](size_t, const event&) {}, 3));
+
+    // Out of capacity
+    for (long i = 11; i < 100; i++)
+        j.append(make_event(1, i));
+    BOOST_CHECK_THROW(j.append(make_event(1, 100)), utxx::runtime_error);
+    BOOST_CHECK_EQUAL(100u, j.count());
+    BOOST_CHECK_EQUAL(100u, r.read(next, [](size_t, const event&) {}));
+
+    BOOST_CHECK_THROW(journal_type().init_read_only("/tmp/no-such-journal"),
+                      io_error);
+}
+
+BOOST_AUTO_TEST_CASE( test_persist_journal_reader_grow )
+{
+    file_deleter del;
+
+    persist_map_opts opts;
+    opts.max_grow_recs = 100000;
+
+    journal_type w;
+    BOOST_REQUIRE(w.init(s_journal, 10, opts));
+    w.append(make_event(1, 0));
+
+    // By default readers reserve address space for the journal to grow, so
+    // the records stay in place when the writer grows the file
+    journal_type r;
+    r.init_read_only(s_journal);
+    BOOST_CHECK_EQUAL(10u, r.capacity());
+    auto rec = r.get(0);
+    BOOST_REQUIRE(rec);
+
+    for (long i = 1; i < 1000; i++)
+        w.append(make_event(1, i));
+    BOOST_CHECK(w.capacity() >= 1000u);
+
+    long n = 0;
+    BOOST_CHECK_EQUAL(1000u, r.read(0, [&](size_t a_id, const event& e) {
+        BOOST_CHECK_EQUAL(long(a_id), e.seqno);
+        ++n;
+    }));
+    BOOST_CHECK_EQUAL(1000, n);
+    BOOST_CHECK(r.capacity() >= 1000u);
+    BOOST_CHECK_EQUAL(rec, r.get(0));
+}
+
+BOOST_AUTO_TEST_CASE( test_persist_journal_recovery )
+{
+    file_deleter del;
+
+    size_t torn;
+    {
+        journal_type j;
+        BOOST_REQUIRE(j.init(s_journal, 100));
+        j.append(make_event(1, 0));
+
+        // A writer reserved a record and "crashed" before committing it
+        auto p = j.reserve();
+        torn   = p.second;
+        *p.first = make_event(1, 1);
+
+        j.append(make_event(1, 2));
+
+        // Readers stop at the uncommitted record
+        BOOST_CHECK_EQUAL(torn, j.read(0, [](size_t, const event&) {}));
+
+        // Data of a committed record got corrupted by a system crash
+        const_cast<event*>(j.get(2))->data[5] = 'X';
+    }
+
+    journal_type j;
+    BOOST_REQUIRE(!j.init(s_journal, 100));
+    BOOST_CHECK(j.state(torn) == journal_state::SKIPPED);
+    BOOST_CHECK(j.state(2)    == journal_state::SKIPPED);
+    BOOST_CHECK_EQUAL(0u, j.recover());
+
+    // The crashed writer can't commit the skipped record any more
+    BOOST_CHECK(!j.commit(torn));
+
+    j.append(make_event(1, 3));
+
+    std::vector<long> seen;
+    auto next = j.read(0, [&](size_t, const event& e) {
+        seen.push_back(e.seqno);
+    });
+    BOOST_CHECK_EQUAL(4u, next);
+    BOOST_REQUIRE_EQUAL(2u, seen.size());
+    BOOST_CHECK_EQUAL(0, seen[0]);
+    BOOST_CHECK_EQUAL(3, seen[1]);
+}
+
+BOOST_AUTO_TEST_CASE( test_persist_journal_cross_process )
+{
+    static const long ITERATIONS =
+        getenv("ITERATIONS") ? atoi(getenv("ITERATIONS")) : 100000;
+    static const int  WRITERS    = 2;
+
+    // Recovery by a writer opening the journal may skip a record being
+    // written by another writer, which then appends it again
+    static const long CAPACITY   = ITERATIONS * WRITERS + 1000;
+
+    file_deleter del;
+    {
+        journal_type j;
+        BOOST_REQUIRE(j.init(s_journal, CAPACITY));
+    }
+
+    // Writer processes append concurrently while this process tails the file
+    std::vector<pid_t> pids;
+    for (int w = 0; w < WRITERS; w++) {
+        pid_t pid = ::fork();
+        BOOST_REQUIRE(pid >= 0);
+        if (pid == 0) {
+            journal_type j;
+            j.init(s_journal, CAPACITY);
+            for (long i = 0; i < ITERATIONS; i++)
+                j.append(make_event(w, i));
+            ::_exit(0);
+        }
+        pids.push_back(pid);
+    }
+
+    journal_type r;
+    r.init_read_only(s_journal);
+
+    std::vector<long> expect(WRITERS, 0);
+    long   errors = 0, total = 0;
+    size_t next   = 0;
+    timer  tm;
+
+    while (total < ITERATIONS * WRITERS && tm.elapsed() < 60) {
+        auto n = r.read(next, [&](size_t, const event& e) {
+            if (e.seqno != expect[e.producer]++)
+                ++errors;
+            ++total;
+        });
+        if (n == next)
+            std::this_thread::yield();
+        next = n;
+    }
+
+    for (auto pid : pids) {
+        int status;
+        BOOST_REQUIRE_EQUAL(pid, ::waitpid(pid, &status, 0));
+        BOOST_CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    }
+
+    BOOST_CHECK_EQUAL(ITERATIONS * WRITERS, total);
+    BOOST_CHECK_EQUAL(0, errors);
+    for (int w = 0; w < WRITERS; w++)
+        BOOST_CHECK_EQUAL(ITERATIONS, expect[w]);
+}
+
+BOOST_AUTO_TEST_CASE( test_persist_journal_perf )
+{
+    static const long ITERATIONS =
+        getenv("ITERATIONS") ? atoi(getenv("ITERATIONS")) : 1000000;
+
+    file_deleter del;
+
+    // Compare with records added to persist_array under its locks
+    using locked_type = persist_array<event>;
+    for (int threads : {1, 2}) {
+        double t1, t2;
+        {
+            journal_type j;
+            j.init(s_journal, ITERATIONS);
+            timer tm;
+            std::vector<std::thread> th;
+            for (int t = 0; t < threads; t++)
+                th.emplace_back([&, t] {
+                    for (long i = t; i < ITERATIONS; i += threads)
+                        j.append(make_event(t, i));
+                });
+            for (auto& t : th) t.join();
+            t1 = tm.elapsed();
+            BOOST_CHECK_EQUAL(size_t(ITERATIONS), j.count());
+        }
+        ::unlink(s_journal);
+        {
+            locked_type a;
+            a.init(s_journal, ITERATIONS);
+            timer tm;
+            std::vector<std::thread> th;
+            for (int t = 0; t < threads; t++)
+                th.emplace_back([&, t] {
+                    for (long i = t; i < ITERATIONS; i += threads)
+                        a.add(make_event(t, i));
+                });
+            for (auto& t : th) t.join();
+            t2 = tm.elapsed();
+        }
+        ::unlink(s_journal);
+
+        BOOST_TEST_MESSAGE(threads << " writer(s): persist_journal "
+                           << int(double(ITERATIONS) / t1 / 1000)
+                           << " Kops/s, persist_array::add "
+                           << int(double(ITERATIONS) / t2 / 1000)
+                           << " Kops/s");
+    }
+}
@@ -0,0 +1,802 @@
+// vim:ts=2:sw=2:et
+//------------------------------------------------------------------------------
+/// \file  test_reactor.cpp
+//------------------------------------------------------------------------------
+/// \brief Test cases for the utxx::io::Reactor running on every backend
+//------------------------------------------------------------------------------
+// Copyright (c) 2026 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-16
+//------------------------------------------------------------------------------
+#include <boost/test/unit_test.hpp>
+#include <utxx/io/Reactor.hpp>
+#include <utxx/io/ReactorGroup.hpp>
+#include <utxx/path.hpp>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <dirent.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <thread>
+#include <random>
+#include <chrono>
+
+using namespace utxx;
+using namespace utxx::io;
+
+namespace {
+  const BackendT s_backends[] = { BackendT::EPoll, BackendT::IOUring };
+
+  void on_error(FdInfo&, IOType, std::string const& a_err, src_info&&) {
+    BOOST_TEST_MESSAGE("reactor error: " << a_err);
+  }
+
+  /// Receives data into a std::string passed as the opaque pointer
+  int on_read(FdInfo& a_fi, dynamic_io_buffer& a_buf) {
+    auto s = static_cast<std::string*>(a_fi.Opaque());
+    s->append(a_buf.rd_ptr(), a_buf.size());
+    return a_buf.size();
+  }
+
+  /// Consumes data in 4-byte records
+  int on_read_rec(FdInfo& a_fi, dynamic_io_buffer& a_buf) {
+    auto n = static_cast<long*>(a_fi.Opaque());
+    auto c = a_buf.size() / 4;
+    *n    += c;
+    return c * 4;
+  }
+
+  /// Number of open file descriptors of this process
+  int open_fds() {
+    int  n = 0;
+    auto d = opendir("/proc/self/fd");
+    if (!d) return -1;
+    while (readdir(d)) ++n;
+    closedir(d);
+    return n;
+  }
+
+  /// Checks that a test case closes all file descriptors it opened
+  struct fd_leak_check {
+    int m_count = open_fds();
+    ~fd_leak_check() { BOOST_CHECK_EQUAL(m_count, open_fds()); }
+  };
+}
+
+BOOST_AUTO_TEST_CASE( test_reactor_event )
+{
+  fd_leak_check fd_check;
+
+  for (auto be : s_backends) {
+    BOOST_TEST_MESSAGE("Backend: " << be.to_string());
+    Reactor r("ev", 0, -1, 128, be);
+    // Falls back to epoll if io_uring features are missing
+    if (be == BackendT::IOUring && !IOUring::Supported())
+      BOOST_CHECK(BackendT::EPoll == r.Backend());
+    else
+      BOOST_CHECK(be == r.Backend());
+    BOOST_CHECK_EQUAL(r.Backend() == BackendT::EPoll, r.EPollFD() >= 0);
+    BOOST_CHECK(r.Ident().find("ev") != std::string::npos);
+
+    long    received = 0;
+    int     count    = 0;
+    FdInfo& fi       = r.AddEvent("event",
+      [&](FdInfo&, long a_val) { received += a_val; ++count; }, &on_error);
+
+    int efd = fi.FD();
+    BOOST_REQUIRE(efd >= 0);
+
+    for (int i=1; i <= 3; ++i) {
+      uint64_t v = 42;
+      BOOST_REQUIRE_EQUAL(8, ::write(efd, &v, sizeof(v)));
+      for (int j=0; j < 10 && count < i; ++j)
+        r.Wait(100);
+      BOOST_CHECK_EQUAL(i,    count);
+      BOOST_CHECK_EQUAL(42*i, received);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE( test_reactor_timer )
+{
+  fd_leak_check fd_check;
+
+  for (auto be : s_backends) {
+    BOOST_TEST_MESSAGE("Backend: " << be.to_string());
+    Reactor r("timer", 0, -1, 128, be);
+
+    int fired = 0;
+    r.AddTimer("timer", 10, 10, [&fired](FdInfo&, long) { fired++; }, &on_error);
+
+    for (int i=0; i < 100 && fired < 3; i++)
+      r.Wait(50);
+
+    BOOST_CHECK(fired >= 3);
+  }
+}
+
+BOOST_AUTO_TEST_CASE( test_reactor_timer_wheel )
+{
+  fd_leak_check fd_check;
+
+  TimerWheel w(10);
+  std::vector<std::pair<TimerID, uint64_t>> fired;
+  auto fire = [&](EventHandler const& a_fun, TimerID a_id) {
+    fired.emplace_back(a_id, w.Now());
+  };
+
+  // Expiration ticks crossing every level of the wheel
+  const uint64_t ticks[] = { 11, 265, 266, 267, 300, 65545, 65546, 70000,
+                             (1ul << 24) + 15, (1ul << 32) + 25 };
+  std::vector<TimerID> ids;
+  BOOST_CHECK_EQUAL(~0ul, w.NextExpiry());
+  for (auto t : ticks)
+    ids.push_back(w.Add(t, 0, nullptr));
+  BOOST_CHECK_EQUAL(10u, w.Size());
+  BOOST_CHECK_EQUAL(11u, w.NextExpiry());
+
+  // Advance in uneven steps
+  for (uint64_t t = 10; t < (1ul << 32) + 100; t += 1 + t / 7)
+    w.Advance(t, fire);
+  w.Advance((1ul << 32) + 100, fire);
+
+  BOOST_REQUIRE_EQUAL(10u, fired.size());
+  BOOST_CHECK_EQUAL(~0ul, w.NextExpiry());
+  for (size_t i=0; i < fired.size(); ++i) {
+    BOOST_CHECK_EQUAL(ids[i],   fired[i].first);
+    BOOST_CHECK_EQUAL(ticks[i], fired[i].second);
+  }
+  BOOST_CHECK_EQUAL(0u, w.Size());
+  BOOST_CHECK(!w.Cancel(ids[0]));
+
+  // Periodic, rescheduled and cancelled timers
+  fired.clear();
+  auto now = w.Now();
+  auto p   = w.Add(now + 5, 3, nullptr);
+  auto r   = w.Add(now + 5, 0, nullptr);
+  auto c   = w.Add(now + 5, 0, nullptr);
+  BOOST_CHECK(w.Reschedule(r, now + 1000, 0));
+  BOOST_CHECK(w.Cancel(c));
+  BOOST_CHECK(!w.Cancel(c));
+  BOOST_CHECK(!w.Active(c));
+  BOOST_CHECK(w.Active(p));
+  w.Advance(now + 14, fire);
+  BOOST_REQUIRE_EQUAL(4u, fired.size());
+  for (auto& f : fired)
+    BOOST_CHECK_EQUAL(p, f.first);
+  BOOST_CHECK_EQUAL(now + 14, fired.back().second);
+
+  // Periodic timer cancelling itself from the callback
+  fired.clear();
+  w.Advance(now + 20, [&](EventHandler const&, TimerID a_id) {
+    fired.emplace_back(a_id, w.Now());
+    w.Cancel(a_id);
+  });
+  BOOST_CHECK_EQUAL(1u, fired.size());
+  BOOST_CHECK(!w.Active(p));
+  BOOST_CHECK_EQUAL(1u, w.Size());
+
+  fired.clear();
+  w.Advance(now + 1000, fire);
+  BOOST_REQUIRE_EQUAL(1u, fired.size());
+  BOOST_CHECK_EQUAL(r, fired[0].first);
+  BOOST_CHECK_EQUAL(0u, w.Size());
+}
+
+BOOST_AUTO_TEST_CASE( test_reactor_timer_wheel_perf )
+{
+  fd_leak_check fd_check;
+
+  const size_t N = ::getenv("ITERATIONS") ? atoi(::getenv("ITERATIONS")) : 1000000;
+
+  TimerWheel           w(0, N);
+  std::vector<TimerID> ids(N);
+  std::mt19937         rnd(1);
+  size_t               fired = 0;
+  EventHandler         fun([&fired](FdInfo&, long) { ++fired; });
+
+  auto elapsed = [](auto a_start) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>
+           (std::chrono::steady_clock::now() - a_start).count();
+  };
+
+  // Heartbeat-like timers spread over 30s at 1ms resolution
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i=0; i < N; ++i)
+    ids[i] = w.Add(1 + rnd() % 30000, 0, fun);
+  auto add = elapsed(start);
+
+  start = std::chrono::steady_clock::now();
+  for (size_t i=0; i < N; i += 2)
+    w.Reschedule(ids[i], 1 + rnd() % 30000, 0);
+  auto resched = elapsed(start);
+
+  start = std::chrono::steady_clock::now();
+  for (size_t i=1; i < N; i += 4)
+    w.Cancel(ids[i]);
+  auto cancel = elapsed(start);
+
+  FdInfo fi;
+  start = std::chrono::steady_clock::now();
+  for (uint64_t t=1; t <= 30000; ++t)
+    w.Advance(t, [&fi](EventHandler const& a_fun, TimerID a_id) { a_fun(fi, a_id); });
+  auto advance = elapsed(start);
+
+  BOOST_CHECK_EQUAL(N - (N + 2) / 4, fired);
+  BOOST_CHECK_EQUAL(0u, w.Size());
+
+  BOOST_TEST_MESSAGE("TimerWheel with " << N << " timers (ns/op): add="
+                     << add / N << ", reschedule=" << resched / (N/2)
+                     << ", cancel=" << cancel / (N/4)
+                     << ", fire=" << advance / std::max<size_t>(1, fired));
+}
+
+BOOST_AUTO_TEST_CASE( test_reactor_schedule_timer )
+{
+  fd_leak_check fd_check;
+
+  for (auto be : s_backends) {
+    BOOST_TEST_MESSAGE("Backend: " << be.to_string());
+    Reactor r("wheel", 0, -1, 128, be);
+
+    int  once = 0, periodic = 0, cancelled = 0;
+    long once_id = 0;
+
+    auto id1 = r.ScheduleTimer(5, 0,
+      [&](FdInfo&, long a_id) { ++once; once_id = a_id; });
+    auto id2 = r.ScheduleTimer(1, 2, [&](FdInfo&, long) { ++periodic; });
+    auto id3 = r.ScheduleTimer(3, 0, [&](FdInfo&, long) { ++cancelled; });
+    BOOST_CHECK_EQUAL(3u, r.TimerCount());
+
+    BOOST_CHECK(r.CancelTimer(id3));
+    BOOST_CHECK(r.RescheduleTimer(id1, 10, 0));
+    BOOST_CHECK_EQUAL(2u, r.TimerCount());
+
+    for (int i=0; i < 100 && (!once || periodic < 5); ++i)
+      r.Wait(10);
+
+    BOOST_CHECK_EQUAL(1, once);
+    BOOST_CHECK_EQUAL(long(id1), once_id);
+    BOOST_CHECK(periodic >= 5);
+    BOOST_CHECK_EQUAL(0, cancelled);
+    BOOST_CHECK(!r.CancelTimer(id1));
+    BOOST_CHECK(r.CancelTimer(id2));
+    BOOST_CHECK_EQUAL(0u, r.TimerCount());
+
+    // The timerfd is only armed for the next expiration
+    r.ScheduleTimer(200, 0, [&](FdInfo&, long) { ++once; });
+    BOOST_CHECK_EQUAL(0, r.Wait(50));
+    for (int i=0; i < 100 && once < 2; ++i)
+      r.Wait(10);
+    BOOST_CHECK_EQUAL(2, once);
+  }
+}
+
+BOOST_AUTO_TEST_CASE( test_reactor_idle )
+{
+  fd_leak_check fd_check;
+
+  for (auto be : s_backends) {
+    Reactor r("idle", 0, -1, 128, be);
+
+    int idle = 0;
+    r.SetIdle([&idle]() { idle++; });
+    r.Wait(10);
+    BOOST_CHECK_EQUAL(1, idle);
+  }
+}
+
+BOOST_AUTO_TEST_CASE( test_reactor_spin )
+{
+  fd_leak_check fd_check;
+
+  for (auto be : s_backends) {
+    BOOST_TEST_MESSAGE("Backend: " << be.to_string());
+    Reactor r("spin", 0, -1, 128, be);
+
+    long    received = 0;
+    int     idle     = 0;
+    FdInfo& fi       = r.AddEvent("event",
+      [&](FdInfo&, long a_val) { received += a_val; }, &on_error);
+    r.SetIdle([&idle]() { ++idle; });
+
+    SpinOpts opts;
+    opts.spin_us  = 100;
+    opts.pause_us = 200;
+    opts.yield_us = 300;
+    r.SpinMode(true, opts);
+    BOOST_CHECK(r.SpinMode());
+
+    // Arm io_uring requests
+    r.Wait(0);
+    r.ClearSpinCounters();
+    idle = 0;
+
+    // Idle reactor backs off to a blocking wait
+    BOOST_CHECK_EQUAL(0, r.Wait(20));
+    auto& st = r.SpinCounters();
+    BOOST_CHECK(st.polls  > 1);
+    BOOST_CHECK_EQUAL(st.polls, st.empty);
+    BOOST_CHECK(st.pauses > 0);
+    BOOST_CHECK(st.yields > 0);
+    BOOST_CHECK_EQUAL(1u, st.blocks);
+    BOOST_CHECK(st.spin_ns  > 0);
+    BOOST_CHECK(st.block_ns > 0);
+    BOOST_CHECK(idle > 1);
+
+    std::thread t([&fi]() {
+      std::this_thread::sleep_for(std::chrono::milliseconds(5));
+      uint64_t v = 7;
+      BOOST_CHECK_EQUAL(8, ::write(fi.FD(), &v, sizeof(v)));
+    });
+
+    int n = 0;
+    for (int i=0; i < 10 && !n; ++i)
+      n = r.Wait(100);
+    t.join();
+
+    BOOST_CHECK_EQUAL(1, n);
+    BOOST_CHECK_EQUAL(7, received);
+    BOOST_CHECK_EQUAL(1u, st.events);
+    BOOST_CHECK(st.work_ns > 0 || st.block_ns > 0);
+
+    r.SpinMode(false);
+    BOOST_CHECK(!r.SpinMode());
+  }
+}
+
+BOOST_AUTO_TEST_CASE( test_reactor_stream_io )
+{
+  fd_leak_check fd_check;
+
+  for (auto be : s_backends) {
+    BOOST_TEST_MESSAGE("Backend: " << be.to_string());
+    Reactor r("io", 0, -1, 128, be);
+
+    int fds[2];
+    BOOST_REQUIRE_EQUAL(0, ::socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+    Blocking(fds[0], false);
+
+    std::string received;
+    bool        closed = false;
+    int         fd     = fds[0];
+
+    r.Add("sock", fd, &on_read, nullptr,
+          [&closed](FdInfo&, IOType, std::string const&, src_info&&) { closed = true; },
+          nullptr, &received, 128);
+
+    BOOST_REQUIRE_EQUAL(5, ::write(fds[1], "hello", 5));
+    for (int i=0; i < 10 && received.size() < 5; ++i)
+      r.Wait(100);
+    BOOST_CHECK_EQUAL("hello", received);
+
+    // Data larger than the read buffer
+    std::string big(64*1024, 'x');
+    for (size_t n = 0; n < big.size(); ) {
+      auto rc = ::write(fds[1], big.data() + n, big.size() - n);
+      if (rc > 0) n += rc;
+      r.Wait(0);
+    }
+    for (int i=0; i < 100 && received.size() < 5 + big.size(); ++i)
+      r.Wait(10);
+    BOOST_CHECK_EQUAL(5 + big.size(), received.size());
+
+    // Peer disconnect is reported to the error handler
+    ::close(fds[1]);
+    for (int i=0; i < 10 && !closed; ++i)
+      r.Wait(100);
+    BOOST_CHECK(closed);
+  }
+}
+
+BOOST_AUTO_TEST_CASE( test_reactor_wr_queue )
+{
+  fd_leak_check fd_check;
+
+  const int N  = 64;
+  const int SZ = 16*1024;
+
+  for (auto be : s_backends) {
+    Reactor r("wrq", 0, -1, 128, be);
+
+    int fds[2];
+    BOOST_REQUIRE_EQUAL(0, ::socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+    Blocking(fds[0], false);
+    Blocking(fds[1], false);
+
+    // Small send buffer forces partial writes
+    int sz = 32*1024;
+    BOOST_REQUIRE_EQUAL(0, ::setsockopt(fds[0], SOL_SOCKET, SO_SNDBUF, &sz, sizeof(sz)));
+
+    std::vector<bool> marks;
+    auto& fi = r.Add("sock", fds[0], &on_read, nullptr, &on_error, nullptr,
+                     nullptr, 128);
+    fi.EnableWrQueue(64*1024, 256*1024,
+                     [&marks](FdInfo&, bool a_high) { marks.push_back(a_high); });
+
+    std::vector<std::shared_ptr<std::string>> bufs;
+    std::string expected;
+    long        pending = 0;
+
+    for (int i=0; i < N; ++i) {
+      bufs.push_back(std::make_shared<std::string>(SZ, char('a' + i % 26)));
+      expected += *bufs.back();
+      pending   = fi.Send(bufs.back());
+      BOOST_REQUIRE(pending >= 0);
+    }
+
+    // Gather write of segments not owned by the queue
+    static const char s_hdr[] = "header", s_body[] = "body";
+    iovector vec;
+    vec.push_back(s_hdr,  sizeof(s_hdr)-1);
+    vec.push_back(s_body, sizeof(s_body)-1);
+    pending   = fi.Send(vec);
+    expected += "headerbody";
+
+    BOOST_CHECK(pending > 256*1024);
+    BOOST_CHECK_EQUAL(size_t(pending), fi.WriteQueue()->Bytes());
+    BOOST_REQUIRE_EQUAL(1u, marks.size());
+    BOOST_CHECK(marks[0]);
+
+    std::string received;
+    char        buf[64*1024];
+    for (int i=0; i < 10000 && received.size() < expected.size(); ++i) {
+      auto n = ::read(fds[1], buf, sizeof(buf));
+      if (n > 0)
+        received.append(buf, n);
+      r.Wait(1);
+    }
+
+    BOOST_CHECK(received == expected);
+    BOOST_CHECK(fi.WriteQueue()->Empty());
+    BOOST_REQUIRE_EQUAL(2u, marks.size());
+    BOOST_CHECK(!marks[1]);
+
+    // Written buffers are released by the queue
+    for (auto& b : bufs)
+      BOOST_CHECK_EQUAL(1, b.use_count());
+
+    // Data written while the queue is empty doesn't wait for write events
+    BOOST_CHECK_EQUAL(0, fi.Send(s_hdr, sizeof(s_hdr)-1));
+    BOOST_CHECK_EQUAL(long(sizeof(s_hdr)-1), ::read(fds[1], buf, sizeof(buf)));
+
+    ::close(fds[1]);
+  }
+}
+
+BOOST_AUTO_TEST_CASE( test_reactor_wr_queue_subscribe )
+{
+  fd_leak_check fd_check;
+
+  for (auto be : s_backends) {
+    Reactor r("wrqs", 0, -1, 128, be);
+
+    int fds[2];
+    BOOST_REQUIRE_EQUAL(0, ::socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+    Blocking(fds[0], false);
+    Blocking(fds[1], false);
+
+    int sz = 32*1024;
+    BOOST_REQUIRE_EQUAL(0, ::setsockopt(fds[0], SOL_SOCKET, SO_SNDBUF, &sz, sizeof(sz)));
+
+    auto  on_write = [](FdInfo&, dynamic_io_buffer&) { return 0; };
+    auto& fi       = r.Add("sock", fds[0], &on_read, on_write, &on_error, nullptr,
+                           nullptr, 128, 128);
+    fi.EnableWrQueue();
+
+    std::string expected(512*1024, 'x');
+    BOOST_REQUIRE(fi.Send(expected.data(), expected.size()) > 0);
+
+    // Unsubscribing the user from write events must not stall the queue
+    r.SubscribeWrite(fds[0], false);
+
+    std::string received;
+    char        buf[64*1024];
+    for (int i=0; i < 10000 && received.size() < expected.size(); ++i) {
+      auto n = ::read(fds[1], buf, sizeof(buf));
+      if (n > 0)
+        received.append(buf, n);
+      r.Wait(1);
+    }
+
+    BOOST_CHECK(received == expected);
+    BOOST_CHECK(fi.WriteQueue()->Empty());
+
+    ::close(fds[1]);
+  }
+}
+
+BOOST_AUTO_TEST_CASE( test_reactor_dgram_io )
+{
+  fd_leak_check fd_check;
+
+  const int N = 1000;
+
+  for (auto be : s_backends) {
+    Reactor r("dgram", 0, -1, 128, be);
+
+    int fds[2];
+    BOOST_REQUIRE_EQUAL(0, ::socketpair(AF_UNIX, SOCK_DGRAM, 0, fds));
+    Blocking(fds[0], false);
+    Blocking(fds[1], false);
+
+    long count = 0;
+    r.Add("dgram", fds[0], &on_read_rec, nullptr, &on_error, nullptr, &count, 4096);
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i=0, sent=0; count < N && i < 100*N; ++i) {
+      if (sent < N && ::send(fds[1], &sent, sizeof(sent), 0) == sizeof(sent))
+        ++sent;
+      r.Wait(0);
+    }
+    auto us = std::chrono::duration_cast<std::chrono::microseconds>
+              (std::chrono::steady_clock::now() - start).count();
+
+    BOOST_CHECK_EQUAL(N, count);
+    BOOST_TEST_MESSAGE("Backend " << be.to_string() << ": " << N
+                       << " datagrams in " << us << "us");
+    ::close(fds[1]);
+  }
+}
+
+BOOST_AUTO_TEST_CASE( test_reactor_dgram_batch )
+{
+  fd_leak_check fd_check;
+
+  const int N = 1000;
+
+  for (auto be : s_backends) {
+    Reactor r("batch", 0, -1, 128, be);
+
+    sockaddr_in addr{};
+    socklen_t   len = sizeof(addr);
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    int rx = ::socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+    int tx = ::socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+    BOOST_REQUIRE(rx >= 0 && tx >= 0);
+    BOOST_REQUIRE_EQUAL(0, ::bind(rx, (sockaddr*)&addr, sizeof(addr)));
+    BOOST_REQUIRE_EQUAL(0, ::getsockname(rx, (sockaddr*)&addr, &len));
+    BOOST_REQUIRE_EQUAL(0, ::connect(tx, (sockaddr*)&addr, sizeof(addr)));
+
+    sockaddr_in src{};
+    len = sizeof(src);
+    BOOST_REQUIRE_EQUAL(0, ::getsockname(tx, (sockaddr*)&src, &len));
+
+    int  count = 0, batches = 0, max_batch = 0, errors = 0;
+    auto& fi   = r.AddDgramBatch("batch", rx,
+      [&](FdInfo&, DgramSpan const& a_pkts) {
+        for (auto& pkt : a_pkts) {
+          int v;
+          memcpy(&v, pkt.data, sizeof(v));
+          if (pkt.len != sizeof(v) || v != count++ ||
+              pkt.src.sin_port     != src.sin_port ||
+              pkt.dst_addr         != htonl(INADDR_LOOPBACK) ||
+              pkt.ts_wire.empty())
+            ++errors;
+        }
+        ++batches;
+        max_batch = std::max<int>(max_batch, a_pkts.size());
+        return 0;
+      },
+      &on_error, nullptr, 32);
+
+    fi.EnableDgramPktInfo();
+    fi.EnablePktTimeStamps(true);
+
+    int            data[N];
+    DgramSendBatch out(64);
+    for (int sent = 0; sent < N; ) {
+      for (; sent < N && !out.Full(); ++sent) {
+        data[sent] = sent;
+        out.Add(&data[sent], sizeof(int));
+      }
+      // Datagrams that didn't fit the socket's send buffer remain queued
+      while (!out.Empty()) {
+        BOOST_REQUIRE(out.Send(tx) >= 0);
+        r.Wait(0);
+      }
+      for (int i=0; i < 10 && count < sent; ++i)
+        r.Wait(10);
+    }
+    for (int i=0; i < 10 && count < N; ++i)
+      r.Wait(10);
+
+    BOOST_CHECK_EQUAL(N, count);
+    BOOST_CHECK_EQUAL(0, errors);
+    BOOST_CHECK(max_batch > 1 && max_batch <= 32);
+    BOOST_TEST_MESSAGE("Backend " << be.to_string() << ": " << N
+                       << " datagrams in " << batches << " batches");
+    ::close(tx);
+  }
+}
+
+BOOST_AUTO_TEST_CASE( test_reactor_dgram_batch_error )
+{
+  fd_leak_check fd_check;
+
+  sockaddr_in addr{};
+  socklen_t   len = sizeof(addr);
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+  int rx = ::socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+  int tx = ::socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+  BOOST_REQUIRE(rx >= 0 && tx >= 0);
+  BOOST_REQUIRE_EQUAL(0, ::bind(rx, (sockaddr*)&addr, sizeof(addr)));
+  BOOST_REQUIRE_EQUAL(0, ::getsockname(rx, (sockaddr*)&addr, &len));
+  BOOST_REQUIRE_EQUAL(0, ::connect(tx, (sockaddr*)&addr, sizeof(addr)));
+
+  // The second datagram exceeds the UDP size limit, so sendmmsg() sends the
+  // first one and then fails with EMSGSIZE
+  int               one = 1, two = 2;
+  std::vector<char> big(70000);
+  DgramSendBatch    out(4);
+  out.Add(&one, sizeof(one));
+  out.Add(big.data(), big.size());
+  out.Add(&two, sizeof(two));
+
+  BOOST_CHECK_EQUAL(-1, out.Send(tx));
+  BOOST_CHECK_EQUAL(EMSGSIZE, errno);
+  BOOST_REQUIRE_EQUAL(2u, out.Size());
+
+  // Retrying must not resend the first datagram
+  BOOST_CHECK_EQUAL(-1, out.Send(tx));
+  BOOST_CHECK_EQUAL(2u, out.Size());
+
+  int v = 0;
+  BOOST_CHECK_EQUAL((int)sizeof(v), ::recv(rx, &v, sizeof(v), 0));
+  BOOST_CHECK_EQUAL(1, v);
+  BOOST_CHECK_EQUAL(-1, ::recv(rx, &v, sizeof(v), 0));
+
+  ::close(rx);
+  ::close(tx);
+}
+
+BOOST_AUTO_TEST_CASE( test_reactor_raw_io )
+{
+  fd_leak_check fd_check;
+
+  for (auto be : s_backends) {
+    Reactor r("raw", 0, -1, 128, be);
+
+    int fds[2];
+    BOOST_REQUIRE_EQUAL(0, ::pipe(fds));
+    Blocking(fds[0], false);
+
+    IOType observed = IOType::UNDEFINED;
+    r.Add("pipe", fds[0],
+          [&observed](FdInfo&, IOType a_type, uint32_t) { observed = a_type; },
+          &on_error, nullptr, EPOLLIN | EPOLLET);
+
+    BOOST_REQUIRE_EQUAL(1, ::write(fds[1], "x", 1));
+    for (int i=0; i < 10 && observed == IOType::UNDEFINED; ++i)
+      r.Wait(100);
+
+    BOOST_CHECK(observed == IOType::Read);
+    ::close(fds[1]);
+  }
+}
+
+BOOST_AUTO_TEST_CASE( test_reactor_uds_listener )
+{
+  fd_leak_check fd_check;
+
+  const char* path = "/tmp/test-reactor-uds.sock";
+
+  for (auto be : s_backends) {
+    Reactor r("uds", 0, -1, 128, be);
+
+    bool accepted = false;
+    r.AddUDSListener("uds", path,
+      [&accepted](FdInfo&, const char*, int) { accepted = true; return false; },
+      &on_error);
+
+    std::thread t([path]() {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+      sockaddr_un addr{};
+      addr.sun_family = AF_UNIX;
+      strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+      ::connect(fd, (sockaddr*)&addr, sizeof(addr));
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      ::close(fd);
+    });
+
+    for (int i=0; i < 20 && !accepted; i++)
+      r.Wait(50);
+
+    t.join();
+    BOOST_CHECK(accepted);
+  }
+
+  utxx::path::file_unlink(path);
+}
+
+BOOST_AUTO_TEST_CASE( test_reactor_group )
+{
+  fd_leak_check fd_check;
+
+  const int N = 20;
+
+  for (auto be : s_backends) {
+    BOOST_TEST_MESSAGE("Backend: " << be.to_string());
+    ReactorGroup g("grp", 2, {0}, be);
+    BOOST_REQUIRE_EQUAL(2u, g.Size());
+
+    std::atomic<int> accepted[2] = {{0}, {0}};
+    std::atomic<int> posted(0);
+    std::thread::id  ids[2];
+    int              cpu = -1;
+
+    g.Start(100);
+    BOOST_CHECK(g.Running());
+
+    // Tasks are executed by the threads of the reactors
+    for (int i=0; i < 2; ++i)
+      BOOST_CHECK(g.Post(i, [&, i]() {
+        ids[i] = std::this_thread::get_id();
+        if (i == 0) cpu = sched_getcpu();
+        ++posted;
+      }));
+    for (int i=0; i < 100 && posted < 2; ++i)
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+    BOOST_CHECK_EQUAL(2, posted);
+    BOOST_CHECK(ids[0] != ids[1]);
+    BOOST_CHECK(ids[0] != std::this_thread::get_id());
+    BOOST_CHECK_EQUAL(0, cpu);
+
+    // The listening port is shared by the reactors
+    int port = g.AddListener("tcp", "127.0.0.1", 0,
+      [&g, &accepted](FdInfo& a_fi, const char* a_cli, int) {
+        BOOST_CHECK(strncmp(a_cli, "127.0.0.1:", 10) == 0);
+        ++accepted[&a_fi.Owner() == &g[0] ? 0 : 1];
+        return false;
+      }, &on_error);
+    BOOST_REQUIRE(port > 0);
+
+    sockaddr_in addr{};
+    addr.sin_family      = AF_INET;
+    addr.sin_port        = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    for (int i=0; i < N; ++i) {
+      int fd = socket(AF_INET, SOCK_STREAM, 0);
+      BOOST_CHECK_EQUAL(0, ::connect(fd, (sockaddr*)&addr, sizeof(addr)));
+      ::close(fd);
+    }
+
+    for (int i=0; i < 100 && accepted[0] + accepted[1] < N; ++i)
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+    BOOST_CHECK_EQUAL(N, accepted[0] + accepted[1]);
+    BOOST_TEST_MESSAGE("Accepted connections: " << accepted[0] << '/' << accepted[1]);
+
+    // Listeners can be added by the thread of a reactor of the group
+    std::atomic<int> port2(0);
+    BOOST_CHECK(g.Post(0, [&]() {
+      port2 = g.AddListener("tcp2", "127.0.0.1", 0,
+                            [](FdInfo&, const char*, int) { return false; },
+                            &on_error);
+    }));
+    for (int i=0; i < 100 && !port2; ++i)
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    BOOST_CHECK(port2 > 0 && port2 != port);
+
+    // Reactors adding listeners at the same time don't wait for each other
+    std::atomic<int> ports[2] = {{0}, {0}};
+    for (int i=0; i < 2; ++i)
+      BOOST_CHECK(g.Post(i, [&, i]() {
+        ports[i] = g.AddListener(utxx::to_string("tcp-", i), "127.0.0.1", 0,
+                                 [](FdInfo&, const char*, int) { return false; },
+                                 &on_error);
+      }));
+    for (int i=0; i < 100 && !(ports[0] && ports[1]); ++i)
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    BOOST_CHECK(ports[0] > 0 && ports[1] > 0 && ports[0] != ports[1]);
+
+    g.Stop();
+    BOOST_CHECK(!g.Running());
+  }
+}
@@ -0,0 +1,298 @@
+#include <boost/test/unit_test.hpp>
+#include <utxx/sharded_atomic_hash_map.hpp>
+
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <string>
+#include <thread>
+
+namespace utxx {
+
+namespace {
+    size_t iterations() { return getenv("ITERATIONS") ? atoi(getenv("ITERATIONS")) : 0; }
+
+    struct DtorChecker {
+        static int numInstances;
+        long       value;
+        DtorChecker(long a = 0) : value(a) { ++numInstances; }
+        DtorChecker(const DtorChecker& a) : value(a.value) { ++numInstances; }
+        DtorChecker& operator=(const DtorChecker&) = default;
+        ~DtorChecker() { --numInstances; }
+    };
+
+    int DtorChecker::numInstances = 0;
+
+    typedef sharded_atomic_hash_map<long, long> map_type;
+
+    template <class Map = map_type>
+    typename Map::config make_config(uint32_t a_shards)
+    {
+        typename Map::config cfg;
+        cfg.m_shards = a_shards;
+        return cfg;
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_sharded_atomic_hash_map_basic )
+{
+    map_type m(100, make_config(3));    // Rounded up to 4 shards
+    BOOST_CHECK_EQUAL(4u, m.shards());
+    BOOST_CHECK(m.empty());
+
+    long v;
+    BOOST_CHECK(m.insert(10, 100));
+    BOOST_CHECK(m.insert(20, 200));
+    BOOST_CHECK(!m.insert(10, 101));    // Duplicate key
+    BOOST_CHECK_EQUAL(2u, m.size());
+
+    BOOST_CHECK(m.find(10, v));
+    BOOST_CHECK_EQUAL(100, v);
+    BOOST_CHECK(m.exists(20));
+    BOOST_CHECK(!m.exists(30));
+
+    BOOST_CHECK_EQUAL(1u, m.erase(10));
+    BOOST_CHECK_EQUAL(0u, m.erase(10));
+    BOOST_CHECK(!m.find(10, v));
+    BOOST_CHECK_EQUAL(1u, m.size());
+
+    // An erased key can be inserted again
+    BOOST_CHECK(m.insert(10, 102));
+    BOOST_CHECK(m.find(10, v));
+    BOOST_CHECK_EQUAL(102, v);
+
+    // Empty and erased keys are reserved
+    BOOST_CHECK_THROW(m.insert(-1, 0), badarg_error);
+    BOOST_CHECK_THROW(m.insert(-3, 0), badarg_error);
+    BOOST_CHECK(!m.exists(-1));
+
+    m.clear();
+    BOOST_CHECK(m.empty());
+    BOOST_CHECK(!m.exists(20));
+
+    map_type::config cfg;
+    cfg.m_max_load_factor = 1.0;
+    BOOST_CHECK_THROW(map_type(100, cfg), badarg_error);
+}
+
+BOOST_AUTO_TEST_CASE( test_sharded_atomic_hash_map_growth )
+{
+    map_type m(64, make_config(4));
+    auto cap = m.capacity();
+
+    const long n = 100000;
+    for (long i = 0; i < n; ++i)
+        BOOST_REQUIRE(m.insert(i, i * 2));
+
+    BOOST_CHECK_EQUAL(size_t(n), m.size());
+    BOOST_CHECK(m.capacity() >= size_t(n / m.cfg().m_max_load_factor) / 2);
+    BOOST_CHECK(m.capacity() >  cap * 100);
+    BOOST_CHECK(m.migrations() > 0u);
+
+    long v;
+    for (long i = 0; i < n; ++i) {
+        BOOST_REQUIRE(m.find(i, v));
+        BOOST_REQUIRE_EQUAL(i * 2, v);
+    }
+
+    for (long i = 0; i < n; i += 2)
+        BOOST_REQUIRE_EQUAL(1u, m.erase(i));
+    BOOST_CHECK_EQUAL(size_t(n / 2), m.size());
+    for (long i = 0; i < n; ++i)
+        BOOST_REQUIRE_EQUAL(i & 1, m.exists(i));
+}
+
+BOOST_AUTO_TEST_CASE( test_sharded_atomic_hash_map_compaction )
+{
+    // A sliding window of live keys: the erased cells get compacted, so the
+    // capacity is bounded by the number of live entries
+    map_type   m(1024, make_config(4));
+    const long window = 1000;
+    size_t     max_cap = 0;
+
+    for (long i = 0; i < 1000000; ++i) {
+        BOOST_REQUIRE(m.insert(i, i));
+        if (i >= window)
+            BOOST_REQUIRE_EQUAL(1u, m.erase(i - window));
+        max_cap = std::max(max_cap, m.capacity());
+    }
+
+    BOOST_CHECK_EQUAL(size_t(window), m.size());
+    BOOST_CHECK(max_cap <= 16 * size_t(window));
+    BOOST_CHECK(m.migrations() > 100u);
+    for (long i = 1000000 - window; i < 1000000; ++i)
+        BOOST_REQUIRE(m.exists(i));
+
+    // Values of migrated, erased and cleared entries are destroyed
+    {
+        typedef sharded_atomic_hash_map<long, DtorChecker> dmap;
+        dmap d(16, make_config<dmap>(2));
+        for (long i = 0; i < 10000; ++i) {
+            d.insert(i, DtorChecker(i));
+            if (i >= 100)
+                d.erase(i - 100);
+        }
+        BOOST_CHECK(DtorChecker::numInstances >= 100);
+        d.clear();
+        BOOST_CHECK_EQUAL(0, DtorChecker::numInstances);
+        for (long i = 0; i < 1000; ++i)
+            d.emplace(i, i);
+    }
+    BOOST_CHECK_EQUAL(0, DtorChecker::numInstances);
+}
+
+BOOST_AUTO_TEST_CASE( test_sharded_atomic_hash_map_concurrent )
+{
+    // The writer grows the map and erases most of the keys behind it, while
+    // the readers look up the keys that are never erased
+    map_type   m(64, make_config(4));
+    const long n      = 200000;
+    const long window = 5000;
+
+    std::atomic<long>     hi(0);
+    std::atomic<uint64_t> errors(0), lookups(0);
+
+    std::thread writer([&] {
+        for (long i = 0; i < n; ++i) {
+            m.insert(i, i * 3);
+            if (i >= window && ((i - window) & 15) != 0)
+                m.erase(i - window);
+            hi.store(i + 1, std::memory_order_release);
+            if ((i & 255) == 0)
+                std::this_thread::yield();
+        }
+    });
+
+    std::vector<std::thread> readers;
+    for (int r = 0; r < 3; ++r)
+        readers.emplace_back([&, r] {
+            std::mt19937_64 rnd(r);
+            uint64_t        errs = 0, cnt = 0;
+            long            v;
+            for (long h; (h = hi.load(std::memory_order_acquire)) < n; ++cnt) {
+                if (h < 16) { std::this_thread::yield(); continue; }
+                long k = long(rnd() % h) & ~15l;
+                if (!m.find(k, v) || v != k * 3)
+                    ++errs;
+                if ((cnt & 255) == 0)
+                    std::this_thread::yield();
+            }
+            errors  += errs;
+            lookups += cnt;
+        });
+
+    writer.join();
+    for (auto& t : readers)
+        t.join();
+
+    BOOST_CHECK_EQUAL(0u, errors.load());
+    BOOST_CHECK(m.migrations() > 0u);
+    BOOST_TEST_MESSAGE("Concurrent lookups: " << lookups.load()
+                       << ", migrations: " << m.migrations()
+                       << ", capacity: "   << m.capacity());
+}
+
+BOOST_AUTO_TEST_CASE( test_sharded_atomic_hash_map_concurrent_resize )
+{
+    // A few keys stay in a single shard for the whole test, while the writer
+    // churns other keys through it, forcing back-to-back migrations: a lookup
+    // of a present key must never miss while it is being migrated
+    map_type   m(16, make_config(1));
+    const long keys   = 64;
+    const long window = 32;
+
+    for (long i = 0; i < keys; ++i)
+        BOOST_REQUIRE(m.insert(i, i * 5));
+
+    std::atomic<bool>     done(false);
+    std::atomic<uint64_t> errors(0), lookups(0);
+
+    std::thread writer([&] {
+        for (long i = keys; i < keys + 1000000; ++i) {
+            m.insert(i, i);
+            if (i >= keys + window)
+                m.erase(i - window);
+        }
+        done.store(true, std::memory_order_release);
+    });
+
+    std::vector<std::thread> readers;
+    for (int r = 0; r < 3; ++r)
+        readers.emplace_back([&, r] {
+            uint64_t errs = 0, cnt = 0;
+            long     v;
+            for (long k = r; !done.load(std::memory_order_acquire); ++cnt) {
+                if (!m.find(k, v) || v != k * 5)
+                    ++errs;
+                k = (k + 1) % keys;
+            }
+            errors  += errs;
+            lookups += cnt;
+        });
+
+    writer.join();
+    for (auto& t : readers)
+        t.join();
+
+    BOOST_CHECK_EQUAL(0u, errors.load());
+    BOOST_CHECK(m.migrations() > 1000u);
+    BOOST_TEST_MESSAGE("Lookups during resizes: " << lookups.load()
+                       << ", migrations: " << m.migrations());
+}
+
+BOOST_AUTO_TEST_CASE( test_sharded_atomic_hash_map_churn_perf )
+{
+    // 24 "hours" of order ids: every hour N orders are inserted, each order
+    // is looked up a few times while it's live, and erased once it falls out
+    // of the window of live orders
+    auto       n      = iterations();
+    const long orders = n ? long(n) : 200000;
+    const long window = std::max(orders / 10, 1l);
+    const int  finds  = 4;
+
+    map_type        m(window);
+    std::mt19937_64 rnd(1);
+    long            id = 1, v = 0;
+    size_t          max_cap = 0;
+    uint64_t        total   = 0, misses = 0;
+    auto            start   = std::chrono::steady_clock::now();
+
+    for (int hour = 0; hour < 24; ++hour) {
+        auto t0 = std::chrono::steady_clock::now();
+
+        for (long i = 0; i < orders; ++i, ++id) {
+            m.insert(id, id);
+            auto live = std::min(id, window);
+            for (int j = 0; j < finds; ++j)
+                misses += !m.find(id - long(rnd() % live), v);
+            if (id > window)
+                m.erase(id - window);
+        }
+        max_cap = std::max(max_cap, m.capacity());
+
+        auto ops  = uint64_t(orders) * (2 + finds);
+        auto secs = std::chrono::duration<double>
+                    (std::chrono::steady_clock::now() - t0).count();
+        total    += ops;
+
+        if (hour % 6 == 5)
+            BOOST_TEST_MESSAGE("Hour " << (hour+1) << ": "
+                               << int(double(ops) / secs / 1e3) << " Kops/s"
+                               << ", size: "     << m.size()
+                               << ", capacity: " << m.capacity());
+    }
+
+    auto secs = std::chrono::duration<double>
+                (std::chrono::steady_clock::now() - start).count();
+
+    BOOST_CHECK_EQUAL(0u, misses);
+    BOOST_CHECK_EQUAL(size_t(window), m.size());
+    BOOST_CHECK(max_cap <= 16 * size_t(window) + 16 * m.shards());
+    BOOST_TEST_MESSAGE("Churn of " << 24 * orders << " orders: "
+                       << int(double(total) / secs / 1e3) << " Kops/s"
+                       << ", final capacity: " << m.capacity()
+                       << ", migrations: "     << m.migrations());
+}
+
+} // namespace utxx
@@ -34,6 +34,9 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include <utxx/unordered_map_with_ttl.hpp>
 #include <utxx/string.hpp>
 
+#include <chrono>
+#include <random>
+
 using namespace utxx;
 
 BOOST_AUTO_TEST_CASE( test_unordered_map_with_ttl )
@@ -55,3 +58,186 @@ BOOST_AUTO_TEST_CASE( test_unordered_map_with_ttl )
 }
 
 
+
+namespace {
+    size_t iterations() { return getenv("ITERATIONS") ? atoi(getenv("ITERATIONS")) : 0; }
+
+    struct DtorChecker {
+        static int numInstances;
+        DtorChecker() { ++numInstances; }
+        DtorChecker(const DtorChecker&) { ++numInstances; }
+        DtorChecker(DtorChecker&&) { ++numInstances; }
+        DtorChecker& operator=(const DtorChecker&) = default;
+        ~DtorChecker() { --numInstances; }
+    };
+
+    int DtorChecker::numInstances = 0;
+
+    // Updates the value and refreshes the TTL of an existing key
+    struct val_refresher {
+        bool operator()(val_node<int>& old, const int& val, uint64_t time)
+        {
+            old.value = val;
+            old.time  = time;
+            return true;
+        }
+    };
+
+    /// Feed a stream of sequence numbers, where every 4th one is a replay of
+    /// a recent one, through a dedup map, and time it
+    template <class Map>
+    void bench_dedup(const char* a_name, Map& a_map, long a_count)
+    {
+        long dups = 0;
+        auto t0   = std::chrono::steady_clock::now();
+        for (long i = 0, seq = 0; i < a_count; ++i) {
+            auto s = (i & 3) == 3 ? seq - 1 - (i & 255) % seq : seq++;
+            dups  += !a_map.try_add(s, int(i), uint64_t(i) + 1000000);
+        }
+        auto secs = std::chrono::duration<double>
+                    (std::chrono::steady_clock::now() - t0).count();
+        BOOST_CHECK_EQUAL(a_count / 4, dups);
+        BOOST_TEST_MESSAGE(a_name << ": " << int(double(a_count) / secs / 1e3)
+                           << " Kops/s, size: " << a_map.size());
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_compact_map_with_ttl )
+{
+    compact_map_with_ttl<int, int> map(1000, 4);
+    BOOST_CHECK_EQUAL(8u, map.capacity());
+
+    BOOST_REQUIRE(map.try_add(1, 123, 10000));
+    BOOST_REQUIRE(map.try_add(2, 234, 10000));
+    BOOST_REQUIRE_EQUAL(2u, map.size());
+    BOOST_REQUIRE(map.find(2));
+    BOOST_CHECK_EQUAL(234, map.find(2)->value);
+    BOOST_CHECK(!map.find(3));
+
+    BOOST_CHECK( map.try_add(1, 123, 11000));
+    BOOST_REQUIRE_EQUAL(1u, map.size());
+    BOOST_CHECK(!map.try_add(1, 123, 11500));
+    BOOST_REQUIRE_EQUAL(1u, map.size());
+    BOOST_REQUIRE_EQUAL(1u, map.refresh(12000));
+    BOOST_REQUIRE_EQUAL(0u, map.size());
+    BOOST_CHECK( map.try_add(1, 123, 12000));
+    BOOST_REQUIRE_EQUAL(1u, map.size());
+
+    BOOST_CHECK(map.erase(1));
+    BOOST_CHECK(!map.erase(1));
+    BOOST_CHECK(map.empty());
+
+    // The ring grows, and the erased entries are dropped on growth
+    for (int i = 0; i < 100; ++i) {
+        BOOST_REQUIRE(map.try_add(i, int(i), 13000));
+        if (i & 1)
+            BOOST_REQUIRE(map.erase(i));
+    }
+    BOOST_CHECK_EQUAL(50u, map.size());
+    BOOST_CHECK(map.capacity() >= 64u);
+    BOOST_CHECK(map.capacity() <= 128u);
+
+    int prev = -1, n = 0;
+    map.for_each([&](int k, val_node<int>& v) {
+        BOOST_REQUIRE_EQUAL(k, v.value);
+        BOOST_REQUIRE(k > prev);        // In the order of addition
+        prev = k;
+        ++n;
+    });
+    BOOST_CHECK_EQUAL(50, n);
+    for (int i = 0; i < 100; ++i)
+        BOOST_REQUIRE_EQUAL(!(i & 1), map.find(i) != nullptr);
+
+    map.clear();
+    BOOST_CHECK(map.empty());
+    BOOST_CHECK(!map.find(0));
+
+    BOOST_CHECK_THROW((compact_map_with_ttl<int, int>(1000, 0)), badarg_error);
+
+    // An updated key moves to the tail of the expiration ring
+    compact_map_with_ttl<int, int, std::hash<int>, std::equal_to<int>,
+                         val_refresher> upd(1000, 8);
+    BOOST_CHECK(upd.try_add(1, 1, 10000));
+    BOOST_CHECK(upd.try_add(2, 2, 10500));
+    BOOST_CHECK(upd.try_add(1, 3, 10800));
+    BOOST_CHECK_EQUAL(2u, upd.size());
+    BOOST_CHECK_EQUAL(1u, upd.refresh(11600));
+    BOOST_REQUIRE(upd.find(1));
+    BOOST_CHECK_EQUAL(3, upd.find(1)->value);
+    BOOST_CHECK_EQUAL(10800u, upd.find(1)->time);
+}
+
+BOOST_AUTO_TEST_CASE( test_compact_map_with_ttl_fixed )
+{
+    // The fixed-capacity map evicts the oldest entries when full
+    compact_map_with_ttl<long, int> map(1000000, 1024, true);
+
+    for (long i = 0; i < 10000; ++i)
+        BOOST_REQUIRE(map.try_add(i, int(i), 1000000 + i));
+
+    BOOST_CHECK_EQUAL(1024u, map.capacity());
+    BOOST_CHECK_EQUAL(1024u, map.size());
+    BOOST_CHECK_EQUAL(10000u - 1024, map.evicted());
+    for (long i = 0; i < 10000; ++i)
+        BOOST_REQUIRE_EQUAL(i >= 10000 - 1024, map.find(i) != nullptr);
+
+    // Erased entries make room for new ones without evictions
+    for (long i = 9000; i < 9100; ++i)
+        BOOST_REQUIRE(map.erase(i));
+    auto evicted = map.evicted();
+    for (long i = 20000; i < 20100; ++i)
+        BOOST_REQUIRE(map.try_add(i, int(i), 1020000));
+    BOOST_CHECK(map.evicted() - evicted <= 100u);
+    BOOST_CHECK_EQUAL(1024u, map.capacity());
+    for (long i = 20000; i < 20100; ++i)
+        BOOST_REQUIRE(map.find(i));
+
+    // Same results as of the unordered_map_with_ttl for random keys
+    compact_map_with_ttl<int, int>   c(500, 16);
+    unordered_map_with_ttl<int, int> u(500);
+    std::mt19937                     rnd(1);
+    uint64_t                         now = 1000;
+
+    for (int i = 0; i < 200000; ++i) {
+        now   += rnd() % 3;
+        int k  = rnd() % 1000;
+        BOOST_REQUIRE_EQUAL(u.try_add(k, int(i), now), c.try_add(k, int(i), now));
+        BOOST_REQUIRE_EQUAL(u.size(), c.size());
+    }
+    for (auto& v : u)
+        BOOST_REQUIRE_EQUAL(v.second.value, c.find(v.first)->value);
+    BOOST_CHECK(c.capacity() <= 2048u);
+
+    {
+        compact_map_with_ttl<int, DtorChecker> d(100, 64, true);
+        for (int i = 0; i < 1000; ++i) {
+            d.try_add(i, DtorChecker(), 1000 + i / 4);
+            if (i % 3 == 0)
+                d.erase(i);
+        }
+        BOOST_CHECK_EQUAL(int(d.size()), DtorChecker::numInstances);
+    }
+    BOOST_CHECK_EQUAL(0, DtorChecker::numInstances);
+}
+
+BOOST_AUTO_TEST_CASE( test_compact_map_with_ttl_perf )
+{
+    // Dedup of packet sequence numbers within a TTL window
+    auto n      = iterations();
+    long count  = n ? long(n) : 2000000;
+    long window = std::max(count / 8, 1024l);
+
+    {
+        unordered_map_with_ttl<long, int> m(window, size_t(window));
+        bench_dedup("unordered_map_with_ttl       ", m, count);
+    }
+    {
+        compact_map_with_ttl<long, int> m(window, 1024);
+        bench_dedup("compact_map_with_ttl (grow)  ", m, count);
+    }
+    {
+        compact_map_with_ttl<long, int> m(window, size_t(window) * 2, true);
+        bench_dedup("compact_map_with_ttl (fixed) ", m, count);
+        BOOST_CHECK_EQUAL(0u, m.evicted());
+    }
+}